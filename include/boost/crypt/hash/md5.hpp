@@ -17,10 +17,13 @@
 #include <boost/crypt/utility/cstddef.hpp>
 #include <boost/crypt/utility/iterator.hpp>
 #include <boost/crypt/utility/file.hpp>
+#include <boost/crypt/utility/sparse_file.hpp>
 
 #ifndef BOOST_CRYPT_BUILD_MODULE
 #include <memory>
+#include <new>
 #include <string>
+#include <system_error>
 #include <cstdint>
 #include <cstring>
 #endif
@@ -28,6 +31,14 @@
 namespace boost {
 namespace crypt {
 
+// The chaining values of a hasher after a whole number of blocks, and the number of bytes they cover,
+// from which hashing can be resumed later, such as once more has been appended to a file
+struct md5_state
+{
+    boost::crypt::array<boost::crypt::uint32_t, 4> chain;
+    boost::crypt::uint64_t byte_count;
+};
+
 class md5_hasher
 {
 private:
@@ -42,11 +53,21 @@ private:
     boost::crypt::array<boost::crypt::uint8_t, 64> buffer_ {};
     boost::crypt::array<boost::crypt::uint32_t, 16> blocks_ {};
 
+    BOOST_CRYPT_GPU_ENABLED constexpr auto md5_update_length(boost::crypt::size_t size) noexcept -> boost::crypt::size_t;
+
+    BOOST_CRYPT_GPU_ENABLED constexpr auto md5_total_bits() const noexcept -> boost::crypt::uint64_t;
+
+    template <typename ForwardIter>
+    BOOST_CRYPT_GPU_ENABLED constexpr auto md5_absorb(ForwardIter data, boost::crypt::size_t size, boost::crypt::size_t used) noexcept -> boost::crypt::size_t;
+
     template <typename ForwardIter>
     BOOST_CRYPT_GPU_ENABLED constexpr auto md5_update(ForwardIter data, boost::crypt::size_t size) noexcept;
 
     BOOST_CRYPT_GPU_ENABLED constexpr auto md5_convert_buffer_to_blocks() noexcept;
 
+    template <typename ForwardIter>
+    BOOST_CRYPT_GPU_ENABLED constexpr auto md5_convert_to_blocks(ForwardIter data) noexcept;
+
     template <typename ForwardIter>
     BOOST_CRYPT_GPU_ENABLED constexpr auto md5_copy_data(ForwardIter data, boost::crypt::size_t offset, boost::crypt::size_t size) noexcept;
 
@@ -68,7 +89,26 @@ public:
     template <typename ForwardIter, boost::crypt::enable_if_t<sizeof(typename utility::iterator_traits<ForwardIter>::value_type) == 4, bool> = true>
     BOOST_CRYPT_GPU_ENABLED constexpr auto process_bytes(ForwardIter buffer, boost::crypt::size_t byte_count) noexcept;
 
+    BOOST_CRYPT_GPU_ENABLED constexpr auto process_zero_bytes(boost::crypt::size_t byte_count) noexcept -> void;
+
+    #ifndef BOOST_CRYPT_HAS_CUDA
+
+    template <typename BufferSequence>
+    auto process_buffers(const BufferSequence& buffers) noexcept -> void;
+
+    #ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+    auto process_iovec(const struct iovec* iov, boost::crypt::size_t count) noexcept -> void;
+    #endif
+
+    #endif // BOOST_CRYPT_HAS_CUDA
+
     BOOST_CRYPT_GPU_ENABLED constexpr auto get_digest() noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>;
+
+    using state_type = md5_state;
+
+    BOOST_CRYPT_GPU_ENABLED constexpr auto get_state(md5_state& state) const noexcept -> bool;
+
+    BOOST_CRYPT_GPU_ENABLED constexpr auto set_state(const md5_state& state) noexcept -> bool;
 };
 
 BOOST_CRYPT_GPU_ENABLED constexpr auto md5_hasher::init() noexcept -> void
@@ -85,22 +125,30 @@ BOOST_CRYPT_GPU_ENABLED constexpr auto md5_hasher::init() noexcept -> void
     blocks_.fill(0U);
 }
 
-BOOST_CRYPT_GPU_ENABLED constexpr auto md5_hasher::md5_convert_buffer_to_blocks() noexcept
+// Reads a full 64-byte block straight from the input so that whole blocks
+// do not have to be staged through buffer_ first
+template <typename ForwardIter>
+BOOST_CRYPT_GPU_ENABLED constexpr auto md5_hasher::md5_convert_to_blocks(ForwardIter data) noexcept
 {
-    boost::crypt::size_t buffer_index {};
+    boost::crypt::size_t data_index {};
     for (auto& block : blocks_)
     {
         block = static_cast<boost::crypt::uint32_t>(
-                static_cast<boost::crypt::uint32_t>(buffer_[buffer_index]) |
-                (static_cast<boost::crypt::uint32_t>(buffer_[buffer_index + 1U]) << 8U) |
-                (static_cast<boost::crypt::uint32_t>(buffer_[buffer_index + 2U]) << 16U) |
-                (static_cast<boost::crypt::uint32_t>(buffer_[buffer_index + 3U]) << 24U)
+                static_cast<boost::crypt::uint32_t>(static_cast<boost::crypt::uint8_t>(*(data + static_cast<boost::crypt::ptrdiff_t>(data_index)))) |
+                (static_cast<boost::crypt::uint32_t>(static_cast<boost::crypt::uint8_t>(*(data + static_cast<boost::crypt::ptrdiff_t>(data_index + 1U)))) << 8U) |
+                (static_cast<boost::crypt::uint32_t>(static_cast<boost::crypt::uint8_t>(*(data + static_cast<boost::crypt::ptrdiff_t>(data_index + 2U)))) << 16U) |
+                (static_cast<boost::crypt::uint32_t>(static_cast<boost::crypt::uint8_t>(*(data + static_cast<boost::crypt::ptrdiff_t>(data_index + 3U)))) << 24U)
         );
 
-        buffer_index += 4U;
+        data_index += 4U;
     }
 }
 
+BOOST_CRYPT_GPU_ENABLED constexpr auto md5_hasher::md5_convert_buffer_to_blocks() noexcept
+{
+    md5_convert_to_blocks(buffer_.begin());
+}
+
 template <typename ForwardIter>
 BOOST_CRYPT_GPU_ENABLED constexpr auto md5_hasher::md5_copy_data(ForwardIter data, boost::crypt::size_t offset, boost::crypt::size_t size) noexcept
 {
@@ -111,8 +159,8 @@ BOOST_CRYPT_GPU_ENABLED constexpr auto md5_hasher::md5_copy_data(ForwardIter dat
     }
 }
 
-template <typename ForwardIter>
-BOOST_CRYPT_GPU_ENABLED constexpr auto md5_hasher::md5_update(ForwardIter data, boost::crypt::size_t size) noexcept
+// Adds size bytes to the message length, and returns the number of bytes that were already in buffer_
+BOOST_CRYPT_GPU_ENABLED constexpr auto md5_hasher::md5_update_length(boost::crypt::size_t size) noexcept -> boost::crypt::size_t
 {
     const auto input_bits {size << 3U}; // Convert size to bits
     const auto old_low {low_};
@@ -122,17 +170,36 @@ BOOST_CRYPT_GPU_ENABLED constexpr auto md5_hasher::md5_update(ForwardIter data,
         // This should never happen as it indicates size_t roll over
         ++high_; // LCOV_EXCL_LINE
     }
-    high_ += size >> 29U;
 
-    auto used {(old_low >> 3U) & 0x3F}; // Number of bytes used in buffer
+    // A 32-bit low_ loses the top three bits of size << 3, which go into high_.
+    // A 64-bit one keeps them, so high_ only takes the carry out of low_
+    if (sizeof(boost::crypt::size_t) <= 4U)
+    {
+        high_ += static_cast<boost::crypt::size_t>(static_cast<boost::crypt::uint64_t>(size) >> 29U);
+    }
+
+    return (old_low >> 3U) & 0x3F;
+}
 
+// The message length in bits, modulo 2^64 as the padding stores it
+BOOST_CRYPT_GPU_ENABLED constexpr auto md5_hasher::md5_total_bits() const noexcept -> boost::crypt::uint64_t
+{
+    return sizeof(boost::crypt::size_t) > 4U ? static_cast<boost::crypt::uint64_t>(low_) :
+                                               (static_cast<boost::crypt::uint64_t>(high_) << 32U) | low_;
+}
+
+// Compresses whole blocks straight from data, only staging bytes through buffer_ to complete
+// the used bytes already there or to hold the tail. Returns the number of bytes now used in buffer_
+template <typename ForwardIter>
+BOOST_CRYPT_GPU_ENABLED constexpr auto md5_hasher::md5_absorb(ForwardIter data, boost::crypt::size_t size, boost::crypt::size_t used) noexcept -> boost::crypt::size_t
+{
     if (used)
     {
         auto available = 64U - used;
         if (size < available)
         {
             md5_copy_data(data, used, size);
-            return;
+            return used + size;
         }
 
         md5_copy_data(data, used, available);
@@ -144,8 +211,7 @@ BOOST_CRYPT_GPU_ENABLED constexpr auto md5_hasher::md5_update(ForwardIter data,
 
     while (size >= 64U)
     {
-        md5_copy_data(data, 0U, 64U);
-        md5_convert_buffer_to_blocks();
+        md5_convert_to_blocks(data);
         md5_body();
         data += 64U;
         size -= 64U;
@@ -155,6 +221,53 @@ BOOST_CRYPT_GPU_ENABLED constexpr auto md5_hasher::md5_update(ForwardIter data,
     {
         md5_copy_data(data, 0U, size);
     }
+
+    return size;
+}
+
+template <typename ForwardIter>
+BOOST_CRYPT_GPU_ENABLED constexpr auto md5_hasher::md5_update(ForwardIter data, boost::crypt::size_t size) noexcept
+{
+    const auto used {md5_update_length(size)}; // Number of bytes used in buffer
+    static_cast<void>(md5_absorb(data, size, used));
+}
+
+// Equivalent to process_bytes with byte_count zero bytes, without needing a buffer of zeros.
+// The message words of a zero block are all zero, so blocks_ is cleared once
+// and each whole block is just a run of the compression function
+BOOST_CRYPT_GPU_ENABLED constexpr auto md5_hasher::process_zero_bytes(boost::crypt::size_t byte_count) noexcept -> void
+{
+    auto used {md5_update_length(byte_count)};
+
+    if (used)
+    {
+        const auto available {64U - used};
+        if (byte_count < available)
+        {
+            fill_array(buffer_.begin() + used, buffer_.begin() + used + byte_count, static_cast<boost::crypt::uint8_t>(0));
+            return;
+        }
+
+        fill_array(buffer_.begin() + used, buffer_.end(), static_cast<boost::crypt::uint8_t>(0));
+        md5_convert_buffer_to_blocks();
+        md5_body();
+        byte_count -= available;
+    }
+
+    if (byte_count >= 64U)
+    {
+        blocks_.fill(0U);
+        do
+        {
+            md5_body();
+            byte_count -= 64U;
+        } while (byte_count >= 64U);
+    }
+
+    if (byte_count > 0U)
+    {
+        fill_array(buffer_.begin(), buffer_.begin() + byte_count, static_cast<boost::crypt::uint8_t>(0));
+    }
 }
 
 BOOST_CRYPT_GPU_ENABLED constexpr auto md5_hasher::get_digest() noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
@@ -177,7 +290,7 @@ BOOST_CRYPT_GPU_ENABLED constexpr auto md5_hasher::get_digest() noexcept -> boos
         fill_array(buffer_.begin() + used, buffer_.end() - 8, static_cast<boost::crypt::uint8_t>(0));
     }
 
-    const auto total_bits {(static_cast<uint64_t>(high_) << 32) | low_};
+    const auto total_bits {md5_total_bits()};
 
     // Append the length in bits as a 64-bit little-endian integer
     buffer_[56] = static_cast<boost::crypt::uint8_t>(total_bits & 0xFF);
@@ -204,6 +317,49 @@ BOOST_CRYPT_GPU_ENABLED constexpr auto md5_hasher::get_digest() noexcept -> boos
     return digest;
 }
 
+// Fills in the state and returns true if the bytes processed so far are a whole number of 64-byte blocks.
+// Otherwise the last block is incomplete, its bytes are only held in the buffer, and false is returned
+BOOST_CRYPT_GPU_ENABLED constexpr auto md5_hasher::get_state(md5_state& state) const noexcept -> bool
+{
+    const auto total_bits {md5_total_bits()};
+    if ((total_bits & 0x1FFU) != 0U)
+    {
+        return false;
+    }
+
+    state.chain[0] = a0_;
+    state.chain[1] = b0_;
+    state.chain[2] = c0_;
+    state.chain[3] = d0_;
+    state.byte_count = total_bits >> 3U;
+
+    return true;
+}
+
+// Continues from a state saved by get_state, as if the same byte_count bytes had been processed again.
+// Returns false, and leaves the hasher as it was, if byte_count is not a whole number of blocks
+BOOST_CRYPT_GPU_ENABLED constexpr auto md5_hasher::set_state(const md5_state& state) noexcept -> bool
+{
+    if ((state.byte_count & 0x3FU) != 0U)
+    {
+        return false;
+    }
+
+    init();
+    a0_ = state.chain[0];
+    b0_ = state.chain[1];
+    c0_ = state.chain[2];
+    d0_ = state.chain[3];
+
+    // A 64-bit size_t holds the whole bit count in low_, as md5_update_length leaves it when fed in pieces,
+    // and a 32-bit one carries into high_
+    const auto total_bits {state.byte_count << 3U};
+    low_ = static_cast<boost::crypt::size_t>(total_bits);
+    high_ = sizeof(boost::crypt::size_t) > 4U ? 0U : static_cast<boost::crypt::size_t>(total_bits >> 32U);
+
+    return true;
+}
+
 template <typename ByteType>
 BOOST_CRYPT_GPU_ENABLED constexpr auto md5_hasher::process_byte(ByteType byte) noexcept
     BOOST_CRYPT_REQUIRES_CONVERSION(ByteType, boost::crypt::uint8_t)
@@ -252,6 +408,50 @@ BOOST_CRYPT_GPU_ENABLED constexpr auto md5_hasher::process_bytes(ForwardIter buf
     #endif
 }
 
+#ifndef BOOST_CRYPT_HAS_CUDA
+
+// Hashes a sequence of segments, such as a std::vector<std::string_view> or an Asio buffer sequence,
+// as if they were one contiguous message. Each element needs data() and size() in bytes.
+// Whole blocks are compressed straight from each segment, and only blocks that straddle two segments are stitched together
+template <typename BufferSequence>
+auto md5_hasher::process_buffers(const BufferSequence& buffers) noexcept -> void
+{
+    boost::crypt::size_t total {};
+    for (const auto& segment : buffers)
+    {
+        total += static_cast<boost::crypt::size_t>(segment.size());
+    }
+
+    auto used {md5_update_length(total)};
+    for (const auto& segment : buffers)
+    {
+        const auto* data {static_cast<const boost::crypt::uint8_t*>(static_cast<const void*>(segment.data()))};
+        used = md5_absorb(data, static_cast<boost::crypt::size_t>(segment.size()), used);
+    }
+}
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+// Hashes the count segments of an iovec array, as gathered by readv(2) or received from the network
+inline auto md5_hasher::process_iovec(const struct iovec* iov, boost::crypt::size_t count) noexcept -> void
+{
+    boost::crypt::size_t total {};
+    for (boost::crypt::size_t i {}; i < count; ++i)
+    {
+        total += iov[i].iov_len;
+    }
+
+    auto used {md5_update_length(total)};
+    for (boost::crypt::size_t i {}; i < count; ++i)
+    {
+        used = md5_absorb(static_cast<const boost::crypt::uint8_t*>(iov[i].iov_base), iov[i].iov_len, used);
+    }
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#endif // BOOST_CRYPT_HAS_CUDA
+
 // See: Applied Cryptography - Bruce Schneier
 // Section 18.5
 namespace md5_body_detail {
@@ -573,12 +773,262 @@ inline auto md5(std::wstring_view str) -> boost::crypt::array<boost::crypt::uint
 
 #endif // BOOST_CRYPT_HAS_STRING_VIEW
 
+// ---- Many short messages at once -----
+
+namespace detail {
+
+// MD5 is one long chain of dependent additions, so hashing a single short message leaves most of the core idle.
+// Running each step on several messages at once fills it, and the loops over the lanes are simple enough
+// for the compiler to turn into vector instructions
+BOOST_CRYPT_INLINE_CONSTEXPR std::size_t md5_lane_count {4U};
+
+// Messages at least this long are hashed on their own, so that one of them does not leave the other lanes idle
+BOOST_CRYPT_INLINE_CONSTEXPR std::size_t md5_lane_max_size {1024U};
+
+using md5_lane_words = boost::crypt::uint32_t[md5_lane_count];
+
+template <int Round, boost::crypt::uint32_t Shift>
+inline auto md5_lane_step(md5_lane_words& a, const md5_lane_words& b, const md5_lane_words& c, const md5_lane_words& d,
+                          const md5_lane_words& m, boost::crypt::uint32_t t) noexcept -> void
+{
+    using namespace md5_body_detail;
+
+    for (std::size_t i {}; i < md5_lane_count; ++i)
+    {
+        const auto f {Round == 0 ? F(b[i], c[i], d[i]) : Round == 1 ? G(b[i], c[i], d[i]) : Round == 2 ? H(b[i], c[i], d[i]) : I(b[i], c[i], d[i])};
+        const auto x {a[i] + f + m[i] + t};
+        a[i] = b[i] + ((x << Shift) | (x >> (32U - Shift)));
+    }
+}
+
+// The same steps as md5_hasher::md5_body, on one block of each lane
+inline auto md5_lane_body(md5_lane_words (&state)[4], const md5_lane_words (&m)[16]) noexcept -> void
+{
+    md5_lane_words a {};
+    md5_lane_words b {};
+    md5_lane_words c {};
+    md5_lane_words d {};
+    std::memcpy(a, state[0], sizeof(a));
+    std::memcpy(b, state[1], sizeof(b));
+    std::memcpy(c, state[2], sizeof(c));
+    std::memcpy(d, state[3], sizeof(d));
+
+    // Round 1
+    md5_lane_step<0, 7>(a, b, c, d, m[0], 0xd76aa478);
+    md5_lane_step<0, 12>(d, a, b, c, m[1], 0xe8c7b756);
+    md5_lane_step<0, 17>(c, d, a, b, m[2], 0x242070db);
+    md5_lane_step<0, 22>(b, c, d, a, m[3], 0xc1bdceee);
+    md5_lane_step<0, 7>(a, b, c, d, m[4], 0xf57c0faf);
+    md5_lane_step<0, 12>(d, a, b, c, m[5], 0x4787c62a);
+    md5_lane_step<0, 17>(c, d, a, b, m[6], 0xa8304613);
+    md5_lane_step<0, 22>(b, c, d, a, m[7], 0xfd469501);
+    md5_lane_step<0, 7>(a, b, c, d, m[8], 0x698098d8);
+    md5_lane_step<0, 12>(d, a, b, c, m[9], 0x8b44f7af);
+    md5_lane_step<0, 17>(c, d, a, b, m[10], 0xffff5bb1);
+    md5_lane_step<0, 22>(b, c, d, a, m[11], 0x895cd7be);
+    md5_lane_step<0, 7>(a, b, c, d, m[12], 0x6b901122);
+    md5_lane_step<0, 12>(d, a, b, c, m[13], 0xfd987193);
+    md5_lane_step<0, 17>(c, d, a, b, m[14], 0xa679438e);
+    md5_lane_step<0, 22>(b, c, d, a, m[15], 0x49b40821);
+
+    // Round 2
+    md5_lane_step<1, 5>(a, b, c, d, m[1], 0xf61e2562);
+    md5_lane_step<1, 9>(d, a, b, c, m[6], 0xc040b340);
+    md5_lane_step<1, 14>(c, d, a, b, m[11], 0x265e5a51);
+    md5_lane_step<1, 20>(b, c, d, a, m[0], 0xe9b6c7aa);
+    md5_lane_step<1, 5>(a, b, c, d, m[5], 0xd62f105d);
+    md5_lane_step<1, 9>(d, a, b, c, m[10], 0x02441453);
+    md5_lane_step<1, 14>(c, d, a, b, m[15], 0xd8a1e681);
+    md5_lane_step<1, 20>(b, c, d, a, m[4], 0xe7d3fbc8);
+    md5_lane_step<1, 5>(a, b, c, d, m[9], 0x21e1cde6);
+    md5_lane_step<1, 9>(d, a, b, c, m[14], 0xc33707d6);
+    md5_lane_step<1, 14>(c, d, a, b, m[3], 0xf4d50d87);
+    md5_lane_step<1, 20>(b, c, d, a, m[8], 0x455a14ed);
+    md5_lane_step<1, 5>(a, b, c, d, m[13], 0xa9e3e905);
+    md5_lane_step<1, 9>(d, a, b, c, m[2], 0xfcefa3f8);
+    md5_lane_step<1, 14>(c, d, a, b, m[7], 0x676f02d9);
+    md5_lane_step<1, 20>(b, c, d, a, m[12], 0x8d2a4c8a);
+
+    // Round 3
+    md5_lane_step<2, 4>(a, b, c, d, m[5], 0xfffa3942);
+    md5_lane_step<2, 11>(d, a, b, c, m[8], 0x8771f681);
+    md5_lane_step<2, 16>(c, d, a, b, m[11], 0x6d9d6122);
+    md5_lane_step<2, 23>(b, c, d, a, m[14], 0xfde5380c);
+    md5_lane_step<2, 4>(a, b, c, d, m[1], 0xa4beea44);
+    md5_lane_step<2, 11>(d, a, b, c, m[4], 0x4bdecfa9);
+    md5_lane_step<2, 16>(c, d, a, b, m[7], 0xf6bb4b60);
+    md5_lane_step<2, 23>(b, c, d, a, m[10], 0xbebfbc70);
+    md5_lane_step<2, 4>(a, b, c, d, m[13], 0x289b7ec6);
+    md5_lane_step<2, 11>(d, a, b, c, m[0], 0xeaa127fa);
+    md5_lane_step<2, 16>(c, d, a, b, m[3], 0xd4ef3085);
+    md5_lane_step<2, 23>(b, c, d, a, m[6], 0x04881d05);
+    md5_lane_step<2, 4>(a, b, c, d, m[9], 0xd9d4d039);
+    md5_lane_step<2, 11>(d, a, b, c, m[12], 0xe6db99e5);
+    md5_lane_step<2, 16>(c, d, a, b, m[15], 0x1fa27cf8);
+    md5_lane_step<2, 23>(b, c, d, a, m[2], 0xc4ac5665);
+
+    // Round 4
+    md5_lane_step<3, 6>(a, b, c, d, m[0], 0xf4292244);
+    md5_lane_step<3, 10>(d, a, b, c, m[7], 0x432aff97);
+    md5_lane_step<3, 15>(c, d, a, b, m[14], 0xab9423a7);
+    md5_lane_step<3, 21>(b, c, d, a, m[5], 0xfc93a039);
+    md5_lane_step<3, 6>(a, b, c, d, m[12], 0x655b59c3);
+    md5_lane_step<3, 10>(d, a, b, c, m[3], 0x8f0ccc92);
+    md5_lane_step<3, 15>(c, d, a, b, m[10], 0xffeff47d);
+    md5_lane_step<3, 21>(b, c, d, a, m[1], 0x85845dd1);
+    md5_lane_step<3, 6>(a, b, c, d, m[8], 0x6fa87e4f);
+    md5_lane_step<3, 10>(d, a, b, c, m[15], 0xfe2ce6e0);
+    md5_lane_step<3, 15>(c, d, a, b, m[6], 0xa3014314);
+    md5_lane_step<3, 21>(b, c, d, a, m[13], 0x4e0811a1);
+    md5_lane_step<3, 6>(a, b, c, d, m[4], 0xf7537e82);
+    md5_lane_step<3, 10>(d, a, b, c, m[11], 0xbd3af235);
+    md5_lane_step<3, 15>(c, d, a, b, m[2], 0x2ad7d2bb);
+    md5_lane_step<3, 21>(b, c, d, a, m[9], 0xeb86d391);
+
+    for (std::size_t i {}; i < md5_lane_count; ++i)
+    {
+        state[0][i] += a[i];
+        state[1][i] += b[i];
+        state[2][i] += c[i];
+        state[3][i] += d[i];
+    }
+}
+
+// The message in one lane: its whole blocks are read in place, and only the last partial block is copied to add the padding
+struct md5_lane
+{
+    const std::uint8_t* data;
+    std::size_t blocks;
+    std::size_t tail_blocks;
+    std::size_t tail_used;
+    std::size_t message;
+    std::uint8_t tail[128];
+};
+
+inline auto md5_lane_load(md5_lane& lane, const std::uint8_t* data, std::size_t size, std::size_t message) noexcept -> void
+{
+    lane.data = data;
+    lane.blocks = size / 64U;
+    lane.tail_used = 0U;
+    lane.message = message;
+
+    const auto rest {size % 64U};
+    lane.tail_blocks = rest < 56U ? 1U : 2U;
+    std::memset(lane.tail, 0, sizeof(lane.tail));
+    if (rest != 0U)
+    {
+        std::memcpy(lane.tail, data + lane.blocks * 64U, rest);
+    }
+    lane.tail[rest] = 0x80U;
+
+    const auto bits {static_cast<std::uint64_t>(size) << 3U};
+    for (std::size_t i {}; i < 8U; ++i)
+    {
+        lane.tail[lane.tail_blocks * 64U - 8U + i] = static_cast<std::uint8_t>(bits >> (8U * i));
+    }
+}
+
+} // namespace detail
+
+// Hashes count separate messages, writing the digest of the sizes[i] bytes at data[i] to digests[i].
+// Short messages, such as the lines or records of a file, are hashed several at a time, which is faster than one after another
+inline auto md5_messages(const std::uint8_t* const* data, const std::size_t* sizes, std::size_t count,
+                         boost::crypt::array<boost::crypt::uint8_t, 16>* digests) noexcept -> void
+{
+    detail::md5_lane lanes[detail::md5_lane_count];
+    detail::md5_lane_words state[4] {};
+    detail::md5_lane_words m[16] {};
+
+    std::size_t next {};
+    std::size_t active {};
+    const auto start = [&](std::size_t i) {
+        while (next < count && sizes[next] >= detail::md5_lane_max_size)
+        {
+            md5_hasher hasher;
+            hasher.process_bytes(data[next], sizes[next]);
+            digests[next] = hasher.get_digest();
+            ++next;
+        }
+
+        if (next == count)
+        {
+            lanes[i].message = count;
+            return;
+        }
+
+        detail::md5_lane_load(lanes[i], data[next], sizes[next], next);
+        state[0][i] = 0x67452301U;
+        state[1][i] = 0xefcdab89U;
+        state[2][i] = 0x98badcfeU;
+        state[3][i] = 0x10325476U;
+        ++next;
+        ++active;
+    };
+
+    for (std::size_t i {}; i < detail::md5_lane_count; ++i)
+    {
+        std::memset(lanes[i].tail, 0, sizeof(lanes[i].tail));
+        start(i);
+    }
+
+    while (active != 0U)
+    {
+        for (std::size_t i {}; i < detail::md5_lane_count; ++i)
+        {
+            const auto& lane {lanes[i]};
+            const auto* block {lane.message == count ? lane.tail : lane.blocks != 0U ? lane.data : lane.tail + lane.tail_used * 64U};
+            for (std::size_t j {}; j < 16U; ++j)
+            {
+                m[j][i] = static_cast<boost::crypt::uint32_t>(block[4U * j]) |
+                          (static_cast<boost::crypt::uint32_t>(block[4U * j + 1U]) << 8U) |
+                          (static_cast<boost::crypt::uint32_t>(block[4U * j + 2U]) << 16U) |
+                          (static_cast<boost::crypt::uint32_t>(block[4U * j + 3U]) << 24U);
+            }
+        }
+
+        detail::md5_lane_body(state, m);
+
+        for (std::size_t i {}; i < detail::md5_lane_count; ++i)
+        {
+            auto& lane {lanes[i]};
+            if (lane.message == count)
+            {
+                continue;
+            }
+
+            if (lane.blocks != 0U)
+            {
+                lane.data += 64U;
+                --lane.blocks;
+                continue;
+            }
+
+            if (++lane.tail_used != lane.tail_blocks)
+            {
+                continue;
+            }
+
+            auto& digest {digests[lane.message]};
+            for (std::size_t j {}; j < 4U; ++j)
+            {
+                digest[j * 4U] = static_cast<boost::crypt::uint8_t>(state[j][i]);
+                digest[j * 4U + 1U] = static_cast<boost::crypt::uint8_t>(state[j][i] >> 8U);
+                digest[j * 4U + 2U] = static_cast<boost::crypt::uint8_t>(state[j][i] >> 16U);
+                digest[j * 4U + 3U] = static_cast<boost::crypt::uint8_t>(state[j][i] >> 24U);
+            }
+
+            --active;
+            start(i);
+        }
+    }
+}
+
 // ---- CUDA also does not have the ability to consume files -----
 
 namespace detail {
 
-template <boost::crypt::size_t block_size = 64U>
-auto md5_file_impl(utility::file_reader<block_size>& reader) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+template <typename Reader>
+auto md5_file_impl(Reader& reader) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
 {
     md5_hasher hasher;
     while (!reader.eof())
@@ -591,27 +1041,101 @@ auto md5_file_impl(utility::file_reader<block_size>& reader) noexcept -> boost::
     return hasher.get_digest();
 }
 
-} // namespace detail
+#ifdef BOOST_CRYPT_HAS_SEEK_HOLE
 
-inline auto md5_file(const std::string& filepath) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+// Holes are hashed without being read or copied
+inline auto md5_file_impl(utility::sparse_file_reader& reader) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    md5_hasher hasher;
+    while (!reader.eof())
+    {
+        const auto buffer_iter {reader.read_next_block()};
+        const auto len {reader.get_bytes_read()};
+        if (reader.hole())
+        {
+            hasher.process_zero_bytes(len);
+        }
+        else
+        {
+            hasher.process_bytes(buffer_iter, len);
+        }
+    }
+
+    return hasher.get_digest();
+}
+
+#endif // BOOST_CRYPT_HAS_SEEK_HOLE
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+template <typename Reader>
+auto md5_file_checked(Reader& reader) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    const auto digest {md5_file_impl(reader)};
+    return reader.error() == 0 ? digest : boost::crypt::array<boost::crypt::uint8_t, 16>{};
+}
+
+// Whole buffers of BOOST_CRYPT_FILE_BUFFER_SIZE bytes are handed to the hasher at once.
+// The other read modes are in <boost/crypt/hash/md5/file.hpp>
+template <typename T>
+auto md5_file_dispatch(T filepath) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
 {
     try
     {
-        utility::file_reader<64U> reader(filepath);
-        return detail::md5_file_impl(reader);
+        const std::string path {filepath};
+
+        #ifdef BOOST_CRYPT_HAS_SEEK_HOLE
+        if (utility::detail::should_seek_holes(path.c_str(), utility::read_mode::read))
+        {
+            try
+            {
+                utility::sparse_file_reader reader(path);
+                return md5_file_checked(reader);
+            }
+            catch (const std::runtime_error&)
+            {
+                // The file changed type since it was checked, so try reading it instead
+            }
+        }
+        #endif
+
+        utility::posix_file_reader reader(path);
+        return md5_file_checked(reader);
     }
-    catch (const std::runtime_error&)
+    catch (const std::exception&)
     {
         return boost::crypt::array<boost::crypt::uint8_t, 16>{};
     }
 }
 
-inline auto md5_file(const char* filepath) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+// Nothing on this path throws, so a file that can not be opened costs no more than the failed open(2)
+inline auto md5_file_ec(const char* filepath, std::error_code& ec) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    utility::posix_file_reader reader(filepath, ec);
+    if (ec)
+    {
+        return boost::crypt::array<boost::crypt::uint8_t, 16>{};
+    }
+
+    const auto digest {md5_file_impl(reader)};
+    if (reader.error() != 0)
+    {
+        ec.assign(reader.error(), std::system_category());
+        return boost::crypt::array<boost::crypt::uint8_t, 16>{};
+    }
+
+    return digest;
+}
+
+#else
+
+template <typename T>
+auto md5_file_dispatch(T filepath) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
 {
     try
     {
         utility::file_reader<64U> reader(filepath);
-        return detail::md5_file_impl(reader);
+        return md5_file_impl(reader);
     }
     catch (const std::runtime_error&)
     {
@@ -619,17 +1143,89 @@ inline auto md5_file(const char* filepath) noexcept -> boost::crypt::array<boost
     }
 }
 
+inline auto md5_file_ec(const char* filepath, std::error_code& ec) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    try
+    {
+        utility::detail::file_source source(filepath);
+        if (!source.is_open())
+        {
+            ec = std::make_error_code(std::errc::no_such_file_or_directory);
+            return boost::crypt::array<boost::crypt::uint8_t, 16>{};
+        }
+
+        md5_hasher hasher;
+        boost::crypt::array<boost::crypt::uint8_t, 4096> buffer {};
+        while (!source.eof())
+        {
+            hasher.process_bytes(buffer.begin(), source.read(buffer.begin(), buffer.size()));
+        }
+
+        if (!source.good())
+        {
+            ec = std::make_error_code(std::errc::io_error);
+            return boost::crypt::array<boost::crypt::uint8_t, 16>{};
+        }
+
+        ec.clear();
+        return hasher.get_digest();
+    }
+    catch (const std::bad_alloc&)
+    {
+        ec = std::make_error_code(std::errc::not_enough_memory);
+        return boost::crypt::array<boost::crypt::uint8_t, 16>{};
+    }
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+} // namespace detail
+
+inline auto md5_file(const std::string& filepath) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    return detail::md5_file_dispatch(filepath);
+}
+
+inline auto md5_file(const char* filepath) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    return detail::md5_file_dispatch(filepath);
+}
+
+// Hashes the file, and on failure returns an all zero digest with the reason in ec.
+// Unlike the other overloads no exception is thrown and caught internally when the file can not be opened,
+// which keeps scanning directories where many files have vanished or are unreadable cheap
+inline auto md5_file(const char* filepath, std::error_code& ec) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    if (filepath == nullptr)
+    {
+        ec = std::make_error_code(std::errc::invalid_argument);
+        return boost::crypt::array<boost::crypt::uint8_t, 16>{};
+    }
+
+    return detail::md5_file_ec(filepath, ec);
+}
+
+inline auto md5_file(const std::string& filepath, std::error_code& ec) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    return detail::md5_file_ec(filepath.c_str(), ec);
+}
+
 #ifdef BOOST_CRYPT_HAS_STRING_VIEW
 
 inline auto md5_file(std::string_view filepath) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    return detail::md5_file_dispatch(filepath);
+}
+
+inline auto md5_file(std::string_view filepath, std::error_code& ec) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
 {
     try
     {
-        utility::file_reader<64U> reader(filepath);
-        return detail::md5_file_impl(reader);
+        return detail::md5_file_ec(std::string{filepath}.c_str(), ec);
     }
-    catch (const std::runtime_error&)
+    catch (const std::bad_alloc&)
     {
+        ec = std::make_error_code(std::errc::not_enough_memory);
         return boost::crypt::array<boost::crypt::uint8_t, 16>{};
     }
 }
@@ -0,0 +1,77 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// md5_copy_file, which hashes a file while copying it
+
+#ifndef BOOST_CRYPT_HASH_MD5_COPY_FILE_HPP
+#define BOOST_CRYPT_HASH_MD5_COPY_FILE_HPP
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/utility/copy_file.hpp>
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <string>
+#include <system_error>
+#endif
+
+namespace boost {
+namespace crypt {
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+// Copies from to to, reading the source once, and returns the digest of the bytes written.
+// On failure the digest is all zeros with the reason in ec, and the destination may be incomplete
+inline auto md5_copy_file(const char* from, const char* to, std::error_code& ec,
+                          utility::copy_sync sync = utility::copy_sync::none,
+                          utility::copy_mode mode = utility::copy_mode::buffered) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    if (from == nullptr || to == nullptr)
+    {
+        ec = std::make_error_code(std::errc::invalid_argument);
+        return boost::crypt::array<boost::crypt::uint8_t, 16>{};
+    }
+
+    try
+    {
+        md5_hasher hasher;
+        ec = utility::copy_and_hash_file(from, to, hasher, sync, mode);
+        if (!ec)
+        {
+            return hasher.get_digest();
+        }
+    }
+    catch (const std::system_error& e)
+    {
+        // Unable to start the reader or writer thread
+        ec = e.code();
+    }
+    catch (const std::exception&)
+    {
+        ec = std::make_error_code(std::errc::not_enough_memory);
+    }
+
+    return boost::crypt::array<boost::crypt::uint8_t, 16>{};
+}
+
+inline auto md5_copy_file(const std::string& from, const std::string& to, std::error_code& ec,
+                          utility::copy_sync sync = utility::copy_sync::none,
+                          utility::copy_mode mode = utility::copy_mode::buffered) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    return md5_copy_file(from.c_str(), to.c_str(), ec, sync, mode);
+}
+
+inline auto md5_copy_file(const std::string& from, const std::string& to,
+                          utility::copy_sync sync = utility::copy_sync::none,
+                          utility::copy_mode mode = utility::copy_mode::buffered) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    std::error_code ec;
+    return md5_copy_file(from.c_str(), to.c_str(), ec, sync, mode);
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HASH_MD5_COPY_FILE_HPP
@@ -0,0 +1,74 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// md5_decompressed_file, which hashes the uncompressed contents of a gzip or zstd file
+
+#ifndef BOOST_CRYPT_HASH_MD5_DECOMPRESS_HPP
+#define BOOST_CRYPT_HASH_MD5_DECOMPRESS_HPP
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/utility/decompress.hpp>
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <string>
+#include <system_error>
+#endif
+
+namespace boost {
+namespace crypt {
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+// Hashes the uncompressed contents of a gzip or zstd file without writing them anywhere, detecting the format by default.
+// On failure the digest is all zeros with the reason in ec
+inline auto md5_decompressed_file(const char* filepath, std::error_code& ec,
+                                  utility::compression format = utility::compression::automatic) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    if (filepath == nullptr)
+    {
+        ec = std::make_error_code(std::errc::invalid_argument);
+        return boost::crypt::array<boost::crypt::uint8_t, 16>{};
+    }
+
+    try
+    {
+        md5_hasher hasher;
+        ec = utility::decompress_and_hash_file(filepath, hasher, format);
+        if (!ec)
+        {
+            return hasher.get_digest();
+        }
+    }
+    catch (const std::system_error& e)
+    {
+        // Unable to start the decoder thread
+        ec = e.code();
+    }
+    catch (const std::exception&)
+    {
+        ec = std::make_error_code(std::errc::not_enough_memory);
+    }
+
+    return boost::crypt::array<boost::crypt::uint8_t, 16>{};
+}
+
+inline auto md5_decompressed_file(const std::string& filepath, std::error_code& ec,
+                                  utility::compression format = utility::compression::automatic) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    return md5_decompressed_file(filepath.c_str(), ec, format);
+}
+
+inline auto md5_decompressed_file(const std::string& filepath,
+                                  utility::compression format = utility::compression::automatic) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    std::error_code ec;
+    return md5_decompressed_file(filepath.c_str(), ec, format);
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HASH_MD5_DECOMPRESS_HPP
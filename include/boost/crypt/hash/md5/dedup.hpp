@@ -0,0 +1,38 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// md5_find_duplicates, which groups the files under directories that have the same contents
+
+#ifndef BOOST_CRYPT_HASH_MD5_DEDUP_HPP
+#define BOOST_CRYPT_HASH_MD5_DEDUP_HPP
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/utility/dedup.hpp>
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <string>
+#include <vector>
+#endif
+
+namespace boost {
+namespace crypt {
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+using md5_dedup_result = utility::dedup_result<boost::crypt::array<boost::crypt::uint8_t, 16>>;
+
+// Groups the regular files under roots that have the same contents, only hashing in full the files that have the same size,
+// and the same MD5 of their first and last 4 KiB, as another file
+inline auto md5_find_duplicates(const std::vector<std::string>& roots,
+                                const utility::dedup_options& options = utility::dedup_options{}) -> md5_dedup_result
+{
+    return utility::find_duplicates<md5_hasher>(roots, options);
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HASH_MD5_DEDUP_HPP
@@ -0,0 +1,56 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// md5_file overloads that skip hashing files whose metadata is unchanged since they were cached
+
+#ifndef BOOST_CRYPT_HASH_MD5_DIGEST_CACHE_HPP
+#define BOOST_CRYPT_HASH_MD5_DIGEST_CACHE_HPP
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/utility/digest_cache.hpp>
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <string>
+#include <system_error>
+#endif
+
+namespace boost {
+namespace crypt {
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+using md5_digest_cache = utility::digest_cache<16U>;
+
+// Returns the digest of the file from the cache without reading it if its device, inode, size, mtime and ctime are unchanged,
+// and otherwise hashes it and adds it to the cache. On failure the digest is all zeros with the reason in ec
+inline auto md5_file(const std::string& filepath, md5_digest_cache& cache, std::error_code& ec) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    try
+    {
+        return utility::hash_file_cached<md5_hasher>(cache, filepath.c_str(), ec);
+    }
+    catch (const std::system_error& e)
+    {
+        ec = e.code();
+    }
+    catch (const std::exception&)
+    {
+        ec = std::make_error_code(std::errc::not_enough_memory);
+    }
+
+    return boost::crypt::array<boost::crypt::uint8_t, 16>{};
+}
+
+inline auto md5_file(const std::string& filepath, md5_digest_cache& cache) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    std::error_code ec;
+    return md5_file(filepath, cache, ec);
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HASH_MD5_DIGEST_CACHE_HPP
@@ -0,0 +1,229 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// md5_file overloads that choose how the file is read, or hash an open descriptor, a stream or a range of a file
+
+#ifndef BOOST_CRYPT_HASH_MD5_FILE_HPP
+#define BOOST_CRYPT_HASH_MD5_FILE_HPP
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/utility/file.hpp>
+#include <boost/crypt/utility/posix_file.hpp>
+#include <boost/crypt/utility/mapped_file.hpp>
+#include <boost/crypt/utility/direct_file.hpp>
+#include <boost/crypt/utility/scan_file.hpp>
+#include <boost/crypt/utility/sparse_file.hpp>
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <string>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#endif
+
+namespace boost {
+namespace crypt {
+
+namespace detail {
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+// Whole buffers of BOOST_CRYPT_FILE_BUFFER_SIZE bytes, or whole mapped windows, are handed to the hasher at once
+template <typename T>
+auto md5_file_dispatch(T filepath, utility::read_mode mode) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    try
+    {
+        const std::string path {filepath};
+
+        #ifdef BOOST_CRYPT_HAS_DIRECT_IO
+        if (mode == utility::read_mode::direct)
+        {
+            try
+            {
+                utility::direct_file_reader reader(path);
+                return md5_file_checked(reader);
+            }
+            catch (const std::runtime_error&)
+            {
+                // Pipes and other special files can not be read directly
+            }
+        }
+        #endif
+
+        if (mode == utility::read_mode::scan)
+        {
+            try
+            {
+                utility::scan_file_reader reader(path);
+                return md5_file_checked(reader);
+            }
+            catch (const std::runtime_error&)
+            {
+                // Pipes and other special files are not cached, so are just read
+            }
+        }
+
+        #ifdef BOOST_CRYPT_HAS_SEEK_HOLE
+        if (utility::detail::should_seek_holes(path.c_str(), mode))
+        {
+            try
+            {
+                utility::sparse_file_reader reader(path);
+                return md5_file_checked(reader);
+            }
+            catch (const std::runtime_error&)
+            {
+                // The file changed type since it was checked, so try reading it instead
+            }
+        }
+        #endif
+
+        if (utility::detail::should_map(path.c_str(), mode))
+        {
+            try
+            {
+                utility::mapped_file_reader reader(path);
+                return md5_file_checked(reader);
+            }
+            catch (const std::runtime_error&)
+            {
+                // The file changed type since it was checked, so try reading it instead
+            }
+        }
+
+        utility::posix_file_reader reader(path);
+        return md5_file_checked(reader);
+    }
+    catch (const std::exception&)
+    {
+        return boost::crypt::array<boost::crypt::uint8_t, 16>{};
+    }
+}
+
+// Hashes a range of a file, or of a descriptor owned by the caller, with pread(2)
+inline auto md5_file_range(int fd, std::uint64_t offset, std::uint64_t length) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    try
+    {
+        utility::posix_file_reader reader(fd, offset, length);
+        return md5_file_checked(reader);
+    }
+    catch (const std::exception&)
+    {
+        return boost::crypt::array<boost::crypt::uint8_t, 16>{};
+    }
+}
+
+inline auto md5_file_range(const char* filepath, std::uint64_t offset, std::uint64_t length) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    try
+    {
+        utility::posix_file_reader reader(filepath, offset, length);
+        return md5_file_checked(reader);
+    }
+    catch (const std::exception&)
+    {
+        return boost::crypt::array<boost::crypt::uint8_t, 16>{};
+    }
+}
+
+inline auto md5_file_range(std::FILE* file, std::uint64_t offset, std::uint64_t length) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    return file == nullptr ? boost::crypt::array<boost::crypt::uint8_t, 16>{} : md5_file_range(::fileno(file), offset, length);
+}
+
+BOOST_CRYPT_INLINE_CONSTEXPR std::uint64_t whole_file {(std::numeric_limits<std::uint64_t>::max)()};
+
+#else
+
+// Memory mapping is not available so every mode reads the file
+template <typename T>
+auto md5_file_dispatch(T filepath, utility::read_mode) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    return md5_file_dispatch(filepath);
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+} // namespace detail
+
+inline auto md5_file(const std::string& filepath, utility::read_mode mode) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    return detail::md5_file_dispatch(filepath, mode);
+}
+
+inline auto md5_file(const char* filepath, utility::read_mode mode) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    return detail::md5_file_dispatch(filepath, mode);
+}
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+// Hashes the whole of a file that is already open, from its beginning regardless of the file position.
+// The descriptor is not closed, and its file position is not used or changed.
+// Pipes and other non-seekable descriptors are read from where they are up to their end
+inline auto md5_file(int fd) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    return detail::md5_file_range(fd, 0U, detail::whole_file);
+}
+
+// Hashes the length bytes of an open file starting at offset, or up to the end of the file if it is shorter.
+// Different ranges of the same descriptor can be hashed concurrently from several threads
+inline auto md5_file(int fd, std::uint64_t offset, std::uint64_t length) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    return detail::md5_file_range(fd, offset, length);
+}
+
+// Hashes the file underlying the stream, without using or changing the stream's position.
+// Writes still held in the stream's buffer are not seen, so flush them first
+inline auto md5_file(std::FILE* file) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    return detail::md5_file_range(file, 0U, detail::whole_file);
+}
+
+inline auto md5_file(std::FILE* file, std::uint64_t offset, std::uint64_t length) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    return detail::md5_file_range(file, offset, length);
+}
+
+inline auto md5_file(const std::string& filepath, std::uint64_t offset, std::uint64_t length) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    return detail::md5_file_range(filepath.c_str(), offset, length);
+}
+
+inline auto md5_file(const char* filepath, std::uint64_t offset, std::uint64_t length) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    return filepath == nullptr ? boost::crypt::array<boost::crypt::uint8_t, 16>{} : detail::md5_file_range(filepath, offset, length);
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#ifdef BOOST_CRYPT_HAS_STRING_VIEW
+
+inline auto md5_file(std::string_view filepath, utility::read_mode mode) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    return detail::md5_file_dispatch(filepath, mode);
+}
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+inline auto md5_file(std::string_view filepath, std::uint64_t offset, std::uint64_t length) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    try
+    {
+        return detail::md5_file_range(std::string{filepath}.c_str(), offset, length);
+    }
+    catch (const std::exception&)
+    {
+        return boost::crypt::array<boost::crypt::uint8_t, 16>{};
+    }
+}
+#endif
+
+#endif // BOOST_CRYPT_HAS_STRING_VIEW
+
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HASH_MD5_FILE_HPP
@@ -0,0 +1,68 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// md5_file_incremental, which only reads what was appended to a file since it was last hashed
+
+#ifndef BOOST_CRYPT_HASH_MD5_INCREMENTAL_FILE_HPP
+#define BOOST_CRYPT_HASH_MD5_INCREMENTAL_FILE_HPP
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/utility/incremental_file.hpp>
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <string>
+#include <system_error>
+#endif
+
+namespace boost {
+namespace crypt {
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+// Hashes a file that is only appended to, reading only the bytes added since the state was last saved in state_path.
+// The state is checked against the file first, and the whole file is hashed if it was replaced or truncated
+inline auto md5_file_incremental(const std::string& filepath, const std::string& state_path, std::error_code& ec) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    try
+    {
+        md5_hasher hasher;
+        static_cast<void>(utility::incremental_hash_file(filepath, state_path, hasher, ec));
+        if (!ec)
+        {
+            return hasher.get_digest();
+        }
+    }
+    catch (const std::system_error& e)
+    {
+        ec = e.code();
+    }
+    catch (const std::exception&)
+    {
+        ec = std::make_error_code(std::errc::not_enough_memory);
+    }
+
+    return boost::crypt::array<boost::crypt::uint8_t, 16>{};
+}
+
+// Keeps the state next to the file, in filepath + ".md5state"
+inline auto md5_file_incremental(const std::string& filepath, std::error_code& ec) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    try
+    {
+        return md5_file_incremental(filepath, filepath + ".md5state", ec);
+    }
+    catch (const std::exception&)
+    {
+        ec = std::make_error_code(std::errc::not_enough_memory);
+    }
+
+    return boost::crypt::array<boost::crypt::uint8_t, 16>{};
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HASH_MD5_INCREMENTAL_FILE_HPP
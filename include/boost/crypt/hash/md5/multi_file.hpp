@@ -0,0 +1,63 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// md5_files, which hashes many files concurrently
+
+#ifndef BOOST_CRYPT_HASH_MD5_MULTI_FILE_HPP
+#define BOOST_CRYPT_HASH_MD5_MULTI_FILE_HPP
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/utility/multi_file.hpp>
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <cstddef>
+#include <string>
+#include <system_error>
+#include <vector>
+#endif
+
+namespace boost {
+namespace crypt {
+
+// Hashes many files concurrently, calling callback(index, digest, ec) as each one completes.
+// The callback is never invoked concurrently, and on failure the digest is all zeros
+template <typename Callback>
+auto md5_files(const std::vector<std::string>& paths, Callback&& callback,
+               std::size_t files_in_flight = utility::default_files_in_flight,
+               std::size_t buffer_size = utility::default_multi_file_buffer_size) -> void
+{
+    utility::hash_files<md5_hasher>(paths, [&callback](std::size_t index, md5_hasher& hasher, const std::error_code& ec) {
+        callback(index, ec ? boost::crypt::array<boost::crypt::uint8_t, 16>{} : hasher.get_digest(), ec);
+    }, files_in_flight, buffer_size);
+}
+
+// Returns the digest of each file in the same order as paths, with all zeros for any file that could not be read
+inline auto md5_files(const std::vector<std::string>& paths) -> std::vector<boost::crypt::array<boost::crypt::uint8_t, 16>>
+{
+    std::vector<boost::crypt::array<boost::crypt::uint8_t, 16>> digests(paths.size());
+    md5_files(paths, [&digests](std::size_t index, const boost::crypt::array<boost::crypt::uint8_t, 16>& digest, const std::error_code&) {
+        digests[index] = digest;
+    });
+
+    return digests;
+}
+
+// Returns the digest of each file in the same order as paths, and sets the matching element of ec to the reason
+// each file could not be read, or clears it
+inline auto md5_files(const std::vector<std::string>& paths, std::vector<std::error_code>& ec) -> std::vector<boost::crypt::array<boost::crypt::uint8_t, 16>>
+{
+    std::vector<boost::crypt::array<boost::crypt::uint8_t, 16>> digests(paths.size());
+    ec.assign(paths.size(), std::error_code{});
+    md5_files(paths, [&digests, &ec](std::size_t index, const boost::crypt::array<boost::crypt::uint8_t, 16>& digest, const std::error_code& file_ec) {
+        digests[index] = digest;
+        ec[index] = file_ec;
+    });
+
+    return digests;
+}
+
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HASH_MD5_MULTI_FILE_HPP
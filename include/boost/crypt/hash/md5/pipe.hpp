@@ -0,0 +1,75 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// md5_pipe and md5_pipe_through, which hash the data read from a pipe
+
+#ifndef BOOST_CRYPT_HASH_MD5_PIPE_HPP
+#define BOOST_CRYPT_HASH_MD5_PIPE_HPP
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/utility/pipe.hpp>
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <system_error>
+#endif
+
+namespace boost {
+namespace crypt {
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+// Hashes everything written to a pipe, or stdin by default, until the writer closes it.
+// The descriptor is not closed, and on failure the digest is all zeros with the reason in ec
+inline auto md5_pipe(int fd, std::error_code& ec) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    utility::pipe_reader reader(fd, ec);
+    if (ec)
+    {
+        return boost::crypt::array<boost::crypt::uint8_t, 16>{};
+    }
+
+    const auto digest {detail::md5_file_impl(reader)};
+    if (reader.error() != 0)
+    {
+        ec.assign(reader.error(), std::system_category());
+        return boost::crypt::array<boost::crypt::uint8_t, 16>{};
+    }
+
+    return digest;
+}
+
+inline auto md5_pipe(int fd = STDIN_FILENO) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    std::error_code ec;
+    return md5_pipe(fd, ec);
+}
+
+// Hashes everything read from in_fd while passing it on unchanged to out_fd, like tee(1) into md5sum.
+// Between two pipes the data is duplicated with tee(2) inside the kernel, so passing it on costs no extra copy
+inline auto md5_pipe_through(int in_fd, int out_fd, std::error_code& ec) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    md5_hasher hasher;
+    const auto err {utility::pass_through_hash(in_fd, out_fd, hasher)};
+    if (err != 0)
+    {
+        ec.assign(err, std::system_category());
+        return boost::crypt::array<boost::crypt::uint8_t, 16>{};
+    }
+
+    ec.clear();
+    return hasher.get_digest();
+}
+
+inline auto md5_pipe_through(int in_fd = STDIN_FILENO, int out_fd = STDOUT_FILENO) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    std::error_code ec;
+    return md5_pipe_through(in_fd, out_fd, ec);
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HASH_MD5_PIPE_HPP
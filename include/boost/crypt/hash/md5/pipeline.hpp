@@ -0,0 +1,44 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// md5_file_pipelined, which reads the file on a separate thread from the hasher
+
+#ifndef BOOST_CRYPT_HASH_MD5_PIPELINE_HPP
+#define BOOST_CRYPT_HASH_MD5_PIPELINE_HPP
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/utility/pipeline.hpp>
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <cstddef>
+#include <string>
+#endif
+
+namespace boost {
+namespace crypt {
+
+// Reads the file on a separate thread into a ring of queue_depth buffers while the calling thread hashes
+inline auto md5_file_pipelined(const std::string& filepath, std::size_t queue_depth = utility::default_queue_depth,
+                               std::size_t buffer_size = 0U) noexcept -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    try
+    {
+        md5_hasher hasher;
+        if (utility::pipelined_hash_file(filepath, hasher, queue_depth, buffer_size))
+        {
+            return hasher.get_digest();
+        }
+    }
+    catch (const std::exception&)
+    {
+        // Unable to start the reader thread or allocate the buffers
+    }
+
+    return boost::crypt::array<boost::crypt::uint8_t, 16>{};
+}
+
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HASH_MD5_PIPELINE_HPP
@@ -0,0 +1,87 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// md5_records and md5_file_records, which hash every line or record on its own
+
+#ifndef BOOST_CRYPT_HASH_MD5_RECORDS_HPP
+#define BOOST_CRYPT_HASH_MD5_RECORDS_HPP
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/utility/records.hpp>
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <system_error>
+#include <vector>
+#endif
+
+namespace boost {
+namespace crypt {
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+namespace utility {
+
+template <>
+struct record_batch<md5_hasher>
+{
+    static auto hash(const std::uint8_t* const* data, const std::size_t* sizes, std::size_t count,
+                     boost::crypt::array<boost::crypt::uint8_t, 16>* digests) noexcept -> void
+    {
+        md5_messages(data, sizes, count, digests);
+    }
+};
+
+} // namespace utility
+
+// The MD5 of each line, or each length prefixed record, of the size bytes at data, in the order of the records.
+// On failure the result is empty with the reason in ec
+inline auto md5_records(const std::uint8_t* data, std::size_t size, std::error_code& ec,
+                        const utility::record_options& options = utility::record_options{}) noexcept -> std::vector<boost::crypt::array<boost::crypt::uint8_t, 16>>
+{
+    try
+    {
+        return utility::hash_records<md5_hasher>(data, size, ec, options);
+    }
+    catch (const std::system_error& e)
+    {
+        ec = e.code();
+    }
+    catch (const std::exception&)
+    {
+        ec = std::make_error_code(std::errc::not_enough_memory);
+    }
+
+    return {};
+}
+
+// The MD5 of each line, or each length prefixed record, of a file, hashed in place and in parallel.
+// On failure the result is empty with the reason in ec
+inline auto md5_file_records(const std::string& filepath, std::error_code& ec,
+                             const utility::record_options& options = utility::record_options{}) noexcept -> std::vector<boost::crypt::array<boost::crypt::uint8_t, 16>>
+{
+    try
+    {
+        return utility::hash_file_records<md5_hasher>(filepath, ec, options);
+    }
+    catch (const std::system_error& e)
+    {
+        ec = e.code();
+    }
+    catch (const std::exception&)
+    {
+        ec = std::make_error_code(std::errc::not_enough_memory);
+    }
+
+    return {};
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HASH_MD5_RECORDS_HPP
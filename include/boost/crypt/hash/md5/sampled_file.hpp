@@ -0,0 +1,51 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// md5_file_sampled, a quick fingerprint of a huge file from sampled ranges
+
+#ifndef BOOST_CRYPT_HASH_MD5_SAMPLED_FILE_HPP
+#define BOOST_CRYPT_HASH_MD5_SAMPLED_FILE_HPP
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/utility/sampled_file.hpp>
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <string>
+#include <system_error>
+#endif
+
+namespace boost {
+namespace crypt {
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+using md5_sampled_fingerprint = utility::sampled_fingerprint<boost::crypt::array<boost::crypt::uint8_t, 16>>;
+
+// A quick fingerprint of a huge file from its size and the MD5 of sampled ranges, which only says whether two files are
+// probably the same. On failure the digest is all zeros with the reason in ec
+inline auto md5_file_sampled(const std::string& filepath, std::error_code& ec,
+                             const utility::sample_options& options = utility::sample_options{}) noexcept -> md5_sampled_fingerprint
+{
+    try
+    {
+        return utility::sample_file<md5_hasher>(filepath, ec, options);
+    }
+    catch (const std::system_error& e)
+    {
+        ec = e.code();
+    }
+    catch (const std::exception&)
+    {
+        ec = std::make_error_code(std::errc::not_enough_memory);
+    }
+
+    return md5_sampled_fingerprint{{}, 0U, options.sample_count, options.sample_length, options.key, false};
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HASH_MD5_SAMPLED_FILE_HPP
@@ -0,0 +1,49 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// md5_tar, which hashes the files in a tar archive without extracting them
+
+#ifndef BOOST_CRYPT_HASH_MD5_TAR_HPP
+#define BOOST_CRYPT_HASH_MD5_TAR_HPP
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/utility/tar.hpp>
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <string>
+#include <system_error>
+#endif
+
+namespace boost {
+namespace crypt {
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+// Hashes each regular file in a tar archive without extracting it,
+// calling callback(const utility::tar_entry& entry, const digest& digest) in archive order
+template <typename Callback>
+auto md5_tar(const std::string& filepath, Callback&& callback) -> std::error_code
+{
+    return utility::hash_tar<md5_hasher>(filepath, [&callback](const utility::tar_entry& entry, md5_hasher& hasher) {
+        const auto digest {hasher.get_digest()};
+        callback(entry, digest);
+    });
+}
+
+// Reads the archive from a descriptor owned by the caller, such as stdin receiving the output of tar c
+template <typename Callback>
+auto md5_tar(int fd, Callback&& callback) -> std::error_code
+{
+    return utility::hash_tar<md5_hasher>(fd, [&callback](const utility::tar_entry& entry, md5_hasher& hasher) {
+        const auto digest {hasher.get_digest()};
+        callback(entry, digest);
+    });
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HASH_MD5_TAR_HPP
@@ -0,0 +1,69 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// md5_tree, which hashes every file under a directory in parallel
+
+#ifndef BOOST_CRYPT_HASH_MD5_TREE_HPP
+#define BOOST_CRYPT_HASH_MD5_TREE_HPP
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/utility/tree.hpp>
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <system_error>
+#include <vector>
+#endif
+
+namespace boost {
+namespace crypt {
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+// One file of the manifest returned by md5_tree
+struct md5_tree_entry
+{
+    std::string path;
+    std::uint64_t size;
+    boost::crypt::array<boost::crypt::uint8_t, 16> digest;
+    std::error_code ec;
+};
+
+// Hashes every regular file under root in parallel, calling callback(path, size, digest, ec) as each one completes
+// with the path relative to root. The callback is never invoked concurrently, and on failure the digest is all zeros
+template <typename Callback>
+auto md5_tree(const std::string& root, Callback&& callback,
+              const utility::tree_options& options = utility::tree_options{}) -> std::error_code
+{
+    return utility::hash_tree<md5_hasher>(root, [&callback](const std::string& path, std::uint64_t size, md5_hasher& hasher, const std::error_code& ec) {
+        callback(path, size, ec ? boost::crypt::array<boost::crypt::uint8_t, 16>{} : hasher.get_digest(), ec);
+    }, options);
+}
+
+// Returns the manifest of every regular file under root sorted by path, so the same tree always gives the same manifest
+// however the work was divided between the threads. If root cannot be opened the manifest is empty with the reason in ec
+inline auto md5_tree(const std::string& root, std::error_code& ec,
+                     const utility::tree_options& options = utility::tree_options{}) -> std::vector<md5_tree_entry>
+{
+    std::vector<md5_tree_entry> manifest;
+    ec = md5_tree(root, [&manifest](const std::string& path, std::uint64_t size,
+                                    const boost::crypt::array<boost::crypt::uint8_t, 16>& digest, const std::error_code& file_ec) {
+        manifest.push_back(md5_tree_entry{path, size, digest, file_ec});
+    }, options);
+
+    std::sort(manifest.begin(), manifest.end(), [](const md5_tree_entry& lhs, const md5_tree_entry& rhs) {
+        return lhs.path < rhs.path;
+    });
+
+    return manifest;
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HASH_MD5_TREE_HPP
@@ -0,0 +1,55 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// md5_verify, which checks the files named in a checksum list written by md5sum
+
+#ifndef BOOST_CRYPT_HASH_MD5_VERIFY_HPP
+#define BOOST_CRYPT_HASH_MD5_VERIFY_HPP
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/utility/verify.hpp>
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <algorithm>
+#include <string>
+#include <vector>
+#endif
+
+namespace boost {
+namespace crypt {
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+// Checks every file named in a checksum list written by md5sum, with or without --tag, against its listed digest,
+// calling callback(const utility::verify_failure&) for each line that does not verify.
+// The callback is never invoked concurrently, and the lines are reported in no particular order
+template <typename Callback>
+auto md5_verify(const std::string& list_path, Callback&& callback,
+                const utility::verify_options& options = utility::verify_options{}) -> utility::verify_result
+{
+    return utility::verify_checksum_file<md5_hasher>(list_path, "MD5", callback, options);
+}
+
+// Checks every file named in the checksum list, and sets failures to the lines that did not verify in the order of the list
+inline auto md5_verify(const std::string& list_path, std::vector<utility::verify_failure>& failures,
+                       const utility::verify_options& options = utility::verify_options{}) -> utility::verify_result
+{
+    failures.clear();
+    const auto result {md5_verify(list_path, [&failures](const utility::verify_failure& failure) {
+        failures.push_back(failure);
+    }, options)};
+
+    std::sort(failures.begin(), failures.end(), [](const utility::verify_failure& lhs, const utility::verify_failure& rhs) {
+        return lhs.line < rhs.line;
+    });
+
+    return result;
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HASH_MD5_VERIFY_HPP
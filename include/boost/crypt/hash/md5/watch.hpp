@@ -0,0 +1,26 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// md5_tree_watcher, which keeps the MD5 of every file under a directory current
+
+#ifndef BOOST_CRYPT_HASH_MD5_WATCH_HPP
+#define BOOST_CRYPT_HASH_MD5_WATCH_HPP
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/utility/watch.hpp>
+
+namespace boost {
+namespace crypt {
+
+#ifdef BOOST_CRYPT_HAS_INOTIFY
+
+// Keeps the MD5 of every file under a directory current as files change (See: utility::tree_watcher)
+using md5_tree_watcher = utility::tree_watcher<md5_hasher>;
+
+#endif // BOOST_CRYPT_HAS_INOTIFY
+
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HASH_MD5_WATCH_HPP
@@ -0,0 +1,222 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#ifndef BOOST_CRYPT_UTILITY_BUFFER_RING_HPP
+#define BOOST_CRYPT_UTILITY_BUFFER_RING_HPP
+
+#include <boost/crypt/utility/config.hpp>
+#include <boost/crypt/utility/cstdint.hpp>
+#include <boost/crypt/utility/file.hpp>
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+#endif
+
+namespace boost {
+namespace crypt {
+namespace utility {
+
+// A fixed set of large buffers shared between one producer and one or more consumers.
+// The producer fills the slots in order, and every consumer sees every slot in the same order.
+// A slot is only handed back to the producer once all consumers have released it,
+// so the data is read once and then shared read-only between all the consumers.
+// Each slot starts on a multiple of alignment, which must be a power of two, for I/O that requires it
+class buffer_ring
+{
+private:
+    struct slot
+    {
+        std::unique_ptr<std::uint8_t[]> storage;
+        std::uint8_t* data {};
+        std::size_t size {};
+        std::size_t readers {};
+    };
+
+    std::vector<slot> slots_;
+    std::vector<std::uint64_t> cursors_;
+    std::size_t slot_size_;
+    std::uint64_t produced_ {};
+    bool closed_ {};
+    bool aborted_ {};
+
+    std::mutex mutex_;
+    std::condition_variable slot_released_;
+    std::condition_variable slot_filled_;
+
+public:
+    buffer_ring(std::size_t slot_count, std::size_t slot_size, std::size_t consumer_count = 1U, std::size_t alignment = 1U)
+        : slots_(slot_count == 0U ? 1U : slot_count), cursors_(consumer_count), slot_size_ {slot_size}
+    {
+        alignment = alignment == 0U ? 1U : alignment;
+        for (auto& s : slots_)
+        {
+            auto space {slot_size + alignment - 1U};
+            s.storage.reset(new std::uint8_t[space]);
+
+            void* aligned {s.storage.get()};
+            s.data = static_cast<std::uint8_t*>(std::align(alignment, slot_size, aligned, space));
+        }
+    }
+
+    auto slot_size() const noexcept -> std::size_t { return slot_size_; }
+
+    auto consumer_count() const noexcept -> std::size_t { return cursors_.size(); }
+
+    // Producer: Waits for the next slot in sequence to be free and returns it to be filled.
+    // Returns nullptr if the ring has been aborted
+    auto acquire() -> std::uint8_t*
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto& s {slots_[static_cast<std::size_t>(produced_ % slots_.size())]};
+        slot_released_.wait(lock, [&] { return s.readers == 0U || aborted_; });
+        return aborted_ ? nullptr : s.data;
+    }
+
+    // Producer: Publishes the slot returned by the last call to acquire to all consumers
+    auto commit(std::size_t bytes) -> void
+    {
+        BOOST_CRYPT_ASSERT(bytes <= slot_size_);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto& s {slots_[static_cast<std::size_t>(produced_ % slots_.size())]};
+            s.size = bytes;
+            s.readers = cursors_.size();
+            ++produced_;
+        }
+        slot_filled_.notify_all();
+    }
+
+    // Producer: No more slots will be committed
+    auto close() -> void
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        slot_filled_.notify_all();
+    }
+
+    // Either side: Stops the ring and wakes up everyone waiting on it
+    auto abort() -> void
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            aborted_ = true;
+        }
+        slot_filled_.notify_all();
+        slot_released_.notify_all();
+    }
+
+    auto aborted() -> bool
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return aborted_;
+    }
+
+    // Consumer: Waits for the next slot this consumer has not seen yet.
+    // Returns false once the producer has closed the ring and every slot has been seen, or on abort
+    auto next(std::size_t consumer, const std::uint8_t*& data, std::size_t& size) -> bool
+    {
+        BOOST_CRYPT_ASSERT(consumer < cursors_.size());
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        const auto cursor {cursors_[consumer]};
+        slot_filled_.wait(lock, [&] { return produced_ > cursor || closed_ || aborted_; });
+
+        if (aborted_ || produced_ == cursor)
+        {
+            return false;
+        }
+
+        const auto& s {slots_[static_cast<std::size_t>(cursor % slots_.size())]};
+        data = s.data;
+        size = s.size;
+        return true;
+    }
+
+    // Consumer: Hands the slot returned by the last call to next back to the ring
+    auto release(std::size_t consumer) -> void
+    {
+        bool free_slot {};
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto& s {slots_[static_cast<std::size_t>(cursors_[consumer] % slots_.size())]};
+            ++cursors_[consumer];
+            free_slot = --s.readers == 0U;
+        }
+
+        if (free_slot)
+        {
+            slot_released_.notify_all();
+        }
+    }
+};
+
+namespace detail {
+
+// Reads the whole source into the ring, then closes the ring.
+// Returns false and aborts the ring if the source could not be read
+inline auto fill_ring(file_source& source, buffer_ring& ring) -> bool
+{
+    while (!source.eof())
+    {
+        auto* buffer {ring.acquire()};
+        if (buffer == nullptr)
+        {
+            return false;
+        }
+
+        const auto len {source.read(buffer, ring.slot_size())};
+        if (len > 0U)
+        {
+            ring.commit(len);
+        }
+    }
+
+    const auto read_ok {source.good()};
+    read_ok ? ring.close() : ring.abort();
+    return read_ok;
+}
+
+// Reads the whole of a reader with read_into, eof and error, such as posix_file_reader, into the ring, then closes the ring.
+// Returns the errno of a failed read after aborting the ring, or 0
+template <typename Reader>
+auto fill_ring_from(Reader& reader, buffer_ring& ring) -> int
+{
+    while (!reader.eof())
+    {
+        auto* buffer {ring.acquire()};
+        if (buffer == nullptr)
+        {
+            return 0;
+        }
+
+        const auto len {reader.read_into(buffer, ring.slot_size())};
+        if (reader.error() != 0)
+        {
+            ring.abort();
+            return reader.error();
+        }
+        if (len > 0U)
+        {
+            ring.commit(len);
+        }
+    }
+
+    ring.close();
+    return 0;
+}
+
+} // namespace detail
+
+} // namespace utility
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_UTILITY_BUFFER_RING_HPP
@@ -70,6 +70,64 @@
 #endif
 // ----- Has CXX something -----
 
+// ----- File I/O -----
+#if (defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__))) && \
+    !defined(BOOST_CRYPT_HAS_CUDA) && !defined(BOOST_CRYPT_DISABLE_POSIX_FILE_IO)
+#  define BOOST_CRYPT_HAS_POSIX_FILE_IO
+#endif
+
+#if defined(__linux__) && defined(BOOST_CRYPT_HAS_POSIX_FILE_IO) && !defined(BOOST_CRYPT_DISABLE_IO_URING)
+#  if defined(__has_include)
+#    if __has_include(<linux/io_uring.h>)
+#      define BOOST_CRYPT_HAS_IO_URING
+#    endif
+#  endif
+#endif
+
+#if (defined(__linux__) || defined(__FreeBSD__) || defined(__DragonFly__) || defined(__NetBSD__)) && \
+    defined(BOOST_CRYPT_HAS_POSIX_FILE_IO) && !defined(BOOST_CRYPT_DISABLE_DIRECT_IO)
+#  define BOOST_CRYPT_HAS_DIRECT_IO
+#endif
+
+// Decompressing inputs needs zlib or libzstd to be linked, so each is only used when it is asked for
+#if defined(BOOST_CRYPT_ENABLE_ZLIB) && defined(__has_include)
+#  if __has_include(<zlib.h>)
+#    define BOOST_CRYPT_HAS_ZLIB
+#  endif
+#endif
+
+#if defined(BOOST_CRYPT_ENABLE_ZSTD) && defined(__has_include)
+#  if __has_include(<zstd.h>)
+#    define BOOST_CRYPT_HAS_ZSTD
+#  endif
+#endif
+
+// Size of the individual buffers used when reading files
+#ifndef BOOST_CRYPT_FILE_BUFFER_SIZE
+#  define BOOST_CRYPT_FILE_BUFFER_SIZE 1048576
+#endif
+
+// Files at least this large are memory mapped when using read_mode::automatic
+#ifndef BOOST_CRYPT_MMAP_THRESHOLD
+#  define BOOST_CRYPT_MMAP_THRESHOLD 4194304
+#endif
+
+// Largest part of a file that is mapped at any one time
+#ifndef BOOST_CRYPT_MMAP_WINDOW_SIZE
+#  define BOOST_CRYPT_MMAP_WINDOW_SIZE 67108864
+#endif
+
+// How far ahead of the hasher read_mode::scan asks the kernel to read
+#ifndef BOOST_CRYPT_SCAN_READAHEAD_SIZE
+#  define BOOST_CRYPT_SCAN_READAHEAD_SIZE 8388608
+#endif
+
+// Size that pipes being hashed are grown to, and of the buffer they are read into
+#ifndef BOOST_CRYPT_PIPE_BUFFER_SIZE
+#  define BOOST_CRYPT_PIPE_BUFFER_SIZE 1048576
+#endif
+// ----- File I/O -----
+
 // ----- Unreachable -----
 #if defined(__GNUC__) || defined(__clang__)
 #  define BOOST_CRYPT_UNREACHABLE __builtin_unreachable()
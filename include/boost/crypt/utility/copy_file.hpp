@@ -0,0 +1,314 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// Copies a file while hashing it, so that the source is only read once
+
+#ifndef BOOST_CRYPT_UTILITY_COPY_FILE_HPP
+#define BOOST_CRYPT_UTILITY_COPY_FILE_HPP
+
+#include <boost/crypt/utility/config.hpp>
+#include <boost/crypt/utility/buffer_ring.hpp>
+#include <boost/crypt/utility/posix_file.hpp>
+#include <boost/crypt/utility/pipeline.hpp>
+#include <boost/crypt/utility/pipe.hpp>
+
+#ifdef BOOST_CRYPT_HAS_DIRECT_IO
+#include <boost/crypt/utility/direct_file.hpp>
+#endif
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+namespace boost {
+namespace crypt {
+namespace utility {
+
+// When the copy is flushed to stable storage, once everything has been written
+enum class copy_sync
+{
+    none,   // Leave it to the kernel to write back the page cache
+    data,   // fdatasync(2) the destination
+    all     // fsync(2) the destination, including its metadata
+};
+
+// How the destination is written
+enum class copy_mode
+{
+    buffered,   // Through the page cache
+    direct      // With O_DIRECT where it is supported, so that the copy does not evict other files from the cache
+};
+
+namespace detail {
+
+// The destination of copy_and_hash_file.
+// O_DIRECT writes must start and end on multiples of alignment(), so the flag is dropped for a final partial block
+class copy_sink
+{
+private:
+    int fd_ {-1};
+    std::size_t alignment_ {1U};
+    bool direct_ {};
+
+public:
+    copy_sink() = default;
+    copy_sink(const copy_sink&) = delete;
+    auto operator=(const copy_sink&) -> copy_sink& = delete;
+
+    // Creates or truncates the file, and returns the errno of a failure or 0
+    auto open(const char* filename, ::mode_t permissions, copy_mode mode) noexcept -> int
+    {
+        constexpr int flags {O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC};
+
+        #ifdef BOOST_CRYPT_HAS_DIRECT_IO
+        if (mode == copy_mode::direct)
+        {
+            do
+            {
+                fd_ = ::open(filename, flags | O_DIRECT, permissions);
+            } while (fd_ < 0 && errno == EINTR);
+
+            // Filesystems such as tmpfs do not support O_DIRECT at all
+            if (fd_ >= 0)
+            {
+                struct stat st {};
+                direct_ = true;
+                alignment_ = ::fstat(fd_, &st) == 0 ? direct_io_alignment(fd_, st) : page_size();
+                return 0;
+            }
+            else if (errno != EINVAL)
+            {
+                return errno;
+            }
+        }
+        #else
+        static_cast<void>(mode);
+        #endif
+
+        do
+        {
+            fd_ = ::open(filename, flags, permissions);
+        } while (fd_ < 0 && errno == EINTR);
+
+        return fd_ < 0 ? errno : 0;
+    }
+
+    auto write(const std::uint8_t* data, std::size_t size) noexcept -> int
+    {
+        #ifdef BOOST_CRYPT_HAS_DIRECT_IO
+        if (direct_ && size % alignment_ != 0U)
+        {
+            // Every earlier write was a whole number of blocks, so only the length is unaligned
+            const auto flags {::fcntl(fd_, F_GETFL)};
+            if (flags < 0 || ::fcntl(fd_, F_SETFL, flags & ~O_DIRECT) != 0)
+            {
+                return errno;
+            }
+            direct_ = false;
+        }
+        #endif
+
+        return write_all(fd_, data, size);
+    }
+
+    // Flushes the file as requested and closes it, and returns the errno of a failure or 0
+    auto finish(copy_sync sync) noexcept -> int
+    {
+        int err {};
+        if (sync == copy_sync::data)
+        {
+            #if defined(_POSIX_SYNCHRONIZED_IO) && _POSIX_SYNCHRONIZED_IO > 0
+            err = ::fdatasync(fd_) == 0 ? 0 : errno;
+            #else
+            err = ::fsync(fd_) == 0 ? 0 : errno;
+            #endif
+        }
+        else if (sync == copy_sync::all)
+        {
+            err = ::fsync(fd_) == 0 ? 0 : errno;
+        }
+
+        // Some filesystems only report a failed write back when the file is closed
+        if (::close(fd_) != 0 && err == 0 && errno != EINTR)
+        {
+            err = errno;
+        }
+
+        fd_ = -1;
+        return err;
+    }
+
+    auto alignment() const noexcept -> std::size_t
+    {
+        return alignment_;
+    }
+
+    // True while the file is being written with O_DIRECT
+    auto direct() const noexcept -> bool
+    {
+        return direct_;
+    }
+
+    ~copy_sink()
+    {
+        if (fd_ >= 0)
+        {
+            ::close(fd_);
+        }
+    }
+};
+
+} // namespace detail
+
+// Copies from to to, and hashes the bytes as they are written.
+// A reader thread fills a ring of queue_depth buffers of buffer_size bytes from the source, and each buffer is then
+// both written by a writer thread and hashed by the calling thread, so the source is read once and the read, the write
+// and the hash all overlap. The digest therefore covers exactly the bytes that were handed to write(2).
+// The destination is created with the permissions of the source, or truncated if it exists, and is flushed as sync asks.
+// Copying a file onto itself is refused with std::errc::invalid_argument rather than truncating it.
+// Returns the error of the first failed open, read, write or flush, in which case the destination is left incomplete.
+// If the hasher throws, the other threads are stopped and the exception is propagated
+template <typename Hasher>
+auto copy_and_hash_file(const char* from, const char* to, Hasher& hasher,
+                        copy_sync sync = copy_sync::none, copy_mode mode = copy_mode::buffered,
+                        std::size_t queue_depth = default_queue_depth, std::size_t buffer_size = 0U) -> std::error_code
+{
+    std::error_code ec;
+    posix_file_reader source(from, ec);
+    if (ec)
+    {
+        return ec;
+    }
+
+    struct stat from_st {};
+    struct stat to_st {};
+    if (::stat(from, &from_st) != 0)
+    {
+        return std::error_code(errno, std::system_category());
+    }
+    if (::stat(to, &to_st) == 0 && from_st.st_dev == to_st.st_dev && from_st.st_ino == to_st.st_ino)
+    {
+        return std::make_error_code(std::errc::invalid_argument);
+    }
+
+    detail::copy_sink sink;
+    auto err {sink.open(to, from_st.st_mode & 0777, mode)};
+    if (err != 0)
+    {
+        return std::error_code(err, std::system_category());
+    }
+
+    // Whole slots are written with O_DIRECT, so they are aligned and a multiple of the block size
+    const auto alignment {sink.alignment()};
+    auto slot_size {buffer_size == 0U ? std::size_t{BOOST_CRYPT_FILE_BUFFER_SIZE} : buffer_size};
+    slot_size = (slot_size + alignment - 1U) / alignment * alignment;
+
+    // Consumer 0 hashes on this thread and consumer 1 writes
+    buffer_ring ring(queue_depth, slot_size, 2U, alignment);
+
+    int read_err {};
+    std::thread reader([&source, &ring, &read_err]() {
+        try
+        {
+            read_err = detail::fill_ring_from(source, ring);
+        }
+        catch (...)
+        {
+            read_err = ENOMEM;
+            ring.abort();
+        }
+    });
+
+    int write_err {};
+    std::thread writer;
+    try
+    {
+        writer = std::thread([&sink, &ring, &write_err]() {
+            try
+            {
+                const std::uint8_t* data {};
+                std::size_t size {};
+                while (ring.next(1U, data, size))
+                {
+                    write_err = sink.write(data, size);
+                    if (write_err != 0)
+                    {
+                        ring.abort();
+                        return;
+                    }
+                    ring.release(1U);
+                }
+            }
+            catch (...)
+            {
+                write_err = ENOMEM;
+                ring.abort();
+            }
+        });
+    }
+    catch (...)
+    {
+        // The reader is already running and may be waiting on a full ring
+        ring.abort();
+        reader.join();
+        throw;
+    }
+
+    try
+    {
+        const std::uint8_t* data {};
+        std::size_t size {};
+        while (ring.next(0U, data, size))
+        {
+            hasher.process_bytes(data, size);
+            ring.release(0U);
+        }
+    }
+    catch (...)
+    {
+        ring.abort();
+        reader.join();
+        writer.join();
+        throw;
+    }
+
+    reader.join();
+    writer.join();
+
+    err = read_err != 0 ? read_err : write_err;
+    const auto sync_err {sink.finish(sync)};
+    if (err == 0)
+    {
+        err = sync_err;
+    }
+
+    return err == 0 ? std::error_code{} : std::error_code(err, std::system_category());
+}
+
+template <typename Hasher>
+auto copy_and_hash_file(const std::string& from, const std::string& to, Hasher& hasher,
+                        copy_sync sync = copy_sync::none, copy_mode mode = copy_mode::buffered,
+                        std::size_t queue_depth = default_queue_depth, std::size_t buffer_size = 0U) -> std::error_code
+{
+    return copy_and_hash_file(from.c_str(), to.c_str(), hasher, sync, mode, queue_depth, buffer_size);
+}
+
+} // namespace utility
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#endif // BOOST_CRYPT_UTILITY_COPY_FILE_HPP
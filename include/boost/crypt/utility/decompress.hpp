@@ -0,0 +1,545 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// Hashes the uncompressed contents of gzip and zstd files without writing them anywhere
+
+#ifndef BOOST_CRYPT_UTILITY_DECOMPRESS_HPP
+#define BOOST_CRYPT_UTILITY_DECOMPRESS_HPP
+
+#include <boost/crypt/utility/config.hpp>
+#include <boost/crypt/utility/buffer_ring.hpp>
+#include <boost/crypt/utility/posix_file.hpp>
+#include <boost/crypt/utility/mapped_file.hpp>
+#include <boost/crypt/utility/pipeline.hpp>
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <new>
+#include <string>
+#include <system_error>
+#include <thread>
+#ifdef BOOST_CRYPT_HAS_ZLIB
+#include <zlib.h>
+#endif
+#ifdef BOOST_CRYPT_HAS_ZSTD
+#include <zstd.h>
+#endif
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+#include <sys/stat.h>
+#endif
+#endif
+
+namespace boost {
+namespace crypt {
+namespace utility {
+
+// The format of a compressed input
+enum class compression
+{
+    automatic,  // Detected from the magic bytes at the start of the input, which is hashed as is if it matches neither
+    none,       // Hashed as is
+    gzip,       // RFC 1952, including several members one after another as written by pigz
+    zstd        // Any number of zstd frames
+};
+
+namespace detail {
+
+inline auto detect_compression(const std::uint8_t* data, std::size_t size) noexcept -> compression
+{
+    if (size >= 2U && data[0] == 0x1FU && data[1] == 0x8BU)
+    {
+        return compression::gzip;
+    }
+    if (size >= 4U && data[0] == 0x28U && data[1] == 0xB5U && data[2] == 0x2FU && data[3] == 0xFDU)
+    {
+        return compression::zstd;
+    }
+
+    return compression::none;
+}
+
+// Each decoder decompresses as much of [in, in + in_size) into [out, out + out_size) as fits, advancing both,
+// and returns EILSEQ if the data is corrupt, EBADMSG if something other than a stream follows a stream, or 0.
+// complete() is true when the input seen so far ends at the end of a stream
+class copy_decoder
+{
+public:
+    auto valid() const noexcept -> bool
+    {
+        return true;
+    }
+
+    auto decode(const std::uint8_t*& in, std::size_t& in_size, std::uint8_t*& out, std::size_t& out_size) noexcept -> int
+    {
+        const auto len {(std::min)(in_size, out_size)};
+        std::memcpy(out, in, len);
+        in += len;
+        in_size -= len;
+        out += len;
+        out_size -= len;
+        return 0;
+    }
+
+    auto complete() const noexcept -> bool
+    {
+        return true;
+    }
+};
+
+#ifdef BOOST_CRYPT_HAS_ZLIB
+
+// After each member only another member, starting with the magic 1f 8b, or zeros up to the end of the file
+// are accepted. The zeros are the padding that tapes and some block devices leave, which gzip ignores too
+class gzip_decoder
+{
+private:
+    z_stream stream_ {};
+    bool valid_ {};
+    bool end_ {};
+    bool magic_seen_ {}; // The first byte of the next member arrived at the end of the last input
+    bool padding_ {};
+
+    // Starts the next member, feeding inflate the first byte of its magic if that was consumed already
+    auto next_member() noexcept -> int
+    {
+        if (::inflateReset(&stream_) != Z_OK)
+        {
+            return EILSEQ;
+        }
+
+        end_ = false;
+        if (magic_seen_)
+        {
+            magic_seen_ = false;
+
+            Bytef magic {0x1FU};
+            Bytef unused {};
+            stream_.next_in = &magic;
+            stream_.avail_in = 1U;
+            stream_.next_out = &unused;
+            stream_.avail_out = 0U;
+            if (::inflate(&stream_, Z_NO_FLUSH) != Z_OK || stream_.avail_in != 0U)
+            {
+                return EILSEQ; // LCOV_EXCL_LINE
+            }
+        }
+
+        return 0;
+    }
+
+    // Looks at what follows a member, and returns 0 once the next one has been started or the input is used up
+    auto after_member(const std::uint8_t*& in, std::size_t& in_size) noexcept -> int
+    {
+        if (padding_)
+        {
+            while (in_size > 0U && *in == 0U)
+            {
+                ++in;
+                --in_size;
+            }
+
+            return in_size == 0U ? 0 : EBADMSG;
+        }
+
+        if (magic_seen_)
+        {
+            return *in == 0x8BU ? next_member() : EBADMSG;
+        }
+
+        if (*in == 0x1FU)
+        {
+            if (in_size == 1U)
+            {
+                magic_seen_ = true;
+                ++in;
+                --in_size;
+                return 0;
+            }
+
+            return in[1] == 0x8BU ? next_member() : EBADMSG;
+        }
+
+        if (*in == 0U)
+        {
+            padding_ = true;
+            return after_member(in, in_size);
+        }
+
+        return EBADMSG;
+    }
+
+public:
+    gzip_decoder() noexcept
+    {
+        // A window of 15 bits plus 16 accepts only the gzip wrapper
+        valid_ = ::inflateInit2(&stream_, 15 + 16) == Z_OK;
+    }
+
+    gzip_decoder(const gzip_decoder&) = delete;
+    auto operator=(const gzip_decoder&) -> gzip_decoder& = delete;
+
+    auto valid() const noexcept -> bool
+    {
+        return valid_;
+    }
+
+    auto decode(const std::uint8_t*& in, std::size_t& in_size, std::uint8_t*& out, std::size_t& out_size) noexcept -> int
+    {
+        while (in_size > 0U && out_size > 0U)
+        {
+            // Another member, or the padding, follows the one that has just ended
+            if (end_)
+            {
+                const auto err {after_member(in, in_size)};
+                if (err != 0)
+                {
+                    return err;
+                }
+                if (end_)
+                {
+                    continue;
+                }
+            }
+
+            const auto avail_in {static_cast<uInt>((std::min)(in_size, static_cast<std::size_t>(UINT_MAX)))};
+            const auto avail_out {static_cast<uInt>((std::min)(out_size, static_cast<std::size_t>(UINT_MAX)))};
+            stream_.next_in = const_cast<Bytef*>(in);
+            stream_.avail_in = avail_in;
+            stream_.next_out = out;
+            stream_.avail_out = avail_out;
+
+            const auto res {::inflate(&stream_, Z_NO_FLUSH)};
+
+            const auto consumed {static_cast<std::size_t>(avail_in - stream_.avail_in)};
+            const auto produced {static_cast<std::size_t>(avail_out - stream_.avail_out)};
+            in += consumed;
+            in_size -= consumed;
+            out += produced;
+            out_size -= produced;
+
+            if (res == Z_STREAM_END)
+            {
+                end_ = true;
+            }
+            else if (res != Z_OK)
+            {
+                return EILSEQ;
+            }
+        }
+
+        return 0;
+    }
+
+    auto complete() const noexcept -> bool
+    {
+        return end_ && !magic_seen_;
+    }
+
+    ~gzip_decoder()
+    {
+        if (valid_)
+        {
+            ::inflateEnd(&stream_);
+        }
+    }
+};
+
+#endif // BOOST_CRYPT_HAS_ZLIB
+
+#ifdef BOOST_CRYPT_HAS_ZSTD
+
+class zstd_decoder
+{
+private:
+    ZSTD_DStream* stream_ {};
+    bool end_ {};
+
+public:
+    zstd_decoder() noexcept : stream_ {::ZSTD_createDStream()}
+    {
+        if (stream_ != nullptr && ::ZSTD_isError(::ZSTD_initDStream(stream_)))
+        {
+            ::ZSTD_freeDStream(stream_);
+            stream_ = nullptr;
+        }
+    }
+
+    zstd_decoder(const zstd_decoder&) = delete;
+    auto operator=(const zstd_decoder&) -> zstd_decoder& = delete;
+
+    auto valid() const noexcept -> bool
+    {
+        return stream_ != nullptr;
+    }
+
+    // Unlike inflate, zstd can hold decompressed data back once the input is used up,
+    // so it is called until it leaves space in the output even when there is no more input
+    auto decode(const std::uint8_t*& in, std::size_t& in_size, std::uint8_t*& out, std::size_t& out_size) noexcept -> int
+    {
+        while (out_size > 0U)
+        {
+            ZSTD_inBuffer input {in, in_size, 0U};
+            ZSTD_outBuffer output {out, out_size, 0U};
+
+            const auto res {::ZSTD_decompressStream(stream_, &output, &input)};
+            if (::ZSTD_isError(res))
+            {
+                return EILSEQ;
+            }
+
+            if (output.pos == 0U && input.pos == 0U)
+            {
+                break;
+            }
+
+            in += input.pos;
+            in_size -= input.pos;
+            out += output.pos;
+            out_size -= output.pos;
+
+            // 0 means a frame has been completely decoded and flushed
+            end_ = res == 0U;
+        }
+
+        return 0;
+    }
+
+    auto complete() const noexcept -> bool
+    {
+        return end_;
+    }
+
+    ~zstd_decoder()
+    {
+        ::ZSTD_freeDStream(stream_);
+    }
+};
+
+#endif // BOOST_CRYPT_HAS_ZSTD
+
+} // namespace detail
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+namespace detail {
+
+// Reads the compressed input and decompresses it into the ring, starting with the size bytes already in input.
+// Returns the errno of a failed read, EILSEQ for corrupt data, EIO for a truncated stream, or 0
+template <typename Decoder>
+auto decompress_into_ring(posix_file_reader& source, std::uint8_t* input, std::size_t capacity, std::size_t size,
+                          buffer_ring& ring) -> int
+{
+    Decoder decoder;
+    if (!decoder.valid())
+    {
+        ring.abort();
+        return ENOMEM;
+    }
+
+    const std::uint8_t* in {input};
+    std::size_t in_size {size};
+    std::uint8_t* slot {};
+    std::uint8_t* out {};
+    std::size_t out_size {};
+
+    while (true)
+    {
+        if (in_size == 0U && !source.eof())
+        {
+            in = input;
+            in_size = source.read_into(input, capacity);
+            if (source.error() != 0)
+            {
+                ring.abort();
+                return source.error();
+            }
+        }
+
+        if (slot == nullptr)
+        {
+            slot = ring.acquire();
+            if (slot == nullptr)
+            {
+                return 0;
+            }
+            out = slot;
+            out_size = ring.slot_size();
+        }
+
+        const auto err {decoder.decode(in, in_size, out, out_size)};
+        if (err != 0)
+        {
+            ring.abort();
+            return err;
+        }
+
+        if (out_size == 0U)
+        {
+            ring.commit(ring.slot_size());
+            slot = nullptr;
+        }
+        else if (in_size == 0U && source.eof())
+        {
+            break;
+        }
+    }
+
+    if (out != slot)
+    {
+        ring.commit(static_cast<std::size_t>(out - slot));
+    }
+
+    if (!decoder.complete())
+    {
+        ring.abort();
+        return EIO;
+    }
+
+    ring.close();
+    return 0;
+}
+
+template <typename Hasher>
+auto decompress_and_hash(posix_file_reader& source, Hasher& hasher, compression format,
+                         std::size_t queue_depth, std::size_t buffer_size) -> std::error_code
+{
+    buffer_size = buffer_size == 0U ? std::size_t{BOOST_CRYPT_FILE_BUFFER_SIZE} : buffer_size;
+
+    std::unique_ptr<std::uint8_t[]> input {new std::uint8_t[buffer_size]};
+    const auto first {source.read_into(input.get(), buffer_size)};
+    if (source.error() != 0)
+    {
+        return std::error_code(source.error(), std::system_category());
+    }
+
+    if (format == compression::automatic)
+    {
+        format = detect_compression(input.get(), first);
+    }
+
+    #ifndef BOOST_CRYPT_HAS_ZLIB
+    if (format == compression::gzip)
+    {
+        return std::make_error_code(std::errc::not_supported);
+    }
+    #endif
+    #ifndef BOOST_CRYPT_HAS_ZSTD
+    if (format == compression::zstd)
+    {
+        return std::make_error_code(std::errc::not_supported);
+    }
+    #endif
+
+    // The decompressed data goes into page aligned buffers of whole pages, ready to be handed to any reader of the ring
+    const auto alignment {page_size()};
+    buffer_ring ring(queue_depth, (buffer_size + alignment - 1U) / alignment * alignment, 1U, alignment);
+
+    int decode_err {};
+    std::thread decoder([&]() {
+        try
+        {
+            switch (format)
+            {
+                #ifdef BOOST_CRYPT_HAS_ZLIB
+                case compression::gzip:
+                    decode_err = decompress_into_ring<gzip_decoder>(source, input.get(), buffer_size, first, ring);
+                    break;
+                #endif
+                #ifdef BOOST_CRYPT_HAS_ZSTD
+                case compression::zstd:
+                    decode_err = decompress_into_ring<zstd_decoder>(source, input.get(), buffer_size, first, ring);
+                    break;
+                #endif
+                default:
+                    decode_err = decompress_into_ring<copy_decoder>(source, input.get(), buffer_size, first, ring);
+                    break;
+            }
+        }
+        catch (...)
+        {
+            decode_err = ENOMEM;
+            ring.abort();
+        }
+    });
+
+    try
+    {
+        const std::uint8_t* data {};
+        std::size_t size {};
+        while (ring.next(0U, data, size))
+        {
+            hasher.process_bytes(data, size);
+            ring.release(0U);
+        }
+    }
+    catch (...)
+    {
+        ring.abort();
+        decoder.join();
+        throw;
+    }
+
+    decoder.join();
+    return decode_err == 0 ? std::error_code{} : std::error_code(decode_err, std::system_category());
+}
+
+} // namespace detail
+
+// Hashes the uncompressed contents of a gzip or zstd file, as if it had been decompressed to a file first.
+// A decoder thread reads and decompresses the file into a ring of queue_depth page aligned buffers of buffer_size bytes,
+// while the calling thread hashes the buffers that are ready, so memory use is bounded whatever the size of the contents.
+// Returns the error of a failed open or read, std::errc::not_supported for a format that was not enabled,
+// std::errc::illegal_byte_sequence for corrupt data, or std::errc::io_error if the compressed stream is truncated.
+// If the hasher throws, the decoder is stopped and the exception is propagated
+template <typename Hasher>
+auto decompress_and_hash_file(const char* filepath, Hasher& hasher, compression format = compression::automatic,
+                              std::size_t queue_depth = default_queue_depth, std::size_t buffer_size = 0U) -> std::error_code
+{
+    std::error_code ec;
+    posix_file_reader source(filepath, ec);
+    if (ec)
+    {
+        return ec;
+    }
+
+    return detail::decompress_and_hash(source, hasher, format, queue_depth, buffer_size);
+}
+
+template <typename Hasher>
+auto decompress_and_hash_file(const std::string& filepath, Hasher& hasher, compression format = compression::automatic,
+                              std::size_t queue_depth = default_queue_depth, std::size_t buffer_size = 0U) -> std::error_code
+{
+    return decompress_and_hash_file(filepath.c_str(), hasher, format, queue_depth, buffer_size);
+}
+
+// Reads the compressed data from a descriptor owned by the caller, such as stdin receiving a download.
+// Regular files are read from the start, and pipes from where they are
+template <typename Hasher>
+auto decompress_and_hash_file(int fd, Hasher& hasher, compression format = compression::automatic,
+                              std::size_t queue_depth = default_queue_depth, std::size_t buffer_size = 0U) -> std::error_code
+{
+    struct stat st {};
+    if (fd < 0 || ::fstat(fd, &st) != 0)
+    {
+        return std::make_error_code(std::errc::bad_file_descriptor);
+    }
+
+    posix_file_reader source(fd, 0U, (std::numeric_limits<std::uint64_t>::max)());
+    return detail::decompress_and_hash(source, hasher, format, queue_depth, buffer_size);
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+} // namespace utility
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_UTILITY_DECOMPRESS_HPP
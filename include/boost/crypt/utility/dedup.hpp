@@ -0,0 +1,629 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// Finds files with the same contents, reading as little of each file as it takes to tell it apart from the others
+
+#ifndef BOOST_CRYPT_UTILITY_DEDUP_HPP
+#define BOOST_CRYPT_UTILITY_DEDUP_HPP
+
+#include <boost/crypt/utility/config.hpp>
+#include <boost/crypt/utility/multi_file.hpp>
+#include <boost/crypt/utility/posix_file.hpp>
+#include <boost/crypt/utility/thread_pool.hpp>
+#include <boost/crypt/utility/tree.hpp>
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+namespace boost {
+namespace crypt {
+namespace utility {
+
+// Bytes read from each end of a file by the partial hash
+BOOST_CRYPT_INLINE_CONSTEXPR std::size_t default_dedup_sample_size {4096U};
+
+struct dedup_options
+{
+    // Threads that list directories and read files. 0 uses twice the number of hardware threads, and at least 4
+    std::size_t thread_count {};
+
+    // The partial hash covers this many bytes from the start of the file and this many from the end
+    std::size_t sample_size {default_dedup_sample_size};
+
+    // Smaller files are ignored, which by default leaves out empty files
+    std::uint64_t min_size {1U};
+
+    // Size of the read buffer of each thread for the full hash
+    std::size_t buffer_size {default_multi_file_buffer_size};
+};
+
+// The number of files and bytes that went through each stage. Hard links to the same file count as one file
+// everywhere but in files, and are only ever read once
+struct dedup_stats
+{
+    // Regular files of at least min_size bytes that were found, counting each hard link
+    std::uint64_t files;
+
+    // What hashing every file in full would have read
+    std::uint64_t total_bytes;
+
+    // Files that had the same size as another, and were given a partial hash
+    std::uint64_t partial_files;
+    std::uint64_t partial_bytes_read;
+
+    // Files that still matched another after the partial hash, and were hashed in full
+    std::uint64_t full_files;
+    std::uint64_t full_bytes_read;
+
+    // Bytes that were not read because no other file had the same size
+    std::uint64_t saved_by_size;
+
+    // Bytes that were not read because no other file had the same partial hash, less what the partial hashes read
+    std::uint64_t saved_by_partial;
+
+    // Bytes taken up by the second and later copies in every group
+    std::uint64_t duplicate_bytes;
+};
+
+template <typename Digest>
+struct dedup_group
+{
+    std::uint64_t size;
+    Digest digest;
+
+    // Sorted, and including every hard link. There are always at least two different files among them
+    std::vector<std::string> paths;
+};
+
+struct dedup_failure
+{
+    std::string path;
+    std::error_code ec;
+};
+
+template <typename Digest>
+struct dedup_result
+{
+    // Sorted by size, largest first, and then by the first path
+    std::vector<dedup_group<Digest>> groups;
+
+    // Files and directories that could not be listed or read, which are left out of the groups
+    std::vector<dedup_failure> failures;
+
+    dedup_stats stats;
+};
+
+namespace detail {
+
+// Files are handed to a thread in batches of this many during the partial hash, since each only takes two small reads
+BOOST_CRYPT_INLINE_CONSTEXPR std::size_t dedup_partial_batch {32U};
+
+struct dedup_file
+{
+    std::string path;
+    std::uint64_t size;
+    std::uint64_t device;
+    std::uint64_t inode;
+};
+
+// One file on disk, however many hard links it has, which are files[first, first + count)
+template <typename Digest>
+struct dedup_inode
+{
+    std::size_t first;
+    std::size_t count;
+    std::uint64_t size;
+    Digest partial;
+    Digest full;
+
+    // Set if the partial hash read the whole file, in which case it is also the full hash
+    bool complete;
+    int error;
+};
+
+template <typename Digest>
+auto dedup_compare(const Digest& lhs, const Digest& rhs) noexcept -> int
+{
+    for (std::size_t i {}; i < lhs.size(); ++i)
+    {
+        if (lhs[i] != rhs[i])
+        {
+            return lhs[i] < rhs[i] ? -1 : 1;
+        }
+    }
+
+    return 0;
+}
+
+inline auto dedup_pread(int fd, std::uint8_t* data, std::size_t size, std::uint64_t offset) noexcept -> int
+{
+    while (size > 0U)
+    {
+        const auto res {::pread(fd, data, size, static_cast<::off_t>(offset))};
+        if (res < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (res < 0)
+        {
+            return errno;
+        }
+        if (res == 0)
+        {
+            // Shorter than it was when it was listed
+            return EAGAIN;
+        }
+
+        data += res;
+        size -= static_cast<std::size_t>(res);
+        offset += static_cast<std::uint64_t>(res);
+    }
+
+    return 0;
+}
+
+inline auto dedup_thread_count(std::size_t thread_count) -> std::size_t
+{
+    // Threads spend most of their time blocked in the kernel, so use more than the number of cores
+    return thread_count != 0U ? thread_count :
+        (std::max)(std::size_t{4U}, 2U * static_cast<std::size_t>(std::thread::hardware_concurrency()));
+}
+
+// Lists every regular file under the roots on the pool, with the size and identity from one fstatat(2) each
+class dedup_walker
+{
+private:
+    using directory_ptr = std::shared_ptr<tree_directory>;
+
+    const dedup_options& options_;
+    work_stealing_pool& pool_;
+    std::vector<std::vector<dedup_file>> found_;
+    std::vector<std::vector<char>> listing_buffers_;
+    std::vector<dedup_failure>& failures_;
+    std::mutex failures_mutex_;
+
+    auto fail(const std::string& path, int error) -> void
+    {
+        std::lock_guard<std::mutex> lock(failures_mutex_);
+        failures_.push_back(dedup_failure{path, std::error_code(error, std::system_category())});
+    }
+
+    auto add(const std::string& path, const struct stat& st) -> void
+    {
+        if (S_ISREG(st.st_mode) && static_cast<std::uint64_t>(st.st_size) >= options_.min_size)
+        {
+            found_[pool_.current_worker()].push_back(dedup_file{path, static_cast<std::uint64_t>(st.st_size),
+                                                                static_cast<std::uint64_t>(st.st_dev),
+                                                                static_cast<std::uint64_t>(st.st_ino)});
+        }
+    }
+
+    auto open_directory(const directory_ptr& parent, const std::string& name) -> void
+    {
+        int fd {};
+        do
+        {
+            fd = ::openat(parent->fd.get(), name.c_str(), open_read_flags | O_DIRECTORY | O_NOFOLLOW);
+        } while (fd < 0 && errno == EINTR);
+
+        const auto path {tree_join(parent->path, name)};
+        if (fd < 0)
+        {
+            if (errno != ELOOP)
+            {
+                fail(path, errno);
+            }
+            return;
+        }
+
+        tree_fd directory_fd {fd};
+        list(std::make_shared<tree_directory>(std::move(directory_fd), path));
+    }
+
+    auto list(const directory_ptr& directory) -> void
+    {
+        const auto error {tree_list_directory(directory->fd.get(), listing_buffers_[pool_.current_worker()],
+                                              [&](const char* name, tree_entry_kind kind) {
+            if (kind == tree_entry_kind::directory)
+            {
+                const std::string subdirectory {name};
+                pool_.submit([this, directory, subdirectory]() { open_directory(directory, subdirectory); });
+            }
+            else if (kind == tree_entry_kind::file || kind == tree_entry_kind::unknown)
+            {
+                struct stat st {};
+                if (::fstatat(directory->fd.get(), name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+                {
+                    fail(tree_join(directory->path, name), errno);
+                }
+                else if (S_ISDIR(st.st_mode))
+                {
+                    const std::string subdirectory {name};
+                    pool_.submit([this, directory, subdirectory]() { open_directory(directory, subdirectory); });
+                }
+                else
+                {
+                    add(tree_join(directory->path, name), st);
+                }
+            }
+        })};
+
+        if (error != 0)
+        {
+            fail(directory->path, error);
+        }
+    }
+
+public:
+    dedup_walker(const dedup_options& options, work_stealing_pool& pool, std::vector<dedup_failure>& failures)
+        : options_ {options}, pool_ {pool}, found_(pool.thread_count()), failures_ {failures}
+    {
+        for (std::size_t i {}; i < pool_.thread_count(); ++i)
+        {
+            listing_buffers_.emplace_back(tree_listing_buffer_size);
+        }
+    }
+
+    // A root that is a file is taken as it is, and a directory is walked with paths of the form root/relative/path
+    auto run(const std::vector<std::string>& roots) -> std::vector<dedup_file>
+    {
+        for (const auto& root : roots)
+        {
+            pool_.submit([this, root]() {
+                int fd {};
+                do
+                {
+                    fd = ::open(root.c_str(), open_read_flags | O_NONBLOCK | O_NOCTTY);
+                } while (fd < 0 && errno == EINTR);
+
+                if (fd < 0)
+                {
+                    fail(root, errno);
+                    return;
+                }
+
+                tree_fd root_fd {fd};
+                struct stat st {};
+                if (::fstat(fd, &st) != 0)
+                {
+                    fail(root, errno);
+                }
+                else if (S_ISDIR(st.st_mode))
+                {
+                    auto path {root};
+                    while (path.size() > 1U && path.back() == '/')
+                    {
+                        path.pop_back();
+                    }
+                    list(std::make_shared<tree_directory>(std::move(root_fd), path));
+                }
+                else
+                {
+                    add(root, st);
+                }
+            });
+        }
+        pool_.wait();
+
+        std::vector<dedup_file> files;
+        for (auto& found : found_)
+        {
+            for (auto& file : found)
+            {
+                files.push_back(std::move(file));
+            }
+            found.clear();
+        }
+
+        return files;
+    }
+};
+
+// Runs f(i, worker) for every i in [0, count) on the pool, in batches of batch_size
+template <typename F>
+auto dedup_for_each(work_stealing_pool& pool, std::size_t count, std::size_t batch_size, F&& f) -> void
+{
+    for (std::size_t begin {}; begin < count; begin += batch_size)
+    {
+        const auto end {(std::min)(count, begin + batch_size)};
+        pool.submit([&pool, &f, begin, end]() {
+            const auto worker {pool.current_worker()};
+            for (std::size_t i {begin}; i < end; ++i)
+            {
+                f(i, worker);
+            }
+        });
+    }
+    pool.wait();
+}
+
+// Hashes the first and last sample_size bytes of the file, or all of it if that is no more than twice sample_size
+template <typename Hasher, typename Digest>
+auto dedup_partial_hash(const std::string& path, dedup_inode<Digest>& inode, std::uint8_t* buffer, std::size_t sample_size) -> std::uint64_t
+{
+    int fd {};
+    do
+    {
+        fd = ::open(path.c_str(), open_read_flags | O_NOFOLLOW | O_NONBLOCK | O_NOCTTY);
+    } while (fd < 0 && errno == EINTR);
+
+    if (fd < 0)
+    {
+        inode.error = errno;
+        return 0U;
+    }
+
+    const tree_fd file {fd};
+    Hasher hasher {};
+    std::uint64_t read {};
+
+    inode.complete = inode.size <= 2U * static_cast<std::uint64_t>(sample_size);
+    if (inode.complete)
+    {
+        const auto size {static_cast<std::size_t>(inode.size)};
+        inode.error = dedup_pread(fd, buffer, size, 0U);
+        hasher.process_bytes(static_cast<const std::uint8_t*>(buffer), size);
+        read = size;
+    }
+    else
+    {
+        inode.error = dedup_pread(fd, buffer, sample_size, 0U);
+        if (inode.error == 0)
+        {
+            hasher.process_bytes(static_cast<const std::uint8_t*>(buffer), sample_size);
+            inode.error = dedup_pread(fd, buffer, sample_size, inode.size - sample_size);
+            hasher.process_bytes(static_cast<const std::uint8_t*>(buffer), sample_size);
+        }
+        read = 2U * static_cast<std::uint64_t>(sample_size);
+    }
+
+    inode.partial = hasher.get_digest();
+    if (inode.complete)
+    {
+        inode.full = inode.partial;
+    }
+
+    return read;
+}
+
+// Calls f(begin, end) for every run of candidates that compare equal with equal, where candidates is sorted with less
+template <typename Candidates, typename Equal, typename F>
+auto dedup_for_each_run(const Candidates& candidates, Equal&& equal, F&& f) -> void
+{
+    std::size_t begin {};
+    while (begin < candidates.size())
+    {
+        auto end {begin + 1U};
+        while (end < candidates.size() && equal(candidates[begin], candidates[end]))
+        {
+            ++end;
+        }
+
+        f(begin, end);
+        begin = end;
+    }
+}
+
+} // namespace detail
+
+// Finds the regular files under roots that have the same contents, in three stages that each only look at the files
+// the one before could not tell apart:
+// 1. Files are grouped by size, from the listing of each directory and one fstatat(2) per file.
+// 2. Files that share a size are grouped by a hash of their first and last sample_size bytes, read with pread(2).
+// 3. Files that still share both are hashed in full.
+// Every stage runs on the same pool of threads, and the only buffers are one listing buffer and one read buffer per thread.
+// Hard links to the same file are read once, and are only reported alongside a different file with the same contents.
+// Symbolic links and special files are skipped, and links to directories are not followed.
+// If a hasher throws, the exception is propagated
+template <typename Hasher>
+auto find_duplicates(const std::vector<std::string>& roots, const dedup_options& options = dedup_options{})
+    -> dedup_result<decltype(std::declval<Hasher&>().get_digest())>
+{
+    using digest_type = decltype(std::declval<Hasher&>().get_digest());
+    using inode_type = detail::dedup_inode<digest_type>;
+
+    dedup_result<digest_type> result {};
+    const auto sample_size {options.sample_size != 0U ? options.sample_size : default_dedup_sample_size};
+    const auto buffer_size {(std::max)(options.buffer_size, 2U * sample_size)};
+
+    work_stealing_pool pool {detail::dedup_thread_count(options.thread_count)};
+    std::vector<std::unique_ptr<std::uint8_t[]>> buffers;
+    for (std::size_t i {}; i < pool.thread_count(); ++i)
+    {
+        buffers.emplace_back(new std::uint8_t[buffer_size]);
+    }
+
+    auto files {detail::dedup_walker(options, pool, result.failures).run(roots)};
+
+    // Sorting by identity puts the hard links to a file next to each other, and a root listed twice is only counted once
+    std::sort(files.begin(), files.end(), [](const detail::dedup_file& lhs, const detail::dedup_file& rhs) {
+        if (lhs.size != rhs.size)
+        {
+            return lhs.size < rhs.size;
+        }
+        if (lhs.device != rhs.device)
+        {
+            return lhs.device < rhs.device;
+        }
+        return lhs.inode != rhs.inode ? lhs.inode < rhs.inode : lhs.path < rhs.path;
+    });
+    files.erase(std::unique(files.begin(), files.end(), [](const detail::dedup_file& lhs, const detail::dedup_file& rhs) {
+        return lhs.path == rhs.path;
+    }), files.end());
+    result.stats.files = files.size();
+
+    std::vector<inode_type> inodes;
+    for (std::size_t i {}; i < files.size(); ++i)
+    {
+        if (inodes.empty() || files[inodes.back().first].device != files[i].device || files[inodes.back().first].inode != files[i].inode)
+        {
+            inodes.push_back(inode_type{i, 0U, files[i].size, digest_type{}, digest_type{}, false, 0});
+            result.stats.total_bytes += files[i].size;
+        }
+        ++inodes.back().count;
+    }
+
+    // Stage 1: sizes
+    std::vector<std::size_t> candidates;
+    detail::dedup_for_each_run(inodes, [](const inode_type& lhs, const inode_type& rhs) { return lhs.size == rhs.size; },
+                               [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i {begin}; i < end; ++i)
+        {
+            if (end - begin > 1U)
+            {
+                candidates.push_back(i);
+            }
+            else
+            {
+                result.stats.saved_by_size += inodes[i].size;
+            }
+        }
+    });
+
+    // Stage 2: the first and last bytes
+    std::vector<std::uint64_t> partial_read(candidates.size());
+    detail::dedup_for_each(pool, candidates.size(), detail::dedup_partial_batch, [&](std::size_t i, std::size_t worker) {
+        auto& inode {inodes[candidates[i]]};
+        partial_read[i] = detail::dedup_partial_hash<Hasher>(files[inode.first].path, inode, buffers[worker].get(), sample_size);
+    });
+
+    const auto by_partial = [&inodes](std::size_t lhs, std::size_t rhs) {
+        if (inodes[lhs].size != inodes[rhs].size)
+        {
+            return inodes[lhs].size < inodes[rhs].size;
+        }
+        return detail::dedup_compare(inodes[lhs].partial, inodes[rhs].partial) < 0;
+    };
+    const auto same_partial = [&inodes](std::size_t lhs, std::size_t rhs) {
+        return inodes[lhs].size == inodes[rhs].size && detail::dedup_compare(inodes[lhs].partial, inodes[rhs].partial) == 0;
+    };
+
+    std::vector<std::size_t> finalists;
+    std::vector<std::size_t> remaining;
+    for (std::size_t i {}; i < candidates.size(); ++i)
+    {
+        auto& inode {inodes[candidates[i]]};
+        result.stats.partial_bytes_read += partial_read[i];
+        ++result.stats.partial_files;
+        if (inode.error != 0)
+        {
+            result.failures.push_back(dedup_failure{files[inode.first].path, std::error_code(inode.error, std::system_category())});
+        }
+        else
+        {
+            remaining.push_back(candidates[i]);
+        }
+    }
+    std::sort(remaining.begin(), remaining.end(), by_partial);
+
+    std::vector<std::size_t> full_candidates;
+    detail::dedup_for_each_run(remaining, same_partial, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i {begin}; i < end; ++i)
+        {
+            const auto& inode {inodes[remaining[i]]};
+            if (end - begin == 1U)
+            {
+                result.stats.saved_by_partial += inode.size - (inode.complete ? inode.size : 2U * static_cast<std::uint64_t>(sample_size));
+            }
+            else if (inode.complete)
+            {
+                finalists.push_back(remaining[i]);
+            }
+            else
+            {
+                full_candidates.push_back(remaining[i]);
+            }
+        }
+    });
+
+    // Stage 3: everything, for the files that are still not told apart
+    detail::dedup_for_each(pool, full_candidates.size(), 1U, [&](std::size_t i, std::size_t worker) {
+        auto& inode {inodes[full_candidates[i]]};
+        Hasher hasher {};
+        const auto ec {detail::hash_one_file(files[inode.first].path, hasher, buffers[worker].get(), buffer_size)};
+        inode.error = ec.value();
+        inode.full = hasher.get_digest();
+    });
+
+    for (const auto index : full_candidates)
+    {
+        const auto& inode {inodes[index]};
+        ++result.stats.full_files;
+        result.stats.full_bytes_read += inode.size;
+        if (inode.error != 0)
+        {
+            result.failures.push_back(dedup_failure{files[inode.first].path, std::error_code(inode.error, std::system_category())});
+        }
+        else
+        {
+            finalists.push_back(index);
+        }
+    }
+
+    const auto same_full = [&inodes](std::size_t lhs, std::size_t rhs) {
+        return inodes[lhs].size == inodes[rhs].size && detail::dedup_compare(inodes[lhs].full, inodes[rhs].full) == 0;
+    };
+    std::sort(finalists.begin(), finalists.end(), [&inodes](std::size_t lhs, std::size_t rhs) {
+        if (inodes[lhs].size != inodes[rhs].size)
+        {
+            return inodes[lhs].size < inodes[rhs].size;
+        }
+        return detail::dedup_compare(inodes[lhs].full, inodes[rhs].full) < 0;
+    });
+
+    detail::dedup_for_each_run(finalists, same_full, [&](std::size_t begin, std::size_t end) {
+        if (end - begin < 2U)
+        {
+            return;
+        }
+
+        dedup_group<digest_type> group {inodes[finalists[begin]].size, inodes[finalists[begin]].full, {}};
+        for (std::size_t i {begin}; i < end; ++i)
+        {
+            const auto& inode {inodes[finalists[i]]};
+            for (std::size_t j {}; j < inode.count; ++j)
+            {
+                group.paths.push_back(files[inode.first + j].path);
+            }
+        }
+        std::sort(group.paths.begin(), group.paths.end());
+
+        result.stats.duplicate_bytes += group.size * (end - begin - 1U);
+        result.groups.push_back(std::move(group));
+    });
+
+    std::sort(result.groups.begin(), result.groups.end(), [](const dedup_group<digest_type>& lhs, const dedup_group<digest_type>& rhs) {
+        return lhs.size != rhs.size ? lhs.size > rhs.size : lhs.paths.front() < rhs.paths.front();
+    });
+    std::sort(result.failures.begin(), result.failures.end(), [](const dedup_failure& lhs, const dedup_failure& rhs) {
+        return lhs.path < rhs.path;
+    });
+
+    return result;
+}
+
+} // namespace utility
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#endif // BOOST_CRYPT_UTILITY_DEDUP_HPP
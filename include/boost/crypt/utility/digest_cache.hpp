@@ -0,0 +1,677 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// Remembers the digests of unchanged files in a table on disk that several processes can share
+
+#ifndef BOOST_CRYPT_UTILITY_DIGEST_CACHE_HPP
+#define BOOST_CRYPT_UTILITY_DIGEST_CACHE_HPP
+
+#include <boost/crypt/utility/config.hpp>
+#include <boost/crypt/utility/posix_config.hpp>
+#include <boost/crypt/utility/array.hpp>
+#include <boost/crypt/utility/cstdint.hpp>
+#include <boost/crypt/utility/posix_file.hpp>
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef __linux__
+#include <sys/sysmacros.h>
+#endif
+#endif
+
+namespace boost {
+namespace crypt {
+namespace utility {
+
+// Identifies one version of a file.
+// Every write to a file moves its ctime forward, and ctime can not be set by the user, so a file with the same key has the same contents
+struct file_key
+{
+    std::uint64_t device;
+    std::uint64_t inode;
+    std::uint64_t size;
+    std::int64_t mtime_ns;
+    std::int64_t ctime_ns;
+};
+
+inline auto operator==(const file_key& lhs, const file_key& rhs) noexcept -> bool
+{
+    return lhs.device == rhs.device && lhs.inode == rhs.inode && lhs.size == rhs.size &&
+           lhs.mtime_ns == rhs.mtime_ns && lhs.ctime_ns == rhs.ctime_ns;
+}
+
+inline auto operator!=(const file_key& lhs, const file_key& rhs) noexcept -> bool
+{
+    return !(lhs == rhs);
+}
+
+// A file whose ctime is less than this long before it is read is hashed but not cached,
+// since file timestamps are only as fine as the kernel's clock tick and a write moments later might not change them
+BOOST_CRYPT_INLINE_CONSTEXPR std::int64_t default_racy_window_ns {INT64_C(1000000000)};
+
+namespace detail {
+
+inline auto timespec_ns(const struct timespec& ts) noexcept -> std::int64_t
+{
+    return static_cast<std::int64_t>(ts.tv_sec) * INT64_C(1000000000) + static_cast<std::int64_t>(ts.tv_nsec);
+}
+
+inline auto key_of_stat(const struct stat& st, file_key& key) noexcept -> bool
+{
+    key.device = static_cast<std::uint64_t>(st.st_dev);
+    key.inode = static_cast<std::uint64_t>(st.st_ino);
+    key.size = static_cast<std::uint64_t>(st.st_size);
+    #ifdef __APPLE__
+    key.mtime_ns = timespec_ns(st.st_mtimespec);
+    key.ctime_ns = timespec_ns(st.st_ctimespec);
+    #else
+    key.mtime_ns = timespec_ns(st.st_mtim);
+    key.ctime_ns = timespec_ns(st.st_ctim);
+    #endif
+
+    return S_ISREG(st.st_mode);
+}
+
+// Fills in the key of the file at path and sets regular to whether it is a regular file.
+// Returns the errno of the failure, or 0
+inline auto stat_file_key(const char* path, file_key& key, bool& regular) noexcept -> int
+{
+    #ifdef BOOST_CRYPT_HAS_STATX
+
+    struct statx stx {};
+    if (::statx(AT_FDCWD, path, AT_STATX_SYNC_AS_STAT, STATX_TYPE | STATX_INO | STATX_SIZE | STATX_MTIME | STATX_CTIME, &stx) == 0)
+    {
+        // The same encoding of the device as st_dev, so keys from statx(2) and fstat(2) agree
+        key.device = static_cast<std::uint64_t>(makedev(stx.stx_dev_major, stx.stx_dev_minor));
+        key.inode = static_cast<std::uint64_t>(stx.stx_ino);
+        key.size = static_cast<std::uint64_t>(stx.stx_size);
+        key.mtime_ns = static_cast<std::int64_t>(stx.stx_mtime.tv_sec) * INT64_C(1000000000) + static_cast<std::int64_t>(stx.stx_mtime.tv_nsec);
+        key.ctime_ns = static_cast<std::int64_t>(stx.stx_ctime.tv_sec) * INT64_C(1000000000) + static_cast<std::int64_t>(stx.stx_ctime.tv_nsec);
+        regular = S_ISREG(stx.stx_mode);
+        return 0;
+    }
+
+    // Kernels before 4.11, and some sandboxes, do not have statx(2)
+    if (errno != ENOSYS && errno != EPERM)
+    {
+        return errno;
+    }
+
+    #endif
+
+    struct stat st {};
+    if (::stat(path, &st) != 0)
+    {
+        return errno;
+    }
+
+    regular = key_of_stat(st, key);
+    return 0;
+}
+
+inline auto fstat_file_key(int fd, file_key& key, bool& regular) noexcept -> int
+{
+    struct stat st {};
+    if (::fstat(fd, &st) != 0)
+    {
+        return errno;
+    }
+
+    regular = key_of_stat(st, key);
+    return 0;
+}
+
+struct file_key_hash
+{
+    auto operator()(const file_key& key) const noexcept -> std::size_t
+    {
+        // Inodes are close to unique on their own, and the times separate the versions of a file
+        std::uint64_t h {key.inode * UINT64_C(0x9E3779B97F4A7C15)};
+        h ^= (key.device + static_cast<std::uint64_t>(key.ctime_ns)) * UINT64_C(0xC2B2AE3D27D4EB4F);
+        h ^= h >> 29U;
+        return static_cast<std::size_t>(h);
+    }
+};
+
+// Records are stored little endian whatever the platform, so a cache can be shared over a network filesystem
+inline auto cache_store(std::uint8_t* p, std::uint64_t value) noexcept -> void
+{
+    for (std::size_t i {}; i < 8U; ++i)
+    {
+        p[i] = static_cast<std::uint8_t>(value >> (8U * i));
+    }
+}
+
+inline auto cache_load(const std::uint8_t* p) noexcept -> std::uint64_t
+{
+    std::uint64_t value {};
+    for (std::size_t i {}; i < 8U; ++i)
+    {
+        value |= static_cast<std::uint64_t>(p[i]) << (8U * i);
+    }
+
+    return value;
+}
+
+// FNV-1a, which tells a complete record from one that is torn or still being written
+inline auto cache_checksum(const std::uint8_t* p, std::size_t size) noexcept -> std::uint64_t
+{
+    std::uint64_t h {UINT64_C(0xCBF29CE484222325)};
+    for (std::size_t i {}; i < size; ++i)
+    {
+        h ^= p[i];
+        h *= UINT64_C(0x100000001B3);
+    }
+
+    return h;
+}
+
+BOOST_CRYPT_INLINE_CONSTEXPR char cache_magic[8] {'B', 'C', 'R', 'Y', 'P', 'T', 'D', 'C'};
+BOOST_CRYPT_INLINE_CONSTEXPR std::uint64_t cache_version {1U};
+BOOST_CRYPT_INLINE_CONSTEXPR std::size_t cache_header_size {32U};
+
+// Number of records read from the file at a time while loading it
+BOOST_CRYPT_INLINE_CONSTEXPR std::size_t cache_load_records {16384U};
+
+// Holds an flock(2) until it goes out of scope
+class cache_file_lock
+{
+private:
+    int fd_;
+    bool locked_ {};
+
+public:
+    explicit cache_file_lock(int fd) noexcept : fd_ {fd}
+    {
+        int res {};
+        do
+        {
+            res = ::flock(fd_, LOCK_EX);
+        } while (res != 0 && errno == EINTR);
+
+        locked_ = res == 0;
+    }
+
+    cache_file_lock(const cache_file_lock&) = delete;
+    auto operator=(const cache_file_lock&) -> cache_file_lock& = delete;
+
+    auto locked() const noexcept -> bool
+    {
+        return locked_;
+    }
+
+    ~cache_file_lock()
+    {
+        if (locked_)
+        {
+            static_cast<void>(::flock(fd_, LOCK_UN));
+        }
+    }
+};
+
+inline auto cache_write_all(int fd, const std::uint8_t* data, std::size_t size) noexcept -> int
+{
+    while (size > 0U)
+    {
+        const auto res {::write(fd, data, size)};
+        if (res < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return errno;
+        }
+
+        data += res;
+        size -= static_cast<std::size_t>(res);
+    }
+
+    return 0;
+}
+
+} // namespace detail
+
+// Fills in the key of the regular file at path with a single statx(2), or stat(2) where that is not available
+inline auto file_key_of(const std::string& path, file_key& key) noexcept -> std::error_code
+{
+    bool regular {};
+    const auto error {detail::stat_file_key(path.c_str(), key, regular)};
+    if (error != 0)
+    {
+        return std::error_code(error, std::system_category());
+    }
+
+    return regular ? std::error_code{} : std::make_error_code(std::errc::invalid_argument);
+}
+
+// A table on disk from file keys to the digests of N bytes that the files had.
+// The file is a header followed by fixed size records, each holding a key, a digest and a checksum,
+// and it is only ever appended to, so that it can be shared by any number of processes and threads.
+// Lookups take no file lock: the whole table is indexed in memory when the cache is opened,
+// and the records other processes have appended since are read only when a lookup misses.
+// Appends take an flock(2) for the moment of the write.
+// If the file can not be written the cache is opened read only, and insert() fails
+template <boost::crypt::size_t N>
+class digest_cache
+{
+public:
+    using digest_type = boost::crypt::array<boost::crypt::uint8_t, N>;
+
+    static constexpr std::size_t record_size {40U + N + 8U};
+
+private:
+    int fd_ {-1};
+    bool writable_ {};
+    std::uint64_t indexed_ {};
+    std::unordered_map<file_key, digest_type, detail::file_key_hash> entries_;
+    mutable std::mutex mutex_;
+
+    auto encode(const file_key& key, const digest_type& digest, std::uint8_t* record) const noexcept -> void
+    {
+        detail::cache_store(record, key.device);
+        detail::cache_store(record + 8, key.inode);
+        detail::cache_store(record + 16, key.size);
+        detail::cache_store(record + 24, static_cast<std::uint64_t>(key.mtime_ns));
+        detail::cache_store(record + 32, static_cast<std::uint64_t>(key.ctime_ns));
+        for (std::size_t i {}; i < N; ++i)
+        {
+            record[40U + i] = digest[i];
+        }
+        detail::cache_store(record + 40 + N, detail::cache_checksum(record, 40U + N));
+    }
+
+    auto decode(const std::uint8_t* record, file_key& key, digest_type& digest) const noexcept -> bool
+    {
+        if (detail::cache_load(record + 40 + N) != detail::cache_checksum(record, 40U + N))
+        {
+            return false;
+        }
+
+        key.device = detail::cache_load(record);
+        key.inode = detail::cache_load(record + 8);
+        key.size = detail::cache_load(record + 16);
+        key.mtime_ns = static_cast<std::int64_t>(detail::cache_load(record + 24));
+        key.ctime_ns = static_cast<std::int64_t>(detail::cache_load(record + 32));
+        for (std::size_t i {}; i < N; ++i)
+        {
+            digest[i] = record[40U + i];
+        }
+
+        return true;
+    }
+
+    auto encode_header(std::uint8_t* header) const noexcept -> void
+    {
+        std::memset(header, 0, detail::cache_header_size);
+        std::memcpy(header, detail::cache_magic, sizeof(detail::cache_magic));
+        detail::cache_store(header + 8, detail::cache_version);
+        detail::cache_store(header + 16, N);
+        detail::cache_store(header + 24, record_size);
+    }
+
+    // Indexes the records appended since the last call. Must be called with mutex_ held.
+    // Returns the errno of the failure, or 0
+    auto load() -> int
+    {
+        struct stat st {};
+        if (::fstat(fd_, &st) != 0)
+        {
+            return errno;
+        }
+
+        const auto file_size {static_cast<std::uint64_t>(st.st_size)};
+        std::vector<std::uint8_t> buffer;
+        while (file_size - indexed_ >= record_size)
+        {
+            const auto count {static_cast<std::size_t>((std::min)((file_size - indexed_) / record_size,
+                                                                  static_cast<std::uint64_t>(detail::cache_load_records)))};
+            buffer.resize(count * record_size);
+
+            ::ssize_t res {};
+            do
+            {
+                res = ::pread(fd_, buffer.data(), buffer.size(), static_cast<::off_t>(indexed_));
+            } while (res < 0 && errno == EINTR);
+
+            if (res < 0)
+            {
+                return errno;
+            }
+
+            const auto complete {static_cast<std::size_t>(res) / record_size};
+            if (complete == 0U)
+            {
+                break;
+            }
+
+            for (std::size_t i {}; i < complete; ++i)
+            {
+                file_key key {};
+                digest_type digest {};
+                if (decode(buffer.data() + i * record_size, key, digest))
+                {
+                    entries_[key] = digest;
+                }
+                else if (indexed_ + record_size >= file_size)
+                {
+                    // The last record may still be being written by another process, so look at it again next time
+                    return 0;
+                }
+
+                // A bad record before the end was torn by a crash, and the writer that found it padded it out
+                indexed_ += record_size;
+            }
+        }
+
+        return 0;
+    }
+
+public:
+    digest_cache() = default;
+
+    digest_cache(const std::string& path, std::error_code& ec)
+    {
+        ec = open(path);
+    }
+
+    digest_cache(const digest_cache&) = delete;
+    auto operator=(const digest_cache&) -> digest_cache& = delete;
+
+    // Opens the cache at path, creating it if it does not exist, and indexes its contents.
+    // Fails with std::errc::invalid_argument if the file is not a cache of digests of N bytes
+    auto open(const std::string& path) -> std::error_code
+    {
+        close();
+
+        do
+        {
+            fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        } while (fd_ < 0 && errno == EINTR);
+
+        writable_ = fd_ >= 0;
+        if (fd_ < 0 && (errno == EACCES || errno == EROFS || errno == EPERM))
+        {
+            do
+            {
+                fd_ = ::open(path.c_str(), detail::open_read_flags);
+            } while (fd_ < 0 && errno == EINTR);
+        }
+
+        if (fd_ < 0)
+        {
+            return std::error_code(errno, std::system_category());
+        }
+
+        std::uint8_t expected[detail::cache_header_size] {};
+        encode_header(expected);
+
+        if (writable_)
+        {
+            detail::cache_file_lock lock(fd_);
+            struct stat st {};
+            if (lock.locked() && ::fstat(fd_, &st) == 0 && st.st_size == 0)
+            {
+                const auto error {detail::cache_write_all(fd_, expected, sizeof(expected))};
+                if (error != 0)
+                {
+                    close();
+                    return std::error_code(error, std::system_category());
+                }
+            }
+        }
+
+        std::uint8_t header[detail::cache_header_size] {};
+        ::ssize_t res {};
+        do
+        {
+            res = ::pread(fd_, header, sizeof(header), 0);
+        } while (res < 0 && errno == EINTR);
+
+        if (res < 0)
+        {
+            const auto error {errno};
+            close();
+            return std::error_code(error, std::system_category());
+        }
+
+        // A read only cache that was never written to is simply empty
+        if (res == 0 && !writable_)
+        {
+            indexed_ = detail::cache_header_size;
+            return std::error_code{};
+        }
+
+        if (static_cast<std::size_t>(res) != sizeof(header) || std::memcmp(header, expected, sizeof(header)) != 0)
+        {
+            close();
+            return std::make_error_code(std::errc::invalid_argument);
+        }
+
+        std::lock_guard<std::mutex> guard(mutex_);
+        indexed_ = detail::cache_header_size;
+        const auto error {load()};
+        return error == 0 ? std::error_code{} : std::error_code(error, std::system_category());
+    }
+
+    auto is_open() const noexcept -> bool
+    {
+        return fd_ >= 0;
+    }
+
+    auto writable() const noexcept -> bool
+    {
+        return fd_ >= 0 && writable_;
+    }
+
+    // Number of distinct keys indexed so far
+    auto size() const -> std::size_t
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return entries_.size();
+    }
+
+    // Looks the key up, first in memory and then in any records appended by other processes since
+    auto find(const file_key& key, digest_type& digest) -> bool
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (fd_ < 0)
+        {
+            return false;
+        }
+
+        auto it {entries_.find(key)};
+        if (it == entries_.end())
+        {
+            static_cast<void>(load());
+            it = entries_.find(key);
+            if (it == entries_.end())
+            {
+                return false;
+            }
+        }
+
+        digest = it->second;
+        return true;
+    }
+
+    // Appends a record for the key with a single write(2)
+    auto insert(const file_key& key, const digest_type& digest) -> std::error_code
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (!writable())
+        {
+            return std::make_error_code(std::errc::read_only_file_system);
+        }
+
+        std::uint8_t record[record_size] {};
+        encode(key, digest, record);
+
+        detail::cache_file_lock lock(fd_);
+        if (!lock.locked())
+        {
+            return std::error_code(errno, std::system_category());
+        }
+
+        // A writer that crashed part way through a record leaves the file out of step, so pad it back to a record boundary
+        struct stat st {};
+        if (::fstat(fd_, &st) != 0)
+        {
+            return std::error_code(errno, std::system_category());
+        }
+        const auto used {(static_cast<std::uint64_t>(st.st_size) - detail::cache_header_size) % record_size};
+        if (used != 0U)
+        {
+            const std::uint8_t padding[record_size] {};
+            const auto error {detail::cache_write_all(fd_, padding, static_cast<std::size_t>(record_size - used))};
+            if (error != 0)
+            {
+                return std::error_code(error, std::system_category());
+            }
+        }
+
+        const auto error {detail::cache_write_all(fd_, record, record_size)};
+        if (error != 0)
+        {
+            return std::error_code(error, std::system_category());
+        }
+
+        entries_[key] = digest;
+        return std::error_code{};
+    }
+
+    auto close() noexcept -> void
+    {
+        if (fd_ >= 0)
+        {
+            ::close(fd_);
+            fd_ = -1;
+        }
+
+        writable_ = false;
+        indexed_ = 0U;
+        entries_.clear();
+    }
+
+    ~digest_cache()
+    {
+        close();
+    }
+};
+
+// Returns the digest of the file at path from the cache if its key is there, at the cost of one statx(2).
+// Otherwise the file is hashed, and the digest is added to the cache if the file was not changed while it was read,
+// and its ctime is at least racy_window_ns old.
+// On failure the digest is all zeros with the reason in ec, which is not affected by failing to add to the cache
+template <typename Hasher, boost::crypt::size_t N>
+auto hash_file_cached(digest_cache<N>& cache, const char* path, std::error_code& ec,
+                      std::int64_t racy_window_ns = default_racy_window_ns) -> boost::crypt::array<boost::crypt::uint8_t, N>
+{
+    using digest_type = boost::crypt::array<boost::crypt::uint8_t, N>;
+
+    file_key key {};
+    bool regular {};
+    auto error {detail::stat_file_key(path, key, regular)};
+    if (error != 0)
+    {
+        ec.assign(error, std::system_category());
+        return digest_type{};
+    }
+
+    digest_type digest {};
+    if (regular && cache.find(key, digest))
+    {
+        ec.clear();
+        return digest;
+    }
+
+    struct timespec now {};
+    static_cast<void>(::clock_gettime(CLOCK_REALTIME, &now));
+    const auto started_ns {detail::timespec_ns(now)};
+
+    int fd {};
+    do
+    {
+        fd = ::open(path, detail::open_read_flags);
+    } while (fd < 0 && errno == EINTR);
+
+    if (fd < 0)
+    {
+        ec.assign(errno, std::system_category());
+        return digest_type{};
+    }
+
+    file_key before {};
+    file_key after {};
+    bool still_regular {};
+    Hasher hasher {};
+    try
+    {
+        error = detail::fstat_file_key(fd, before, regular);
+
+        posix_file_reader reader(fd, 0U, (std::numeric_limits<std::uint64_t>::max)());
+        while (!reader.eof())
+        {
+            const auto buffer {reader.read_next_block()};
+            hasher.process_bytes(buffer, reader.get_bytes_read());
+        }
+
+        if (error == 0)
+        {
+            error = reader.error();
+        }
+        if (error == 0)
+        {
+            error = detail::fstat_file_key(fd, after, still_regular);
+        }
+    }
+    catch (...)
+    {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+
+    if (error != 0)
+    {
+        ec.assign(error, std::system_category());
+        return digest_type{};
+    }
+
+    digest = hasher.get_digest();
+    if (regular && before == after && after.ctime_ns < started_ns - racy_window_ns)
+    {
+        static_cast<void>(cache.insert(after, digest));
+    }
+
+    ec.clear();
+    return digest;
+}
+
+} // namespace utility
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#endif // BOOST_CRYPT_UTILITY_DIGEST_CACHE_HPP
@@ -0,0 +1,540 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// Reads files and block devices with O_DIRECT so that hashing them does not go through the page cache
+
+#ifndef BOOST_CRYPT_UTILITY_DIRECT_FILE_HPP
+#define BOOST_CRYPT_UTILITY_DIRECT_FILE_HPP
+
+#include <boost/crypt/utility/config.hpp>
+#include <boost/crypt/utility/posix_file.hpp>
+#include <boost/crypt/utility/mapped_file.hpp>
+#include <boost/crypt/utility/io_uring.hpp>
+
+#ifdef BOOST_CRYPT_HAS_DIRECT_IO
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+#endif
+
+namespace boost {
+namespace crypt {
+namespace utility {
+
+// Number of aligned reads kept in flight by direct_file_reader
+BOOST_CRYPT_INLINE_CONSTEXPR std::size_t default_direct_queue_depth {4U};
+
+namespace detail {
+
+// count buffers of size bytes each, carved out of one allocation aligned for O_DIRECT
+class aligned_buffer_pool
+{
+private:
+    void* data_ {};
+    std::size_t size_ {};
+
+public:
+    aligned_buffer_pool(std::size_t count, std::size_t size, std::size_t alignment) : size_ {size}
+    {
+        if (::posix_memalign(&data_, alignment, count * size) != 0)
+        {
+            data_ = nullptr;
+            throw std::bad_alloc();
+        }
+    }
+
+    aligned_buffer_pool(const aligned_buffer_pool&) = delete;
+    auto operator=(const aligned_buffer_pool&) -> aligned_buffer_pool& = delete;
+
+    auto operator[](std::size_t i) const noexcept -> std::uint8_t*
+    {
+        return static_cast<std::uint8_t*>(data_) + i * size_;
+    }
+
+    ~aligned_buffer_pool()
+    {
+        std::free(data_);
+    }
+};
+
+// Offsets, lengths, and buffer addresses of O_DIRECT reads must be multiples of the logical block size.
+// Using at least a page is always sufficient for files, and block devices report their own
+inline auto direct_io_alignment(int fd, const struct stat& st) noexcept -> std::size_t
+{
+    auto alignment {page_size()};
+
+    #if defined(__linux__) && defined(BLKSSZGET)
+    if (S_ISBLK(st.st_mode))
+    {
+        int logical_block_size {};
+        if (::ioctl(fd, BLKSSZGET, &logical_block_size) == 0 && static_cast<std::size_t>(logical_block_size) > alignment)
+        {
+            alignment = static_cast<std::size_t>(logical_block_size);
+        }
+    }
+    #else
+    static_cast<void>(fd);
+    static_cast<void>(st);
+    #endif
+
+    return alignment;
+}
+
+// st_size is 0 for block devices, so ask the device itself
+inline auto device_size(int fd, const struct stat& st) noexcept -> std::uint64_t
+{
+    if (!S_ISBLK(st.st_mode))
+    {
+        return static_cast<std::uint64_t>(st.st_size);
+    }
+
+    #if defined(__linux__) && defined(BLKGETSIZE64)
+    std::uint64_t size {};
+    if (::ioctl(fd, BLKGETSIZE64, &size) == 0)
+    {
+        return size;
+    }
+    #endif
+
+    const auto end {::lseek(fd, 0, SEEK_END)};
+    return end > 0 ? static_cast<std::uint64_t>(end) : 0U;
+}
+
+} // namespace detail
+
+// Reads a regular file or block device with O_DIRECT, bypassing the page cache.
+// queue_depth reads of buffer_size bytes are kept in flight at once (using io_uring where it is available),
+// into buffers aligned to the device's logical block size.
+// The last block may be any length, and is read with an aligned request that stops at the end of the file.
+// If the filesystem does not support O_DIRECT the file is read normally,
+// and the pages that have been hashed are dropped from the page cache instead.
+class direct_file_reader
+{
+private:
+    struct block
+    {
+        std::uint64_t offset {};
+        std::size_t requested {};
+        std::size_t done {};
+        int error {};
+        bool in_flight {};
+    };
+
+    int fd_ {-1};
+    int buffered_fd_ {-1};
+    bool direct_ {};
+    bool eof_ {};
+    int error_ {};
+    std::uint64_t file_size_ {};
+    std::uint64_t next_offset_ {};
+    std::uint64_t consumed_ {};
+    std::size_t alignment_ {};
+    std::size_t buffer_size_ {};
+    std::size_t bytes_read_ {};
+    std::size_t current_ {};
+    bool resubmit_ {};
+    std::vector<block> blocks_;
+    std::unique_ptr<detail::aligned_buffer_pool> pool_;
+    std::string filename_;
+
+    #ifdef BOOST_CRYPT_HAS_IO_URING
+    std::unique_ptr<io_uring_queue> ring_;
+    std::size_t in_flight_ {};
+    #endif
+
+    auto round_up(std::size_t size) const noexcept -> std::size_t
+    {
+        return ((size + alignment_ - 1U) / alignment_) * alignment_;
+    }
+
+    auto close_all() noexcept -> void
+    {
+        if (fd_ >= 0)
+        {
+            ::close(fd_);
+            fd_ = -1;
+        }
+        if (buffered_fd_ >= 0)
+        {
+            ::close(buffered_fd_);
+            buffered_fd_ = -1;
+        }
+    }
+
+    auto open_file(const char* filename, std::size_t buffer_size, std::size_t queue_depth) -> void
+    {
+        filename_ = filename;
+        direct_ = true;
+        do
+        {
+            fd_ = ::open(filename, detail::open_read_flags | O_DIRECT);
+        } while (fd_ < 0 && errno == EINTR);
+
+        // Filesystems such as tmpfs do not support O_DIRECT at all
+        if (fd_ < 0 && errno == EINVAL)
+        {
+            direct_ = false;
+            do
+            {
+                fd_ = ::open(filename, detail::open_read_flags);
+            } while (fd_ < 0 && errno == EINTR);
+        }
+
+        if (fd_ < 0)
+        {
+            throw std::runtime_error("Error opening file");
+        }
+
+        struct stat st {};
+        if (::fstat(fd_, &st) != 0 || !(S_ISREG(st.st_mode) || S_ISBLK(st.st_mode)))
+        {
+            close_all();
+            throw std::runtime_error("Only regular files and block devices can be read directly");
+        }
+
+        alignment_ = detail::direct_io_alignment(fd_, st);
+        file_size_ = detail::device_size(fd_, st);
+        eof_ = file_size_ == 0U;
+
+        // Each read must fit in the 32-bit length of an io_uring request
+        constexpr std::size_t max_buffer_size {1073741824U};
+        buffer_size_ = round_up((std::min)(buffer_size == 0U ? std::size_t{BOOST_CRYPT_FILE_BUFFER_SIZE} : buffer_size, max_buffer_size));
+
+        if (!direct_)
+        {
+            detail::advise_sequential(fd_);
+        }
+
+        const auto depth {queue_depth == 0U ? std::size_t{1U} : queue_depth};
+        try
+        {
+            blocks_.resize(depth);
+            pool_.reset(new detail::aligned_buffer_pool(depth, buffer_size_, alignment_));
+
+            #ifdef BOOST_CRYPT_HAS_IO_URING
+            if (depth > 1U)
+            {
+                ring_.reset(new io_uring_queue(static_cast<unsigned>(depth)));
+                if (!ring_->valid() || !ring_->supports(IORING_OP_READ))
+                {
+                    ring_.reset();
+                }
+            }
+            #endif
+        }
+        catch (...)
+        {
+            close_all();
+            throw;
+        }
+
+        for (std::size_t i {}; i < depth; ++i)
+        {
+            submit(i);
+        }
+    }
+
+    // Assigns the next block of the file to the slot, and starts reading it if io_uring is available
+    auto submit(std::size_t slot) noexcept -> void
+    {
+        auto& b {blocks_[slot]};
+        b = block{};
+        if (next_offset_ >= file_size_)
+        {
+            return;
+        }
+
+        b.offset = next_offset_;
+        b.requested = static_cast<std::size_t>((std::min)(static_cast<std::uint64_t>(buffer_size_), file_size_ - next_offset_));
+        next_offset_ += b.requested;
+
+        #ifdef BOOST_CRYPT_HAS_IO_URING
+        if (ring_)
+        {
+            // The queue has one entry per slot, and each slot has at most one read in flight
+            auto* sqe {ring_->get_sqe()};
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = fd_;
+            sqe->addr = reinterpret_cast<std::uint64_t>((*pool_)[slot]);
+            sqe->len = static_cast<std::uint32_t>(direct_ ? round_up(b.requested) : b.requested);
+            sqe->off = b.offset;
+            sqe->user_data = slot;
+            b.in_flight = true;
+            ++in_flight_;
+
+            // If the kernel is busy the entry stays queued, and is submitted by the next wait
+            static_cast<void>(ring_->submit_and_wait(0U));
+        }
+        #endif
+    }
+
+    // Reads whatever is left of the block with pread(2).
+    // O_DIRECT can only continue from an aligned offset, so a short read that ends unaligned is finished without it
+    auto read_rest(std::size_t slot) noexcept -> void
+    {
+        auto& b {blocks_[slot]};
+        auto* buffer {(*pool_)[slot]};
+
+        while (b.done < b.requested && b.error == 0)
+        {
+            const auto pos {b.offset + b.done};
+            int fd {fd_};
+            auto len {b.requested - b.done};
+
+            if (direct_)
+            {
+                if (pos % alignment_ == 0U)
+                {
+                    len = round_up(len);
+                }
+                else
+                {
+                    // A duplicated descriptor would share the O_DIRECT flag, so open the file again
+                    while (buffered_fd_ < 0)
+                    {
+                        buffered_fd_ = ::open(filename_.c_str(), detail::open_read_flags);
+                        if (buffered_fd_ < 0 && errno != EINTR)
+                        {
+                            b.error = errno;
+                            return;
+                        }
+                    }
+                    fd = buffered_fd_;
+                }
+            }
+
+            ::ssize_t res {};
+            do
+            {
+                res = ::pread(fd, buffer + b.done, len, static_cast<::off_t>(pos));
+            } while (res < 0 && errno == EINTR);
+
+            if (res < 0)
+            {
+                b.error = errno;
+            }
+            else if (res == 0)
+            {
+                // The file was truncated while it was being read
+                b.requested = b.done;
+                file_size_ = pos;
+            }
+            else
+            {
+                b.done += (std::min)(static_cast<std::size_t>(res), b.requested - b.done);
+            }
+        }
+    }
+
+    #ifdef BOOST_CRYPT_HAS_IO_URING
+    // Records the result of every read that has completed
+    auto reap() noexcept -> void
+    {
+        while (auto* cqe = ring_->peek_cqe())
+        {
+            auto& b {blocks_[static_cast<std::size_t>(cqe->user_data)]};
+            if (cqe->res < 0)
+            {
+                b.error = -cqe->res;
+            }
+            else
+            {
+                b.done = (std::min)(static_cast<std::size_t>(cqe->res), b.requested);
+            }
+            b.in_flight = false;
+            ring_->cqe_seen();
+            --in_flight_;
+        }
+    }
+    #endif
+
+    auto wait_for(std::size_t slot) noexcept -> void
+    {
+        auto& b {blocks_[slot]};
+
+        #ifdef BOOST_CRYPT_HAS_IO_URING
+        if (ring_)
+        {
+            reap();
+            while (b.in_flight)
+            {
+                const auto res {ring_->submit_and_wait(1U)};
+                if (res != 0)
+                {
+                    // The read is still queued, so it must not be redone synchronously
+                    b.error = -res;
+                    return;
+                }
+                reap();
+            }
+        }
+        #endif
+
+        // Reads the whole block synchronously, or finishes off a short read
+        if (b.error == 0 && b.done < b.requested)
+        {
+            read_rest(slot);
+        }
+    }
+
+public:
+    explicit direct_file_reader(const std::string& filename, std::size_t buffer_size = 0U,
+                                std::size_t queue_depth = default_direct_queue_depth)
+    {
+        open_file(filename.c_str(), buffer_size, queue_depth);
+    }
+
+    explicit direct_file_reader(const char* filename, std::size_t buffer_size = 0U,
+                                std::size_t queue_depth = default_direct_queue_depth)
+    {
+        open_file(filename, buffer_size, queue_depth);
+    }
+
+    #ifdef BOOST_CRYPT_HAS_STRING_VIEW
+    explicit direct_file_reader(std::string_view filename, std::size_t buffer_size = 0U,
+                                std::size_t queue_depth = default_direct_queue_depth)
+    {
+        open_file(std::string{filename}.c_str(), buffer_size, queue_depth);
+    }
+    #endif
+
+    direct_file_reader(const direct_file_reader&) = delete;
+    auto operator=(const direct_file_reader&) -> direct_file_reader& = delete;
+
+    // Returns the next block of the file, which stays valid until the next call.
+    // Only the last block before the end of the file can be shorter than buffer_size()
+    auto read_next_block() noexcept -> const std::uint8_t*
+    {
+        const auto previous {current_ == 0U ? blocks_.size() - 1U : current_ - 1U};
+        if (resubmit_)
+        {
+            // The caller is done with the previous block, so its buffer can be reused for a block further ahead
+            resubmit_ = false;
+            submit(previous);
+        }
+
+        const auto slot {current_};
+        auto& b {blocks_[slot]};
+        bytes_read_ = 0U;
+
+        if (b.requested == 0U)
+        {
+            eof_ = true;
+            return (*pool_)[slot];
+        }
+
+        wait_for(slot);
+
+        if (b.error != 0)
+        {
+            error_ = b.error;
+            eof_ = true;
+            return (*pool_)[slot];
+        }
+
+        bytes_read_ = b.done;
+        consumed_ += b.done;
+        current_ = (slot + 1U) % blocks_.size();
+        resubmit_ = true;
+
+        if (!direct_)
+        {
+            // Without O_DIRECT the best we can do is not leave the file behind in the page cache
+            #ifdef POSIX_FADV_DONTNEED
+            static_cast<void>(::posix_fadvise(fd_, static_cast<::off_t>(b.offset), static_cast<::off_t>(b.done), POSIX_FADV_DONTNEED));
+            #endif
+        }
+
+        if (consumed_ >= file_size_)
+        {
+            eof_ = true;
+        }
+
+        return (*pool_)[slot];
+    }
+
+    auto get_bytes_read() const noexcept -> std::size_t
+    {
+        return bytes_read_;
+    }
+
+    auto eof() const noexcept -> bool
+    {
+        return eof_;
+    }
+
+    // The errno of a failed read, or 0
+    auto error() const noexcept -> int
+    {
+        return error_;
+    }
+
+    // True if the file was opened with O_DIRECT
+    auto direct() const noexcept -> bool
+    {
+        return direct_;
+    }
+
+    auto file_size() const noexcept -> std::uint64_t
+    {
+        return file_size_;
+    }
+
+    auto buffer_size() const noexcept -> std::size_t
+    {
+        return buffer_size_;
+    }
+
+    auto alignment() const noexcept -> std::size_t
+    {
+        return alignment_;
+    }
+
+    auto queue_depth() const noexcept -> std::size_t
+    {
+        return blocks_.size();
+    }
+
+    ~direct_file_reader()
+    {
+        #ifdef BOOST_CRYPT_HAS_IO_URING
+        // The kernel may still be writing into the buffers
+        if (ring_)
+        {
+            reap();
+            while (in_flight_ > 0U && ring_->submit_and_wait(1U) == 0)
+            {
+                reap();
+            }
+        }
+        #endif
+
+        close_all();
+    }
+};
+
+} // namespace utility
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HAS_DIRECT_IO
+
+#endif // BOOST_CRYPT_UTILITY_DIRECT_FILE_HPP
@@ -0,0 +1,181 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// Reads a file once and feeds the same bytes to any number of hashers
+
+#ifndef BOOST_CRYPT_UTILITY_FAN_OUT_HPP
+#define BOOST_CRYPT_UTILITY_FAN_OUT_HPP
+
+#include <boost/crypt/utility/config.hpp>
+#include <boost/crypt/utility/buffer_ring.hpp>
+#include <boost/crypt/utility/file.hpp>
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <cstdint>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#endif
+
+namespace boost {
+namespace crypt {
+namespace utility {
+
+namespace detail {
+
+template <typename...>
+struct make_void
+{
+    using type = void;
+};
+
+template <typename... Ts>
+using void_t = typename make_void<Ts...>::type;
+
+} // namespace detail
+
+// Anything that can consume a contiguous range of bytes e.g. md5_hasher
+template <typename Hasher, typename = void>
+struct is_byte_hasher : std::false_type {};
+
+template <typename Hasher>
+struct is_byte_hasher<Hasher, detail::void_t<decltype(std::declval<Hasher&>().process_bytes(std::declval<const std::uint8_t*>(), std::declval<std::size_t>()))>> : std::true_type {};
+
+namespace detail {
+
+template <typename... Ts>
+struct all_byte_hashers : std::true_type {};
+
+template <typename T, typename... Ts>
+struct all_byte_hashers<T, Ts...> : std::integral_constant<bool, is_byte_hasher<T>::value && all_byte_hashers<Ts...>::value> {};
+
+BOOST_CRYPT_INLINE_CONSTEXPR std::size_t fan_out_ring_slots {4U};
+
+template <typename... Hashers>
+auto feed_all(const std::uint8_t* data, std::size_t size, Hashers&... hashers) -> void
+{
+    using expand = int[];
+    static_cast<void>(expand{0, (hashers.process_bytes(data, size), 0)...});
+}
+
+template <typename Hasher>
+auto fan_out_consume(buffer_ring& ring, std::size_t consumer, Hasher& hasher,
+                     std::exception_ptr& error, std::mutex& error_mutex) -> void
+{
+    try
+    {
+        const std::uint8_t* data {};
+        std::size_t size {};
+        while (ring.next(consumer, data, size))
+        {
+            hasher.process_bytes(data, size);
+            ring.release(consumer);
+        }
+    }
+    catch (...)
+    {
+        {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+        }
+        ring.abort();
+    }
+}
+
+} // namespace detail
+
+// Reads the file once in large blocks and passes each block to every hasher in turn.
+// Returns false if the file could not be opened or read
+template <typename... Hashers>
+auto fan_out_file(const std::string& filepath, Hashers&... hashers) -> bool
+{
+    static_assert(detail::all_byte_hashers<Hashers...>::value, "Every hasher must provide process_bytes(const std::uint8_t*, std::size_t)");
+
+    detail::file_source source(filepath);
+    if (!source.is_open())
+    {
+        return false;
+    }
+
+    std::unique_ptr<std::uint8_t[]> buffer {new std::uint8_t[BOOST_CRYPT_FILE_BUFFER_SIZE]};
+    while (!source.eof())
+    {
+        const auto len {source.read(buffer.get(), BOOST_CRYPT_FILE_BUFFER_SIZE)};
+        if (len > 0U)
+        {
+            detail::feed_all(buffer.get(), len, hashers...);
+        }
+    }
+
+    return source.good();
+}
+
+// Reads the file once into a ring of large buffers, and each hasher consumes
+// the shared read-only buffers on its own thread.
+// Returns false if the file could not be opened or read.
+// If any of the hashers throws the exception is rethrown on the calling thread
+template <typename... Hashers>
+auto parallel_fan_out_file(const std::string& filepath, Hashers&... hashers) -> bool
+{
+    static_assert(detail::all_byte_hashers<Hashers...>::value, "Every hasher must provide process_bytes(const std::uint8_t*, std::size_t)");
+
+    detail::file_source source(filepath);
+    if (!source.is_open())
+    {
+        return false;
+    }
+
+    buffer_ring ring(detail::fan_out_ring_slots, BOOST_CRYPT_FILE_BUFFER_SIZE, sizeof...(Hashers));
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    std::vector<std::thread> threads;
+    threads.reserve(sizeof...(Hashers));
+
+    bool read_ok {true};
+    try
+    {
+        std::size_t consumer {};
+        using expand = int[];
+        static_cast<void>(expand{0, (threads.emplace_back(&detail::fan_out_consume<Hashers>, std::ref(ring), consumer++,
+                                                          std::ref(hashers), std::ref(error), std::ref(error_mutex)), 0)...});
+
+        read_ok = detail::fill_ring(source, ring);
+    }
+    catch (...)
+    {
+        ring.abort();
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        throw;
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+
+    return read_ok;
+}
+
+} // namespace utility
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_UTILITY_FAN_OUT_HPP
@@ -7,6 +7,7 @@
 
 #include <boost/crypt/utility/config.hpp>
 #include <boost/crypt/utility/cstdint.hpp>
+#include <boost/crypt/utility/posix_file.hpp>
 
 #ifndef BOOST_CRYPT_BUILD_MODULE
 #include <fstream>
@@ -14,12 +15,26 @@
 #include <ios>
 #include <exception>
 #include <array>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
 #endif
 
 namespace boost {
 namespace crypt {
 namespace utility {
 
+// How the contents of a file are brought into memory for hashing
+enum class read_mode
+{
+    automatic,  // Memory maps large regular files and reads everything else
+    read,       // Reads the file into a buffer
+    mmap,       // Memory maps the file if it is a regular file, otherwise reads it
+    direct,     // Reads the file with O_DIRECT, bypassing the page cache where the platform supports it
+    scan,       // Reads the file, leaving the page cache as it was found
+};
+
 template <std::size_t block_size = 64U>
 class file_reader
 {
@@ -79,6 +94,75 @@ public:
     }
 };
 
+namespace detail {
+
+// Reads a file straight into the caller's buffers using the best reader available on the platform
+class file_source
+{
+private:
+    #ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+    std::unique_ptr<posix_file_reader> reader_;
+    #else
+    std::ifstream fd_;
+    #endif
+
+public:
+    explicit file_source(const std::string& filepath)
+    {
+        #ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+        try
+        {
+            reader_.reset(new posix_file_reader(filepath));
+        }
+        catch (const std::runtime_error&)
+        {
+            reader_.reset();
+        }
+        #else
+        fd_.open(filepath, std::ios::binary | std::ios::in);
+        #endif
+    }
+
+    auto is_open() const -> bool
+    {
+        #ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+        return reader_ != nullptr;
+        #else
+        return fd_.is_open();
+        #endif
+    }
+
+    auto read(std::uint8_t* buffer, std::size_t size) -> std::size_t
+    {
+        #ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+        return reader_->read_into(buffer, size);
+        #else
+        fd_.read(reinterpret_cast<char*>(buffer), static_cast<std::streamsize>(size));
+        return static_cast<std::size_t>(fd_.gcount());
+        #endif
+    }
+
+    auto eof() const -> bool
+    {
+        #ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+        return reader_->eof();
+        #else
+        return !fd_;
+        #endif
+    }
+
+    auto good() const -> bool
+    {
+        #ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+        return reader_->error() == 0;
+        #else
+        return !fd_.bad();
+        #endif
+    }
+};
+
+} // namespace detail
+
 } // namespace utility
 } // namespace crypt
 } // namespace boost
@@ -0,0 +1,326 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// Hashes files that only ever grow, such as logs, by resuming from the hasher state saved at the end of the previous pass
+
+#ifndef BOOST_CRYPT_UTILITY_INCREMENTAL_FILE_HPP
+#define BOOST_CRYPT_UTILITY_INCREMENTAL_FILE_HPP
+
+#include <boost/crypt/utility/config.hpp>
+#include <boost/crypt/utility/posix_file.hpp>
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+namespace boost {
+namespace crypt {
+namespace utility {
+
+// Bytes at the start of the file, and just before the saved state, that are compared to check that the part
+// of the file that was already hashed has not been replaced
+BOOST_CRYPT_INLINE_CONSTEXPR std::size_t incremental_sample_size {4096U};
+
+struct incremental_result
+{
+    // Offset the hash was resumed from, or 0 if the whole file was hashed
+    std::uint64_t resumed_from;
+
+    // Size of the file when it was opened, which is how many bytes the hasher has processed
+    std::uint64_t size;
+};
+
+namespace detail {
+
+BOOST_CRYPT_INLINE_CONSTEXPR char incremental_magic[8] {'B', 'C', 'R', 'Y', 'P', 'T', 'I', 'H'};
+BOOST_CRYPT_INLINE_CONSTEXPR std::uint32_t incremental_version {1U};
+
+// Written in the byte order of the platform, so a state file moved to a platform of the other byte order is not used
+BOOST_CRYPT_INLINE_CONSTEXPR std::uint32_t incremental_byte_order {0x01020304U};
+
+template <typename State>
+struct incremental_record
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint32_t state_size;
+    std::uint32_t reserved;
+    std::uint64_t device;
+    std::uint64_t inode;
+    std::uint64_t head_fingerprint;
+    std::uint64_t tail_fingerprint;
+    State state;
+};
+
+// FNV-1a, which is enough to notice a file that was replaced rather than appended to
+inline auto incremental_fingerprint(const std::uint8_t* data, std::size_t size) noexcept -> std::uint64_t
+{
+    std::uint64_t h {UINT64_C(0xCBF29CE484222325)};
+    for (std::size_t i {}; i < size; ++i)
+    {
+        h ^= data[i];
+        h *= UINT64_C(0x100000001B3);
+    }
+
+    return h;
+}
+
+inline auto incremental_pread(int fd, void* data, std::size_t size, std::uint64_t offset) noexcept -> bool
+{
+    auto* p {static_cast<std::uint8_t*>(data)};
+    while (size > 0U)
+    {
+        const auto res {::pread(fd, p, size, static_cast<::off_t>(offset))};
+        if (res < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (res <= 0)
+        {
+            return false;
+        }
+
+        p += res;
+        size -= static_cast<std::size_t>(res);
+        offset += static_cast<std::uint64_t>(res);
+    }
+
+    return true;
+}
+
+// Fingerprints of the first bytes of the file and of the bytes just before boundary
+inline auto incremental_samples(int fd, std::uint64_t boundary, std::uint64_t& head, std::uint64_t& tail) noexcept -> bool
+{
+    std::uint8_t sample[incremental_sample_size] {};
+    const auto size {static_cast<std::size_t>((std::min)(boundary, static_cast<std::uint64_t>(incremental_sample_size)))};
+
+    if (!incremental_pread(fd, sample, size, 0U))
+    {
+        return false;
+    }
+    head = incremental_fingerprint(sample, size);
+
+    if (!incremental_pread(fd, sample, size, boundary - size))
+    {
+        return false;
+    }
+    tail = incremental_fingerprint(sample, size);
+
+    return true;
+}
+
+template <typename State>
+auto incremental_load(const std::string& state_path, incremental_record<State>& record) noexcept -> bool
+{
+    int fd {};
+    do
+    {
+        fd = ::open(state_path.c_str(), open_read_flags);
+    } while (fd < 0 && errno == EINTR);
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    const bool read {incremental_pread(fd, &record, sizeof(record), 0U)};
+    ::close(fd);
+
+    return read && std::memcmp(record.magic, incremental_magic, sizeof(incremental_magic)) == 0 &&
+           record.version == incremental_version && record.byte_order == incremental_byte_order &&
+           record.state_size == sizeof(State);
+}
+
+// Numbers the temporary files of one process, so threads saving the same state at once each write their own
+inline auto incremental_temp_id() noexcept -> std::uint64_t
+{
+    static std::atomic<std::uint64_t> next {0U};
+    return next.fetch_add(1U);
+}
+
+// Writes a new state file and renames it over the old one, so a reader never sees half of it
+template <typename State>
+auto incremental_save(const std::string& state_path, const incremental_record<State>& record) noexcept -> void
+{
+    std::string temp_path;
+    try
+    {
+        temp_path = state_path + ".tmp." + std::to_string(static_cast<long>(::getpid())) + '.' + std::to_string(incremental_temp_id());
+    }
+    catch (...)
+    {
+        return; // LCOV_EXCL_LINE
+    }
+
+    int fd {};
+    do
+    {
+        fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    } while (fd < 0 && errno == EINTR);
+
+    if (fd < 0)
+    {
+        return;
+    }
+
+    const auto* p {reinterpret_cast<const std::uint8_t*>(&record)};
+    std::size_t remaining {sizeof(record)};
+    while (remaining > 0U)
+    {
+        const auto res {::write(fd, p, remaining)};
+        if (res < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (res <= 0)
+        {
+            break;
+        }
+
+        p += res;
+        remaining -= static_cast<std::size_t>(res);
+    }
+
+    if (::close(fd) != 0 || remaining != 0U || std::rename(temp_path.c_str(), state_path.c_str()) != 0)
+    {
+        static_cast<void>(std::remove(temp_path.c_str()));
+    }
+}
+
+} // namespace detail
+
+// Hashes the file at path into hasher, which is reset first, resuming from the state saved in state_path
+// if the file is the same one, and still starts with the bytes that were hashed last time.
+// That check is the device and inode, and fingerprints of the first and last 4 KiB that were hashed,
+// so it notices a file that was rotated, truncated or rewritten, but not one changed in the middle.
+// When it resumes only the bytes appended since are read, along with the two samples.
+// The state at the last whole block of the file is then saved in state_path for the next pass.
+// Failing to read or write the state file only means that the whole file is hashed.
+// The Hasher needs get_state and set_state, and a trivially copyable state_type with a byte_count member
+// holding the number of bytes the state covers, as md5_state has
+template <typename Hasher>
+auto incremental_hash_file(const std::string& path, const std::string& state_path, Hasher& hasher, std::error_code& ec) -> incremental_result
+{
+    using state_type = typename Hasher::state_type;
+    static_assert(std::is_trivially_copyable<state_type>::value, "The hasher state is saved by copying its bytes");
+
+    incremental_result result {0U, 0U};
+
+    int fd {};
+    do
+    {
+        fd = ::open(path.c_str(), detail::open_read_flags);
+    } while (fd < 0 && errno == EINTR);
+
+    if (fd < 0)
+    {
+        ec.assign(errno, std::system_category());
+        return result;
+    }
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0)
+    {
+        ec.assign(errno, std::system_category());
+        ::close(fd);
+        return result;
+    }
+    result.size = static_cast<std::uint64_t>(st.st_size);
+
+    detail::incremental_record<state_type> record {};
+    std::uint64_t head {};
+    std::uint64_t tail {};
+    if (S_ISREG(st.st_mode) && detail::incremental_load(state_path, record) &&
+        record.device == static_cast<std::uint64_t>(st.st_dev) && record.inode == static_cast<std::uint64_t>(st.st_ino) &&
+        record.state.byte_count > 0U && record.state.byte_count <= result.size &&
+        detail::incremental_samples(fd, record.state.byte_count, head, tail) &&
+        head == record.head_fingerprint && tail == record.tail_fingerprint && hasher.set_state(record.state))
+    {
+        result.resumed_from = record.state.byte_count;
+    }
+    else
+    {
+        hasher.init();
+    }
+
+    // Hash up to the last whole block, save the state there, and then hash the rest
+    const auto boundary {result.size - result.size % 64U};
+    int error {};
+    try
+    {
+        if (boundary > result.resumed_from)
+        {
+            posix_file_reader reader(fd, result.resumed_from, boundary - result.resumed_from);
+            while (!reader.eof())
+            {
+                const auto buffer {reader.read_next_block()};
+                hasher.process_bytes(buffer, reader.get_bytes_read());
+            }
+            error = reader.error();
+        }
+
+        std::uint8_t rest[64] {};
+        const auto rest_size {static_cast<std::size_t>(result.size - boundary)};
+        errno = 0;
+        if (error == 0 && !detail::incremental_pread(fd, rest, rest_size, boundary))
+        {
+            // A read of nothing means the file was truncated while it was being hashed
+            error = errno == 0 ? EIO : errno;
+        }
+
+        if (error == 0 && S_ISREG(st.st_mode) && boundary > 0U && hasher.get_state(record.state) &&
+            detail::incremental_samples(fd, boundary, record.head_fingerprint, record.tail_fingerprint))
+        {
+            std::memcpy(record.magic, detail::incremental_magic, sizeof(detail::incremental_magic));
+            record.version = detail::incremental_version;
+            record.byte_order = detail::incremental_byte_order;
+            record.state_size = static_cast<std::uint32_t>(sizeof(state_type));
+            record.device = static_cast<std::uint64_t>(st.st_dev);
+            record.inode = static_cast<std::uint64_t>(st.st_ino);
+            detail::incremental_save(state_path, record);
+        }
+
+        hasher.process_bytes(rest, rest_size);
+    }
+    catch (...)
+    {
+        ::close(fd);
+        throw;
+    }
+
+    ::close(fd);
+
+    if (error != 0)
+    {
+        ec.assign(error, std::system_category());
+        return result;
+    }
+
+    ec.clear();
+    return result;
+}
+
+} // namespace utility
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#endif // BOOST_CRYPT_UTILITY_INCREMENTAL_FILE_HPP
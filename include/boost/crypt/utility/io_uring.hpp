@@ -0,0 +1,270 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// A minimal io_uring submission/completion queue pair built directly on the system calls,
+// so that no dependency on liburing is required
+
+#ifndef BOOST_CRYPT_UTILITY_IO_URING_HPP
+#define BOOST_CRYPT_UTILITY_IO_URING_HPP
+
+#include <boost/crypt/utility/config.hpp>
+
+#ifdef BOOST_CRYPT_HAS_IO_URING
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace boost {
+namespace crypt {
+namespace utility {
+
+class io_uring_queue
+{
+private:
+    int ring_fd_ {-1};
+
+    void* sq_ptr_ {};
+    std::size_t sq_size_ {};
+    void* cq_ptr_ {};
+    std::size_t cq_size_ {};
+    io_uring_sqe* sqes_ {};
+    std::size_t sqes_size_ {};
+
+    unsigned* sq_head_ {};
+    unsigned* sq_tail_ {};
+    unsigned* sq_mask_ {};
+    unsigned* sq_array_ {};
+    unsigned sq_entries_ {};
+
+    unsigned* cq_head_ {};
+    unsigned* cq_tail_ {};
+    unsigned* cq_mask_ {};
+    io_uring_cqe* cqes_ {};
+
+    unsigned pending_ {};
+
+    static auto load_acquire(const unsigned* p) noexcept -> unsigned
+    {
+        return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+    }
+
+    static auto store_release(unsigned* p, unsigned value) noexcept -> void
+    {
+        __atomic_store_n(p, value, __ATOMIC_RELEASE);
+    }
+
+    static auto offset(void* base, std::uint32_t off) noexcept -> unsigned*
+    {
+        return reinterpret_cast<unsigned*>(static_cast<char*>(base) + off);
+    }
+
+    auto setup(unsigned entries) noexcept -> void
+    {
+        #if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+        io_uring_params params {};
+        const auto fd {::syscall(__NR_io_uring_setup, entries, &params)};
+        if (fd < 0)
+        {
+            return;
+        }
+        ring_fd_ = static_cast<int>(fd);
+
+        sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap {(params.features & IORING_FEAT_SINGLE_MMAP) != 0U};
+        if (single_mmap)
+        {
+            sq_size_ = cq_size_ = (sq_size_ > cq_size_ ? sq_size_ : cq_size_);
+        }
+
+        sq_ptr_ = ::mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, static_cast<::off_t>(IORING_OFF_SQ_RING));
+        if (sq_ptr_ == MAP_FAILED)
+        {
+            sq_ptr_ = nullptr;
+            return;
+        }
+
+        if (single_mmap)
+        {
+            cq_ptr_ = sq_ptr_;
+        }
+        else
+        {
+            cq_ptr_ = ::mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, static_cast<::off_t>(IORING_OFF_CQ_RING));
+            if (cq_ptr_ == MAP_FAILED)
+            {
+                cq_ptr_ = nullptr;
+                return;
+            }
+        }
+
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        auto* sqes {::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, static_cast<::off_t>(IORING_OFF_SQES))};
+        if (sqes == MAP_FAILED)
+        {
+            return;
+        }
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        sq_head_ = offset(sq_ptr_, params.sq_off.head);
+        sq_tail_ = offset(sq_ptr_, params.sq_off.tail);
+        sq_mask_ = offset(sq_ptr_, params.sq_off.ring_mask);
+        sq_array_ = offset(sq_ptr_, params.sq_off.array);
+        sq_entries_ = params.sq_entries;
+
+        cq_head_ = offset(cq_ptr_, params.cq_off.head);
+        cq_tail_ = offset(cq_ptr_, params.cq_off.tail);
+        cq_mask_ = offset(cq_ptr_, params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(static_cast<char*>(cq_ptr_) + params.cq_off.cqes);
+        #else
+        static_cast<void>(entries);
+        #endif
+    }
+
+public:
+    // The kernel rounds entries up to a power of 2.
+    // If io_uring is not available (old kernel, seccomp, etc.) valid() returns false
+    explicit io_uring_queue(unsigned entries) noexcept
+    {
+        setup(entries);
+    }
+
+    io_uring_queue(const io_uring_queue&) = delete;
+    auto operator=(const io_uring_queue&) -> io_uring_queue& = delete;
+
+    auto valid() const noexcept -> bool
+    {
+        return sqes_ != nullptr;
+    }
+
+    auto entries() const noexcept -> unsigned
+    {
+        return sq_entries_;
+    }
+
+    // Asks the kernel if the operation (e.g. IORING_OP_OPENAT) is supported
+    auto supports(unsigned op) const noexcept -> bool
+    {
+        #ifdef __NR_io_uring_register
+        constexpr std::size_t max_ops {256U};
+        const auto probe_size {sizeof(io_uring_probe) + max_ops * sizeof(io_uring_probe_op)};
+        auto* probe {static_cast<io_uring_probe*>(std::calloc(1U, probe_size))};
+        if (probe == nullptr)
+        {
+            return false;
+        }
+
+        bool supported {false};
+        if (::syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_PROBE, probe, max_ops) >= 0)
+        {
+            supported = op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED) != 0U;
+        }
+
+        std::free(probe);
+        return supported;
+        #else
+        static_cast<void>(op);
+        return false;
+        #endif
+    }
+
+    // Returns a zeroed submission queue entry, or nullptr if the submission queue is full.
+    // The kernel only reads the entry during submit_and_wait, so it can be filled in after this returns
+    auto get_sqe() noexcept -> io_uring_sqe*
+    {
+        const auto tail {*sq_tail_};
+        if (tail - load_acquire(sq_head_) >= sq_entries_)
+        {
+            return nullptr;
+        }
+
+        const auto index {tail & *sq_mask_};
+        auto* sqe {&sqes_[index]};
+        std::memset(sqe, 0, sizeof(io_uring_sqe));
+        sq_array_[index] = index;
+        store_release(sq_tail_, tail + 1U);
+        ++pending_;
+
+        return sqe;
+    }
+
+    // Submits all new entries and waits for at least wait_nr completions.
+    // Returns 0 or -errno
+    auto submit_and_wait(unsigned wait_nr) noexcept -> int
+    {
+        #ifdef __NR_io_uring_enter
+        while (true)
+        {
+            const auto res {::syscall(__NR_io_uring_enter, ring_fd_, pending_, wait_nr, IORING_ENTER_GETEVENTS, nullptr, 0)};
+            if (res >= 0)
+            {
+                pending_ -= static_cast<unsigned>(res);
+                return 0;
+            }
+            if (errno != EINTR)
+            {
+                return -errno;
+            }
+        }
+        #else
+        static_cast<void>(wait_nr);
+        return -ENOSYS;
+        #endif
+    }
+
+    // Returns the next completion, or nullptr if there are none ready
+    auto peek_cqe() noexcept -> io_uring_cqe*
+    {
+        const auto head {*cq_head_};
+        if (head == load_acquire(cq_tail_))
+        {
+            return nullptr;
+        }
+
+        return &cqes_[head & *cq_mask_];
+    }
+
+    // Marks the completion returned by peek_cqe as consumed
+    auto cqe_seen() noexcept -> void
+    {
+        store_release(cq_head_, *cq_head_ + 1U);
+    }
+
+    ~io_uring_queue()
+    {
+        if (sqes_ != nullptr)
+        {
+            ::munmap(sqes_, sqes_size_);
+        }
+        if (cq_ptr_ != nullptr && cq_ptr_ != sq_ptr_)
+        {
+            ::munmap(cq_ptr_, cq_size_);
+        }
+        if (sq_ptr_ != nullptr)
+        {
+            ::munmap(sq_ptr_, sq_size_);
+        }
+        if (ring_fd_ >= 0)
+        {
+            ::close(ring_fd_);
+        }
+    }
+};
+
+} // namespace utility
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HAS_IO_URING
+
+#endif // BOOST_CRYPT_UTILITY_IO_URING_HPP
@@ -0,0 +1,215 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#ifndef BOOST_CRYPT_UTILITY_MAPPED_FILE_HPP
+#define BOOST_CRYPT_UTILITY_MAPPED_FILE_HPP
+
+#include <boost/crypt/utility/config.hpp>
+#include <boost/crypt/utility/file.hpp>
+#include <boost/crypt/utility/posix_file.hpp>
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+namespace boost {
+namespace crypt {
+namespace utility {
+
+namespace detail {
+
+inline auto page_size() noexcept -> std::size_t
+{
+    const auto size {::sysconf(_SC_PAGESIZE)};
+    return size > 0 ? static_cast<std::size_t>(size) : 4096U;
+}
+
+inline auto advise_mapping(void* addr, std::size_t size) noexcept -> void
+{
+    #if defined(MADV_SEQUENTIAL) && defined(MADV_WILLNEED)
+    static_cast<void>(::madvise(addr, size, MADV_SEQUENTIAL));
+    static_cast<void>(::madvise(addr, size, MADV_WILLNEED));
+    #elif defined(POSIX_MADV_SEQUENTIAL)
+    static_cast<void>(::posix_madvise(addr, size, POSIX_MADV_SEQUENTIAL));
+    #else
+    static_cast<void>(addr);
+    static_cast<void>(size);
+    #endif
+}
+
+// True if the file is a regular file that read_mode::automatic should map
+inline auto should_map(const char* filename, read_mode mode) noexcept -> bool
+{
+    if (mode == read_mode::read || mode == read_mode::direct || mode == read_mode::scan)
+    {
+        return false;
+    }
+
+    struct stat st {};
+    if (::stat(filename, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        return false;
+    }
+
+    return mode == read_mode::mmap || static_cast<std::uint64_t>(st.st_size) >= BOOST_CRYPT_MMAP_THRESHOLD;
+}
+
+} // namespace detail
+
+// Memory maps a regular file read-only one window at a time, so hashing reads directly from the page cache.
+// At most BOOST_CRYPT_MMAP_WINDOW_SIZE bytes are mapped at once regardless of the size of the file.
+// The size of the file is fixed when it is opened, and truncating the file while it is mapped raises SIGBUS.
+class mapped_file_reader
+{
+private:
+    int fd_ {-1};
+    std::uint64_t file_size_ {};
+    std::uint64_t offset_ {};
+    std::size_t window_size_ {};
+    void* window_ {};
+    std::size_t bytes_read_ {};
+    bool eof_ {};
+    int error_ {};
+
+    auto open_file(const char* filename, std::size_t window_size) -> void
+    {
+        do
+        {
+            fd_ = ::open(filename, detail::open_read_flags);
+        } while (fd_ < 0 && errno == EINTR);
+
+        if (fd_ < 0)
+        {
+            throw std::runtime_error("Error opening file");
+        }
+
+        struct stat st {};
+        if (::fstat(fd_, &st) != 0 || !S_ISREG(st.st_mode))
+        {
+            ::close(fd_);
+            fd_ = -1;
+            throw std::runtime_error("File can not be memory mapped");
+        }
+
+        file_size_ = static_cast<std::uint64_t>(st.st_size);
+        eof_ = file_size_ == 0U;
+
+        // Windows must start on a page boundary
+        const auto page {detail::page_size()};
+        window_size_ = window_size == 0U ? BOOST_CRYPT_MMAP_WINDOW_SIZE : window_size;
+        window_size_ = ((window_size_ + page - 1U) / page) * page;
+    }
+
+    auto unmap() noexcept -> void
+    {
+        if (window_ != nullptr)
+        {
+            ::munmap(window_, bytes_read_);
+            window_ = nullptr;
+        }
+    }
+
+public:
+    explicit mapped_file_reader(const std::string& filename, std::size_t window_size = 0U)
+    {
+        open_file(filename.c_str(), window_size);
+    }
+
+    explicit mapped_file_reader(const char* filename, std::size_t window_size = 0U)
+    {
+        open_file(filename, window_size);
+    }
+
+    #ifdef BOOST_CRYPT_HAS_STRING_VIEW
+    explicit mapped_file_reader(std::string_view filename, std::size_t window_size = 0U)
+    {
+        open_file(std::string{filename}.c_str(), window_size);
+    }
+    #endif
+
+    mapped_file_reader(const mapped_file_reader&) = delete;
+    auto operator=(const mapped_file_reader&) -> mapped_file_reader& = delete;
+
+    // Unmaps the previous window and maps the next one.
+    // The returned pointer is valid until the next call or the reader is destroyed
+    auto read_next_block() noexcept -> const std::uint8_t*
+    {
+        unmap();
+        bytes_read_ = 0U;
+
+        if (eof_)
+        {
+            return nullptr;
+        }
+
+        const auto remaining {file_size_ - offset_};
+        const auto length {remaining < window_size_ ? static_cast<std::size_t>(remaining) : window_size_};
+
+        auto* addr {::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd_, static_cast<::off_t>(offset_))};
+        if (addr == MAP_FAILED)
+        {
+            error_ = errno;
+            eof_ = true;
+            return nullptr;
+        }
+
+        detail::advise_mapping(addr, length);
+
+        window_ = addr;
+        bytes_read_ = length;
+        offset_ += length;
+        eof_ = offset_ == file_size_;
+
+        return static_cast<const std::uint8_t*>(addr);
+    }
+
+    auto get_bytes_read() const noexcept -> std::size_t
+    {
+        return bytes_read_;
+    }
+
+    auto eof() const noexcept -> bool
+    {
+        return eof_;
+    }
+
+    // The errno of a failed mapping, or 0
+    auto error() const noexcept -> int
+    {
+        return error_;
+    }
+
+    auto file_size() const noexcept -> std::uint64_t
+    {
+        return file_size_;
+    }
+
+    ~mapped_file_reader()
+    {
+        unmap();
+        if (fd_ >= 0)
+        {
+            ::close(fd_);
+        }
+    }
+};
+
+} // namespace utility
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#endif // BOOST_CRYPT_UTILITY_MAPPED_FILE_HPP
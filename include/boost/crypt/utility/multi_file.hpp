@@ -0,0 +1,564 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// Hashes many files concurrently, keeping many opens and reads in flight at once
+
+#ifndef BOOST_CRYPT_UTILITY_MULTI_FILE_HPP
+#define BOOST_CRYPT_UTILITY_MULTI_FILE_HPP
+
+#include <boost/crypt/utility/config.hpp>
+#include <boost/crypt/utility/file.hpp>
+#include <boost/crypt/utility/io_uring.hpp>
+#include <boost/crypt/utility/thread_pool.hpp>
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef BOOST_CRYPT_HAS_IO_URING
+#include <sys/eventfd.h>
+#endif
+#endif
+
+namespace boost {
+namespace crypt {
+namespace utility {
+
+// Number of files that are open and being read at the same time
+BOOST_CRYPT_INLINE_CONSTEXPR std::size_t default_files_in_flight {256U};
+
+// Size of the read buffer for each file in flight
+BOOST_CRYPT_INLINE_CONSTEXPR std::size_t default_multi_file_buffer_size {131072U};
+
+namespace detail {
+
+// Hashes a single file into hasher, reporting failures through ec instead of throwing
+template <typename Hasher>
+auto hash_one_file(const std::string& path, Hasher& hasher, std::uint8_t* buffer, std::size_t buffer_size) -> std::error_code
+{
+    #ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+    int fd {};
+    do
+    {
+        fd = ::open(path.c_str(), open_read_flags);
+    } while (fd < 0 && errno == EINTR);
+
+    if (fd < 0)
+    {
+        return std::error_code(errno, std::system_category());
+    }
+
+    advise_sequential(fd);
+
+    std::error_code ec;
+    while (true)
+    {
+        const auto res {::read(fd, buffer, buffer_size)};
+        if (res > 0)
+        {
+            hasher.process_bytes(static_cast<const std::uint8_t*>(buffer), static_cast<std::size_t>(res));
+        }
+        else if (res == 0)
+        {
+            break;
+        }
+        else if (errno != EINTR)
+        {
+            ec = std::error_code(errno, std::system_category());
+            break;
+        }
+    }
+
+    ::close(fd);
+    return ec;
+
+    #else
+
+    file_source source(path);
+    if (!source.is_open())
+    {
+        return std::make_error_code(std::errc::no_such_file_or_directory);
+    }
+
+    while (!source.eof())
+    {
+        const auto len {source.read(buffer, buffer_size)};
+        hasher.process_bytes(static_cast<const std::uint8_t*>(buffer), len);
+    }
+
+    return source.good() ? std::error_code{} : std::make_error_code(std::errc::io_error);
+
+    #endif
+}
+
+} // namespace detail
+
+// Hashes each file on a pool of worker threads that each synchronously open and read one file at a time.
+// Each file gets a fresh default constructed Hasher, and once a file is complete
+// callback(index, hasher, ec) is called with the index of the path.
+// The callback is never invoked concurrently, but it is invoked from the worker threads.
+// If the callback or a hasher throws, no more files are started and the exception is rethrown.
+// A thread_count of 0 selects a count based on std::thread::hardware_concurrency()
+template <typename Hasher, typename Callback>
+auto thread_pool_hash_files(const std::vector<std::string>& paths, Callback&& callback,
+                            std::size_t thread_count = 0U, std::size_t buffer_size = default_multi_file_buffer_size) -> void
+{
+    if (paths.empty())
+    {
+        return;
+    }
+
+    if (thread_count == 0U)
+    {
+        // Threads spend most of their time blocked in the kernel, so use more than the number of cores
+        thread_count = (std::max)(std::size_t{4U}, 2U * static_cast<std::size_t>(std::thread::hardware_concurrency()));
+    }
+    thread_count = (std::min)(thread_count, paths.size());
+
+    std::atomic<std::size_t> next_index {0U};
+    std::atomic<bool> stop {false};
+    std::mutex callback_mutex;
+    std::exception_ptr error;
+
+    auto worker = [&]() {
+        try
+        {
+            std::unique_ptr<std::uint8_t[]> buffer {new std::uint8_t[buffer_size]};
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                const auto index {next_index.fetch_add(1U, std::memory_order_relaxed)};
+                if (index >= paths.size())
+                {
+                    break;
+                }
+
+                Hasher hasher {};
+                const auto ec {detail::hash_one_file(paths[index], hasher, buffer.get(), buffer_size)};
+
+                std::lock_guard<std::mutex> lock(callback_mutex);
+                callback(index, hasher, ec);
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(callback_mutex);
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+            stop.store(true, std::memory_order_relaxed);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1U);
+    try
+    {
+        for (std::size_t i {1U}; i < thread_count; ++i)
+        {
+            threads.emplace_back(worker);
+        }
+    }
+    catch (...)
+    {
+        // Could not start as many threads as requested, so carry on with the ones we have
+    }
+
+    worker();
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+#ifdef BOOST_CRYPT_HAS_IO_URING
+
+namespace detail {
+
+template <typename Hasher>
+struct io_uring_file_state
+{
+    std::size_t index {};
+    int fd {-1};
+    std::uint64_t offset {};
+    std::size_t filled {};
+    Hasher hasher {};
+    std::unique_ptr<std::uint8_t[]> buffer;
+
+    io_uring_file_state() = default;
+    io_uring_file_state(const io_uring_file_state&) = delete;
+    auto operator=(const io_uring_file_state&) -> io_uring_file_state& = delete;
+
+    auto close() noexcept -> void
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    ~io_uring_file_state()
+    {
+        close();
+    }
+};
+
+// Hands the slots whose buffers have been hashed on the pool back to the thread driving the ring.
+// That thread always has a read of the eventfd queued, so each hand back wakes it like any other completion
+class io_uring_hash_handoff
+{
+private:
+    int fd_ {-1};
+    std::mutex mutex_;
+    std::vector<std::size_t> hashed_;
+    std::exception_ptr error_;
+
+public:
+    // Where the queued read of the eventfd puts its count
+    std::uint64_t count {};
+
+    // Reserves room for every slot, so handing one back never allocates
+    explicit io_uring_hash_handoff(std::size_t slot_count) : fd_ {::eventfd(0U, EFD_CLOEXEC)}
+    {
+        hashed_.reserve(slot_count);
+    }
+
+    io_uring_hash_handoff(const io_uring_hash_handoff&) = delete;
+    auto operator=(const io_uring_hash_handoff&) -> io_uring_hash_handoff& = delete;
+
+    auto fd() const noexcept -> int
+    {
+        return fd_;
+    }
+
+    auto wake() noexcept -> void
+    {
+        const std::uint64_t one {1U};
+        ssize_t res {};
+        do
+        {
+            res = ::write(fd_, &one, sizeof(one));
+        } while (res < 0 && errno == EINTR);
+    }
+
+    // Called on a pool thread once the buffer of slot is hashed, with the exception the hasher threw if any
+    auto post(std::size_t slot, std::exception_ptr error) noexcept -> void
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            hashed_.push_back(slot);
+            if (error && !error_)
+            {
+                error_ = error;
+            }
+        }
+        wake();
+    }
+
+    // Swaps the slots handed back so far into slots, which must have the same capacity,
+    // and rethrows the first exception thrown by a hasher
+    auto take(std::vector<std::size_t>& slots) -> void
+    {
+        slots.clear();
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (error_)
+        {
+            std::rethrow_exception(error_);
+        }
+        slots.swap(hashed_);
+    }
+
+    ~io_uring_hash_handoff()
+    {
+        if (fd_ >= 0)
+        {
+            ::close(fd_);
+        }
+    }
+};
+
+} // namespace detail
+
+// Hashes each file using a single io_uring, keeping up to files_in_flight opens and reads
+// in flight at once from the calling thread.
+// The buffers that are read are hashed on a work_stealing_pool of hash_thread_count threads, so hashing is not limited
+// to the one core driving the ring, and the next read of a file is queued once its last buffer has been hashed.
+// A hash_thread_count of 0 uses one thread per hardware thread, and 1 hashes on the calling thread.
+// Each file gets a fresh default constructed Hasher, and once a file is complete
+// callback(index, hasher, ec) is called on the calling thread with the index of the path.
+// If the callback or a hasher throws, the operations in flight are completed and the exception is rethrown.
+// Returns false without calling the callback if io_uring, or the operations it needs, are not supported by the kernel
+template <typename Hasher, typename Callback>
+auto io_uring_hash_files(const std::vector<std::string>& paths, Callback&& callback,
+                         std::size_t files_in_flight = default_files_in_flight,
+                         std::size_t buffer_size = default_multi_file_buffer_size,
+                         std::size_t hash_thread_count = 0U) -> bool
+{
+    files_in_flight = (std::max)(std::size_t{1U}, (std::min)(files_in_flight, std::size_t{4096U}));
+    if (hash_thread_count == 0U)
+    {
+        hash_thread_count = static_cast<std::size_t>(std::thread::hardware_concurrency());
+    }
+
+    // One more entry for the read of the eventfd that the hashing threads wake the ring with
+    io_uring_queue ring(static_cast<unsigned>(files_in_flight + 1U));
+    if (!ring.valid() || !ring.supports(IORING_OP_OPENAT) || !ring.supports(IORING_OP_READ))
+    {
+        return false;
+    }
+
+    const auto slot_count {(std::min)(files_in_flight, paths.size())};
+    std::vector<std::unique_ptr<detail::io_uring_file_state<Hasher>>> slots(slot_count);
+    std::vector<std::size_t> free_slots;
+    free_slots.reserve(slot_count);
+    for (std::size_t i {}; i < slot_count; ++i)
+    {
+        slots[i].reset(new detail::io_uring_file_state<Hasher>());
+        slots[i]->buffer.reset(new std::uint8_t[buffer_size]);
+        free_slots.push_back(slot_count - 1U - i);
+    }
+
+    std::vector<std::size_t> hashed;
+    hashed.reserve(slot_count);
+    detail::io_uring_hash_handoff handoff(slot_count);
+
+    // Declared after the slots and the handoff, so that a hash still running is finished before they are destroyed
+    std::unique_ptr<work_stealing_pool> pool;
+    if (hash_thread_count > 1U && slot_count > 1U && handoff.fd() >= 0)
+    {
+        pool.reset(new work_stealing_pool((std::min)(hash_thread_count, slot_count)));
+    }
+
+    const auto read_size {static_cast<std::uint32_t>((std::min)(buffer_size, std::size_t{UINT32_MAX}))};
+    constexpr std::uint64_t wake_tag {UINT64_MAX};
+    std::size_t in_flight {};
+
+    // Each slot has at most one operation in flight, plus the read of the eventfd, so the submission queue can never be full
+    auto queue_open = [&](std::size_t slot) {
+        auto* sqe {ring.get_sqe()};
+        BOOST_CRYPT_ASSERT(sqe != nullptr);
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = reinterpret_cast<std::uint64_t>(paths[slots[slot]->index].c_str());
+        sqe->open_flags = static_cast<std::uint32_t>(detail::open_read_flags);
+        sqe->user_data = slot;
+        ++in_flight;
+    };
+
+    auto queue_read = [&](std::size_t slot) {
+        auto& state {*slots[slot]};
+        auto* sqe {ring.get_sqe()};
+        BOOST_CRYPT_ASSERT(sqe != nullptr);
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = state.fd;
+        sqe->addr = reinterpret_cast<std::uint64_t>(state.buffer.get());
+        sqe->len = read_size;
+        sqe->off = state.offset;
+        sqe->user_data = slot;
+        ++in_flight;
+    };
+
+    auto queue_wake = [&]() {
+        auto* sqe {ring.get_sqe()};
+        BOOST_CRYPT_ASSERT(sqe != nullptr);
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = handoff.fd();
+        sqe->addr = reinterpret_cast<std::uint64_t>(&handoff.count);
+        sqe->len = static_cast<std::uint32_t>(sizeof(handoff.count));
+        sqe->off = 0U;
+        sqe->user_data = wake_tag;
+        ++in_flight;
+    };
+
+    auto finish = [&](std::size_t slot, const std::error_code& ec) {
+        auto& state {*slots[slot]};
+        state.close();
+        callback(state.index, state.hasher, ec);
+        free_slots.push_back(slot);
+    };
+
+    // The kernel may still be writing into the buffers of operations in flight,
+    // so they must all complete before the slots are destroyed. Waking the eventfd completes its read
+    auto drain = [&]() noexcept {
+        if (pool)
+        {
+            handoff.wake();
+        }
+
+        while (in_flight > 0U && ring.submit_and_wait(1U) == 0)
+        {
+            while (auto* cqe = ring.peek_cqe())
+            {
+                if (cqe->user_data != wake_tag)
+                {
+                    auto& state {*slots[static_cast<std::size_t>(cqe->user_data)]};
+                    if (state.fd < 0 && cqe->res >= 0)
+                    {
+                        state.fd = cqe->res;
+                    }
+                }
+                ring.cqe_seen();
+                --in_flight;
+            }
+        }
+    };
+
+    std::size_t next_index {};
+
+    try
+    {
+        if (pool)
+        {
+            queue_wake();
+        }
+
+        while (next_index < paths.size() || free_slots.size() < slot_count)
+        {
+            while (!free_slots.empty() && next_index < paths.size())
+            {
+                const auto slot {free_slots.back()};
+                free_slots.pop_back();
+
+                auto& state {*slots[slot]};
+                state.index = next_index++;
+                state.offset = 0U;
+                state.fd = -1;
+                state.hasher = Hasher{};
+                queue_open(slot);
+            }
+
+            const auto res {ring.submit_and_wait(1U)};
+            if (res < 0)
+            {
+                throw std::system_error(std::error_code(-res, std::system_category()), "io_uring_enter");
+            }
+
+            while (auto* cqe = ring.peek_cqe())
+            {
+                const auto tag {cqe->user_data};
+                const auto result {cqe->res};
+                ring.cqe_seen();
+                --in_flight;
+
+                if (tag == wake_tag)
+                {
+                    if (result < 0 && result != -EINTR && result != -EAGAIN)
+                    {
+                        throw std::system_error(std::error_code(-result, std::system_category()), "eventfd");
+                    }
+
+                    // Each hashed buffer is followed by the next read of its file, which ends it when it returns nothing
+                    handoff.take(hashed);
+                    for (const auto slot : hashed)
+                    {
+                        queue_read(slot);
+                    }
+                    queue_wake();
+                    continue;
+                }
+
+                const auto slot {static_cast<std::size_t>(tag)};
+                auto& state {*slots[slot]};
+                if (result < 0)
+                {
+                    finish(slot, std::error_code(-result, std::system_category()));
+                }
+                else if (state.fd < 0)
+                {
+                    // Open completed
+                    state.fd = result;
+                    detail::advise_sequential(state.fd);
+                    queue_read(slot);
+                }
+                else if (result > 0)
+                {
+                    state.offset += static_cast<std::uint64_t>(result);
+                    state.filled = static_cast<std::size_t>(result);
+                    if (pool)
+                    {
+                        auto* handoff_ptr {&handoff};
+                        auto* state_ptr {&state};
+                        pool->submit([handoff_ptr, state_ptr, slot]() {
+                            std::exception_ptr error;
+                            try
+                            {
+                                state_ptr->hasher.process_bytes(static_cast<const std::uint8_t*>(state_ptr->buffer.get()), state_ptr->filled);
+                            }
+                            catch (...)
+                            {
+                                error = std::current_exception();
+                            }
+                            handoff_ptr->post(slot, error);
+                        });
+                    }
+                    else
+                    {
+                        state.hasher.process_bytes(static_cast<const std::uint8_t*>(state.buffer.get()), state.filled);
+                        queue_read(slot);
+                    }
+                }
+                else
+                {
+                    finish(slot, std::error_code{});
+                }
+            }
+        }
+    }
+    catch (...)
+    {
+        drain();
+        throw;
+    }
+
+    drain();
+    return true;
+}
+
+#endif // BOOST_CRYPT_HAS_IO_URING
+
+// Hashes each of the files concurrently using io_uring where the kernel supports it, with the buffers hashed on a pool
+// of one thread per hardware thread, and otherwise falls back to thread_pool_hash_files.
+// Each file gets a fresh default constructed Hasher, and once a file is complete callback(index, hasher, ec) is called.
+// The callback is never invoked concurrently
+template <typename Hasher, typename Callback>
+auto hash_files(const std::vector<std::string>& paths, Callback&& callback,
+                std::size_t files_in_flight = default_files_in_flight,
+                std::size_t buffer_size = default_multi_file_buffer_size) -> void
+{
+    #ifdef BOOST_CRYPT_HAS_IO_URING
+    if (io_uring_hash_files<Hasher>(paths, callback, files_in_flight, buffer_size))
+    {
+        return;
+    }
+    #endif
+
+    thread_pool_hash_files<Hasher>(paths, callback, (std::min)(files_in_flight, std::size_t{64U}), buffer_size);
+}
+
+} // namespace utility
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_UTILITY_MULTI_FILE_HPP
@@ -0,0 +1,401 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// Hashes data streamed through pipes, optionally passing it on unchanged
+
+#ifndef BOOST_CRYPT_UTILITY_PIPE_HPP
+#define BOOST_CRYPT_UTILITY_PIPE_HPP
+
+#include <boost/crypt/utility/config.hpp>
+#include <boost/crypt/utility/posix_config.hpp>
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace boost {
+namespace crypt {
+namespace utility {
+
+namespace detail {
+
+// Grows a pipe so that a fast producer can get further ahead of the hasher. Other files are unaffected
+inline auto enlarge_pipe(int fd, std::size_t size) noexcept -> void
+{
+    #if defined(F_SETPIPE_SZ) && defined(F_GETPIPE_SZ)
+    const auto current {::fcntl(fd, F_GETPIPE_SZ)};
+    if (current < 0)
+    {
+        return;
+    }
+
+    // Unprivileged processes are limited to /proc/sys/fs/pipe-max-size, so settle for less if need be
+    for (auto request {size}; request > static_cast<std::size_t>(current); request /= 2U)
+    {
+        if (::fcntl(fd, F_SETPIPE_SZ, static_cast<int>(request)) >= 0)
+        {
+            break;
+        }
+    }
+    #else
+    static_cast<void>(fd);
+    static_cast<void>(size);
+    #endif
+}
+
+// Blocks until fd is ready for events, and returns the errno of a failure or 0
+inline auto wait_for(int fd, short events) noexcept -> int
+{
+    struct pollfd pfd {};
+    pfd.fd = fd;
+    pfd.events = events;
+
+    int res {};
+    do
+    {
+        res = ::poll(&pfd, 1, -1);
+    } while (res < 0 && errno == EINTR);
+
+    return res < 0 ? errno : 0;
+}
+
+// Whether data can be read from fd without waiting for it
+inline auto readable_now(int fd) noexcept -> bool
+{
+    struct pollfd pfd {};
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+
+    int res {};
+    do
+    {
+        res = ::poll(&pfd, 1, 0);
+    } while (res < 0 && errno == EINTR);
+
+    return res > 0;
+}
+
+// Reads size bytes, and returns the errno of a failure, EIO if the data ran out, or 0
+inline auto read_all(int fd, std::uint8_t* data, std::size_t size) noexcept -> int
+{
+    while (size > 0U)
+    {
+        const auto res {::read(fd, data, size)};
+        if (res > 0)
+        {
+            data += res;
+            size -= static_cast<std::size_t>(res);
+        }
+        else if (res == 0)
+        {
+            return EIO;
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            const auto err {wait_for(fd, POLLIN)};
+            if (err != 0)
+            {
+                return err;
+            }
+        }
+        else if (errno != EINTR)
+        {
+            return errno;
+        }
+    }
+
+    return 0;
+}
+
+// Writes size bytes, and returns the errno of a failure or 0
+inline auto write_all(int fd, const std::uint8_t* data, std::size_t size) noexcept -> int
+{
+    while (size > 0U)
+    {
+        const auto res {::write(fd, data, size)};
+        if (res >= 0)
+        {
+            data += res;
+            size -= static_cast<std::size_t>(res);
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            const auto err {wait_for(fd, POLLOUT)};
+            if (err != 0)
+            {
+                return err;
+            }
+        }
+        else if (errno != EINTR)
+        {
+            return errno;
+        }
+    }
+
+    return 0;
+}
+
+} // namespace detail
+
+// Reads a pipe, or stdin, owned by the caller with large reads.
+// The pipe is grown to BOOST_CRYPT_PIPE_BUFFER_SIZE where the platform allows it, and each call to read_next_block
+// drains whatever has been written so far, up to buffer_size() bytes, only waiting when the pipe is empty.
+// The descriptor's flags are left alone, as other processes may share them: only the first read of each block
+// waits, and later ones are only made while poll(2) reports more data
+class pipe_reader
+{
+private:
+    int fd_ {-1};
+    std::size_t buffer_size_ {};
+    std::size_t bytes_read_ {};
+    std::unique_ptr<std::uint8_t[]> buffer_;
+    bool eof_ {};
+    int error_ {};
+
+    // Returns the errno of a failure, or 0
+    auto try_open(int fd, std::size_t buffer_size) noexcept -> int
+    {
+        const auto flags {fd < 0 ? -1 : ::fcntl(fd, F_GETFL)};
+        if (flags < 0)
+        {
+            eof_ = true;
+            return fd < 0 ? EBADF : errno;
+        }
+
+        fd_ = fd;
+        buffer_size_ = buffer_size == 0U ? BOOST_CRYPT_PIPE_BUFFER_SIZE : buffer_size;
+        detail::enlarge_pipe(fd_, buffer_size_);
+
+        return 0;
+    }
+
+public:
+    explicit pipe_reader(int fd, std::size_t buffer_size = 0U)
+    {
+        if (try_open(fd, buffer_size) != 0)
+        {
+            throw std::runtime_error("Invalid file descriptor");
+        }
+    }
+
+    // Reports an invalid descriptor through ec instead of throwing, in which case the reader is already at its end
+    pipe_reader(int fd, std::error_code& ec, std::size_t buffer_size = 0U) noexcept
+    {
+        const auto err {try_open(fd, buffer_size)};
+        ec = err == 0 ? std::error_code{} : std::error_code(err, std::system_category());
+    }
+
+    pipe_reader(const pipe_reader&) = delete;
+    auto operator=(const pipe_reader&) -> pipe_reader& = delete;
+
+    auto read_next_block() noexcept -> const std::uint8_t*
+    {
+        bytes_read_ = 0U;
+        if (eof_)
+        {
+            return nullptr;
+        }
+
+        if (!buffer_)
+        {
+            buffer_.reset(new (std::nothrow) std::uint8_t[buffer_size_]);
+            if (!buffer_)
+            {
+                error_ = ENOMEM;
+                eof_ = true;
+                return nullptr;
+            }
+        }
+
+        while (bytes_read_ < buffer_size_)
+        {
+            const auto res {::read(fd_, buffer_.get() + bytes_read_, buffer_size_ - bytes_read_)};
+            if (res > 0)
+            {
+                // Hash what has arrived rather than waiting for the rest of the buffer
+                bytes_read_ += static_cast<std::size_t>(res);
+                if (bytes_read_ < buffer_size_ && !detail::readable_now(fd_))
+                {
+                    break;
+                }
+            }
+            else if (res == 0)
+            {
+                eof_ = true;
+                break;
+            }
+            else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                // The caller opened the descriptor with O_NONBLOCK
+                if (bytes_read_ > 0U)
+                {
+                    break;
+                }
+
+                error_ = detail::wait_for(fd_, POLLIN);
+                if (error_ != 0)
+                {
+                    eof_ = true;
+                    break;
+                }
+            }
+            else if (errno != EINTR)
+            {
+                error_ = errno;
+                eof_ = true;
+                break;
+            }
+        }
+
+        return buffer_.get();
+    }
+
+    auto get_bytes_read() const noexcept -> std::size_t
+    {
+        return bytes_read_;
+    }
+
+    auto eof() const noexcept -> bool
+    {
+        return eof_;
+    }
+
+    // The errno of a failed read, or 0
+    auto error() const noexcept -> int
+    {
+        return error_;
+    }
+
+    auto buffer_size() const noexcept -> std::size_t
+    {
+        return buffer_size_;
+    }
+};
+
+// Hashes everything read from in_fd until the end of the stream, while writing it on unchanged to out_fd.
+// When both are pipes tee(2) duplicates the data into out_fd inside the kernel, and the same bytes are then read
+// from in_fd to be hashed, so passing the data through costs no copy beyond the one the hasher needs.
+// Otherwise each buffer is read, hashed and written. Neither descriptor is closed.
+// Returns the errno of a failed read or write, or 0
+template <typename Hasher>
+auto pass_through_hash(int in_fd, int out_fd, Hasher& hasher, std::size_t buffer_size = 0U) -> int
+{
+    if (buffer_size == 0U)
+    {
+        buffer_size = BOOST_CRYPT_PIPE_BUFFER_SIZE;
+    }
+
+    std::unique_ptr<std::uint8_t[]> buffer {new (std::nothrow) std::uint8_t[buffer_size]};
+    if (!buffer)
+    {
+        return ENOMEM;
+    }
+
+    detail::enlarge_pipe(in_fd, buffer_size);
+    detail::enlarge_pipe(out_fd, buffer_size);
+
+    #ifdef BOOST_CRYPT_HAS_TEE
+    bool use_tee {true};
+    #endif
+
+    while (true)
+    {
+        #ifdef BOOST_CRYPT_HAS_TEE
+        if (use_tee)
+        {
+            const auto res {::tee(in_fd, out_fd, buffer_size, 0U)};
+            if (res > 0)
+            {
+                // The duplicated bytes are still waiting in in_fd, so reading them hashes and consumes them
+                const auto len {static_cast<std::size_t>(res)};
+                const auto err {detail::read_all(in_fd, buffer.get(), len)};
+                if (err != 0)
+                {
+                    return err;
+                }
+
+                hasher.process_bytes(static_cast<const std::uint8_t*>(buffer.get()), len);
+                continue;
+            }
+            else if (res == 0)
+            {
+                return 0;
+            }
+            else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                // Either in_fd is empty or out_fd is full
+                auto err {detail::wait_for(in_fd, POLLIN)};
+                if (err == 0)
+                {
+                    err = detail::wait_for(out_fd, POLLOUT);
+                }
+                if (err != 0)
+                {
+                    return err;
+                }
+                continue;
+            }
+            else if (errno == EINTR)
+            {
+                continue;
+            }
+            else if (errno != EINVAL)
+            {
+                return errno;
+            }
+
+            // One of the descriptors is not a pipe
+            use_tee = false;
+        }
+        #endif
+
+        const auto res {::read(in_fd, buffer.get(), buffer_size)};
+        if (res > 0)
+        {
+            const auto len {static_cast<std::size_t>(res)};
+            hasher.process_bytes(static_cast<const std::uint8_t*>(buffer.get()), len);
+
+            const auto err {detail::write_all(out_fd, buffer.get(), len)};
+            if (err != 0)
+            {
+                return err;
+            }
+        }
+        else if (res == 0)
+        {
+            return 0;
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            const auto err {detail::wait_for(in_fd, POLLIN)};
+            if (err != 0)
+            {
+                return err;
+            }
+        }
+        else if (errno != EINTR)
+        {
+            return errno;
+        }
+    }
+}
+
+} // namespace utility
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#endif // BOOST_CRYPT_UTILITY_PIPE_HPP
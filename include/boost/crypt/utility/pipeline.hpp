@@ -0,0 +1,82 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// Overlaps reading a file with hashing it
+
+#ifndef BOOST_CRYPT_UTILITY_PIPELINE_HPP
+#define BOOST_CRYPT_UTILITY_PIPELINE_HPP
+
+#include <boost/crypt/utility/config.hpp>
+#include <boost/crypt/utility/buffer_ring.hpp>
+#include <boost/crypt/utility/file.hpp>
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <thread>
+#endif
+
+namespace boost {
+namespace crypt {
+namespace utility {
+
+BOOST_CRYPT_INLINE_CONSTEXPR std::size_t default_queue_depth {4U};
+
+// A reader thread fills a ring of queue_depth buffers of buffer_size bytes,
+// while the calling thread hashes the buffers that have already been filled.
+// At most queue_depth buffers are ever allocated, and the hasher sees the bytes in file order.
+// A buffer_size of 0 selects BOOST_CRYPT_FILE_BUFFER_SIZE.
+// Returns false if the file could not be opened or read.
+// If the hasher throws, the reader is stopped and the exception is propagated
+template <typename Hasher>
+auto pipelined_hash_file(const std::string& filepath, Hasher& hasher,
+                         std::size_t queue_depth = default_queue_depth, std::size_t buffer_size = 0U) -> bool
+{
+    detail::file_source source(filepath);
+    if (!source.is_open())
+    {
+        return false;
+    }
+
+    buffer_ring ring(queue_depth, buffer_size == 0U ? BOOST_CRYPT_FILE_BUFFER_SIZE : buffer_size);
+
+    bool read_ok {false};
+    std::thread reader([&source, &ring, &read_ok]() {
+        try
+        {
+            read_ok = detail::fill_ring(source, ring);
+        }
+        catch (...)
+        {
+            ring.abort();
+        }
+    });
+
+    try
+    {
+        const std::uint8_t* data {};
+        std::size_t size {};
+        while (ring.next(0U, data, size))
+        {
+            hasher.process_bytes(data, size);
+            ring.release(0U);
+        }
+    }
+    catch (...)
+    {
+        ring.abort();
+        reader.join();
+        throw;
+    }
+
+    reader.join();
+    return read_ok;
+}
+
+} // namespace utility
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_UTILITY_PIPELINE_HPP
@@ -0,0 +1,49 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// Detects the system calls the file readers use where the platform's headers declare them.
+// Kept apart from config.hpp so that only the I/O headers pull in the POSIX headers
+
+#ifndef BOOST_CRYPT_UTILITY_POSIX_CONFIG_HPP
+#define BOOST_CRYPT_UTILITY_POSIX_CONFIG_HPP
+
+#include <boost/crypt/utility/config.hpp>
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/stat.h>
+#  include <sys/types.h>
+#  include <sys/uio.h>
+#  ifdef __linux__
+#    include <sys/syscall.h>
+#  endif
+
+#  if defined(__linux__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__) || defined(__DragonFly__)
+#    define BOOST_CRYPT_HAS_PREADV
+#  endif
+
+#  if defined(__linux__) && defined(RWF_NOWAIT)
+#    define BOOST_CRYPT_HAS_PREADV2
+#  endif
+
+#  if defined(SEEK_DATA) && defined(SEEK_HOLE)
+#    define BOOST_CRYPT_HAS_SEEK_HOLE
+#  endif
+
+#  ifdef __linux__
+#    define BOOST_CRYPT_HAS_TEE
+#    define BOOST_CRYPT_HAS_INOTIFY
+#  endif
+
+#  if defined(__linux__) && defined(SYS_getdents64)
+#    define BOOST_CRYPT_HAS_GETDENTS64
+#  endif
+
+#  if defined(__linux__) && defined(STATX_BASIC_STATS) && defined(AT_STATX_SYNC_AS_STAT)
+#    define BOOST_CRYPT_HAS_STATX
+#  endif
+#endif
+
+#endif // BOOST_CRYPT_UTILITY_POSIX_CONFIG_HPP
@@ -0,0 +1,427 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#ifndef BOOST_CRYPT_UTILITY_POSIX_FILE_HPP
+#define BOOST_CRYPT_UTILITY_POSIX_FILE_HPP
+
+#include <boost/crypt/utility/config.hpp>
+#include <boost/crypt/utility/posix_config.hpp>
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#endif
+
+namespace boost {
+namespace crypt {
+namespace utility {
+
+namespace detail {
+
+#ifdef O_CLOEXEC
+BOOST_CRYPT_INLINE_CONSTEXPR int open_read_flags {O_RDONLY | O_CLOEXEC};
+#else
+BOOST_CRYPT_INLINE_CONSTEXPR int open_read_flags {O_RDONLY};
+#endif
+
+// Rounds the requested size up to a whole number of the filesystem's preferred I/O blocks
+inline auto io_buffer_size(std::size_t requested, std::size_t fs_block_size) noexcept -> std::size_t
+{
+    if (requested == 0U)
+    {
+        requested = BOOST_CRYPT_FILE_BUFFER_SIZE;
+    }
+    if (fs_block_size == 0U)
+    {
+        return requested;
+    }
+
+    return ((requested + fs_block_size - 1U) / fs_block_size) * fs_block_size;
+}
+
+// Tells the kernel to read ahead aggressively since we will touch every byte exactly once
+inline auto advise_sequential(int fd) noexcept -> void
+{
+    #if defined(POSIX_FADV_SEQUENTIAL)
+    static_cast<void>(posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL));
+    #elif defined(F_RDAHEAD)
+    static_cast<void>(fcntl(fd, F_RDAHEAD, 1));
+    #else
+    static_cast<void>(fd);
+    #endif
+}
+
+} // namespace detail
+
+// Reads a file with large pread(2) calls directly into a single heap buffer, or into the caller's buffers.
+// The buffer size defaults to BOOST_CRYPT_FILE_BUFFER_SIZE rounded up to a multiple of st_blksize,
+// and each call to read_next_block fills the whole buffer unless the end of the file is reached.
+// Pipes and other non-seekable files fall back to read(2).
+// A reader can also borrow a descriptor that is already open, and be limited to a range of the file,
+// in which case the descriptor's file position is never used or changed
+class posix_file_reader
+{
+private:
+    int fd_ {-1};
+    bool owns_fd_ {true};
+    bool seekable_ {true};
+    bool eof_ {};
+    int error_ {};
+    std::uint64_t offset_ {};
+    std::uint64_t end_ {(std::numeric_limits<std::uint64_t>::max)()};
+    std::size_t buffer_size_ {};
+    std::size_t bytes_read_ {};
+    std::unique_ptr<std::uint8_t[]> buffer_;
+
+    // Returns the errno of a failed open, or 0
+    auto try_open(const char* filename, std::size_t buffer_size) noexcept -> int
+    {
+        do
+        {
+            fd_ = ::open(filename, detail::open_read_flags);
+        } while (fd_ < 0 && errno == EINTR);
+
+        if (fd_ < 0)
+        {
+            eof_ = true;
+            return errno;
+        }
+
+        struct stat st {};
+        std::size_t fs_block_size {};
+        if (::fstat(fd_, &st) == 0)
+        {
+            seekable_ = S_ISREG(st.st_mode) || S_ISBLK(st.st_mode);
+            fs_block_size = st.st_blksize > 0 ? static_cast<std::size_t>(st.st_blksize) : 0U;
+        }
+
+        buffer_size_ = detail::io_buffer_size(buffer_size, fs_block_size);
+
+        detail::advise_sequential(fd_);
+        return 0;
+    }
+
+    auto open_file(const char* filename, std::size_t buffer_size) -> void
+    {
+        if (try_open(filename, buffer_size) != 0)
+        {
+            throw std::runtime_error("Error opening file");
+        }
+    }
+
+    auto borrow_fd(int fd, std::uint64_t offset, std::uint64_t length, std::size_t buffer_size) -> void
+    {
+        struct stat st {};
+        if (fd < 0 || ::fstat(fd, &st) != 0)
+        {
+            throw std::runtime_error("Invalid file descriptor");
+        }
+
+        fd_ = fd;
+        owns_fd_ = false;
+        seekable_ = S_ISREG(st.st_mode) || S_ISBLK(st.st_mode);
+        buffer_size_ = detail::io_buffer_size(buffer_size, st.st_blksize > 0 ? static_cast<std::size_t>(st.st_blksize) : 0U);
+
+        // The descriptor's read ahead advice belongs to the caller, so it is left alone
+        set_range(offset, length);
+    }
+
+    auto set_range(std::uint64_t offset, std::uint64_t length) -> void
+    {
+        if (!seekable_ && offset != 0U)
+        {
+            if (owns_fd_)
+            {
+                ::close(fd_);
+                fd_ = -1;
+            }
+            throw std::runtime_error("A range can only be read from a seekable file");
+        }
+
+        offset_ = offset;
+        end_ = length > end_ - offset ? end_ : offset + length;
+    }
+
+    auto read_some(std::uint8_t* data, std::size_t size) noexcept -> ::ssize_t
+    {
+        ::ssize_t res {};
+        do
+        {
+            res = seekable_ ? ::pread(fd_, data, size, static_cast<::off_t>(offset_)) : ::read(fd_, data, size);
+        } while (res < 0 && errno == EINTR);
+
+        if (res < 0 && errno == ESPIPE && seekable_)
+        {
+            seekable_ = false;
+            return read_some(data, size);
+        }
+
+        return res;
+    }
+
+    auto read_some(const struct iovec* iov, std::size_t count) noexcept -> ::ssize_t
+    {
+        #ifndef BOOST_CRYPT_HAS_PREADV
+        if (seekable_)
+        {
+            // Without preadv(2) only the first buffer is filled by each call
+            return read_some(static_cast<std::uint8_t*>(iov[0].iov_base), iov[0].iov_len);
+        }
+        #endif
+
+        ::ssize_t res {};
+        do
+        {
+            #ifdef BOOST_CRYPT_HAS_PREADV
+            res = seekable_ ? ::preadv(fd_, iov, static_cast<int>(count), static_cast<::off_t>(offset_)) : ::readv(fd_, iov, static_cast<int>(count));
+            #else
+            res = ::readv(fd_, iov, static_cast<int>(count));
+            #endif
+        } while (res < 0 && errno == EINTR);
+
+        if (res < 0 && errno == ESPIPE && seekable_)
+        {
+            seekable_ = false;
+            return read_some(iov, count);
+        }
+
+        return res;
+    }
+
+public:
+    explicit posix_file_reader(const std::string& filename, std::size_t buffer_size = 0U)
+    {
+        open_file(filename.c_str(), buffer_size);
+    }
+
+    explicit posix_file_reader(const char* filename, std::size_t buffer_size = 0U)
+    {
+        open_file(filename, buffer_size);
+    }
+
+    #ifdef BOOST_CRYPT_HAS_STRING_VIEW
+    explicit posix_file_reader(std::string_view filename, std::size_t buffer_size = 0U)
+    {
+        open_file(std::string{filename}.c_str(), buffer_size);
+    }
+    #endif
+
+    // Reports a failure to open the file through ec instead of throwing, in which case the reader is already at its end
+    posix_file_reader(const std::string& filename, std::error_code& ec, std::size_t buffer_size = 0U) noexcept
+        : posix_file_reader(filename.c_str(), ec, buffer_size) {}
+
+    posix_file_reader(const char* filename, std::error_code& ec, std::size_t buffer_size = 0U) noexcept
+    {
+        const auto err {try_open(filename, buffer_size)};
+        ec = err == 0 ? std::error_code{} : std::error_code(err, std::system_category());
+    }
+
+    // Reads only the length bytes starting at offset
+    posix_file_reader(const std::string& filename, std::uint64_t offset, std::uint64_t length, std::size_t buffer_size = 0U)
+    {
+        open_file(filename.c_str(), buffer_size);
+        set_range(offset, length);
+    }
+
+    posix_file_reader(const char* filename, std::uint64_t offset, std::uint64_t length, std::size_t buffer_size = 0U)
+    {
+        open_file(filename, buffer_size);
+        set_range(offset, length);
+    }
+
+    // Reads the length bytes starting at offset from a descriptor owned by the caller, which stays open.
+    // Seekable files are read with pread(2), so several readers can share one descriptor across threads.
+    // Non-seekable files such as pipes are read from where they are, and must use an offset of 0
+    posix_file_reader(int fd, std::uint64_t offset, std::uint64_t length, std::size_t buffer_size = 0U)
+    {
+        borrow_fd(fd, offset, length, buffer_size);
+    }
+
+    posix_file_reader(const posix_file_reader&) = delete;
+    auto operator=(const posix_file_reader&) -> posix_file_reader& = delete;
+
+    // Fills the caller's buffer with the next size bytes of the file, and returns the number of bytes read.
+    // Less than size bytes are only returned at the end of the file or on error
+    auto read_into(std::uint8_t* data, std::size_t size) noexcept -> std::size_t
+    {
+        if (end_ - offset_ < size)
+        {
+            size = static_cast<std::size_t>(end_ - offset_);
+            eof_ = size == 0U;
+        }
+
+        std::size_t total {};
+        while (!eof_ && total < size)
+        {
+            const auto res {read_some(data + total, size - total)};
+            if (res <= 0)
+            {
+                error_ = res < 0 ? errno : 0;
+                eof_ = true;
+                break;
+            }
+
+            total += static_cast<std::size_t>(res);
+            offset_ += static_cast<std::uint64_t>(res);
+        }
+
+        if (offset_ == end_)
+        {
+            eof_ = true;
+        }
+
+        return total;
+    }
+
+    // Fills the caller's buffers in order with the next bytes of the file, filling several buffers with each preadv(2).
+    // Returns the number of bytes read, which is less than the total size of the buffers only at the end of the file or on error
+    auto read_into(const struct iovec* iov, std::size_t count) noexcept -> std::size_t
+    {
+        // Keeps the batch on the stack, and well below IOV_MAX
+        constexpr std::size_t max_batch {64U};
+
+        std::size_t total {};
+        std::size_t index {};
+        std::size_t skip {};
+        while (!eof_)
+        {
+            while (index < count && iov[index].iov_len == skip)
+            {
+                ++index;
+                skip = 0U;
+            }
+            if (index == count)
+            {
+                break;
+            }
+
+            struct iovec batch[max_batch] {};
+            std::size_t batch_count {};
+            auto remaining {end_ - offset_};
+            for (auto i {index}; i < count && batch_count < max_batch && remaining > 0U; ++i)
+            {
+                const auto first {i == index ? skip : 0U};
+                const auto len {static_cast<std::size_t>((std::min)(static_cast<std::uint64_t>(iov[i].iov_len - first), remaining))};
+                batch[batch_count].iov_base = static_cast<std::uint8_t*>(iov[i].iov_base) + first;
+                batch[batch_count].iov_len = len;
+                ++batch_count;
+                remaining -= len;
+            }
+
+            if (batch_count == 0U)
+            {
+                eof_ = true;
+                break;
+            }
+
+            const auto res {read_some(batch, batch_count)};
+            if (res <= 0)
+            {
+                error_ = res < 0 ? errno : 0;
+                eof_ = true;
+                break;
+            }
+
+            total += static_cast<std::size_t>(res);
+            offset_ += static_cast<std::uint64_t>(res);
+
+            auto left {static_cast<std::size_t>(res)};
+            while (left > 0U)
+            {
+                const auto available {iov[index].iov_len - skip};
+                if (left < available)
+                {
+                    skip += left;
+                    left = 0U;
+                }
+                else
+                {
+                    left -= available;
+                    ++index;
+                    skip = 0U;
+                }
+            }
+        }
+
+        if (offset_ == end_)
+        {
+            eof_ = true;
+        }
+
+        return total;
+    }
+
+    // Fills the internal buffer with the next block of the file.
+    // Only the last block before the end of the file can be shorter than buffer_size()
+    auto read_next_block() noexcept -> const std::uint8_t*
+    {
+        if (!buffer_)
+        {
+            buffer_.reset(new (std::nothrow) std::uint8_t[buffer_size_]);
+            if (!buffer_)
+            {
+                error_ = ENOMEM;
+                eof_ = true;
+                bytes_read_ = 0U;
+                return nullptr;
+            }
+        }
+
+        bytes_read_ = read_into(buffer_.get(), buffer_size_);
+        return buffer_.get();
+    }
+
+    auto get_bytes_read() const noexcept -> std::size_t
+    {
+        return bytes_read_;
+    }
+
+    auto eof() const noexcept -> bool
+    {
+        return eof_;
+    }
+
+    // The errno of a failed read, or 0
+    auto error() const noexcept -> int
+    {
+        return error_;
+    }
+
+    auto buffer_size() const noexcept -> std::size_t
+    {
+        return buffer_size_;
+    }
+
+    ~posix_file_reader()
+    {
+        if (fd_ >= 0 && owns_fd_)
+        {
+            ::close(fd_);
+        }
+    }
+};
+
+} // namespace utility
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#endif // BOOST_CRYPT_UTILITY_POSIX_FILE_HPP
@@ -0,0 +1,475 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// Hashes every line, or every length-prefixed record, of a file on its own, straight from the mapped file
+// and into one contiguous array of digests
+
+#ifndef BOOST_CRYPT_UTILITY_RECORDS_HPP
+#define BOOST_CRYPT_UTILITY_RECORDS_HPP
+
+#include <boost/crypt/utility/config.hpp>
+#include <boost/crypt/utility/posix_file.hpp>
+#include <boost/crypt/utility/mapped_file.hpp>
+#include <boost/crypt/utility/thread_pool.hpp>
+#include <boost/crypt/utility/tree.hpp>
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+namespace boost {
+namespace crypt {
+namespace utility {
+
+enum class record_format
+{
+    lines,           // Each ended by '\n', which is not part of the record. The last line of the file may be missing it
+    length_prefixed, // Each preceded by its length in bytes, which is not part of the record
+};
+
+BOOST_CRYPT_INLINE_CONSTEXPR std::size_t default_record_window_size {64U * 1024U * 1024U};
+
+struct record_options
+{
+    record_format format {record_format::lines};
+
+    // For lines: also leave out a '\r' before the '\n', for files with Windows line endings
+    bool strip_carriage_return {};
+
+    // For length_prefixed: the size of the length in bytes, from 1 to 8, and its byte order
+    std::size_t prefix_size {4U};
+    bool little_endian {};
+
+    // 0 uses one thread per hardware thread
+    std::size_t thread_count {};
+
+    // Bytes of the file mapped at once. A record longer than this is still hashed, by mapping more of the file for it
+    std::size_t window_size {default_record_window_size};
+};
+
+// Hashes count records into digests, one after another.
+// Specialized for hashers that can hash many short messages together faster than one at a time
+template <typename Hasher>
+struct record_batch
+{
+    template <typename Digest>
+    static auto hash(const std::uint8_t* const* data, const std::size_t* sizes, std::size_t count, Digest* digests) noexcept -> void
+    {
+        Hasher hasher {};
+        for (std::size_t i {}; i < count; ++i)
+        {
+            hasher.init();
+            hasher.process_bytes(data[i], sizes[i]);
+            digests[i] = hasher.get_digest();
+        }
+    }
+};
+
+namespace detail {
+
+// Each window is split into chunks of about this many bytes, ending on a record boundary, which are hashed in parallel
+BOOST_CRYPT_INLINE_CONSTEXPR std::size_t record_chunk_size {1024U * 1024U};
+
+// Records handed to record_batch at once, from arrays on the stack
+BOOST_CRYPT_INLINE_CONSTEXPR std::size_t record_batch_size {64U};
+
+struct record_chunk
+{
+    std::size_t begin;
+    std::size_t end;
+    std::size_t first;
+    std::size_t count;
+};
+
+inline auto record_length(const std::uint8_t* p, std::size_t size, bool little_endian) noexcept -> std::uint64_t
+{
+    std::uint64_t length {};
+    for (std::size_t i {}; i < size; ++i)
+    {
+        const auto byte {static_cast<std::uint64_t>(p[little_endian ? size - 1U - i : i])};
+        length = (length << 8U) | byte;
+    }
+
+    return length;
+}
+
+template <typename Hasher>
+class record_pipeline
+{
+public:
+    using digest_type = decltype(std::declval<Hasher&>().get_digest());
+
+private:
+    const record_options& options_;
+    work_stealing_pool pool_;
+    std::vector<record_chunk> chunks_;
+    std::vector<digest_type>& digests_;
+
+    // Splits whole lines into chunks at the first '\n' after every record_chunk_size bytes, and returns the bytes they cover
+    auto split_lines(const std::uint8_t* data, std::size_t size, bool at_end) -> std::size_t
+    {
+        auto covered {size};
+        if (!at_end)
+        {
+            while (covered > 0U && data[covered - 1U] != '\n')
+            {
+                --covered;
+            }
+        }
+
+        for (std::size_t begin {}; begin < covered;)
+        {
+            auto end {covered};
+            if (covered - begin > record_chunk_size)
+            {
+                const auto* newline {static_cast<const std::uint8_t*>(std::memchr(data + begin + record_chunk_size - 1U, '\n',
+                                                                                  covered - begin - record_chunk_size + 1U))};
+
+                // Otherwise the rest is the last line of the input, which has no '\n'
+                if (newline != nullptr)
+                {
+                    end = static_cast<std::size_t>(newline - data) + 1U;
+                }
+            }
+
+            chunks_.push_back({begin, end, 0U, 0U});
+            begin = end;
+        }
+
+        // Counted in parallel, since on many cores a serial search for newlines would hold up the hashing
+        for (auto& chunk : chunks_)
+        {
+            pool_.submit([data, &chunk]() {
+                std::size_t count {};
+                const auto* p {data + chunk.begin};
+                const auto* end {data + chunk.end};
+                while (p < end)
+                {
+                    const auto* newline {static_cast<const std::uint8_t*>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)))};
+                    ++count;
+                    p = newline == nullptr ? end : newline + 1;
+                }
+
+                chunk.count = count;
+            });
+        }
+        pool_.wait();
+
+        return covered;
+    }
+
+    // Follows the lengths through the whole records, and returns the bytes they cover
+    auto split_records(const std::uint8_t* data, std::size_t size, bool at_end, std::error_code& ec) -> std::size_t
+    {
+        const auto prefix_size {options_.prefix_size};
+
+        std::size_t pos {};
+        record_chunk chunk {};
+        while (size - pos >= prefix_size)
+        {
+            const auto length {record_length(data + pos, prefix_size, options_.little_endian)};
+            if (length > size - pos - prefix_size)
+            {
+                break;
+            }
+
+            pos += prefix_size + static_cast<std::size_t>(length);
+            ++chunk.count;
+            if (pos - chunk.begin >= record_chunk_size)
+            {
+                chunk.end = pos;
+                chunks_.push_back(chunk);
+                chunk = record_chunk{pos, pos, 0U, 0U};
+            }
+        }
+
+        if (chunk.count != 0U)
+        {
+            chunk.end = pos;
+            chunks_.push_back(chunk);
+        }
+
+        if (at_end && pos != size)
+        {
+            // The file ends part way through a length or a record
+            ec = std::make_error_code(std::errc::io_error);
+        }
+
+        return pos;
+    }
+
+    auto hash_chunk(const std::uint8_t* data, const record_chunk& chunk) const noexcept -> void
+    {
+        const std::uint8_t* records[record_batch_size] {};
+        std::size_t sizes[record_batch_size] {};
+        std::size_t batched {};
+        auto* digests {digests_.data() + chunk.first};
+
+        const auto flush = [&]() {
+            record_batch<Hasher>::hash(records, sizes, batched, digests);
+            digests += batched;
+            batched = 0U;
+        };
+
+        const auto* p {data + chunk.begin};
+        const auto* end {data + chunk.end};
+        while (p < end)
+        {
+            if (options_.format == record_format::lines)
+            {
+                const auto* newline {static_cast<const std::uint8_t*>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)))};
+                const auto* record_end {newline == nullptr ? end : newline};
+                if (options_.strip_carriage_return && newline != nullptr && record_end > p && record_end[-1] == '\r')
+                {
+                    --record_end;
+                }
+
+                records[batched] = p;
+                sizes[batched] = static_cast<std::size_t>(record_end - p);
+                p = newline == nullptr ? end : newline + 1;
+            }
+            else
+            {
+                const auto length {static_cast<std::size_t>(record_length(p, options_.prefix_size, options_.little_endian))};
+                records[batched] = p + options_.prefix_size;
+                sizes[batched] = length;
+                p += options_.prefix_size + length;
+            }
+
+            if (++batched == record_batch_size)
+            {
+                flush();
+            }
+        }
+
+        flush();
+    }
+
+public:
+    record_pipeline(const record_options& options, std::vector<digest_type>& digests)
+        : options_ {options}, pool_ {options.thread_count}, digests_ {digests} {}
+
+    // Hashes the whole records at the start of data, and returns the bytes they cover.
+    // With at_end the data is the rest of the input, so a last line without a '\n' is a record of its own
+    auto process(const std::uint8_t* data, std::size_t size, bool at_end, std::error_code& ec) -> std::size_t
+    {
+        chunks_.clear();
+        const auto covered {options_.format == record_format::lines ? split_lines(data, size, at_end) : split_records(data, size, at_end, ec)};
+        if (ec)
+        {
+            return 0U;
+        }
+
+        // Every chunk writes to its own part of one array, so the digests end up in the order of the records
+        auto first {digests_.size()};
+        for (auto& chunk : chunks_)
+        {
+            chunk.first = first;
+            first += chunk.count;
+        }
+        digests_.resize(first);
+
+        for (const auto& chunk : chunks_)
+        {
+            pool_.submit([this, data, &chunk]() { hash_chunk(data, chunk); });
+        }
+        pool_.wait();
+
+        return covered;
+    }
+};
+
+inline auto record_options_valid(const record_options& options) noexcept -> bool
+{
+    return options.window_size != 0U &&
+           (options.format == record_format::lines || (options.prefix_size >= 1U && options.prefix_size <= 8U));
+}
+
+// Reads a pipe or other file that can not be mapped into a buffer, keeping any partial record at the end for the next read
+template <typename Hasher>
+auto hash_stream_records(int fd, record_pipeline<Hasher>& pipeline, std::size_t window_size, std::error_code& ec) -> void
+{
+    std::vector<std::uint8_t> buffer(window_size);
+    std::size_t filled {};
+    bool at_end {};
+    while (!at_end)
+    {
+        while (filled < buffer.size())
+        {
+            const auto res {::read(fd, buffer.data() + filled, buffer.size() - filled)};
+            if (res < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (res < 0)
+            {
+                ec.assign(errno, std::system_category());
+                return;
+            }
+            if (res == 0)
+            {
+                at_end = true;
+                break;
+            }
+
+            filled += static_cast<std::size_t>(res);
+        }
+
+        const auto consumed {pipeline.process(buffer.data(), filled, at_end, ec)};
+        if (ec)
+        {
+            return;
+        }
+
+        std::memmove(buffer.data(), buffer.data() + consumed, filled - consumed);
+        filled -= consumed;
+        if (consumed == 0U && !at_end)
+        {
+            // A record longer than the buffer
+            buffer.resize(buffer.size() * 2U);
+        }
+    }
+}
+
+} // namespace detail
+
+// Hashes each record in the size bytes at data, returning the digests in the order of the records.
+// Returns std::errc::io_error if the data ends part way through a length prefixed record
+template <typename Hasher>
+auto hash_records(const std::uint8_t* data, std::size_t size, std::error_code& ec, const record_options& options = record_options{})
+    -> std::vector<decltype(std::declval<Hasher&>().get_digest())>
+{
+    std::vector<decltype(std::declval<Hasher&>().get_digest())> digests;
+    if (!detail::record_options_valid(options))
+    {
+        ec = std::make_error_code(std::errc::invalid_argument);
+        return digests;
+    }
+
+    ec.clear();
+    detail::record_pipeline<Hasher> pipeline {options, digests};
+    static_cast<void>(pipeline.process(data, size, true, ec));
+    if (ec)
+    {
+        digests.clear();
+    }
+
+    return digests;
+}
+
+// Hashes each record of the file, returning the digests in the order of the records.
+// Regular files are mapped window_size bytes at a time and hashed in place, and anything else is read through a buffer.
+// As with any mapped file, truncating the file while it is being hashed raises SIGBUS.
+// Returns the error of a failed open, map or read, or std::errc::io_error if the file ends part way through a length prefixed record
+template <typename Hasher>
+auto hash_file_records(const std::string& path, std::error_code& ec, const record_options& options = record_options{})
+    -> std::vector<decltype(std::declval<Hasher&>().get_digest())>
+{
+    std::vector<decltype(std::declval<Hasher&>().get_digest())> digests;
+    if (!detail::record_options_valid(options))
+    {
+        ec = std::make_error_code(std::errc::invalid_argument);
+        return digests;
+    }
+
+    int fd {};
+    do
+    {
+        fd = ::open(path.c_str(), detail::open_read_flags);
+    } while (fd < 0 && errno == EINTR);
+
+    if (fd < 0)
+    {
+        ec.assign(errno, std::system_category());
+        return digests;
+    }
+
+    const detail::tree_fd file {fd};
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0)
+    {
+        ec.assign(errno, std::system_category());
+        return digests;
+    }
+
+    ec.clear();
+    detail::record_pipeline<Hasher> pipeline {options, digests};
+    if (!S_ISREG(st.st_mode))
+    {
+        detail::hash_stream_records(fd, pipeline, options.window_size, ec);
+        if (ec)
+        {
+            digests.clear();
+        }
+
+        return digests;
+    }
+
+    const auto file_size {static_cast<std::uint64_t>(st.st_size)};
+    const auto page {static_cast<std::uint64_t>(detail::page_size())};
+    auto window {static_cast<std::uint64_t>(options.window_size)};
+    std::uint64_t offset {};
+    while (offset < file_size)
+    {
+        // Mappings start on a page boundary, so the first record may start part way into the first page
+        const auto map_offset {offset - offset % page};
+        const auto lead {static_cast<std::size_t>(offset - map_offset)};
+        const auto map_size {static_cast<std::size_t>((std::min)(file_size - map_offset, window + lead))};
+
+        auto* addr {::mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd, static_cast<::off_t>(map_offset))};
+        if (addr == MAP_FAILED)
+        {
+            ec.assign(errno, std::system_category());
+            digests.clear();
+            return digests;
+        }
+        detail::advise_mapping(addr, map_size);
+
+        const bool at_end {map_offset + map_size == file_size};
+        const auto consumed {pipeline.process(static_cast<const std::uint8_t*>(addr) + lead, map_size - lead, at_end, ec)};
+        static_cast<void>(::munmap(addr, map_size));
+
+        if (ec)
+        {
+            digests.clear();
+            return digests;
+        }
+
+        if (consumed == 0U)
+        {
+            // A record longer than the window, so map more of the file
+            window *= 2U;
+            continue;
+        }
+
+        window = options.window_size;
+        offset += consumed;
+    }
+
+    return digests;
+}
+
+} // namespace utility
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#endif // BOOST_CRYPT_UTILITY_RECORDS_HPP
@@ -0,0 +1,337 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// Fingerprints a file from its size and a fixed number of sampled ranges, for a quick check of whether
+// two huge files are probably the same without reading either of them in full
+
+#ifndef BOOST_CRYPT_UTILITY_SAMPLED_FILE_HPP
+#define BOOST_CRYPT_UTILITY_SAMPLED_FILE_HPP
+
+#include <boost/crypt/utility/config.hpp>
+#include <boost/crypt/utility/posix_file.hpp>
+#include <boost/crypt/utility/thread_pool.hpp>
+#include <boost/crypt/utility/tree.hpp>
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+namespace boost {
+namespace crypt {
+namespace utility {
+
+BOOST_CRYPT_INLINE_CONSTEXPR std::uint32_t default_sample_count {64U};
+BOOST_CRYPT_INLINE_CONSTEXPR std::uint32_t default_sample_length {65536U};
+
+struct sample_options
+{
+    // Ranges read from the file, which always include the first and the last sample_length bytes
+    std::uint32_t sample_count {default_sample_count};
+    std::uint32_t sample_length {default_sample_length};
+
+    // With 0 the ranges are spaced evenly. Otherwise the ranges between the first and the last are placed
+    // pseudo-randomly from the key, so that someone who does not know it can not predict which bytes are left out.
+    // format_fingerprint writes the key out, so keep that text private if the key is to stay secret
+    std::uint64_t key {};
+
+    // Reads in flight at once. 0 uses one per sample, up to 16
+    std::size_t thread_count {};
+};
+
+// The digest, and everything that went into choosing the samples, since fingerprints are only comparable
+// when they were taken the same way
+template <typename Digest>
+struct sampled_fingerprint
+{
+    Digest digest;
+    std::uint64_t size;
+    std::uint32_t sample_count;
+    std::uint32_t sample_length;
+    std::uint64_t key;
+
+    // Set if the file was no larger than the samples together, so every byte of it was read
+    bool complete;
+};
+
+template <typename Digest>
+auto operator==(const sampled_fingerprint<Digest>& lhs, const sampled_fingerprint<Digest>& rhs) noexcept -> bool
+{
+    if (lhs.size != rhs.size || lhs.sample_count != rhs.sample_count || lhs.sample_length != rhs.sample_length ||
+        lhs.key != rhs.key || lhs.complete != rhs.complete)
+    {
+        return false;
+    }
+
+    for (std::size_t i {}; i < lhs.digest.size(); ++i)
+    {
+        if (lhs.digest[i] != rhs.digest[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template <typename Digest>
+auto operator!=(const sampled_fingerprint<Digest>& lhs, const sampled_fingerprint<Digest>& rhs) noexcept -> bool
+{
+    return !(lhs == rhs);
+}
+
+// <sample_count>x<sample_length>[k<key in hex>]:<size>:<digest in hex>, e.g. 64x65536:1099511627776:d41d8cd98f00b204e9800998ecf8427e,
+// so the text form of two fingerprints is the same exactly when they compare equal
+template <typename Digest>
+auto format_fingerprint(const sampled_fingerprint<Digest>& fingerprint) -> std::string
+{
+    const char* digits {"0123456789abcdef"};
+
+    auto text {std::to_string(fingerprint.sample_count) + 'x' + std::to_string(fingerprint.sample_length)};
+    if (fingerprint.key != 0U)
+    {
+        text.push_back('k');
+        for (int shift {60}; shift >= 0; shift -= 4)
+        {
+            text.push_back(digits[(fingerprint.key >> shift) & 0x0FU]);
+        }
+    }
+    text += ':' + std::to_string(fingerprint.size) + ':';
+
+    for (std::size_t i {}; i < fingerprint.digest.size(); ++i)
+    {
+        text.push_back(digits[fingerprint.digest[i] >> 4U]);
+        text.push_back(digits[fingerprint.digest[i] & 0x0FU]);
+    }
+
+    return text;
+}
+
+namespace detail {
+
+BOOST_CRYPT_INLINE_CONSTEXPR std::size_t max_sample_threads {16U};
+
+inline auto sample_store(std::uint8_t* p, std::uint64_t value, std::size_t size) noexcept -> void
+{
+    for (std::size_t i {}; i < size; ++i)
+    {
+        p[i] = static_cast<std::uint8_t>(value >> (8U * i));
+    }
+}
+
+// SplitMix64, which turns consecutive inputs into well spread outputs
+inline auto sample_mix(std::uint64_t x) noexcept -> std::uint64_t
+{
+    x += UINT64_C(0x9E3779B97F4A7C15);
+    x = (x ^ (x >> 30U)) * UINT64_C(0xBF58476D1CE4E5B9);
+    x = (x ^ (x >> 27U)) * UINT64_C(0x94D049BB133111EB);
+    return x ^ (x >> 31U);
+}
+
+// Offsets of the samples in ascending order, for a file larger than count samples of length bytes
+inline auto sample_offsets(std::uint64_t size, std::uint32_t count, std::uint32_t length, std::uint64_t key) -> std::vector<std::uint64_t>
+{
+    const auto span {size - length};
+    std::vector<std::uint64_t> offsets(count);
+    if (count == 1U)
+    {
+        return offsets;
+    }
+
+    const std::uint64_t gaps {count - 1U};
+    for (std::uint64_t i {}; i < count; ++i)
+    {
+        if (key == 0U || i == 0U || i == gaps)
+        {
+            // i * span / gaps without overflowing, since i * (span % gaps) is less than 2^64
+            offsets[i] = i * (span / gaps) + i * (span % gaps) / gaps;
+        }
+        else
+        {
+            offsets[i] = sample_mix(key ^ sample_mix(i)) % (span + 1U);
+        }
+    }
+    std::sort(offsets.begin(), offsets.end());
+
+    return offsets;
+}
+
+inline auto sample_pread(int fd, std::uint8_t* data, std::size_t size, std::uint64_t offset) noexcept -> int
+{
+    while (size > 0U)
+    {
+        const auto res {::pread(fd, data, size, static_cast<::off_t>(offset))};
+        if (res < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (res < 0)
+        {
+            return errno;
+        }
+        if (res == 0)
+        {
+            // Shorter than it was when it was opened
+            return EAGAIN;
+        }
+
+        data += res;
+        size -= static_cast<std::size_t>(res);
+        offset += static_cast<std::uint64_t>(res);
+    }
+
+    return 0;
+}
+
+} // namespace detail
+
+// Hashes the size of the file, how it was sampled, and sample_count ranges of sample_length bytes, each preceded by its offset.
+// The ranges are read concurrently with pread(2), so the cost depends on the number of samples and not on the size of the file,
+// and a file no larger than the samples together is read whole instead.
+// The fingerprint only says two files are probably the same: any change that misses every sample goes unnoticed.
+// Regular files and block devices can be sampled, and anything else gives std::errc::invalid_argument.
+// Memory use is sample_count * sample_length bytes for the samples
+template <typename Hasher>
+auto sample_file(const std::string& path, std::error_code& ec, const sample_options& options = sample_options{})
+    -> sampled_fingerprint<decltype(std::declval<Hasher&>().get_digest())>
+{
+    using digest_type = decltype(std::declval<Hasher&>().get_digest());
+
+    sampled_fingerprint<digest_type> fingerprint {digest_type{}, 0U, options.sample_count, options.sample_length, options.key, false};
+    if (options.sample_count == 0U || options.sample_length == 0U)
+    {
+        ec = std::make_error_code(std::errc::invalid_argument);
+        return fingerprint;
+    }
+
+    // O_NONBLOCK keeps a FIFO from blocking the open, and it is then rejected below
+    int fd {};
+    do
+    {
+        fd = ::open(path.c_str(), detail::open_read_flags | O_NONBLOCK);
+    } while (fd < 0 && errno == EINTR);
+
+    if (fd < 0)
+    {
+        ec.assign(errno, std::system_category());
+        return fingerprint;
+    }
+
+    const detail::tree_fd file {fd};
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0)
+    {
+        ec.assign(errno, std::system_category());
+        return fingerprint;
+    }
+    if (S_ISREG(st.st_mode))
+    {
+        fingerprint.size = static_cast<std::uint64_t>(st.st_size);
+    }
+    else if (S_ISBLK(st.st_mode))
+    {
+        // st_size is 0 for a block device, but it can be seeked to its end
+        const auto end {::lseek(fd, 0, SEEK_END)};
+        if (end < 0)
+        {
+            ec.assign(errno, std::system_category());
+            return fingerprint;
+        }
+        fingerprint.size = static_cast<std::uint64_t>(end);
+    }
+    else
+    {
+        // A pipe or character device has no size to sample from
+        ec = std::make_error_code(std::errc::invalid_argument);
+        return fingerprint;
+    }
+
+    const auto total {static_cast<std::uint64_t>(options.sample_count) * options.sample_length};
+    fingerprint.complete = fingerprint.size <= total;
+
+    // A complete fingerprint is a single sample of the whole file
+    const std::uint32_t count {fingerprint.complete ? 1U : options.sample_count};
+    const auto length {fingerprint.complete ? static_cast<std::size_t>(fingerprint.size) : static_cast<std::size_t>(options.sample_length)};
+    const auto offsets {fingerprint.complete ? std::vector<std::uint64_t>(1U) :
+                        detail::sample_offsets(fingerprint.size, options.sample_count, options.sample_length, options.key)};
+
+    std::unique_ptr<std::uint8_t[]> samples {new std::uint8_t[(std::max)(std::size_t{1U}, count * length)]};
+    std::atomic<int> error {0};
+
+    const auto read_sample = [&](std::size_t i) {
+        const auto res {detail::sample_pread(fd, samples.get() + i * length, length, offsets[i])};
+        if (res != 0)
+        {
+            error.store(res);
+        }
+    };
+
+    const auto threads {options.thread_count != 0U ? options.thread_count : (std::min)(std::size_t{count}, detail::max_sample_threads)};
+    if (threads <= 1U)
+    {
+        for (std::size_t i {}; i < count; ++i)
+        {
+            read_sample(i);
+        }
+    }
+    else
+    {
+        work_stealing_pool pool {(std::min)(threads, std::size_t{count})};
+        for (std::size_t i {}; i < count; ++i)
+        {
+            pool.submit([&read_sample, i]() { read_sample(i); });
+        }
+        pool.wait();
+    }
+
+    if (error.load() != 0)
+    {
+        ec.assign(error.load(), std::system_category());
+        return fingerprint;
+    }
+
+    // The parameters go first, so that fingerprints taken in different ways never collide by accident
+    std::uint8_t header[24] {};
+    detail::sample_store(header, fingerprint.size, 8U);
+    detail::sample_store(header + 8, options.sample_count, 4U);
+    detail::sample_store(header + 12, options.sample_length, 4U);
+    detail::sample_store(header + 16, options.key, 8U);
+
+    Hasher hasher {};
+    hasher.process_bytes(static_cast<const std::uint8_t*>(header), sizeof(header));
+    for (std::size_t i {}; i < count; ++i)
+    {
+        std::uint8_t offset[8] {};
+        detail::sample_store(offset, offsets[i], 8U);
+        hasher.process_bytes(static_cast<const std::uint8_t*>(offset), sizeof(offset));
+        hasher.process_bytes(static_cast<const std::uint8_t*>(samples.get() + i * length), length);
+    }
+
+    fingerprint.digest = hasher.get_digest();
+    ec.clear();
+    return fingerprint;
+}
+
+} // namespace utility
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#endif // BOOST_CRYPT_UTILITY_SAMPLED_FILE_HPP
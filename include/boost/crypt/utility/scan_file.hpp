@@ -0,0 +1,404 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// Reads files for a bulk scan without growing the page cache
+
+#ifndef BOOST_CRYPT_UTILITY_SCAN_FILE_HPP
+#define BOOST_CRYPT_UTILITY_SCAN_FILE_HPP
+
+#include <boost/crypt/utility/config.hpp>
+#include <boost/crypt/utility/posix_config.hpp>
+#include <boost/crypt/utility/posix_file.hpp>
+#include <boost/crypt/utility/mapped_file.hpp>
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#endif
+
+namespace boost {
+namespace crypt {
+namespace utility {
+
+namespace detail {
+
+// preadv2(2) flag for buffered reads that drop the pages they bring into the page cache (Linux 6.14).
+// Pages that were already cached are left alone
+#ifdef BOOST_CRYPT_HAS_PREADV2
+#  ifdef RWF_DONTCACHE
+BOOST_CRYPT_INLINE_CONSTEXPR int rwf_dontcache {RWF_DONTCACHE};
+#  else
+BOOST_CRYPT_INLINE_CONSTEXPR int rwf_dontcache {0x00000080};
+#  endif
+#endif
+
+// Reading a page that an earlier reader marked for readahead starts asynchronous readahead even with POSIX_FADV_RANDOM.
+// That window is at most the device's read_ahead_kb, so residency is recorded at least this far ahead of the reader
+BOOST_CRYPT_INLINE_CONSTEXPR std::size_t scan_residency_lookahead {33554432U};
+
+// Which pages of [offset, offset + size) of the file are currently in the page cache
+inline auto resident_pages(int fd, std::uint64_t offset, std::size_t size, std::vector<unsigned char>& resident) -> bool
+{
+    const auto pages {(size + page_size() - 1U) / page_size()};
+    resident.assign(pages, 0U);
+    if (size == 0U)
+    {
+        return true;
+    }
+
+    // Mapping without touching the pages does not fault them in
+    auto* addr {::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, static_cast<::off_t>(offset))};
+    if (addr == MAP_FAILED)
+    {
+        return false;
+    }
+
+    #if defined(__linux__)
+    const bool ok {::mincore(addr, size, resident.data()) == 0};
+    #else
+    const bool ok {::mincore(static_cast<char*>(addr), size, reinterpret_cast<char*>(resident.data())) == 0};
+    #endif
+
+    ::munmap(addr, size);
+    return ok;
+}
+
+} // namespace detail
+
+// Reads a regular file for a bulk scan (e.g. verifying a whole volume) while leaving the page cache as it was found.
+// The residency of each range is recorded with mincore(2) before it is read or read ahead,
+// and once it has been hashed only the pages that were not already cached are dropped with POSIX_FADV_DONTNEED.
+// Where the kernel supports it, reads also use RWF_DONTCACHE so that most pages are dropped as soon as they are copied.
+// Otherwise the kernel's readahead is replaced by our own window of readahead_size bytes in front of the reader.
+class scan_file_reader
+{
+private:
+    enum class dontcache_state
+    {
+        unknown,
+        supported,
+        unsupported,
+    };
+
+    int fd_ {-1};
+    bool eof_ {};
+    int error_ {};
+    std::uint64_t file_size_ {};
+    std::uint64_t offset_ {};
+    std::size_t buffer_size_ {};
+    std::size_t readahead_size_ {};
+    std::size_t bytes_read_ {};
+    std::unique_ptr<std::uint8_t[]> buffer_;
+    dontcache_state dontcache_ {dontcache_state::unknown};
+
+    // Residency of the pages in [offset_, recorded_end_) from before we touched them
+    std::vector<unsigned char> resident_;
+    std::vector<unsigned char> scratch_;
+    std::uint64_t recorded_end_ {};
+    std::uint64_t readahead_end_ {};
+
+    // Start of the run of pages that were not cached before we read them, which is still being extended
+    std::uint64_t drop_start_ {};
+    bool dropping_ {};
+
+    auto open_file(const char* filename, std::size_t buffer_size, std::size_t readahead_size) -> void
+    {
+        do
+        {
+            fd_ = ::open(filename, detail::open_read_flags);
+        } while (fd_ < 0 && errno == EINTR);
+
+        if (fd_ < 0)
+        {
+            throw std::runtime_error("Error opening file");
+        }
+
+        struct stat st {};
+        if (::fstat(fd_, &st) != 0 || !S_ISREG(st.st_mode))
+        {
+            ::close(fd_);
+            fd_ = -1;
+            throw std::runtime_error("Only regular files can be scanned");
+        }
+
+        file_size_ = static_cast<std::uint64_t>(st.st_size);
+        eof_ = file_size_ == 0U;
+
+        // Whole pages so that every range we record starts on a page boundary
+        buffer_size_ = detail::io_buffer_size(buffer_size, detail::page_size());
+        readahead_size_ = readahead_size;
+
+        #ifndef BOOST_CRYPT_HAS_PREADV2
+        dontcache_ = dontcache_state::unsupported;
+        #endif
+
+        // Until RWF_DONTCACHE is known to work the kernel's own readahead is turned off,
+        // since it would bring in pages before we have recorded whether they were already cached
+        advise_random();
+    }
+
+    auto advise_random() noexcept -> void
+    {
+        #ifdef POSIX_FADV_RANDOM
+        static_cast<void>(::posix_fadvise(fd_, 0, 0, POSIX_FADV_RANDOM));
+        #endif
+    }
+
+    // Records the residency of the file up to end, before anything in that range has been read
+    auto record_residency(std::uint64_t end) -> void
+    {
+        end = (std::min)(end, file_size_);
+        if (end <= recorded_end_)
+        {
+            return;
+        }
+
+        if (!detail::resident_pages(fd_, recorded_end_, static_cast<std::size_t>(end - recorded_end_), scratch_))
+        {
+            // Unknown, so assume it was cached rather than evicting someone else's pages
+            scratch_.assign(scratch_.size(), 1U);
+        }
+
+        resident_.insert(resident_.end(), scratch_.begin(), scratch_.end());
+        recorded_end_ = end;
+    }
+
+    auto drop(std::uint64_t begin, std::uint64_t end) noexcept -> void
+    {
+        #ifdef POSIX_FADV_DONTNEED
+        static_cast<void>(::posix_fadvise(fd_, static_cast<::off_t>(begin), static_cast<::off_t>(end - begin), POSIX_FADV_DONTNEED));
+        #else
+        static_cast<void>(begin);
+        static_cast<void>(end);
+        #endif
+    }
+
+    // Drops the pages of [offset_, offset_ + size) that we brought into the page cache.
+    // Only whole folios are dropped, and a large folio can straddle two blocks,
+    // so the run of pages that were not cached is dropped from its start each time it grows
+    auto drop_read_pages(std::size_t size) noexcept -> void
+    {
+        const auto page {detail::page_size()};
+        const auto pages {(std::min)((size + page - 1U) / page, resident_.size())};
+
+        for (std::size_t i {}; i < pages; ++i)
+        {
+            const auto page_offset {offset_ + i * page};
+            if ((resident_[i] & 1U) != 0U)
+            {
+                if (dropping_)
+                {
+                    drop(drop_start_, page_offset);
+                    dropping_ = false;
+                }
+            }
+            else if (!dropping_)
+            {
+                drop_start_ = page_offset;
+                dropping_ = true;
+            }
+        }
+
+        if (dropping_)
+        {
+            drop(drop_start_, offset_ + size);
+        }
+
+        resident_.erase(resident_.begin(), resident_.begin() + static_cast<std::ptrdiff_t>(pages));
+    }
+
+    auto read_some(std::uint8_t* data, std::size_t size, std::uint64_t offset) noexcept -> ::ssize_t
+    {
+        ::ssize_t res {};
+
+        #ifdef BOOST_CRYPT_HAS_PREADV2
+        if (dontcache_ != dontcache_state::unsupported)
+        {
+            iovec iov {data, size};
+            do
+            {
+                res = ::preadv2(fd_, &iov, 1, static_cast<::off_t>(offset), detail::rwf_dontcache);
+            } while (res < 0 && errno == EINTR);
+
+            if (res >= 0)
+            {
+                if (dontcache_ == dontcache_state::unknown)
+                {
+                    // Pages read ahead by the kernel are dropped as well
+                    dontcache_ = dontcache_state::supported;
+                    detail::advise_sequential(fd_);
+                }
+                return res;
+            }
+            if (errno != EOPNOTSUPP && errno != EINVAL)
+            {
+                return res;
+            }
+
+            dontcache_ = dontcache_state::unsupported;
+        }
+        #endif
+
+        do
+        {
+            res = ::pread(fd_, data, size, static_cast<::off_t>(offset));
+        } while (res < 0 && errno == EINTR);
+
+        return res;
+    }
+
+public:
+    explicit scan_file_reader(const std::string& filename, std::size_t buffer_size = 0U,
+                              std::size_t readahead_size = BOOST_CRYPT_SCAN_READAHEAD_SIZE)
+    {
+        open_file(filename.c_str(), buffer_size, readahead_size);
+    }
+
+    explicit scan_file_reader(const char* filename, std::size_t buffer_size = 0U,
+                              std::size_t readahead_size = BOOST_CRYPT_SCAN_READAHEAD_SIZE)
+    {
+        open_file(filename, buffer_size, readahead_size);
+    }
+
+    #ifdef BOOST_CRYPT_HAS_STRING_VIEW
+    explicit scan_file_reader(std::string_view filename, std::size_t buffer_size = 0U,
+                              std::size_t readahead_size = BOOST_CRYPT_SCAN_READAHEAD_SIZE)
+    {
+        open_file(std::string{filename}.c_str(), buffer_size, readahead_size);
+    }
+    #endif
+
+    scan_file_reader(const scan_file_reader&) = delete;
+    auto operator=(const scan_file_reader&) -> scan_file_reader& = delete;
+
+    // Fills the internal buffer with the next block of the file.
+    // Only the last block before the end of the file can be shorter than buffer_size()
+    auto read_next_block() noexcept -> const std::uint8_t*
+    {
+        bytes_read_ = 0U;
+        if (eof_)
+        {
+            return buffer_.get();
+        }
+
+        try
+        {
+            if (!buffer_)
+            {
+                buffer_.reset(new std::uint8_t[buffer_size_]);
+            }
+
+            const auto size {static_cast<std::size_t>((std::min)(static_cast<std::uint64_t>(buffer_size_), file_size_ - offset_))};
+
+            const auto ahead {dontcache_ == dontcache_state::unsupported ? readahead_size_ : 0U};
+            record_residency(offset_ + size + (std::max)(ahead, detail::scan_residency_lookahead));
+
+            #ifdef POSIX_FADV_WILLNEED
+            // Start reading ahead of the hasher, but only once the residency of that range is known
+            const auto target {(std::min)(offset_ + size + ahead, file_size_)};
+            if (ahead > 0U && target > readahead_end_)
+            {
+                const auto start {(std::max)(readahead_end_, offset_ + size)};
+                if (target > start)
+                {
+                    static_cast<void>(::posix_fadvise(fd_, static_cast<::off_t>(start), static_cast<::off_t>(target - start), POSIX_FADV_WILLNEED));
+                }
+                readahead_end_ = target;
+            }
+            #endif
+
+            while (bytes_read_ < size)
+            {
+                const auto res {read_some(buffer_.get() + bytes_read_, size - bytes_read_, offset_ + bytes_read_)};
+                if (res <= 0)
+                {
+                    // A read of 0 means the file was truncated while it was being read
+                    error_ = res < 0 ? errno : 0;
+                    eof_ = true;
+                    break;
+                }
+                bytes_read_ += static_cast<std::size_t>(res);
+            }
+
+            // Even with RWF_DONTCACHE, pages read ahead because of another reader's readahead markers are kept by the kernel
+            drop_read_pages(bytes_read_);
+
+            offset_ += bytes_read_;
+            if (offset_ >= file_size_)
+            {
+                eof_ = true;
+            }
+        }
+        catch (const std::bad_alloc&)
+        {
+            error_ = ENOMEM;
+            eof_ = true;
+        }
+
+        return buffer_.get();
+    }
+
+    auto get_bytes_read() const noexcept -> std::size_t
+    {
+        return bytes_read_;
+    }
+
+    auto eof() const noexcept -> bool
+    {
+        return eof_;
+    }
+
+    // The errno of a failed read, or 0
+    auto error() const noexcept -> int
+    {
+        return error_;
+    }
+
+    auto buffer_size() const noexcept -> std::size_t
+    {
+        return buffer_size_;
+    }
+
+    auto file_size() const noexcept -> std::uint64_t
+    {
+        return file_size_;
+    }
+
+    // True once a read has shown that the kernel supports RWF_DONTCACHE
+    auto uses_dontcache() const noexcept -> bool
+    {
+        return dontcache_ == dontcache_state::supported;
+    }
+
+    ~scan_file_reader()
+    {
+        if (fd_ >= 0)
+        {
+            ::close(fd_);
+        }
+    }
+};
+
+} // namespace utility
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#endif // BOOST_CRYPT_UTILITY_SCAN_FILE_HPP
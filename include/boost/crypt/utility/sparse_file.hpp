@@ -0,0 +1,285 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// Reads sparse files without doing any I/O for their holes
+
+#ifndef BOOST_CRYPT_UTILITY_SPARSE_FILE_HPP
+#define BOOST_CRYPT_UTILITY_SPARSE_FILE_HPP
+
+#include <boost/crypt/utility/config.hpp>
+#include <boost/crypt/utility/posix_config.hpp>
+#include <boost/crypt/utility/file.hpp>
+#include <boost/crypt/utility/posix_file.hpp>
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+#ifdef BOOST_CRYPT_HAS_SEEK_HOLE
+
+namespace boost {
+namespace crypt {
+namespace utility {
+
+// Largest part of a hole that is returned by a single call to sparse_file_reader::read_next_block
+BOOST_CRYPT_INLINE_CONSTEXPR std::size_t sparse_zero_block_size {BOOST_CRYPT_FILE_BUFFER_SIZE};
+
+namespace detail {
+
+// A single read-only block of zeros shared by every reader, which stays in .bss until it is touched
+inline auto zero_block() noexcept -> const std::uint8_t*
+{
+    static const std::uint8_t zeros[sparse_zero_block_size] {};
+    return zeros;
+}
+
+// True if the file is a regular file that has fewer blocks allocated than its size needs
+inline auto is_sparse(const struct stat& st) noexcept -> bool
+{
+    return S_ISREG(st.st_mode) && st.st_size > 0 &&
+           static_cast<std::uint64_t>(st.st_blocks) * 512U < static_cast<std::uint64_t>(st.st_size);
+}
+
+// True if md5_file should look for holes in the file before reading it
+inline auto should_seek_holes(const char* filename, read_mode mode) noexcept -> bool
+{
+    if (mode != read_mode::automatic && mode != read_mode::read)
+    {
+        return false;
+    }
+
+    struct stat st {};
+    return ::stat(filename, &st) == 0 && is_sparse(st);
+}
+
+} // namespace detail
+
+// Reads a regular file one data segment at a time, finding the holes with lseek(2) SEEK_DATA and SEEK_HOLE.
+// Holes are returned as blocks of at most sparse_zero_block_size bytes from a shared block of zeros, without any I/O,
+// and hole() reports whether the last block came from one so that hashers can use a faster path for zeros.
+// The size of the file is fixed when it is opened, and on filesystems that do not report holes the whole file is data
+class sparse_file_reader
+{
+private:
+    int fd_ {-1};
+    std::uint64_t file_size_ {};
+    std::uint64_t offset_ {};
+    std::uint64_t data_start_ {};
+    std::uint64_t data_end_ {};
+    std::uint64_t hole_bytes_ {};
+    std::size_t buffer_size_ {};
+    std::size_t bytes_read_ {};
+    std::unique_ptr<std::uint8_t[]> buffer_;
+    bool hole_ {};
+    bool eof_ {};
+    int error_ {};
+
+    auto open_file(const char* filename, std::size_t buffer_size) -> void
+    {
+        do
+        {
+            fd_ = ::open(filename, detail::open_read_flags);
+        } while (fd_ < 0 && errno == EINTR);
+
+        if (fd_ < 0)
+        {
+            throw std::runtime_error("Error opening file");
+        }
+
+        struct stat st {};
+        if (::fstat(fd_, &st) != 0 || !S_ISREG(st.st_mode))
+        {
+            ::close(fd_);
+            fd_ = -1;
+            throw std::runtime_error("Only regular files can be checked for holes");
+        }
+
+        file_size_ = static_cast<std::uint64_t>(st.st_size);
+        buffer_size_ = detail::io_buffer_size(buffer_size, st.st_blksize > 0 ? static_cast<std::size_t>(st.st_blksize) : 0U);
+        eof_ = file_size_ == 0U;
+
+        detail::advise_sequential(fd_);
+    }
+
+    // Finds the next data segment at or after offset_, leaving [offset_, data_start_) as a hole
+    auto next_segment() noexcept -> void
+    {
+        const auto data {::lseek(fd_, static_cast<::off_t>(offset_), SEEK_DATA)};
+        if (data < 0)
+        {
+            // ENXIO means the rest of the file is a hole, and anything else means holes are not supported
+            data_start_ = errno == ENXIO ? file_size_ : offset_;
+            data_end_ = file_size_;
+            return;
+        }
+
+        data_start_ = (std::min)(static_cast<std::uint64_t>(data), file_size_);
+
+        const auto hole {::lseek(fd_, data, SEEK_HOLE)};
+        data_end_ = hole < 0 ? file_size_ : (std::min)(static_cast<std::uint64_t>(hole), file_size_);
+    }
+
+    auto read_data(std::size_t size) noexcept -> void
+    {
+        bytes_read_ = 0U;
+        while (bytes_read_ < size)
+        {
+            ::ssize_t res {};
+            do
+            {
+                res = ::pread(fd_, buffer_.get() + bytes_read_, size - bytes_read_,
+                              static_cast<::off_t>(offset_ + bytes_read_));
+            } while (res < 0 && errno == EINTR);
+
+            if (res <= 0)
+            {
+                // The file was truncated since it was opened
+                error_ = res < 0 ? errno : 0;
+                eof_ = true;
+                break;
+            }
+
+            bytes_read_ += static_cast<std::size_t>(res);
+        }
+    }
+
+public:
+    explicit sparse_file_reader(const std::string& filename, std::size_t buffer_size = 0U)
+    {
+        open_file(filename.c_str(), buffer_size);
+    }
+
+    explicit sparse_file_reader(const char* filename, std::size_t buffer_size = 0U)
+    {
+        open_file(filename, buffer_size);
+    }
+
+    #ifdef BOOST_CRYPT_HAS_STRING_VIEW
+    explicit sparse_file_reader(std::string_view filename, std::size_t buffer_size = 0U)
+    {
+        open_file(std::string{filename}.c_str(), buffer_size);
+    }
+    #endif
+
+    sparse_file_reader(const sparse_file_reader&) = delete;
+    auto operator=(const sparse_file_reader&) -> sparse_file_reader& = delete;
+
+    // Returns the next part of the file, which is either zeros for a hole or at most buffer_size() bytes of data
+    auto read_next_block() noexcept -> const std::uint8_t*
+    {
+        bytes_read_ = 0U;
+        if (eof_)
+        {
+            return nullptr;
+        }
+
+        if (offset_ >= data_end_)
+        {
+            next_segment();
+        }
+
+        const std::uint8_t* block {};
+        if (offset_ < data_start_)
+        {
+            bytes_read_ = static_cast<std::size_t>((std::min)(static_cast<std::uint64_t>(sparse_zero_block_size), data_start_ - offset_));
+            hole_bytes_ += bytes_read_;
+            hole_ = true;
+            block = detail::zero_block();
+        }
+        else
+        {
+            if (!buffer_)
+            {
+                buffer_.reset(new (std::nothrow) std::uint8_t[buffer_size_]);
+                if (!buffer_)
+                {
+                    error_ = ENOMEM;
+                    eof_ = true;
+                    return nullptr;
+                }
+            }
+
+            hole_ = false;
+            read_data(static_cast<std::size_t>((std::min)(static_cast<std::uint64_t>(buffer_size_), data_end_ - offset_)));
+            block = buffer_.get();
+        }
+
+        offset_ += bytes_read_;
+        if (offset_ >= file_size_)
+        {
+            eof_ = true;
+        }
+
+        return block;
+    }
+
+    auto get_bytes_read() const noexcept -> std::size_t
+    {
+        return bytes_read_;
+    }
+
+    auto eof() const noexcept -> bool
+    {
+        return eof_;
+    }
+
+    // The errno of a failed read, or 0
+    auto error() const noexcept -> int
+    {
+        return error_;
+    }
+
+    // True if the last block returned by read_next_block was part of a hole, and so is all zeros
+    auto hole() const noexcept -> bool
+    {
+        return hole_;
+    }
+
+    // Total number of bytes returned from holes so far
+    auto hole_bytes() const noexcept -> std::uint64_t
+    {
+        return hole_bytes_;
+    }
+
+    auto buffer_size() const noexcept -> std::size_t
+    {
+        return buffer_size_;
+    }
+
+    auto file_size() const noexcept -> std::uint64_t
+    {
+        return file_size_;
+    }
+
+    ~sparse_file_reader()
+    {
+        if (fd_ >= 0)
+        {
+            ::close(fd_);
+        }
+    }
+};
+
+} // namespace utility
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HAS_SEEK_HOLE
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#endif // BOOST_CRYPT_UTILITY_SPARSE_FILE_HPP
@@ -0,0 +1,577 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// Hashes each file stored in a tar archive without extracting it
+
+#ifndef BOOST_CRYPT_UTILITY_TAR_HPP
+#define BOOST_CRYPT_UTILITY_TAR_HPP
+
+#include <boost/crypt/utility/config.hpp>
+#include <boost/crypt/utility/buffer_ring.hpp>
+#include <boost/crypt/utility/posix_file.hpp>
+#include <boost/crypt/utility/pipeline.hpp>
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <system_error>
+#include <thread>
+#endif
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <sys/stat.h>
+#endif
+#endif
+
+namespace boost {
+namespace crypt {
+namespace utility {
+
+// A regular file stored in a tar archive
+struct tar_entry
+{
+    std::string path;
+    std::uint64_t size {};
+    char type {};   // The typeflag of the header: '0', '\0' or '7'
+};
+
+namespace detail {
+
+BOOST_CRYPT_INLINE_CONSTEXPR std::size_t tar_block_size {512U};
+
+// Largest pax extended header or GNU long name that is buffered before the entry it describes
+BOOST_CRYPT_INLINE_CONSTEXPR std::uint64_t tar_max_metadata_size {1048576U};
+
+// Reads a NUL terminated field, which is not terminated when it fills the whole field
+inline auto tar_string(const std::uint8_t* field, std::size_t size) -> std::string
+{
+    const auto* begin {reinterpret_cast<const char*>(field)};
+    return std::string(begin, static_cast<std::size_t>(std::find(begin, begin + size, '\0') - begin));
+}
+
+// Numeric fields are octal, or base-256 big endian when the high bit of the first byte is set,
+// which GNU and pax writers use for entries of 8 GiB and more
+inline auto tar_number(const std::uint8_t* field, std::size_t size, std::uint64_t& value) noexcept -> bool
+{
+    value = 0U;
+    if ((field[0] & 0x80U) != 0U)
+    {
+        // A negative number is never a valid size
+        if ((field[0] & 0x40U) != 0U)
+        {
+            return false;
+        }
+
+        for (std::size_t i {}; i < size; ++i)
+        {
+            if (value > ((std::numeric_limits<std::uint64_t>::max)() >> 8U))
+            {
+                return false;
+            }
+            value = (value << 8U) | (i == 0U ? field[i] & 0x3FU : field[i]);
+        }
+        return true;
+    }
+
+    std::size_t i {};
+    while (i < size && field[i] == ' ')
+    {
+        ++i;
+    }
+
+    bool digits {};
+    for (; i < size && field[i] >= '0' && field[i] <= '7'; ++i)
+    {
+        value = (value << 3U) | static_cast<std::uint64_t>(field[i] - '0');
+        digits = true;
+    }
+
+    // The digits end with a space or NUL, or fill the field
+    return (digits || i == size || field[i] == '\0') && (i == size || field[i] == ' ' || field[i] == '\0');
+}
+
+// The checksum is the sum of the header bytes with the checksum field itself counted as spaces.
+// Some historic writers summed signed chars, so either sum is accepted
+inline auto tar_checksum_ok(const std::uint8_t* header) noexcept -> bool
+{
+    std::uint64_t expected {};
+    if (!tar_number(header + 148U, 8U, expected))
+    {
+        return false;
+    }
+
+    std::uint64_t unsigned_sum {};
+    std::int64_t signed_sum {};
+    for (std::size_t i {}; i < tar_block_size; ++i)
+    {
+        const auto byte {i >= 148U && i < 156U ? std::uint8_t{' '} : header[i]};
+        unsigned_sum += byte;
+        signed_sum += static_cast<std::int8_t>(byte);
+    }
+
+    return unsigned_sum == expected || static_cast<std::uint64_t>(signed_sum) == expected;
+}
+
+inline auto tar_zero_block(const std::uint8_t* header) noexcept -> bool
+{
+    return std::all_of(header, header + tar_block_size, [](std::uint8_t byte) { return byte == 0U; });
+}
+
+} // namespace detail
+
+// Parses a tar archive fed to it in pieces of any size, and hashes the payload of each regular file
+// straight from the caller's buffers, calling callback(const tar_entry& entry, Hasher& hasher) once it has all been hashed.
+// ustar and v7 headers are understood, along with the path and size records of pax extended headers and GNU long names,
+// so paths of any length and entries of any size are reported. Directories, links and other entries without data are
+// skipped, as are the payloads of GNU sparse files and unknown entry types, and the padding up to each 512-byte block.
+// Returns EILSEQ if a header is corrupt, or 0. Nothing is read or written outside of the buffers passed to process
+template <typename Hasher>
+class tar_stream
+{
+private:
+    enum class state
+    {
+        header,
+        payload,
+        metadata,
+        padding,
+        end
+    };
+
+    state state_ {state::header};
+    std::uint8_t header_[detail::tar_block_size] {};
+    std::size_t header_fill_ {};
+
+    tar_entry entry_;
+    Hasher hasher_ {};
+    bool hashed_ {};
+    std::uint64_t remaining_ {};
+    std::uint64_t padding_ {};
+
+    // pax and GNU records apply to the entry that follows them
+    char metadata_type_ {};
+    std::string metadata_;
+    std::string next_path_;
+    std::uint64_t next_size_ {};
+    bool has_next_size_ {};
+
+    int error_ {};
+
+    auto parse_pax() -> bool
+    {
+        // Each record is "<length> <key>=<value>\n", where the length counts the whole record
+        std::size_t pos {};
+        while (pos < metadata_.size())
+        {
+            std::size_t length {};
+            auto i {pos};
+            while (i < metadata_.size() && metadata_[i] >= '0' && metadata_[i] <= '9')
+            {
+                length = length * 10U + static_cast<std::size_t>(metadata_[i] - '0');
+                if (length > metadata_.size())
+                {
+                    return false;
+                }
+                ++i;
+            }
+
+            if (i == pos || i >= metadata_.size() || metadata_[i] != ' ' ||
+                length > metadata_.size() - pos || length < i - pos + 2U || metadata_[pos + length - 1U] != '\n')
+            {
+                return false;
+            }
+
+            const auto record_begin {i + 1U};
+            const auto record_end {pos + length - 1U};
+            const auto equals {metadata_.find('=', record_begin)};
+            if (equals == std::string::npos || equals >= record_end)
+            {
+                return false;
+            }
+
+            const auto key {metadata_.substr(record_begin, equals - record_begin)};
+            if (key == "path")
+            {
+                next_path_ = metadata_.substr(equals + 1U, record_end - equals - 1U);
+            }
+            else if (key == "size")
+            {
+                std::uint64_t size {};
+                for (auto j {equals + 1U}; j < record_end; ++j)
+                {
+                    if (metadata_[j] < '0' || metadata_[j] > '9' || size > ((std::numeric_limits<std::uint64_t>::max)() - 9U) / 10U)
+                    {
+                        return false;
+                    }
+                    size = size * 10U + static_cast<std::uint64_t>(metadata_[j] - '0');
+                }
+                next_size_ = size;
+                has_next_size_ = true;
+            }
+
+            pos += length;
+        }
+
+        return true;
+    }
+
+    auto end_metadata() -> bool
+    {
+        if (metadata_type_ == 'L')
+        {
+            next_path_ = metadata_.substr(0U, metadata_.find('\0'));
+            return true;
+        }
+
+        return parse_pax();
+    }
+
+    template <typename Callback>
+    auto end_payload(Callback& callback) -> void
+    {
+        if (hashed_)
+        {
+            callback(static_cast<const tar_entry&>(entry_), hasher_);
+        }
+
+        state_ = padding_ > 0U ? state::padding : state::header;
+    }
+
+    template <typename Callback>
+    auto begin_payload(std::uint64_t size, Callback& callback) -> void
+    {
+        remaining_ = size;
+        padding_ = (detail::tar_block_size - size % detail::tar_block_size) % detail::tar_block_size;
+        if (size == 0U)
+        {
+            end_payload(callback);
+        }
+        else
+        {
+            state_ = state::payload;
+        }
+    }
+
+    template <typename Callback>
+    auto begin_entry(const std::uint8_t* header, Callback& callback) -> bool
+    {
+        if (detail::tar_zero_block(header))
+        {
+            state_ = state::end;
+            return true;
+        }
+
+        std::uint64_t size {};
+        if (!detail::tar_checksum_ok(header) || !detail::tar_number(header + 124U, 12U, size))
+        {
+            return false;
+        }
+
+        const auto type {static_cast<char>(header[156])};
+        if (type == 'x' || type == 'L')
+        {
+            if (size > detail::tar_max_metadata_size)
+            {
+                return false;
+            }
+
+            metadata_type_ = type;
+            metadata_.clear();
+            remaining_ = size;
+            padding_ = (detail::tar_block_size - size % detail::tar_block_size) % detail::tar_block_size;
+            state_ = size > 0U ? state::metadata : (padding_ > 0U ? state::padding : state::header);
+            return size > 0U || end_metadata();
+        }
+
+        // Global pax headers and GNU long link names are skipped without disturbing the records for the next entry
+        if (type == 'g' || type == 'K')
+        {
+            hashed_ = false;
+            begin_payload(size, callback);
+            return true;
+        }
+
+        if (has_next_size_)
+        {
+            size = next_size_;
+        }
+
+        std::string path;
+        if (!next_path_.empty())
+        {
+            path.swap(next_path_);
+        }
+        else
+        {
+            path = detail::tar_string(header, 100U);
+
+            // Only POSIX ustar headers have a prefix, GNU headers store other fields there
+            if (std::memcmp(header + 257U, "ustar\0", 6U) == 0 && header[345] != 0U)
+            {
+                path = detail::tar_string(header + 345U, 155U) + '/' + path;
+            }
+        }
+
+        next_path_.clear();
+        has_next_size_ = false;
+
+        // Links, devices, directories and fifos have no data whatever their size field says
+        if (type == '1' || type == '2' || type == '3' || type == '4' || type == '5' || type == '6')
+        {
+            state_ = state::header;
+            return true;
+        }
+
+        hashed_ = (type == '0' || type == '\0' || type == '7') && !(type == '\0' && !path.empty() && path.back() == '/');
+        if (hashed_)
+        {
+            entry_.path.swap(path);
+            entry_.size = size;
+            entry_.type = type;
+            hasher_ = Hasher{};
+        }
+
+        begin_payload(size, callback);
+        return true;
+    }
+
+public:
+    // Feeds the next size bytes of the archive. Returns EILSEQ if the archive is corrupt, or 0
+    template <typename Callback>
+    auto process(const std::uint8_t* data, std::size_t size, Callback&& callback) -> int
+    {
+        while (size > 0U && error_ == 0 && state_ != state::end)
+        {
+            switch (state_)
+            {
+                case state::header:
+                {
+                    // Headers are parsed in place unless they straddle two of the caller's buffers
+                    const std::uint8_t* header {};
+                    if (header_fill_ == 0U && size >= detail::tar_block_size)
+                    {
+                        header = data;
+                        data += detail::tar_block_size;
+                        size -= detail::tar_block_size;
+                    }
+                    else
+                    {
+                        const auto len {(std::min)(detail::tar_block_size - header_fill_, size)};
+                        std::memcpy(header_ + header_fill_, data, len);
+                        header_fill_ += len;
+                        data += len;
+                        size -= len;
+                        if (header_fill_ < detail::tar_block_size)
+                        {
+                            break;
+                        }
+                        header_fill_ = 0U;
+                        header = header_;
+                    }
+
+                    if (!begin_entry(header, callback))
+                    {
+                        error_ = EILSEQ;
+                    }
+                    break;
+                }
+
+                case state::payload:
+                {
+                    const auto len {static_cast<std::size_t>((std::min)(remaining_, static_cast<std::uint64_t>(size)))};
+                    if (hashed_)
+                    {
+                        hasher_.process_bytes(data, len);
+                    }
+                    data += len;
+                    size -= len;
+                    remaining_ -= len;
+                    if (remaining_ == 0U)
+                    {
+                        end_payload(callback);
+                    }
+                    break;
+                }
+
+                case state::metadata:
+                {
+                    const auto len {static_cast<std::size_t>((std::min)(remaining_, static_cast<std::uint64_t>(size)))};
+                    metadata_.append(reinterpret_cast<const char*>(data), len);
+                    data += len;
+                    size -= len;
+                    remaining_ -= len;
+                    if (remaining_ == 0U)
+                    {
+                        if (!end_metadata())
+                        {
+                            error_ = EILSEQ;
+                        }
+                        state_ = padding_ > 0U ? state::padding : state::header;
+                    }
+                    break;
+                }
+
+                case state::padding:
+                {
+                    const auto len {static_cast<std::size_t>((std::min)(padding_, static_cast<std::uint64_t>(size)))};
+                    data += len;
+                    size -= len;
+                    padding_ -= len;
+                    if (padding_ == 0U)
+                    {
+                        state_ = state::header;
+                    }
+                    break;
+                }
+
+                // LCOV_EXCL_START
+                case state::end:
+                    break;
+                // LCOV_EXCL_STOP
+            }
+        }
+
+        return error_;
+    }
+
+    // Called once the archive has ended. Returns EILSEQ if it was corrupt, EIO if it stopped part way through an entry, or 0.
+    // Archives that end without the two zero blocks of the end-of-archive marker are accepted
+    auto finish() const noexcept -> int
+    {
+        if (error_ != 0)
+        {
+            return error_;
+        }
+
+        return state_ == state::end || (state_ == state::header && header_fill_ == 0U && next_path_.empty() && !has_next_size_) ? 0 : EIO;
+    }
+
+    // True once the end-of-archive marker has been seen, after which the rest of the input is ignored
+    auto finished() const noexcept -> bool
+    {
+        return state_ == state::end;
+    }
+};
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+namespace detail {
+
+// A reader thread fills the ring from source while the calling thread parses the archive
+template <typename Hasher, typename Callback>
+auto hash_tar_source(posix_file_reader& source, Callback& callback, std::size_t queue_depth, std::size_t buffer_size) -> std::error_code
+{
+    buffer_ring ring(queue_depth, buffer_size == 0U ? std::size_t{BOOST_CRYPT_FILE_BUFFER_SIZE} : buffer_size);
+
+    int read_err {};
+    std::thread reader([&source, &ring, &read_err]() {
+        try
+        {
+            read_err = fill_ring_from(source, ring);
+        }
+        catch (...)
+        {
+            read_err = ENOMEM;
+            ring.abort();
+        }
+    });
+
+    tar_stream<Hasher> stream;
+    int err {};
+    try
+    {
+        const std::uint8_t* data {};
+        std::size_t size {};
+        while (ring.next(0U, data, size))
+        {
+            err = stream.process(data, size, callback);
+            ring.release(0U);
+
+            // Whatever follows the end-of-archive marker is not needed
+            if (err != 0 || stream.finished())
+            {
+                ring.abort();
+                break;
+            }
+        }
+    }
+    catch (...)
+    {
+        ring.abort();
+        reader.join();
+        throw;
+    }
+
+    reader.join();
+
+    if (read_err == 0 && err == 0)
+    {
+        err = stream.finish();
+    }
+    else if (err == 0 && !stream.finished())
+    {
+        err = read_err;
+    }
+
+    return err == 0 ? std::error_code{} : std::error_code(err, std::system_category());
+}
+
+} // namespace detail
+
+// Hashes each regular file in the tar archive at filepath, calling callback(const tar_entry& entry, Hasher& hasher)
+// in archive order as each one is hashed. The archive is read on a separate thread into a ring of queue_depth buffers
+// of buffer_size bytes, and the payloads are hashed straight from those buffers.
+// Returns the error of a failed open or read, std::errc::illegal_byte_sequence for a corrupt header,
+// or std::errc::io_error for an archive that stops part way through an entry.
+// If the hasher or the callback throws, the reader is stopped and the exception is propagated
+template <typename Hasher, typename Callback>
+auto hash_tar(const char* filepath, Callback&& callback,
+              std::size_t queue_depth = default_queue_depth, std::size_t buffer_size = 0U) -> std::error_code
+{
+    std::error_code ec;
+    posix_file_reader source(filepath, ec);
+    if (ec)
+    {
+        return ec;
+    }
+
+    return detail::hash_tar_source<Hasher>(source, callback, queue_depth, buffer_size);
+}
+
+template <typename Hasher, typename Callback>
+auto hash_tar(const std::string& filepath, Callback&& callback,
+              std::size_t queue_depth = default_queue_depth, std::size_t buffer_size = 0U) -> std::error_code
+{
+    return hash_tar<Hasher>(filepath.c_str(), callback, queue_depth, buffer_size);
+}
+
+// Reads the archive from a descriptor owned by the caller, such as stdin receiving the output of tar c.
+// Regular files are read from the start, and pipes from where they are
+template <typename Hasher, typename Callback>
+auto hash_tar(int fd, Callback&& callback,
+              std::size_t queue_depth = default_queue_depth, std::size_t buffer_size = 0U) -> std::error_code
+{
+    struct stat st {};
+    if (fd < 0 || ::fstat(fd, &st) != 0)
+    {
+        return std::make_error_code(std::errc::bad_file_descriptor);
+    }
+
+    posix_file_reader source(fd, 0U, (std::numeric_limits<std::uint64_t>::max)());
+    return detail::hash_tar_source<Hasher>(source, callback, queue_depth, buffer_size);
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+} // namespace utility
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_UTILITY_TAR_HPP
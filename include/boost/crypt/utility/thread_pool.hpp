@@ -0,0 +1,256 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// A pool of worker threads that share out work by stealing it from each other
+
+#ifndef BOOST_CRYPT_UTILITY_THREAD_POOL_HPP
+#define BOOST_CRYPT_UTILITY_THREAD_POOL_HPP
+
+#include <boost/crypt/utility/config.hpp>
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#endif
+
+namespace boost {
+namespace crypt {
+namespace utility {
+
+// Each worker has its own deque of tasks. A task submitted from a worker goes on the back of that worker's deque,
+// and the worker takes its next task from the back too, so work that fans out (such as walking a directory tree)
+// is processed depth first and stays on the worker that created it.
+// A worker whose deque is empty steals from the front of the others, taking the oldest and usually largest pieces of work.
+// Tasks submitted from other threads are spread round robin over the workers.
+// Each deque has its own lock, which is only contended while stealing.
+// If a task throws, the tasks that have not started yet are discarded, and wait() rethrows the first exception
+class work_stealing_pool
+{
+public:
+    using task = std::function<void()>;
+
+    // Returned by current_worker() outside of the pool's threads
+    static constexpr std::size_t no_worker {(std::numeric_limits<std::size_t>::max)()};
+
+private:
+    struct worker_queue
+    {
+        std::mutex mutex;
+        std::deque<task> tasks;
+    };
+
+    std::vector<std::unique_ptr<worker_queue>> queues_;
+    std::vector<std::thread> threads_;
+
+    std::atomic<std::size_t> pending_ {0U};
+    std::atomic<std::size_t> queued_ {0U};
+    std::atomic<std::size_t> next_queue_ {0U};
+    std::atomic<bool> stopping_ {false};
+
+    std::mutex state_mutex_;
+    std::condition_variable work_available_;
+    std::condition_variable all_done_;
+    bool shutdown_ {};
+    std::exception_ptr error_;
+
+    struct current
+    {
+        const work_stealing_pool* pool;
+        std::size_t index;
+    };
+
+    static auto current_thread() noexcept -> current&
+    {
+        static thread_local current value {nullptr, no_worker};
+        return value;
+    }
+
+    auto try_take(std::size_t self, task& t) -> bool
+    {
+        {
+            auto& own {*queues_[self]};
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty())
+            {
+                t = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+
+        for (std::size_t i {1U}; i < queues_.size(); ++i)
+        {
+            auto& victim {*queues_[(self + i) % queues_.size()]};
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                t = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    auto finish_task() -> void
+    {
+        if (pending_.fetch_sub(1U) == 1U)
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            all_done_.notify_all();
+        }
+    }
+
+    auto run(std::size_t self) -> void
+    {
+        current_thread() = current {this, self};
+
+        while (true)
+        {
+            task t;
+            if (try_take(self, t))
+            {
+                queued_.fetch_sub(1U);
+                if (!stopping_.load(std::memory_order_relaxed))
+                {
+                    try
+                    {
+                        t();
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard<std::mutex> lock(state_mutex_);
+                        if (!error_)
+                        {
+                            error_ = std::current_exception();
+                        }
+                        stopping_.store(true);
+                    }
+                }
+
+                finish_task();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(state_mutex_);
+            work_available_.wait(lock, [&] { return shutdown_ || queued_.load() > 0U; });
+            if (shutdown_)
+            {
+                return;
+            }
+        }
+    }
+
+public:
+    // A thread_count of 0 uses one thread per hardware thread
+    explicit work_stealing_pool(std::size_t thread_count = 0U)
+    {
+        if (thread_count == 0U)
+        {
+            thread_count = (std::max)(std::size_t{1U}, static_cast<std::size_t>(std::thread::hardware_concurrency()));
+        }
+
+        for (std::size_t i {}; i < thread_count; ++i)
+        {
+            queues_.emplace_back(new worker_queue);
+        }
+
+        try
+        {
+            for (std::size_t i {}; i < thread_count; ++i)
+            {
+                threads_.emplace_back([this, i]() { run(i); });
+            }
+        }
+        catch (...)
+        {
+            // The queues of the threads that could not be started are still drained by stealing, so carry on with the ones we have
+            if (threads_.empty())
+            {
+                throw;
+            }
+        }
+    }
+
+    work_stealing_pool(const work_stealing_pool&) = delete;
+    auto operator=(const work_stealing_pool&) -> work_stealing_pool& = delete;
+
+    auto submit(task t) -> void
+    {
+        const auto& self {current_thread()};
+        const auto index {self.pool == this ? self.index : next_queue_.fetch_add(1U, std::memory_order_relaxed) % queues_.size()};
+
+        pending_.fetch_add(1U);
+        {
+            auto& queue {*queues_[index]};
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(t));
+        }
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            queued_.fetch_add(1U);
+        }
+        work_available_.notify_one();
+    }
+
+    // Blocks until every task, including those submitted by other tasks, has finished, and rethrows the first exception
+    auto wait() -> void
+    {
+        std::unique_lock<std::mutex> lock(state_mutex_);
+        all_done_.wait(lock, [&] { return pending_.load() == 0U; });
+
+        if (error_)
+        {
+            auto error {error_};
+            error_ = nullptr;
+            stopping_.store(false);
+            std::rethrow_exception(error);
+        }
+    }
+
+    auto thread_count() const noexcept -> std::size_t
+    {
+        return queues_.size();
+    }
+
+    // The index of the worker running the calling thread in [0, thread_count()), or no_worker if it is not one of this pool's threads
+    auto current_worker() const noexcept -> std::size_t
+    {
+        const auto& self {current_thread()};
+        return self.pool == this ? self.index : no_worker;
+    }
+
+    ~work_stealing_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            shutdown_ = true;
+            stopping_.store(true);
+        }
+        work_available_.notify_all();
+
+        for (auto& thread : threads_)
+        {
+            thread.join();
+        }
+    }
+};
+
+} // namespace utility
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_UTILITY_THREAD_POOL_HPP
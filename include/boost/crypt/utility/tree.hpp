@@ -0,0 +1,510 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// Hashes every file under a directory, listing directories and hashing files on a pool of threads
+
+#ifndef BOOST_CRYPT_UTILITY_TREE_HPP
+#define BOOST_CRYPT_UTILITY_TREE_HPP
+
+#include <boost/crypt/utility/config.hpp>
+#include <boost/crypt/utility/posix_config.hpp>
+#include <boost/crypt/utility/multi_file.hpp>
+#include <boost/crypt/utility/posix_file.hpp>
+#include <boost/crypt/utility/thread_pool.hpp>
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace boost {
+namespace crypt {
+namespace utility {
+
+// Files of at least this many bytes are hashed by the large file threads
+BOOST_CRYPT_INLINE_CONSTEXPR std::uint64_t default_large_file_size {UINT64_C(67108864)};
+
+struct tree_options
+{
+    // Threads that list directories and hash the files smaller than large_file_size.
+    // 0 selects a count based on std::thread::hardware_concurrency()
+    std::size_t thread_count {};
+
+    // Threads that only hash files of at least large_file_size bytes, so that a few huge files do not hold up
+    // the rest of the tree. With 0 every file is hashed by the thread that found it
+    std::size_t large_file_threads {2U};
+
+    std::uint64_t large_file_size {default_large_file_size};
+
+    // Size of the read buffer of each thread hashing small files. Large file threads use BOOST_CRYPT_FILE_BUFFER_SIZE
+    std::size_t buffer_size {default_multi_file_buffer_size};
+};
+
+namespace detail {
+
+// Number of files in a directory that are handed to a thread as one task
+BOOST_CRYPT_INLINE_CONSTEXPR std::size_t tree_batch_size {64U};
+
+// Size of the buffer that directory entries are read into
+BOOST_CRYPT_INLINE_CONSTEXPR std::size_t tree_listing_buffer_size {65536U};
+
+// Closes the descriptor when it goes out of scope
+class tree_fd
+{
+private:
+    int fd_ {-1};
+
+public:
+    explicit tree_fd(int fd) noexcept : fd_ {fd} {}
+
+    tree_fd(tree_fd&& other) noexcept : fd_ {other.fd_}
+    {
+        other.fd_ = -1;
+    }
+
+    tree_fd(const tree_fd&) = delete;
+    auto operator=(const tree_fd&) -> tree_fd& = delete;
+    auto operator=(tree_fd&&) -> tree_fd& = delete;
+
+    ~tree_fd()
+    {
+        if (fd_ >= 0)
+        {
+            ::close(fd_);
+        }
+    }
+
+    auto get() const noexcept -> int
+    {
+        return fd_;
+    }
+};
+
+// An open directory shared by the tasks for its entries, which open them with openat(2)
+// instead of resolving the whole path again
+struct tree_directory
+{
+    tree_fd fd;
+    std::string path;
+
+    tree_directory(tree_fd&& directory_fd, std::string directory_path) noexcept
+        : fd {std::move(directory_fd)}, path {std::move(directory_path)} {}
+};
+
+enum class tree_entry_kind
+{
+    file,
+    directory,
+    unknown,
+    other
+};
+
+inline auto tree_join(const std::string& directory, const std::string& name) -> std::string
+{
+    return directory.empty() ? name : directory + '/' + name;
+}
+
+inline auto tree_kind_of_type(unsigned char type) noexcept -> tree_entry_kind
+{
+    switch (type)
+    {
+        case DT_REG:
+            return tree_entry_kind::file;
+        case DT_DIR:
+            return tree_entry_kind::directory;
+        case DT_UNKNOWN:
+            return tree_entry_kind::unknown;
+        default:
+            return tree_entry_kind::other;
+    }
+}
+
+// For filesystems that do not report the type of an entry while listing the directory.
+// An entry that cannot be looked at is treated as a file so that hashing it reports why
+inline auto tree_stat_kind(int directory_fd, const char* name) noexcept -> tree_entry_kind
+{
+    struct stat st {};
+    if (::fstatat(directory_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+    {
+        return tree_entry_kind::file;
+    }
+
+    if (S_ISREG(st.st_mode))
+    {
+        return tree_entry_kind::file;
+    }
+
+    return S_ISDIR(st.st_mode) ? tree_entry_kind::directory : tree_entry_kind::other;
+}
+
+inline auto tree_is_dot(const char* name) noexcept -> bool
+{
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+// Calls f(name, kind) for every entry of the open directory other than . and ..
+// Returns the errno of a failed read, or 0
+template <typename F>
+auto tree_list_directory(int fd, std::vector<char>& buffer, F&& f) -> int
+{
+    #ifdef BOOST_CRYPT_HAS_GETDENTS64
+
+    // Each getdents64(2) call returns as many entries as fit in the buffer
+    while (true)
+    {
+        const auto res {::syscall(SYS_getdents64, fd, buffer.data(), buffer.size())};
+        if (res == 0)
+        {
+            return 0;
+        }
+        if (res < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return errno;
+        }
+
+        // struct linux_dirent64 is a 64-bit inode, a 64-bit offset, a 16-bit record length, an 8-bit type and then the name
+        std::size_t offset {};
+        while (offset < static_cast<std::size_t>(res))
+        {
+            const char* record {buffer.data() + offset};
+            std::uint16_t length {};
+            std::memcpy(&length, record + 16, sizeof(length));
+            const char* name {record + 19};
+            offset += length;
+
+            if (!tree_is_dot(name))
+            {
+                f(name, tree_kind_of_type(static_cast<unsigned char>(record[18])));
+            }
+        }
+    }
+
+    #else
+
+    static_cast<void>(buffer);
+
+    // closedir(3) closes the descriptor, so give it a copy
+    const int copy {::dup(fd)};
+    if (copy < 0)
+    {
+        return errno;
+    }
+
+    const auto close_directory = [](DIR* d) { ::closedir(d); };
+    std::unique_ptr<DIR, decltype(close_directory)> directory {::fdopendir(copy), close_directory};
+    if (directory == nullptr)
+    {
+        const auto error {errno};
+        ::close(copy);
+        return error;
+    }
+
+    while (true)
+    {
+        errno = 0;
+        const auto* entry {::readdir(directory.get())};
+        if (entry == nullptr)
+        {
+            return errno;
+        }
+
+        if (!tree_is_dot(entry->d_name))
+        {
+            f(entry->d_name, tree_kind_of_type(entry->d_type));
+        }
+    }
+
+    #endif
+}
+
+template <typename Hasher, typename Callback>
+class tree_hasher
+{
+private:
+    using directory_ptr = std::shared_ptr<tree_directory>;
+
+    Callback& callback_;
+    const tree_options& options_;
+    std::size_t buffer_size_;
+    std::mutex callback_mutex_;
+
+    std::vector<std::unique_ptr<std::uint8_t[]>> buffers_;
+    std::vector<std::vector<char>> listing_buffers_;
+    std::vector<std::unique_ptr<std::uint8_t[]>> large_buffers_;
+
+    // Declared after everything their tasks use, and pool_ last since its tasks submit to large_pool_
+    std::unique_ptr<work_stealing_pool> large_pool_;
+    work_stealing_pool pool_;
+
+    auto report(const std::string& path, std::uint64_t size, Hasher& hasher, const std::error_code& ec) -> void
+    {
+        std::lock_guard<std::mutex> lock(callback_mutex_);
+        callback_(path, size, hasher, ec);
+    }
+
+    auto report_error(const std::string& path, int error) -> void
+    {
+        Hasher hasher {};
+        report(path, 0U, hasher, std::error_code(error, std::system_category()));
+    }
+
+    auto submit_directory(const directory_ptr& parent, std::string name) -> void
+    {
+        pool_.submit([this, parent, name]() {
+            open_directory(parent, name);
+        });
+    }
+
+    auto submit_files(const directory_ptr& directory, std::vector<std::string>&& names) -> void
+    {
+        auto batch {std::make_shared<std::vector<std::string>>(std::move(names))};
+        pool_.submit([this, directory, batch]() {
+            auto& buffer {buffers_[pool_.current_worker()]};
+            for (const auto& name : *batch)
+            {
+                hash_entry(directory, name, buffer.get(), buffer_size_, false);
+            }
+        });
+    }
+
+    auto open_directory(const directory_ptr& parent, const std::string& name) -> void
+    {
+        int fd {};
+        do
+        {
+            fd = ::openat(parent->fd.get(), name.c_str(), open_read_flags | O_DIRECTORY | O_NOFOLLOW);
+        } while (fd < 0 && errno == EINTR);
+
+        const auto path {tree_join(parent->path, name)};
+        if (fd < 0)
+        {
+            // Replaced by a symbolic link since it was listed, which is skipped like any other link
+            if (errno != ELOOP)
+            {
+                report_error(path, errno);
+            }
+            return;
+        }
+
+        tree_fd directory_fd {fd};
+        list(std::make_shared<tree_directory>(std::move(directory_fd), path));
+    }
+
+    // Subdirectories are submitted as soon as they are found so that other threads can steal them,
+    // and the files are submitted in batches
+    auto list(const directory_ptr& directory) -> void
+    {
+        std::vector<std::string> batch;
+        const auto error {tree_list_directory(directory->fd.get(), listing_buffers_[pool_.current_worker()],
+                                              [&](const char* name, tree_entry_kind kind) {
+            if (kind == tree_entry_kind::unknown)
+            {
+                kind = tree_stat_kind(directory->fd.get(), name);
+            }
+
+            if (kind == tree_entry_kind::directory)
+            {
+                submit_directory(directory, name);
+            }
+            else if (kind == tree_entry_kind::file)
+            {
+                batch.emplace_back(name);
+                if (batch.size() == tree_batch_size)
+                {
+                    submit_files(directory, std::move(batch));
+                    batch.clear();
+                }
+            }
+        })};
+
+        if (!batch.empty())
+        {
+            submit_files(directory, std::move(batch));
+        }
+
+        if (error != 0)
+        {
+            report_error(directory->path.empty() ? std::string{"."} : directory->path, error);
+        }
+    }
+
+    auto hash_entry(const directory_ptr& directory, const std::string& name, std::uint8_t* buffer,
+                    std::size_t buffer_size, bool large) -> void
+    {
+        // O_NONBLOCK keeps a file that was replaced by a FIFO since it was listed from blocking the open
+        int fd {};
+        do
+        {
+            fd = ::openat(directory->fd.get(), name.c_str(), open_read_flags | O_NOFOLLOW | O_NONBLOCK | O_NOCTTY);
+        } while (fd < 0 && errno == EINTR);
+
+        const auto path {tree_join(directory->path, name)};
+        if (fd < 0)
+        {
+            if (errno != ELOOP)
+            {
+                report_error(path, errno);
+            }
+            return;
+        }
+
+        const tree_fd file {fd};
+        struct stat st {};
+        if (::fstat(fd, &st) != 0)
+        {
+            report_error(path, errno);
+            return;
+        }
+        if (!S_ISREG(st.st_mode))
+        {
+            return;
+        }
+
+        // The large file thread opens it again rather than keeping a descriptor open for each queued file
+        if (!large && large_pool_ != nullptr && static_cast<std::uint64_t>(st.st_size) >= options_.large_file_size)
+        {
+            large_pool_->submit([this, directory, name]() {
+                auto& large_buffer {large_buffers_[large_pool_->current_worker()]};
+                hash_entry(directory, name, large_buffer.get(), BOOST_CRYPT_FILE_BUFFER_SIZE, true);
+            });
+            return;
+        }
+
+        if (large)
+        {
+            advise_sequential(fd);
+        }
+
+        Hasher hasher {};
+        std::uint64_t size {};
+        std::error_code ec;
+        while (true)
+        {
+            const auto res {::read(fd, buffer, buffer_size)};
+            if (res > 0)
+            {
+                hasher.process_bytes(static_cast<const std::uint8_t*>(buffer), static_cast<std::size_t>(res));
+                size += static_cast<std::uint64_t>(res);
+            }
+            else if (res == 0)
+            {
+                break;
+            }
+            else if (errno != EINTR)
+            {
+                ec = std::error_code(errno, std::system_category());
+                break;
+            }
+        }
+
+        report(path, size, hasher, ec);
+    }
+
+    static auto default_thread_count(std::size_t thread_count) -> std::size_t
+    {
+        // Threads spend most of their time blocked in the kernel, so use more than the number of cores
+        return thread_count != 0U ? thread_count :
+            (std::max)(std::size_t{4U}, 2U * static_cast<std::size_t>(std::thread::hardware_concurrency()));
+    }
+
+public:
+    tree_hasher(Callback& callback, const tree_options& options)
+        : callback_ {callback}, options_ {options},
+          buffer_size_ {options.buffer_size != 0U ? options.buffer_size : default_multi_file_buffer_size},
+          large_pool_ {options.large_file_threads != 0U ? new work_stealing_pool(options.large_file_threads) : nullptr},
+          pool_ {default_thread_count(options.thread_count)}
+    {
+        for (std::size_t i {}; i < pool_.thread_count(); ++i)
+        {
+            buffers_.emplace_back(new std::uint8_t[buffer_size_]);
+            listing_buffers_.emplace_back(tree_listing_buffer_size);
+        }
+
+        if (large_pool_ != nullptr)
+        {
+            for (std::size_t i {}; i < large_pool_->thread_count(); ++i)
+            {
+                large_buffers_.emplace_back(new std::uint8_t[BOOST_CRYPT_FILE_BUFFER_SIZE]);
+            }
+        }
+    }
+
+    auto run(tree_fd&& root) -> void
+    {
+        const auto directory {std::make_shared<tree_directory>(std::move(root), std::string{})};
+        pool_.submit([this, directory]() { list(directory); });
+        pool_.wait();
+
+        if (large_pool_ != nullptr)
+        {
+            large_pool_->wait();
+        }
+    }
+};
+
+} // namespace detail
+
+// Hashes every regular file under root. Directories are listed in parallel with getdents64(2) on Linux and readdir(3)
+// elsewhere, and their files are hashed on a work stealing pool, with files of at least options.large_file_size bytes
+// handed to separate threads.
+// Each file gets a fresh default constructed Hasher, and once it is complete callback(path, size, hasher, ec) is called
+// with the path relative to root and the number of bytes hashed.
+// Files and directories that cannot be read are reported with ec set, and the size is 0 for a directory.
+// Symbolic links and special files are skipped, and the callback is invoked in whatever order the files complete,
+// never concurrently.
+// If the callback or a hasher throws, no more files are started and the exception is rethrown.
+// Returns the reason root could not be opened, or an empty error code
+template <typename Hasher, typename Callback>
+auto hash_tree(const std::string& root, Callback&& callback, const tree_options& options = tree_options{}) -> std::error_code
+{
+    int fd {};
+    do
+    {
+        fd = ::open(root.c_str(), detail::open_read_flags | O_DIRECTORY);
+    } while (fd < 0 && errno == EINTR);
+
+    if (fd < 0)
+    {
+        return std::error_code(errno, std::system_category());
+    }
+
+    detail::tree_fd root_fd {fd};
+    detail::tree_hasher<Hasher, typename std::remove_reference<Callback>::type> hasher(callback, options);
+    hasher.run(std::move(root_fd));
+
+    return std::error_code{};
+}
+
+} // namespace utility
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#endif // BOOST_CRYPT_UTILITY_TREE_HPP
@@ -0,0 +1,593 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// Checks files against a list of checksums in the format written by md5sum, parsing the list and hashing the files on a pool of threads
+
+#ifndef BOOST_CRYPT_UTILITY_VERIFY_HPP
+#define BOOST_CRYPT_UTILITY_VERIFY_HPP
+
+#include <boost/crypt/utility/config.hpp>
+#include <boost/crypt/utility/array.hpp>
+#include <boost/crypt/utility/mapped_file.hpp>
+#include <boost/crypt/utility/multi_file.hpp>
+#include <boost/crypt/utility/posix_file.hpp>
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+namespace boost {
+namespace crypt {
+namespace utility {
+
+struct verify_options
+{
+    // Threads that parse the list and hash the files it names.
+    // 0 selects a count based on std::thread::hardware_concurrency()
+    std::size_t thread_count {};
+
+    // Size of the read buffer of each thread
+    std::size_t buffer_size {default_multi_file_buffer_size};
+};
+
+enum class verify_status
+{
+    mismatch,   // The file was read, but its digest is not the one listed
+    unreadable, // The file could not be opened or read
+    malformed   // The line is not a checksum line
+};
+
+// A line of the list that did not verify
+struct verify_failure
+{
+    std::size_t line;
+    std::string path;
+    verify_status status;
+    std::error_code ec;
+};
+
+struct verify_result
+{
+    std::size_t verified {};
+    std::size_t mismatched {};
+    std::size_t unreadable {};
+    std::size_t malformed {};
+
+    // Why the list itself could not be read, in which case nothing was verified
+    std::error_code ec;
+};
+
+namespace detail {
+
+// Most lines of the list that a thread takes at a time
+BOOST_CRYPT_INLINE_CONSTEXPR std::size_t verify_batch_lines {64U};
+
+// A guess at the length of a line, used to split short lists finely enough to keep every thread busy
+BOOST_CRYPT_INLINE_CONSTEXPR std::size_t verify_typical_line_size {128U};
+
+// The whole list, memory mapped if it is a regular file, and otherwise read into memory
+class verify_list
+{
+private:
+    void* mapping_ {};
+    std::size_t mapping_size_ {};
+    std::string contents_;
+    const char* data_ {};
+    std::size_t size_ {};
+
+public:
+    verify_list() = default;
+    verify_list(const verify_list&) = delete;
+    auto operator=(const verify_list&) -> verify_list& = delete;
+
+    // Returns the errno of the failure, or 0
+    auto open(const std::string& path) -> int
+    {
+        int fd {};
+        do
+        {
+            fd = ::open(path.c_str(), open_read_flags);
+        } while (fd < 0 && errno == EINTR);
+
+        if (fd < 0)
+        {
+            return errno;
+        }
+
+        struct stat st {};
+        if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+            static_cast<std::uint64_t>(st.st_size) <= static_cast<std::uint64_t>(SIZE_MAX))
+        {
+            const auto size {static_cast<std::size_t>(st.st_size)};
+            auto* addr {::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)};
+            if (addr != MAP_FAILED)
+            {
+                advise_mapping(addr, size);
+                ::close(fd);
+
+                mapping_ = addr;
+                mapping_size_ = size;
+                data_ = static_cast<const char*>(addr);
+                size_ = size;
+                return 0;
+            }
+        }
+
+        // Pipes, and files too large for the address space, are read into memory instead
+        std::unique_ptr<char[]> buffer {new char[BOOST_CRYPT_FILE_BUFFER_SIZE]};
+        int error {};
+        while (true)
+        {
+            const auto res {::read(fd, buffer.get(), BOOST_CRYPT_FILE_BUFFER_SIZE)};
+            if (res > 0)
+            {
+                contents_.append(buffer.get(), static_cast<std::size_t>(res));
+            }
+            else if (res == 0)
+            {
+                break;
+            }
+            else if (errno != EINTR)
+            {
+                error = errno;
+                break;
+            }
+        }
+
+        ::close(fd);
+        data_ = contents_.data();
+        size_ = contents_.size();
+        return error;
+    }
+
+    auto data() const noexcept -> const char*
+    {
+        return data_;
+    }
+
+    auto size() const noexcept -> std::size_t
+    {
+        return size_;
+    }
+
+    ~verify_list()
+    {
+        if (mapping_ != nullptr)
+        {
+            ::munmap(mapping_, mapping_size_);
+        }
+    }
+};
+
+// Loads 8 characters into a word with the first character in the low byte, whatever the byte order of the platform
+inline auto verify_load_word(const char* p) noexcept -> std::uint64_t
+{
+    std::uint64_t word {};
+    for (std::size_t i {}; i < 8U; ++i)
+    {
+        word |= static_cast<std::uint64_t>(static_cast<unsigned char>(p[i])) << (8U * i);
+    }
+
+    return word;
+}
+
+// Decodes 8 hex digits of either case into 4 bytes, checking and converting all 8 characters at once
+// in the lanes of a 64-bit word rather than one character at a time.
+// Returns false if any of the characters is not a hex digit
+inline auto decode_hex_word(const char* p, std::uint8_t* out) noexcept -> bool
+{
+    constexpr std::uint64_t ones {UINT64_C(0x0101010101010101)};
+    constexpr std::uint64_t high_bits {UINT64_C(0x8080808080808080)};
+
+    const auto word {verify_load_word(p)};
+    if ((word & high_bits) != 0U)
+    {
+        return false;
+    }
+
+    // With the high bit of every byte clear, adding 0x80 - lo sets it in the bytes that are at least lo,
+    // and adding 0x7F - hi sets it in the bytes greater than hi, without carrying into the next byte
+    const auto digits {(word + ones * (0x80U - '0')) & ~(word + ones * (0x7FU - '9')) & high_bits};
+    const auto lower {word | ones * 0x20U};
+    const auto letters {(lower + ones * (0x80U - 'a')) & ~(lower + ones * (0x7FU - 'f')) & high_bits};
+    if ((digits | letters) != high_bits)
+    {
+        return false;
+    }
+
+    // A digit is worth its low nibble, and a letter its low nibble plus 9
+    const auto nibbles {(word & ones * 0x0FU) + (letters >> 7U) * 9U};
+
+    // The first character of each pair is the high nibble of the byte
+    const auto bytes {((nibbles << 4U) | (nibbles >> 8U)) & UINT64_C(0x00FF00FF00FF00FF)};
+    out[0] = static_cast<std::uint8_t>(bytes);
+    out[1] = static_cast<std::uint8_t>(bytes >> 16U);
+    out[2] = static_cast<std::uint8_t>(bytes >> 32U);
+    out[3] = static_cast<std::uint8_t>(bytes >> 48U);
+
+    return true;
+}
+
+template <boost::crypt::size_t N>
+auto decode_hex_digest(const char* p, boost::crypt::array<boost::crypt::uint8_t, N>& digest) noexcept -> bool
+{
+    static_assert(N % 4U == 0U, "Digests are decoded 4 bytes at a time");
+
+    for (std::size_t i {}; i < N; i += 4U)
+    {
+        if (!decode_hex_word(p + 2U * i, &digest[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+inline auto verify_is_blank(char c) noexcept -> bool
+{
+    return c == ' ' || c == '\t';
+}
+
+// Undoes the escaping md5sum applies to names containing a backslash, newline or carriage return
+inline auto verify_unescape(const char* name, std::size_t size, std::string& path) -> bool
+{
+    path.clear();
+    for (std::size_t i {}; i < size; ++i)
+    {
+        if (name[i] != '\\')
+        {
+            path.push_back(name[i]);
+            continue;
+        }
+
+        if (++i == size)
+        {
+            return false;
+        }
+
+        switch (name[i])
+        {
+            case '\\':
+                path.push_back('\\');
+                break;
+            case 'n':
+                path.push_back('\n');
+                break;
+            case 'r':
+                path.push_back('\r');
+                break;
+            default:
+                return false;
+        }
+    }
+
+    return true;
+}
+
+// Parses a line without its line ending in either the "digest  name" format, with a space or * before the name,
+// or the BSD "TAG (name) = digest" format written by --tag.
+// Lines that start with a backslash have an escaped name
+template <boost::crypt::size_t N>
+auto verify_parse_line(const char* begin, const char* end, const std::string& tag,
+                       boost::crypt::array<boost::crypt::uint8_t, N>& digest, std::string& path) -> bool
+{
+    constexpr std::size_t hex_size {2U * N};
+
+    auto p {begin};
+    while (p != end && verify_is_blank(*p))
+    {
+        ++p;
+    }
+
+    bool escaped {};
+    if (p != end && *p == '\\')
+    {
+        escaped = true;
+        ++p;
+    }
+
+    const char* name {};
+    std::size_t name_size {};
+
+    const auto remaining {static_cast<std::size_t>(end - p)};
+    if (!tag.empty() && remaining > tag.size() && std::memcmp(p, tag.data(), tag.size()) == 0 &&
+        (p[tag.size()] == '(' || p[tag.size()] == ' '))
+    {
+        p += tag.size();
+        if (*p == ' ')
+        {
+            ++p;
+        }
+        if (p == end || *p != '(')
+        {
+            return false;
+        }
+        ++p;
+
+        // The name runs to the last closing parenthesis, so it may contain parentheses of its own
+        auto close {end};
+        while (close != p && *(close - 1) != ')')
+        {
+            --close;
+        }
+        if (close == p)
+        {
+            return false;
+        }
+
+        name = p;
+        name_size = static_cast<std::size_t>(close - 1 - p);
+
+        p = close;
+        while (p != end && verify_is_blank(*p))
+        {
+            ++p;
+        }
+        if (p == end || *p != '=')
+        {
+            return false;
+        }
+        ++p;
+        while (p != end && verify_is_blank(*p))
+        {
+            ++p;
+        }
+
+        if (static_cast<std::size_t>(end - p) != hex_size || !decode_hex_digest(p, digest))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        // The digest, a blank, and at least one character of the name
+        if (remaining < hex_size + 2U || !verify_is_blank(p[hex_size]) || !decode_hex_digest(p, digest))
+        {
+            return false;
+        }
+
+        name = p + hex_size + 1U;
+        name_size = static_cast<std::size_t>(end - name);
+        if (name_size > 1U && (*name == ' ' || *name == '*'))
+        {
+            ++name;
+            --name_size;
+        }
+    }
+
+    if (name_size == 0U)
+    {
+        return false;
+    }
+
+    if (escaped)
+    {
+        return verify_unescape(name, name_size, path);
+    }
+
+    path.assign(name, name_size);
+    return true;
+}
+
+template <typename Digest>
+auto verify_digest_equal(const Digest& lhs, const Digest& rhs) noexcept -> bool
+{
+    for (std::size_t i {}; i < lhs.size(); ++i)
+    {
+        if (lhs[i] != rhs[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace detail
+
+// Hashes every file named in the checksum list at list_path and compares it with the listed digest.
+// The list is memory mapped, and the threads take it up to 64 lines at a time, so parsing it is spread over the pool
+// along with the hashing and never has to run ahead of it.
+// Lines starting with # and empty lines are skipped. Lines in the BSD format are recognized by tag, such as "MD5".
+// Only the lines that do not verify are reported, by calling callback(const verify_failure&),
+// which is never invoked concurrently, but is invoked from the worker threads in no particular order.
+// If the callback or a hasher throws, no more lines are started and the exception is rethrown
+template <typename Hasher, typename Callback>
+auto verify_checksum_file(const std::string& list_path, const std::string& tag, Callback&& callback,
+                          const verify_options& options = verify_options{}) -> verify_result
+{
+    using digest_type = decltype(std::declval<Hasher&>().get_digest());
+
+    verify_result result;
+
+    detail::verify_list list;
+    const auto list_error {list.open(list_path)};
+    if (list_error != 0)
+    {
+        result.ec = std::error_code(list_error, std::system_category());
+        return result;
+    }
+
+    auto thread_count {options.thread_count};
+    if (thread_count == 0U)
+    {
+        // Threads spend most of their time blocked in the kernel, so use more than the number of cores
+        thread_count = (std::max)(std::size_t{4U}, 2U * static_cast<std::size_t>(std::thread::hardware_concurrency()));
+    }
+    // Every line is at least a digest and two more characters long
+    thread_count = (std::min)(thread_count, list.size() / 32U + 1U);
+
+    // A list of a few huge files is split a line at a time so that they are hashed in parallel
+    const auto batch_lines {(std::max)(std::size_t{1U}, (std::min)(detail::verify_batch_lines,
+                                       list.size() / (thread_count * detail::verify_typical_line_size)))};
+
+    const auto buffer_size {(std::max)(options.buffer_size, std::size_t{1U})};
+    const char* const list_end {list.data() + list.size()};
+
+    std::mutex cursor_mutex;
+    const char* cursor {list.data()};
+    std::size_t next_line {1U};
+
+    std::mutex callback_mutex;
+    std::atomic<bool> stop {false};
+    std::exception_ptr error;
+
+    // Finding the ends of the lines uses memchr, which the C library vectorizes
+    auto take_batch = [&](const char*& begin, const char*& end, std::size_t& first_line) -> bool {
+        std::lock_guard<std::mutex> lock(cursor_mutex);
+        if (cursor == list_end)
+        {
+            return false;
+        }
+
+        begin = cursor;
+        first_line = next_line;
+        for (std::size_t i {}; i < batch_lines && cursor != list_end; ++i)
+        {
+            const auto* newline {static_cast<const char*>(std::memchr(cursor, '\n', static_cast<std::size_t>(list_end - cursor)))};
+            cursor = newline == nullptr ? list_end : newline + 1;
+            ++next_line;
+        }
+        end = cursor;
+
+        return true;
+    };
+
+    auto worker = [&]() {
+        verify_result totals;
+        try
+        {
+            std::unique_ptr<std::uint8_t[]> buffer {new std::uint8_t[buffer_size]};
+            std::string path;
+            digest_type expected {};
+
+            auto report = [&](std::size_t line, verify_status status, const std::error_code& ec) {
+                std::lock_guard<std::mutex> lock(callback_mutex);
+                callback(verify_failure{line, status == verify_status::malformed ? std::string{} : path, status, ec});
+            };
+
+            const char* begin {};
+            const char* end {};
+            std::size_t line {};
+            while (!stop.load(std::memory_order_relaxed) && take_batch(begin, end, line))
+            {
+                for (auto p {begin}; p != end; ++line)
+                {
+                    const auto* newline {static_cast<const char*>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)))};
+                    const auto* line_end {newline == nullptr ? end : newline};
+                    const auto* next {newline == nullptr ? end : newline + 1};
+
+                    if (line_end != p && *(line_end - 1) == '\r')
+                    {
+                        --line_end;
+                    }
+
+                    if (line_end == p || *p == '#')
+                    {
+                        p = next;
+                        continue;
+                    }
+
+                    if (!detail::verify_parse_line(p, line_end, tag, expected, path))
+                    {
+                        ++totals.malformed;
+                        report(line, verify_status::malformed, std::error_code{});
+                        p = next;
+                        continue;
+                    }
+                    p = next;
+
+                    Hasher hasher {};
+                    const auto ec {detail::hash_one_file(path, hasher, buffer.get(), buffer_size)};
+                    if (ec)
+                    {
+                        ++totals.unreadable;
+                        report(line, verify_status::unreadable, ec);
+                    }
+                    else if (!detail::verify_digest_equal(hasher.get_digest(), expected))
+                    {
+                        ++totals.mismatched;
+                        report(line, verify_status::mismatch, std::error_code{});
+                    }
+                    else
+                    {
+                        ++totals.verified;
+                    }
+                }
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(callback_mutex);
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+            stop.store(true, std::memory_order_relaxed);
+        }
+
+        std::lock_guard<std::mutex> lock(callback_mutex);
+        result.verified += totals.verified;
+        result.mismatched += totals.mismatched;
+        result.unreadable += totals.unreadable;
+        result.malformed += totals.malformed;
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1U);
+    try
+    {
+        for (std::size_t i {1U}; i < thread_count; ++i)
+        {
+            threads.emplace_back(worker);
+        }
+    }
+    catch (...)
+    {
+        // Could not start as many threads as requested, so carry on with the ones we have
+    }
+
+    worker();
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+
+    return result;
+}
+
+} // namespace utility
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#endif // BOOST_CRYPT_UTILITY_VERIFY_HPP
@@ -0,0 +1,1004 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// Keeps a manifest of the digests of every file under a directory current by watching it with inotify(7)
+
+#ifndef BOOST_CRYPT_UTILITY_WATCH_HPP
+#define BOOST_CRYPT_UTILITY_WATCH_HPP
+
+#include <boost/crypt/utility/config.hpp>
+#include <boost/crypt/utility/posix_config.hpp>
+#include <boost/crypt/utility/digest_cache.hpp>
+#include <boost/crypt/utility/multi_file.hpp>
+#include <boost/crypt/utility/posix_file.hpp>
+#include <boost/crypt/utility/thread_pool.hpp>
+#include <boost/crypt/utility/tree.hpp>
+
+#ifdef BOOST_CRYPT_HAS_INOTIFY
+
+#ifndef BOOST_CRYPT_BUILD_MODULE
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+namespace boost {
+namespace crypt {
+namespace utility {
+
+// How long a file has to go without being written before it is hashed
+BOOST_CRYPT_INLINE_CONSTEXPR std::uint32_t default_watch_debounce_ms {100U};
+
+struct watch_options
+{
+    // Threads that hash changed files. 0 uses one per hardware thread
+    std::size_t thread_count {};
+
+    // A file is hashed once it has not been written for this long, or at the latest ten times this long after
+    // its first unhashed write, so that a file written continuously is still hashed now and then
+    std::uint32_t debounce_ms {default_watch_debounce_ms};
+
+    // If not empty, a digest_cache that the digests are also kept in, so that starting to watch a tree again
+    // only reads the files that changed in between
+    std::string cache_path;
+
+    // If not empty, the manifest is written here in the format of md5sum whenever the watcher is idle after a change
+    std::string manifest_path;
+
+    // Size of the read buffer of each thread
+    std::size_t buffer_size {default_multi_file_buffer_size};
+};
+
+namespace detail {
+
+BOOST_CRYPT_INLINE_CONSTEXPR std::uint32_t watch_directory_mask {IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE | IN_DELETE |
+                                                                IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR |
+                                                                IN_DONT_FOLLOW | IN_EXCL_UNLINK};
+
+// Size of the buffer that inotify events are read into, which holds at least a hundred events with the longest names
+BOOST_CRYPT_INLINE_CONSTEXPR std::size_t watch_event_buffer_size {65536U};
+
+inline auto watch_join(const std::string& root, const std::string& path) -> std::string
+{
+    return path.empty() ? root : root + '/' + path;
+}
+
+inline auto watch_has_prefix(const std::string& path, const std::string& directory) noexcept -> bool
+{
+    return path.size() > directory.size() && path[directory.size()] == '/' && path.compare(0U, directory.size(), directory) == 0;
+}
+
+template <typename Digest>
+auto watch_digest_equal(const Digest& lhs, const Digest& rhs) noexcept -> bool
+{
+    for (std::size_t i {}; i < lhs.size(); ++i)
+    {
+        if (lhs[i] != rhs[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// A line of md5sum output, which starts with a backslash when the name has to be escaped
+template <typename Digest>
+auto watch_manifest_line(const std::string& path, const Digest& digest, std::string& line) -> void
+{
+    const char* digits {"0123456789abcdef"};
+    const bool escape {path.find_first_of("\\\n\r") != std::string::npos};
+
+    line.clear();
+    if (escape)
+    {
+        line.push_back('\\');
+    }
+    for (std::size_t i {}; i < digest.size(); ++i)
+    {
+        line.push_back(digits[digest[i] >> 4U]);
+        line.push_back(digits[digest[i] & 0x0FU]);
+    }
+    line += "  ";
+
+    for (const char c : path)
+    {
+        switch (c)
+        {
+            case '\\':
+                line += "\\\\";
+                break;
+            case '\n':
+                line += "\\n";
+                break;
+            case '\r':
+                line += "\\r";
+                break;
+            default:
+                line.push_back(c);
+        }
+    }
+    line.push_back('\n');
+}
+
+// A file the watcher writes itself, by the identity of its directory and its name, so that writing it
+// inside the tree does not look like a change to the tree. With prefix, any name starting with name matches
+struct watch_own_file
+{
+    ::dev_t dev;
+    ::ino_t ino;
+    std::string name;
+    bool prefix;
+};
+
+inline auto watch_add_own_file(const std::string& path, bool prefix, std::vector<watch_own_file>& own_files) -> void
+{
+    const auto slash {path.rfind('/')};
+    const auto directory {slash == std::string::npos ? std::string{"."} : (slash == 0U ? std::string{"/"} : path.substr(0U, slash))};
+
+    // A directory that does not exist can not be in the tree
+    struct stat st {};
+    if (!path.empty() && ::stat(directory.c_str(), &st) == 0)
+    {
+        own_files.push_back({st.st_dev, st.st_ino, slash == std::string::npos ? path : path.substr(slash + 1U), prefix});
+    }
+}
+
+} // namespace detail
+
+// Watches every directory under root with inotify(7), and keeps the digest of every regular file under it in memory.
+// Writes are debounced, and only the files that were written, created, or moved in are hashed again, on a pool of
+// threads, so once the initial scan is done the cost follows the rate of change rather than the size of the tree.
+// Queries are answered from memory without touching the disk.
+// Subdirectories that are created or moved in are scanned and watched in turn, and if the kernel's event queue
+// overflows the whole tree is scanned again, which is cheap with a cache since only changed files are read.
+// Paths are relative to root, and symbolic links and special files are skipped, as hash_tree does
+template <typename Hasher>
+class tree_watcher
+{
+public:
+    using digest_type = decltype(std::declval<Hasher&>().get_digest());
+
+    struct entry
+    {
+        std::string path;
+        std::uint64_t size;
+        digest_type digest;
+
+        // Why the file could not be read, in which case the digest is all zeros
+        std::error_code ec;
+    };
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct file_state
+    {
+        std::uint64_t size;
+        digest_type digest;
+        std::error_code ec;
+    };
+
+    struct pending_file
+    {
+        clock::time_point first_due;
+        clock::time_point due;
+    };
+
+    std::string root_;
+    watch_options options_;
+    std::chrono::milliseconds debounce_;
+    digest_cache<digest_type{}.size()> cache_;
+
+    int inotify_fd_ {-1};
+    int wake_fd_ {-1};
+
+    // Only used by the thread reading events, and the constructor before it starts
+    std::unordered_map<int, std::string> directories_;
+
+    // The manifest, its temporary files and the cache, and the watched directories they are in
+    std::vector<detail::watch_own_file> own_files_;
+    std::unordered_map<int, std::pair<::dev_t, ::ino_t>> own_directories_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    std::unordered_map<std::string, file_state> files_;
+    std::unordered_map<std::string, pending_file> pending_;
+    std::unordered_set<std::string> in_flight_;
+    std::uint64_t generation_ {};
+    std::uint64_t sync_requested_ {};
+    std::uint64_t sync_done_ {};
+    bool manifest_stale_ {};
+    bool running_ {};
+    std::error_code error_;
+
+    std::atomic<bool> stopping_ {false};
+    std::vector<std::unique_ptr<std::uint8_t[]>> buffers_;
+
+    // Declared after everything their tasks use
+    std::unique_ptr<work_stealing_pool> pool_;
+    std::thread thread_;
+
+    auto note_error(int error) -> void
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_)
+        {
+            error_.assign(error, std::system_category());
+        }
+    }
+
+    auto own_file(int wd, const char* name) const -> bool
+    {
+        const auto it {own_directories_.find(wd)};
+        if (it == own_directories_.end())
+        {
+            return false;
+        }
+
+        for (const auto& own : own_files_)
+        {
+            if (own.dev == it->second.first && own.ino == it->second.second &&
+                (own.prefix ? std::strncmp(name, own.name.c_str(), own.name.size()) == 0 : own.name == name))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    auto wake() noexcept -> void
+    {
+        const std::uint64_t one {1U};
+        static_cast<void>(::write(wake_fd_, &one, sizeof(one)));
+    }
+
+    // Must be called with mutex_ held
+    auto mark_pending(const std::string& path, clock::time_point due) -> void
+    {
+        const auto it {pending_.find(path)};
+        if (it == pending_.end())
+        {
+            pending_.emplace(path, pending_file{due, due});
+        }
+        else
+        {
+            it->second.due = (std::min)(due, it->second.first_due + 10 * debounce_);
+        }
+    }
+
+    // Watches the directory and everything under it, and marks the files in it to be hashed.
+    // The watch is added before the directory is listed, so a file created in between is reported by an event
+    auto scan(const std::string& directory, std::unordered_set<std::string>* seen) -> void
+    {
+        std::vector<std::string> directories {directory};
+        std::vector<std::string> files;
+        std::vector<char> listing(detail::tree_listing_buffer_size);
+
+        while (!directories.empty())
+        {
+            const auto path {std::move(directories.back())};
+            directories.pop_back();
+
+            const auto full_path {detail::watch_join(root_, path)};
+            const auto wd {::inotify_add_watch(inotify_fd_, full_path.c_str(), detail::watch_directory_mask)};
+            if (wd < 0)
+            {
+                // Removed or replaced since it was listed, which its parent's events report
+                if (errno != ENOENT && errno != ENOTDIR)
+                {
+                    note_error(errno);
+                }
+                continue;
+            }
+            directories_[wd] = path;
+
+            int fd {};
+            do
+            {
+                fd = ::open(full_path.c_str(), detail::open_read_flags | O_DIRECTORY | O_NOFOLLOW);
+            } while (fd < 0 && errno == EINTR);
+
+            if (fd < 0)
+            {
+                continue;
+            }
+
+            const detail::tree_fd directory_fd {fd};
+            struct stat st {};
+            if (!own_files_.empty() && ::fstat(fd, &st) == 0)
+            {
+                for (const auto& own : own_files_)
+                {
+                    if (own.dev == st.st_dev && own.ino == st.st_ino)
+                    {
+                        own_directories_[wd] = std::make_pair(st.st_dev, st.st_ino);
+                    }
+                }
+            }
+
+            files.clear();
+            const auto error {detail::tree_list_directory(fd, listing, [&](const char* name, detail::tree_entry_kind kind) {
+                if (own_file(wd, name))
+                {
+                    return;
+                }
+
+                if (kind == detail::tree_entry_kind::unknown)
+                {
+                    kind = detail::tree_stat_kind(fd, name);
+                }
+
+                if (kind == detail::tree_entry_kind::directory)
+                {
+                    directories.push_back(detail::tree_join(path, name));
+                }
+                else if (kind == detail::tree_entry_kind::file)
+                {
+                    files.push_back(detail::tree_join(path, name));
+                }
+            })};
+
+            if (error != 0)
+            {
+                note_error(error);
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            const auto now {clock::now()};
+            for (auto& file : files)
+            {
+                mark_pending(file, now);
+                if (seen != nullptr)
+                {
+                    seen->insert(std::move(file));
+                }
+            }
+        }
+    }
+
+    // A file that is being hashed as it goes is hashed again, which finds it missing and removes it
+    auto forget_file(const std::string& path) -> void
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (files_.erase(path) != 0U)
+        {
+            ++generation_;
+            manifest_stale_ = true;
+        }
+
+        if (in_flight_.count(path) != 0U)
+        {
+            mark_pending(path, clock::now());
+        }
+        else
+        {
+            pending_.erase(path);
+        }
+    }
+
+    auto forget_directory(const std::string& directory) -> void
+    {
+        for (auto it {directories_.begin()}; it != directories_.end();)
+        {
+            if (it->second == directory || detail::watch_has_prefix(it->second, directory))
+            {
+                static_cast<void>(::inotify_rm_watch(inotify_fd_, it->first));
+                own_directories_.erase(it->first);
+                it = directories_.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto now {clock::now()};
+        for (auto it {files_.begin()}; it != files_.end();)
+        {
+            if (detail::watch_has_prefix(it->first, directory))
+            {
+                it = files_.erase(it);
+                ++generation_;
+                manifest_stale_ = true;
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        for (auto it {pending_.begin()}; it != pending_.end();)
+        {
+            if (detail::watch_has_prefix(it->first, directory) && in_flight_.count(it->first) == 0U)
+            {
+                it = pending_.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        for (const auto& path : in_flight_)
+        {
+            if (detail::watch_has_prefix(path, directory))
+            {
+                mark_pending(path, now);
+            }
+        }
+    }
+
+    // After the kernel dropped events nothing is known about what changed, so scan everything again
+    // and remove the files that are gone
+    auto rescan() -> void
+    {
+        std::unordered_set<std::string> seen;
+        scan(std::string{}, &seen);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it {files_.begin()}; it != files_.end();)
+        {
+            if (seen.count(it->first) == 0U && pending_.count(it->first) == 0U)
+            {
+                it = files_.erase(it);
+                ++generation_;
+                manifest_stale_ = true;
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    auto read_events() -> void
+    {
+        alignas(struct inotify_event) char buffer[detail::watch_event_buffer_size];
+        while (true)
+        {
+            const auto res {::read(inotify_fd_, buffer, sizeof(buffer))};
+            if (res < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                if (errno != EAGAIN)
+                {
+                    note_error(errno); // LCOV_EXCL_LINE
+                }
+                return;
+            }
+
+            const auto now {clock::now()};
+            std::size_t offset {};
+            while (offset < static_cast<std::size_t>(res))
+            {
+                const auto* event {reinterpret_cast<const struct inotify_event*>(buffer + offset)};
+                offset += sizeof(struct inotify_event) + event->len;
+
+                if ((event->mask & IN_Q_OVERFLOW) != 0U)
+                {
+                    rescan();
+                    continue;
+                }
+
+                const auto it {directories_.find(event->wd)};
+                if (it == directories_.end())
+                {
+                    continue;
+                }
+                if ((event->mask & IN_IGNORED) != 0U)
+                {
+                    own_directories_.erase(event->wd);
+                    directories_.erase(it);
+                    continue;
+                }
+                if (event->len == 0U || own_file(event->wd, event->name))
+                {
+                    continue;
+                }
+
+                const auto path {detail::tree_join(it->second, event->name)};
+                if ((event->mask & IN_ISDIR) != 0U)
+                {
+                    if ((event->mask & (IN_CREATE | IN_MOVED_TO)) != 0U)
+                    {
+                        scan(path, nullptr);
+                    }
+                    else if ((event->mask & (IN_DELETE | IN_MOVED_FROM)) != 0U)
+                    {
+                        forget_directory(path);
+                    }
+                }
+                else if ((event->mask & (IN_DELETE | IN_MOVED_FROM)) != 0U)
+                {
+                    forget_file(path);
+                }
+                else
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    mark_pending(path, now + debounce_);
+                }
+            }
+        }
+    }
+
+    auto hash(const std::string& path, std::uint8_t* buffer) -> void
+    {
+        file_state state {0U, digest_type{}, std::error_code{}};
+        bool keep {true};
+
+        try
+        {
+            // O_NONBLOCK keeps a FIFO from blocking the open, and it is then skipped as it is not a regular file
+            const auto full_path {detail::watch_join(root_, path)};
+            int fd {};
+            do
+            {
+                fd = ::open(full_path.c_str(), detail::open_read_flags | O_NOFOLLOW | O_NONBLOCK | O_NOCTTY);
+            } while (fd < 0 && errno == EINTR);
+
+            if (fd < 0)
+            {
+                // Gone again, or a symbolic link
+                keep = errno != ENOENT && errno != ELOOP;
+                state.ec.assign(errno, std::system_category());
+            }
+            else
+            {
+                const detail::tree_fd file {fd};
+                struct timespec now {};
+                static_cast<void>(::clock_gettime(CLOCK_REALTIME, &now));
+
+                file_key before {};
+                file_key after {};
+                bool regular {};
+                auto error {detail::fstat_file_key(fd, before, regular)};
+                if (error == 0 && !regular)
+                {
+                    keep = false;
+                }
+                else if (error == 0 && !cache_.find(before, state.digest))
+                {
+                    Hasher hasher {};
+                    while (true)
+                    {
+                        const auto res {::read(fd, buffer, options_.buffer_size)};
+                        if (res > 0)
+                        {
+                            hasher.process_bytes(static_cast<const std::uint8_t*>(buffer), static_cast<std::size_t>(res));
+                        }
+                        else if (res == 0)
+                        {
+                            break;
+                        }
+                        else if (errno != EINTR)
+                        {
+                            error = errno;
+                            break;
+                        }
+                    }
+
+                    if (error == 0)
+                    {
+                        error = detail::fstat_file_key(fd, after, regular);
+                    }
+                    if (error == 0)
+                    {
+                        state.digest = hasher.get_digest();
+                        if (before == after && after.ctime_ns < detail::timespec_ns(now) - default_racy_window_ns)
+                        {
+                            static_cast<void>(cache_.insert(after, state.digest));
+                        }
+                    }
+                }
+
+                state.size = before.size;
+                if (error != 0)
+                {
+                    state = file_state{0U, digest_type{}, std::error_code(error, std::system_category())};
+                }
+            }
+        }
+        catch (const std::exception&)
+        {
+            state = file_state{0U, digest_type{}, std::make_error_code(std::errc::not_enough_memory)};
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        in_flight_.erase(path);
+
+        // Only a file whose digest, size or error changed makes the manifest change
+        bool changed {};
+        const auto it {files_.find(path)};
+        if (keep && it == files_.end())
+        {
+            files_.emplace(path, state);
+            changed = true;
+        }
+        else if (keep)
+        {
+            changed = it->second.size != state.size || it->second.ec != state.ec || !detail::watch_digest_equal(it->second.digest, state.digest);
+            it->second = state;
+        }
+        else if (it != files_.end())
+        {
+            files_.erase(it);
+            changed = true;
+        }
+
+        if (changed)
+        {
+            ++generation_;
+            manifest_stale_ = true;
+        }
+
+        changed_.notify_all();
+        wake();
+    }
+
+    // Hands the files that are due to the pool, and returns how long until the next one is due, or -1 if none are
+    auto submit_due() -> int
+    {
+        std::vector<std::string> due;
+        auto next {clock::time_point::max()};
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const auto now {clock::now()};
+            for (auto it {pending_.begin()}; it != pending_.end();)
+            {
+                // A file that is still being hashed is hashed again once that finishes
+                if (in_flight_.count(it->first) != 0U)
+                {
+                    ++it;
+                }
+                else if (it->second.due <= now)
+                {
+                    in_flight_.insert(it->first);
+                    due.push_back(it->first);
+                    it = pending_.erase(it);
+                }
+                else
+                {
+                    next = (std::min)(next, it->second.due);
+                    ++it;
+                }
+            }
+        }
+
+        for (auto& path : due)
+        {
+            pool_->submit([this, path]() {
+                hash(path, buffers_[pool_->current_worker()].get());
+            });
+        }
+
+        if (next == clock::time_point::max())
+        {
+            return -1;
+        }
+
+        const auto wait {std::chrono::duration_cast<std::chrono::milliseconds>(next - clock::now()).count()};
+        return wait < 0 ? 0 : static_cast<int>(wait) + 1;
+    }
+
+    auto idle() const -> bool
+    {
+        return pending_.empty() && in_flight_.empty();
+    }
+
+    auto save_manifest() -> void
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!manifest_stale_ || !idle())
+            {
+                return;
+            }
+            manifest_stale_ = false;
+        }
+
+        const auto temp_path {options_.manifest_path + ".tmp." + std::to_string(static_cast<long>(::getpid()))};
+        std::FILE* file {std::fopen(temp_path.c_str(), "wb")};
+        if (file == nullptr)
+        {
+            note_error(errno);
+            return;
+        }
+
+        std::string line;
+        bool written {true};
+        for (const auto& e : manifest())
+        {
+            if (!e.ec)
+            {
+                detail::watch_manifest_line(e.path, e.digest, line);
+                written = written && std::fwrite(line.data(), 1U, line.size(), file) == line.size();
+            }
+        }
+
+        written = std::fclose(file) == 0 && written;
+        if (!written || std::rename(temp_path.c_str(), options_.manifest_path.c_str()) != 0)
+        {
+            note_error(errno != 0 ? errno : EIO);
+            static_cast<void>(std::remove(temp_path.c_str()));
+        }
+    }
+
+    auto run() -> void
+    {
+        try
+        {
+            while (!stopping_.load())
+            {
+                std::uint64_t sync {};
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    sync = sync_requested_;
+                }
+
+                // Events queued before a sync was requested are read before it is acknowledged
+                read_events();
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    sync_done_ = sync;
+                }
+                changed_.notify_all();
+
+                const auto timeout {submit_due()};
+                if (timeout < 0 && !options_.manifest_path.empty())
+                {
+                    save_manifest();
+                }
+
+                struct pollfd fds[2] {{inotify_fd_, POLLIN, 0}, {wake_fd_, POLLIN, 0}};
+                if (::poll(fds, 2U, timeout) > 0 && (fds[1].revents & POLLIN) != 0)
+                {
+                    std::uint64_t count {};
+                    static_cast<void>(::read(wake_fd_, &count, sizeof(count)));
+                }
+            }
+        }
+        catch (const std::exception&)
+        {
+            note_error(ENOMEM);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+        changed_.notify_all();
+    }
+
+    auto close_descriptors() noexcept -> void
+    {
+        if (inotify_fd_ >= 0)
+        {
+            ::close(inotify_fd_);
+            inotify_fd_ = -1;
+        }
+        if (wake_fd_ >= 0)
+        {
+            ::close(wake_fd_);
+            wake_fd_ = -1;
+        }
+    }
+
+public:
+    // Scans root and starts watching it. The files found are hashed in the background, so call wait_idle()
+    // for the manifest to be complete. On failure ec is set and the watcher is empty
+    tree_watcher(const std::string& root, std::error_code& ec, const watch_options& options = watch_options{})
+        : root_ {root}, options_ {options}, debounce_ {options.debounce_ms}
+    {
+        if (options_.buffer_size == 0U)
+        {
+            options_.buffer_size = default_multi_file_buffer_size;
+        }
+
+        inotify_fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        wake_fd_ = inotify_fd_ < 0 ? -1 : ::eventfd(0U, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wake_fd_ < 0)
+        {
+            ec.assign(errno, std::system_category());
+            close_descriptors();
+            return;
+        }
+
+        struct stat st {};
+        if (::stat(root_.c_str(), &st) != 0)
+        {
+            ec.assign(errno, std::system_category());
+            close_descriptors();
+            return;
+        }
+        if (!S_ISDIR(st.st_mode))
+        {
+            ec = std::make_error_code(std::errc::not_a_directory);
+            close_descriptors();
+            return;
+        }
+
+        // The files written by the watcher are left out, or writing them would start another round of hashing
+        if (!options_.manifest_path.empty())
+        {
+            detail::watch_add_own_file(options_.manifest_path, false, own_files_);
+            detail::watch_add_own_file(options_.manifest_path + ".tmp.", true, own_files_);
+        }
+        detail::watch_add_own_file(options_.cache_path, false, own_files_);
+
+        // A cache that can not be opened only means that every file is read when watching starts
+        if (!options_.cache_path.empty())
+        {
+            static_cast<void>(cache_.open(options_.cache_path));
+        }
+
+        try
+        {
+            scan(std::string{}, nullptr);
+
+            pool_.reset(new work_stealing_pool(options_.thread_count));
+            for (std::size_t i {}; i < pool_->thread_count(); ++i)
+            {
+                buffers_.emplace_back(new std::uint8_t[options_.buffer_size]);
+            }
+
+            running_ = true;
+            thread_ = std::thread([this]() { run(); });
+        }
+        catch (...)
+        {
+            running_ = false;
+            pool_.reset();
+            close_descriptors();
+            throw;
+        }
+
+        ec.clear();
+    }
+
+    tree_watcher(const tree_watcher&) = delete;
+    auto operator=(const tree_watcher&) -> tree_watcher& = delete;
+
+    // Stops watching once the files being hashed are done, and writes the manifest if it changed.
+    // The manifest in memory can still be queried afterwards
+    auto stop() -> void
+    {
+        if (!thread_.joinable())
+        {
+            return;
+        }
+
+        stopping_.store(true);
+        wake();
+        thread_.join();
+        pool_->wait();
+
+        if (!options_.manifest_path.empty())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                pending_.clear();
+            }
+            save_manifest();
+        }
+
+        close_descriptors();
+    }
+
+    ~tree_watcher()
+    {
+        try
+        {
+            stop();
+        }
+        catch (...) // LCOV_EXCL_LINE
+        {
+            close_descriptors(); // LCOV_EXCL_LINE
+        }
+    }
+
+    // Waits until every change made before the call has been hashed, or timeout_ms has passed.
+    // Returns false on a timeout, or if the watcher has stopped
+    auto wait_idle(std::uint32_t timeout_ms) -> bool
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!running_)
+        {
+            return false;
+        }
+
+        const auto sync {++sync_requested_};
+        wake();
+        return changed_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&] {
+            return !running_ || (sync_done_ >= sync && idle());
+        }) && running_;
+    }
+
+    // Sets found and returns true if path, relative to root, is a regular file in the manifest
+    auto find(const std::string& path, entry& found) const -> bool
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it {files_.find(path)};
+        if (it == files_.end())
+        {
+            return false;
+        }
+
+        found = entry{it->first, it->second.size, it->second.digest, it->second.ec};
+        return true;
+    }
+
+    // Every file currently in the manifest, sorted by path
+    auto manifest() const -> std::vector<entry>
+    {
+        std::vector<entry> entries;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            entries.reserve(files_.size());
+            for (const auto& file : files_)
+            {
+                entries.push_back(entry{file.first, file.second.size, file.second.digest, file.second.ec});
+            }
+        }
+
+        std::sort(entries.begin(), entries.end(), [](const entry& lhs, const entry& rhs) {
+            return lhs.path < rhs.path;
+        });
+
+        return entries;
+    }
+
+    auto size() const -> std::size_t
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return files_.size();
+    }
+
+    // Increases every time a file is added, changed, or removed, so a consumer can tell whether anything changed
+    auto generation() const -> std::uint64_t
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return generation_;
+    }
+
+    // The first error that might leave the manifest incomplete, such as running out of inotify watches (ENOSPC),
+    // a directory that could not be listed, or a manifest file that could not be written
+    auto error() const -> std::error_code
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return error_;
+    }
+};
+
+} // namespace utility
+} // namespace crypt
+} // namespace boost
+
+#endif // BOOST_CRYPT_HAS_INOTIFY
+
+#endif // BOOST_CRYPT_UTILITY_WATCH_HPP
@@ -0,0 +1,1239 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// Measures the throughput of md5_file and the underlying file readers.
+//
+// To run the benchmarks:
+//   b2 cxxstd=17 toolset=gcc define=BOOST_CRYPT_RUN_BENCHMARKS benchmark_md5_file -a release
+//
+// The following environment variables can be used to adjust the run:
+//   BOOST_CRYPT_BENCH_DIR      - Directory in which the test files are generated (default: current directory)
+//   BOOST_CRYPT_BENCH_MAX_SIZE - Largest file to generate in bytes (default: 256 MiB).
+//                                Set to e.g. 4294967296 to include the multi-GiB files.
+//   BOOST_CRYPT_BENCH_KEEP     - If set the generated files are not removed at the end of the run
+
+#if defined(BOOST_CRYPT_RUN_BENCHMARKS) && (defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__)))
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/hash/md5/file.hpp>
+#include <boost/crypt/hash/md5/pipe.hpp>
+#include <boost/crypt/hash/md5/copy_file.hpp>
+#include <boost/crypt/hash/md5/tar.hpp>
+#include <boost/crypt/hash/md5/pipeline.hpp>
+#include <boost/crypt/hash/md5/tree.hpp>
+#include <boost/crypt/hash/md5/dedup.hpp>
+#include <boost/crypt/hash/md5/digest_cache.hpp>
+#include <boost/crypt/hash/md5/sampled_file.hpp>
+#include <boost/crypt/hash/md5/records.hpp>
+#include <boost/crypt/hash/md5/incremental_file.hpp>
+#include <boost/crypt/hash/md5/verify.hpp>
+#include <boost/crypt/hash/md5/watch.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+namespace {
+
+constexpr std::uint64_t kib {1024U};
+constexpr std::uint64_t mib {1024U * kib};
+constexpr std::uint64_t gib {1024U * mib};
+
+struct bench_file
+{
+    std::string path;
+    std::uint64_t size;
+    bool sparse;
+};
+
+struct sample
+{
+    double wall_seconds;
+    double cpu_seconds;
+    std::uint64_t read_syscalls;
+    std::uint64_t bytes;
+};
+
+auto env_or(const char* name, const char* fallback) -> std::string
+{
+    const char* value {std::getenv(name)};
+    return value != nullptr ? std::string{value} : std::string{fallback};
+}
+
+// Number of read-like syscalls issued by this process so far.
+// Only available on Linux, elsewhere this always returns 0
+auto read_syscall_count() -> std::uint64_t
+{
+    std::ifstream io("/proc/self/io");
+    std::string key;
+    std::uint64_t value {};
+    while (io >> key >> value)
+    {
+        if (key == "syscr:")
+        {
+            return value;
+        }
+    }
+
+    return 0U;
+}
+
+auto cpu_time() -> double
+{
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+           static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// Cheap xorshift generator so that generating multi-GiB files is not the bottleneck
+auto fill_random(std::vector<char>& buffer, std::uint64_t& state) -> void
+{
+    for (auto& c : buffer)
+    {
+        state ^= state << 13U;
+        state ^= state >> 7U;
+        state ^= state << 17U;
+        c = static_cast<char>(state & 0xFFU);
+    }
+}
+
+auto generate_file(const bench_file& file) -> bool
+{
+    struct stat st {};
+    if (stat(file.path.c_str(), &st) == 0 && static_cast<std::uint64_t>(st.st_size) == file.size)
+    {
+        return true;
+    }
+
+    const int fd {open(file.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)};
+    if (fd < 0)
+    {
+        std::perror(file.path.c_str());
+        return false;
+    }
+
+    std::uint64_t state {0x9E3779B97F4A7C15ULL ^ file.size};
+    std::vector<char> buffer(static_cast<std::size_t>(std::min<std::uint64_t>(file.size, mib)));
+    bool ok {true};
+
+    if (file.sparse)
+    {
+        // Mostly holes: one block of data at the start and one in the middle
+        ok = ftruncate(fd, static_cast<off_t>(file.size)) == 0;
+        fill_random(buffer, state);
+        ok = ok && pwrite(fd, buffer.data(), buffer.size(), 0) == static_cast<ssize_t>(buffer.size());
+        if (file.size > 2U * buffer.size())
+        {
+            ok = ok && pwrite(fd, buffer.data(), buffer.size(), static_cast<off_t>(file.size / 2U)) == static_cast<ssize_t>(buffer.size());
+        }
+    }
+    else
+    {
+        std::uint64_t written {};
+        while (ok && written < file.size)
+        {
+            fill_random(buffer, state);
+            const auto chunk {static_cast<std::size_t>(std::min<std::uint64_t>(buffer.size(), file.size - written))};
+            ok = write(fd, buffer.data(), chunk) == static_cast<ssize_t>(chunk);
+            written += chunk;
+        }
+    }
+
+    ok = ok && fsync(fd) == 0;
+    close(fd);
+
+    if (!ok)
+    {
+        std::perror(file.path.c_str());
+    }
+
+    return ok;
+}
+
+// Best effort attempt to evict the file from the page cache without needing root.
+// Clean pages are dropped by the kernel on POSIX_FADV_DONTNEED
+auto drop_from_cache(const bench_file& file) -> void
+{
+    const int fd {open(file.path.c_str(), O_RDONLY)};
+    if (fd < 0)
+    {
+        return;
+    }
+
+    fdatasync(fd);
+    #ifdef POSIX_FADV_DONTNEED
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    #endif
+    close(fd);
+}
+
+auto warm_cache(const bench_file& file) -> void
+{
+    const int fd {open(file.path.c_str(), O_RDONLY)};
+    if (fd < 0)
+    {
+        return;
+    }
+
+    std::vector<char> buffer(static_cast<std::size_t>(mib));
+    while (read(fd, buffer.data(), buffer.size()) > 0)
+    {
+        // Touch every page
+    }
+    close(fd);
+}
+
+template <typename Func>
+auto measure(const std::vector<const bench_file*>& files, bool cold, Func&& hash_one) -> sample
+{
+    for (const auto* file : files)
+    {
+        cold ? drop_from_cache(*file) : warm_cache(*file);
+    }
+
+    std::uint64_t bytes {};
+    const auto syscalls_before {read_syscall_count()};
+    const auto cpu_before {cpu_time()};
+    const auto t0 {std::chrono::steady_clock::now()};
+
+    for (const auto* file : files)
+    {
+        const auto digest {hash_one(file->path)};
+        static_cast<void>(digest);
+        bytes += file->size;
+    }
+
+    const auto t1 {std::chrono::steady_clock::now()};
+    const auto cpu_after {cpu_time()};
+    const auto syscalls_after {read_syscall_count()};
+
+    return sample{std::chrono::duration<double>(t1 - t0).count(), cpu_after - cpu_before,
+                  syscalls_after - syscalls_before, bytes};
+}
+
+auto print_header() -> void
+{
+    std::cout << std::left
+              << std::setw(32) << "Method"
+              << std::setw(12) << "Size"
+              << std::setw(8)  << "Files"
+              << std::setw(7)  << "Cache"
+              << std::right
+              << std::setw(12) << "MB/s"
+              << std::setw(14) << "read calls"
+              << std::setw(8)  << "CPU %"
+              << '\n';
+}
+
+auto format_size(std::uint64_t size) -> std::string
+{
+    if (size >= gib && size % gib == 0U)
+    {
+        return std::to_string(size / gib) + " GiB";
+    }
+    if (size >= mib && size % mib == 0U)
+    {
+        return std::to_string(size / mib) + " MiB";
+    }
+
+    return std::to_string(size / kib) + " KiB";
+}
+
+auto print_sample(const std::string& method, const bench_file& file, std::size_t count, bool cold, const sample& s) -> void
+{
+    const auto mb_per_s {s.wall_seconds > 0 ? static_cast<double>(s.bytes) / 1e6 / s.wall_seconds : 0.0};
+    const auto cpu_pct {s.wall_seconds > 0 ? 100.0 * s.cpu_seconds / s.wall_seconds : 0.0};
+
+    std::cout << std::left
+              << std::setw(32) << method
+              << std::setw(12) << (format_size(file.size) + (file.sparse ? "*" : ""))
+              << std::setw(8)  << count
+              << std::setw(7)  << (cold ? "cold" : "warm")
+              << std::right << std::fixed
+              << std::setw(12) << std::setprecision(1) << mb_per_s
+              << std::setw(14) << s.read_syscalls
+              << std::setw(8)  << std::setprecision(0) << cpu_pct
+              << '\n';
+}
+
+template <std::size_t block_size>
+auto hash_with_file_reader(const std::string& path) -> boost::crypt::array<boost::crypt::uint8_t, 16>
+{
+    // Large block sizes do not fit on the stack
+    std::unique_ptr<boost::crypt::utility::file_reader<block_size>> reader {new boost::crypt::utility::file_reader<block_size>(path)};
+    return boost::crypt::detail::md5_file_impl(*reader);
+}
+
+template <std::size_t block_size>
+auto run_file_reader(const std::vector<const bench_file*>& files, bool cold) -> void
+{
+    const auto s {measure(files, cold, hash_with_file_reader<block_size>)};
+    print_sample("file_reader<" + std::to_string(block_size) + ">", *files.front(), files.size(), cold, s);
+}
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+auto run_posix_file_reader(const std::vector<const bench_file*>& files, bool cold, std::size_t buffer_size) -> void
+{
+    const auto s {measure(files, cold, [buffer_size](const std::string& path) {
+        boost::crypt::utility::posix_file_reader reader(path, buffer_size);
+        return boost::crypt::detail::md5_file_impl(reader);
+    })};
+    print_sample("posix_file_reader(" + std::to_string(buffer_size) + ")", *files.front(), files.size(), cold, s);
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+template <typename Func>
+auto run_method(const std::string& method, const std::vector<const bench_file*>& files, bool cold, Func&& func) -> void
+{
+    const auto s {measure(files, cold, func)};
+    print_sample(method, *files.front(), files.size(), cold, s);
+}
+
+auto run_all(const std::vector<const bench_file*>& files) -> void
+{
+    for (const bool cold : {true, false})
+    {
+        run_method("md5_file", files, cold, [](const std::string& path) { return boost::crypt::md5_file(path); });
+        run_file_reader<64U>(files, cold);
+        run_file_reader<4096U>(files, cold);
+        run_file_reader<65536U>(files, cold);
+        run_file_reader<1048576U>(files, cold);
+
+        run_method("md5_file_pipelined(2)", files, cold, [](const std::string& path) { return boost::crypt::md5_file_pipelined(path, 2U); });
+        run_method("md5_file_pipelined(8)", files, cold, [](const std::string& path) { return boost::crypt::md5_file_pipelined(path, 8U); });
+
+        #ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+        run_posix_file_reader(files, cold, 65536U);
+        run_posix_file_reader(files, cold, 1048576U);
+        run_posix_file_reader(files, cold, 4194304U);
+        run_method("md5_file(mmap)", files, cold, [](const std::string& path) { return boost::crypt::md5_file(path, boost::crypt::utility::read_mode::mmap); });
+        run_method("md5_file(automatic)", files, cold, [](const std::string& path) { return boost::crypt::md5_file(path, boost::crypt::utility::read_mode::automatic); });
+        run_method("md5_file(direct)", files, cold, [](const std::string& path) { return boost::crypt::md5_file(path, boost::crypt::utility::read_mode::direct); });
+        run_method("md5_file(scan)", files, cold, [](const std::string& path) { return boost::crypt::md5_file(path, boost::crypt::utility::read_mode::scan); });
+        #endif
+    }
+}
+
+// Percentage of the file's pages that are in the page cache, like fincore(1)
+auto cached_percent(const bench_file& file) -> double
+{
+    const int fd {open(file.path.c_str(), O_RDONLY)};
+    if (fd < 0 || file.size == 0U)
+    {
+        return 0.0;
+    }
+
+    const auto page {static_cast<std::size_t>(sysconf(_SC_PAGESIZE))};
+    const auto size {static_cast<std::size_t>(file.size)};
+    std::vector<unsigned char> resident((size + page - 1U) / page);
+
+    std::size_t count {};
+    void* addr {mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0)};
+    if (addr != MAP_FAILED)
+    {
+        #ifdef __linux__
+        const bool ok {mincore(addr, size, resident.data()) == 0};
+        #else
+        const bool ok {mincore(static_cast<char*>(addr), size, reinterpret_cast<char*>(resident.data())) == 0};
+        #endif
+
+        for (const auto page_state : resident)
+        {
+            count += ok ? (page_state & 1U) : 0U;
+        }
+        munmap(addr, size);
+    }
+    close(fd);
+
+    return 100.0 * static_cast<double>(count) / static_cast<double>(resident.size());
+}
+
+// Evicts the file, then caches its first half without any readahead into the second half
+auto cache_first_half(const bench_file& file) -> void
+{
+    drop_from_cache(file);
+
+    const int fd {open(file.path.c_str(), O_RDONLY)};
+    if (fd < 0)
+    {
+        return;
+    }
+
+    #ifdef POSIX_FADV_RANDOM
+    posix_fadvise(fd, 0, 0, POSIX_FADV_RANDOM);
+    #endif
+
+    std::vector<char> buffer(static_cast<std::size_t>(mib));
+    std::uint64_t offset {};
+    while (offset < file.size / 2U)
+    {
+        const auto len {static_cast<std::size_t>(std::min<std::uint64_t>(buffer.size(), file.size / 2U - offset))};
+        if (pread(fd, buffer.data(), len, static_cast<off_t>(offset)) <= 0)
+        {
+            break;
+        }
+        offset += len;
+    }
+    close(fd);
+}
+
+// A bulk integrity pass should leave the page cache as it found it.
+// Each file starts with its first half cached, and the residency is measured again after hashing it
+auto run_residency(const std::vector<bench_file>& files) -> void
+{
+    std::cout << "\nPage cache residency (% of the file cached before and after hashing)\n\n"
+              << std::left
+              << std::setw(32) << "Method"
+              << std::setw(12) << "Size"
+              << std::right
+              << std::setw(10) << "Before"
+              << std::setw(10) << "After"
+              << '\n';
+
+    using hash_func = boost::crypt::array<boost::crypt::uint8_t, 16> (*)(const std::string&);
+    const std::pair<const char*, hash_func> methods[] {
+        {"md5_file", [](const std::string& path) { return boost::crypt::md5_file(path); }},
+        #ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+        {"md5_file(mmap)", [](const std::string& path) { return boost::crypt::md5_file(path, boost::crypt::utility::read_mode::mmap); }},
+        {"md5_file(direct)", [](const std::string& path) { return boost::crypt::md5_file(path, boost::crypt::utility::read_mode::direct); }},
+        {"md5_file(scan)", [](const std::string& path) { return boost::crypt::md5_file(path, boost::crypt::utility::read_mode::scan); }},
+        #endif
+    };
+
+    for (const auto& file : files)
+    {
+        if (file.sparse || file.size < 16U * mib)
+        {
+            continue;
+        }
+
+        for (const auto& method : methods)
+        {
+            cache_first_half(file);
+            const auto before {cached_percent(file)};
+            const auto digest {method.second(file.path)};
+            static_cast<void>(digest);
+            const auto after {cached_percent(file)};
+
+            std::cout << std::left
+                      << std::setw(32) << method.first
+                      << std::setw(12) << format_size(file.size)
+                      << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(10) << before
+                      << std::setw(10) << after
+                      << '\n';
+        }
+    }
+}
+
+// Scanning trees where many files have vanished spends most of its time failing to open them
+auto run_missing_files(const std::string& dir) -> void
+{
+    constexpr std::size_t count {100000U};
+    const auto path {dir + "/md5_bench_missing.bin"};
+    std::remove(path.c_str());
+
+    std::cout << "\nMissing files (" << count << " calls)\n\n";
+
+    auto time_calls = [&](const char* name, auto&& func) {
+        const auto t0 {std::chrono::steady_clock::now()};
+        for (std::size_t i {}; i < count; ++i)
+        {
+            static_cast<void>(func());
+        }
+        const auto t1 {std::chrono::steady_clock::now()};
+        std::cout << std::left << std::setw(32) << name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(10) << std::chrono::duration<double, std::nano>(t1 - t0).count() / static_cast<double>(count)
+                  << " ns/call\n";
+    };
+
+    time_calls("md5_file", [&]() { return boost::crypt::md5_file(path); });
+
+    std::error_code ec;
+    time_calls("md5_file(error_code)", [&]() { return boost::crypt::md5_file(path, ec); });
+}
+
+// Writes size bytes into fd from another thread, then closes it, like the producer in tar c | hasher
+auto start_producer(int fd, std::uint64_t size) -> std::thread
+{
+    return std::thread([fd, size]() {
+        std::vector<char> buffer(4U * static_cast<std::size_t>(mib));
+        std::uint64_t state {0x243F6A8885A308D3ULL};
+        fill_random(buffer, state);
+
+        std::uint64_t written {};
+        while (written < size)
+        {
+            const auto len {static_cast<std::size_t>(std::min<std::uint64_t>(buffer.size(), size - written))};
+            const auto res {write(fd, buffer.data(), len)};
+            if (res <= 0)
+            {
+                break;
+            }
+            written += static_cast<std::uint64_t>(res);
+        }
+        close(fd);
+    });
+}
+
+auto print_pipe_rate(const char* name, std::uint64_t size, double seconds) -> void
+{
+    std::cout << std::left << std::setw(32) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(10) << static_cast<double>(size) / seconds / static_cast<double>(gib) << " GiB/s\n";
+}
+
+// Throughput of hashing a stream arriving through a pipe, against md5sum reading the same stream
+auto run_pipe(std::uint64_t size) -> void
+{
+    std::cout << "\nPipe throughput (" << format_size(size) << " streamed through a pipe)\n\n";
+
+    {
+        int fds[2] {};
+        if (pipe(fds) != 0)
+        {
+            return;
+        }
+        auto producer {start_producer(fds[1], size)};
+        const auto t0 {std::chrono::steady_clock::now()};
+        static_cast<void>(boost::crypt::md5_pipe(fds[0]));
+        const auto t1 {std::chrono::steady_clock::now()};
+        producer.join();
+        close(fds[0]);
+        print_pipe_rate("md5_pipe", size, std::chrono::duration<double>(t1 - t0).count());
+    }
+
+    {
+        int in[2] {};
+        int out[2] {};
+        if (pipe(in) != 0 || pipe(out) != 0)
+        {
+            return;
+        }
+        auto producer {start_producer(in[1], size)};
+        std::thread consumer([fd = out[0]]() {
+            std::vector<char> buffer(static_cast<std::size_t>(mib));
+            while (read(fd, buffer.data(), buffer.size()) > 0)
+            {
+            }
+        });
+
+        const auto t0 {std::chrono::steady_clock::now()};
+        static_cast<void>(boost::crypt::md5_pipe_through(in[0], out[1]));
+        const auto t1 {std::chrono::steady_clock::now()};
+        close(out[1]);
+        producer.join();
+        consumer.join();
+        close(in[0]);
+        close(out[0]);
+        print_pipe_rate("md5_pipe_through", size, std::chrono::duration<double>(t1 - t0).count());
+    }
+
+    {
+        int fds[2] {};
+        if (pipe(fds) != 0)
+        {
+            return;
+        }
+
+        const auto t0 {std::chrono::steady_clock::now()};
+        const auto pid {fork()};
+        if (pid == 0)
+        {
+            dup2(fds[0], STDIN_FILENO);
+            close(fds[0]);
+            close(fds[1]);
+            const int null_fd {open("/dev/null", O_WRONLY)};
+            dup2(null_fd, STDOUT_FILENO);
+            execlp("md5sum", "md5sum", static_cast<char*>(nullptr));
+            _exit(127);
+        }
+        close(fds[0]);
+
+        auto producer {start_producer(fds[1], size)};
+        producer.join();
+        int status {};
+        waitpid(pid, &status, 0);
+        const auto t1 {std::chrono::steady_clock::now()};
+
+        if (pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0)
+        {
+            print_pipe_rate("md5sum", size, std::chrono::duration<double>(t1 - t0).count());
+        }
+    }
+}
+
+// Throughput of copying a cold file with md5_copy_file, against copying it and then hashing the copy
+auto run_copy(const bench_file& file) -> void
+{
+    std::cout << "\nCopy and hash (" << format_size(file.size) << ", source evicted from the page cache)\n\n";
+
+    const auto to {file.path + ".copy"};
+    const bench_file copy {to, file.size, false};
+
+    {
+        drop_from_cache(file);
+        const auto t0 {std::chrono::steady_clock::now()};
+        const int in {open(file.path.c_str(), O_RDONLY)};
+        const int out {open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600)};
+        std::vector<char> buffer(static_cast<std::size_t>(mib));
+        ssize_t res {};
+        while (in >= 0 && out >= 0 && (res = read(in, buffer.data(), buffer.size())) > 0)
+        {
+            if (write(out, buffer.data(), static_cast<std::size_t>(res)) != res)
+            {
+                break;
+            }
+        }
+        close(in);
+        close(out);
+        static_cast<void>(boost::crypt::md5_file(to));
+        const auto t1 {std::chrono::steady_clock::now()};
+        print_pipe_rate("read/write, then md5_file", file.size, std::chrono::duration<double>(t1 - t0).count());
+    }
+
+    for (const auto mode : {boost::crypt::utility::copy_mode::buffered, boost::crypt::utility::copy_mode::direct})
+    {
+        drop_from_cache(file);
+        drop_from_cache(copy);
+        const auto t0 {std::chrono::steady_clock::now()};
+        static_cast<void>(boost::crypt::md5_copy_file(file.path, to, boost::crypt::utility::copy_sync::none, mode));
+        const auto t1 {std::chrono::steady_clock::now()};
+        print_pipe_rate(mode == boost::crypt::utility::copy_mode::direct ? "md5_copy_file(direct)" : "md5_copy_file",
+                        file.size, std::chrono::duration<double>(t1 - t0).count());
+    }
+
+    std::remove(to.c_str());
+}
+
+// Throughput of hashing every entry of a tar archive, against hashing the archive as a single file
+auto run_tar(const std::vector<bench_file>& files, const std::string& dir) -> void
+{
+    const auto archive {dir + "/md5_bench.tar"};
+    std::string command {"tar -cf " + archive};
+    std::uint64_t size {};
+    std::size_t count {};
+    for (const auto& file : files)
+    {
+        if (!file.sparse)
+        {
+            command += " " + file.path;
+            size += file.size;
+            ++count;
+        }
+    }
+    if (std::system((command + " 2>/dev/null").c_str()) != 0)
+    {
+        return;
+    }
+
+    std::cout << "\nTar archive (" << format_size(size) << " in " << count << " entries, warm cache)\n\n";
+
+    const bench_file tar {archive, size, false};
+    warm_cache(tar);
+
+    {
+        const auto t0 {std::chrono::steady_clock::now()};
+        static_cast<void>(boost::crypt::md5_tar(archive, [](const boost::crypt::utility::tar_entry&, const boost::crypt::array<boost::crypt::uint8_t, 16>&) {}));
+        const auto t1 {std::chrono::steady_clock::now()};
+        print_pipe_rate("md5_tar", size, std::chrono::duration<double>(t1 - t0).count());
+    }
+
+    {
+        const auto t0 {std::chrono::steady_clock::now()};
+        static_cast<void>(boost::crypt::md5_file(archive));
+        const auto t1 {std::chrono::steady_clock::now()};
+        print_pipe_rate("md5_file(archive)", size, std::chrono::duration<double>(t1 - t0).count());
+    }
+
+    std::remove(archive.c_str());
+}
+
+// Throughput of producing a manifest of a directory tree, against a serial walk calling md5_file for each file
+auto run_tree(const std::string& dir) -> void
+{
+    constexpr std::size_t directories {64U};
+    constexpr std::size_t files_per_directory {256U};
+    const auto root {dir + "/md5_bench_tree"};
+
+    std::vector<bench_file> files;
+    std::uint64_t size {};
+    ::mkdir(root.c_str(), 0755);
+    for (std::size_t i {}; i < directories; ++i)
+    {
+        const auto directory {root + "/" + std::to_string(i)};
+        ::mkdir(directory.c_str(), 0755);
+        for (std::size_t j {}; j < files_per_directory; ++j)
+        {
+            files.push_back({directory + "/" + std::to_string(j) + ".bin", (4U + (i * j) % 29U) * kib, false});
+            size += files.back().size;
+            if (!generate_file(files.back()))
+            {
+                return;
+            }
+        }
+    }
+    for (const auto& file : files)
+    {
+        warm_cache(file);
+    }
+
+    std::cout << "\nDirectory tree (" << format_size(size) << " in " << files.size() << " files, warm cache)\n\n";
+
+    {
+        std::size_t count {};
+        std::function<void(const std::string&)> walk = [&](const std::string& path) {
+            DIR* d {::opendir(path.c_str())};
+            if (d == nullptr)
+            {
+                return;
+            }
+            while (const auto* entry {::readdir(d)})
+            {
+                const std::string name {entry->d_name};
+                if (name == "." || name == "..")
+                {
+                    continue;
+                }
+                if (entry->d_type == DT_DIR)
+                {
+                    walk(path + "/" + name);
+                }
+                else
+                {
+                    static_cast<void>(boost::crypt::md5_file(path + "/" + name));
+                    ++count;
+                }
+            }
+            ::closedir(d);
+        };
+
+        const auto t0 {std::chrono::steady_clock::now()};
+        walk(root);
+        const auto t1 {std::chrono::steady_clock::now()};
+        print_pipe_rate("serial walk + md5_file", size, std::chrono::duration<double>(t1 - t0).count());
+    }
+
+    {
+        std::error_code ec;
+        const auto t0 {std::chrono::steady_clock::now()};
+        const auto manifest {boost::crypt::md5_tree(root, ec)};
+        const auto t1 {std::chrono::steady_clock::now()};
+        print_pipe_rate("md5_tree", size, std::chrono::duration<double>(t1 - t0).count());
+    }
+
+    // Keeping the manifest current after a few files change, against hashing the whole tree again
+    #ifdef BOOST_CRYPT_HAS_INOTIFY
+    {
+        boost::crypt::utility::watch_options options;
+        options.debounce_ms = 0U;
+
+        std::error_code ec;
+        auto t0 {std::chrono::steady_clock::now()};
+        boost::crypt::md5_tree_watcher watcher(root, ec, options);
+        static_cast<void>(watcher.wait_idle(600000U));
+        auto t1 {std::chrono::steady_clock::now()};
+        print_pipe_rate("md5_tree_watcher, initial scan", size, std::chrono::duration<double>(t1 - t0).count());
+
+        constexpr std::size_t changed {16U};
+        for (std::size_t i {}; i < changed; ++i)
+        {
+            std::fstream fd(files[i * files.size() / changed].path, std::ios::binary | std::ios::in | std::ios::out);
+            fd.write("changed", 7);
+        }
+
+        t0 = std::chrono::steady_clock::now();
+        static_cast<void>(watcher.wait_idle(600000U));
+        t1 = std::chrono::steady_clock::now();
+        print_pipe_rate("md5_tree_watcher, 16 files changed", size, std::chrono::duration<double>(t1 - t0).count());
+    }
+    #endif
+
+    for (const auto& file : files)
+    {
+        std::remove(file.path.c_str());
+    }
+    for (std::size_t i {}; i < directories; ++i)
+    {
+        ::rmdir((root + "/" + std::to_string(i)).c_str());
+    }
+    ::rmdir(root.c_str());
+}
+
+// Verifying a checksum list against a loop that reads it a line at a time, decodes each digest a character at a time,
+// and calls md5_file for each line
+auto run_verify(const std::vector<bench_file>& files, const std::string& dir) -> void
+{
+    const auto list {dir + "/md5_bench_list.md5"};
+
+    const auto to_hex = [](const boost::crypt::array<boost::crypt::uint8_t, 16>& digest) {
+        std::string hex;
+        for (std::size_t i {}; i < digest.size(); ++i)
+        {
+            hex.push_back("0123456789abcdef"[digest[i] >> 4U]);
+            hex.push_back("0123456789abcdef"[digest[i] & 0x0FU]);
+        }
+        return hex;
+    };
+
+    const auto serial_verify = [](const std::string& path) {
+        std::ifstream stream(path);
+        std::string line;
+        std::size_t verified {};
+        while (std::getline(stream, line))
+        {
+            if (line.size() < 35U)
+            {
+                continue;
+            }
+
+            boost::crypt::array<boost::crypt::uint8_t, 16> expected {};
+            for (std::size_t i {}; i < 16U; ++i)
+            {
+                expected[i] = static_cast<boost::crypt::uint8_t>(std::stoul(line.substr(2U * i, 2U), nullptr, 16));
+            }
+
+            const auto digest {boost::crypt::md5_file(line.substr(34U))};
+            bool equal {true};
+            for (std::size_t i {}; i < 16U; ++i)
+            {
+                equal = equal && digest[i] == expected[i];
+            }
+            verified += equal ? 1U : 0U;
+        }
+        return verified;
+    };
+
+    const auto run = [&](const char* title, std::size_t lines, std::uint64_t size) {
+        for (const auto& file : files)
+        {
+            warm_cache(file);
+        }
+
+        std::cout << "\nVerifying " << title << " (" << lines << " lines, " << format_size(size) << ", warm cache)\n\n";
+
+        auto t0 {std::chrono::steady_clock::now()};
+        const auto serial {serial_verify(list)};
+        auto t1 {std::chrono::steady_clock::now()};
+        print_pipe_rate("getline + md5_file", size, std::chrono::duration<double>(t1 - t0).count());
+
+        t0 = std::chrono::steady_clock::now();
+        const auto result {boost::crypt::md5_verify(list, [](const boost::crypt::utility::verify_failure&) {})};
+        t1 = std::chrono::steady_clock::now();
+        print_pipe_rate("md5_verify", size, std::chrono::duration<double>(t1 - t0).count());
+
+        if (result.verified != lines || serial != lines)
+        {
+            std::cout << "Verified " << result.verified << " and " << serial << " of " << lines << " lines\n";
+        }
+    };
+
+    // Every small file listed many times, where parsing and opening files is a large part of the work
+    {
+        constexpr std::size_t repeats {64U};
+        std::ofstream stream(list, std::ios::binary | std::ios::trunc);
+        std::uint64_t size {};
+        for (std::size_t i {}; i < repeats; ++i)
+        {
+            for (const auto& file : files)
+            {
+                stream << to_hex(boost::crypt::md5_file(file.path)) << "  " << file.path << '\n';
+                size += file.size;
+            }
+        }
+        stream.close();
+        run("many small files", repeats * files.size(), size);
+    }
+
+    std::remove(list.c_str());
+}
+
+// Re-scanning unchanged files through a digest cache, where each file costs one statx(2) instead of being read
+auto run_cache(const std::vector<bench_file>& files, const std::string& dir) -> void
+{
+    const auto cache_path {dir + "/md5_bench_cache.bin"};
+    std::remove(cache_path.c_str());
+
+    std::uint64_t size {};
+    for (const auto& file : files)
+    {
+        warm_cache(file);
+        size += file.size;
+    }
+
+    std::cout << "\nRe-scanning unchanged files (" << files.size() << " files, " << format_size(size) << ", warm cache)\n\n";
+
+    auto t0 {std::chrono::steady_clock::now()};
+    for (const auto& file : files)
+    {
+        static_cast<void>(boost::crypt::md5_file(file.path));
+    }
+    auto t1 {std::chrono::steady_clock::now()};
+    print_pipe_rate("md5_file", size, std::chrono::duration<double>(t1 - t0).count());
+
+    std::error_code ec;
+    boost::crypt::md5_digest_cache cache(cache_path, ec);
+    t0 = std::chrono::steady_clock::now();
+    for (const auto& file : files)
+    {
+        static_cast<void>(boost::crypt::md5_file(file.path, cache));
+    }
+    t1 = std::chrono::steady_clock::now();
+    print_pipe_rate("md5_file(cache), first scan", size, std::chrono::duration<double>(t1 - t0).count());
+
+    t0 = std::chrono::steady_clock::now();
+    for (const auto& file : files)
+    {
+        static_cast<void>(boost::crypt::md5_file(file.path, cache));
+    }
+    t1 = std::chrono::steady_clock::now();
+    print_pipe_rate("md5_file(cache), re-scan", size, std::chrono::duration<double>(t1 - t0).count());
+
+    // A new process has to load the cache from disk first
+    t0 = std::chrono::steady_clock::now();
+    boost::crypt::md5_digest_cache reopened(cache_path, ec);
+    for (const auto& file : files)
+    {
+        static_cast<void>(boost::crypt::md5_file(file.path, reopened));
+    }
+    t1 = std::chrono::steady_clock::now();
+    print_pipe_rate("md5_file(cache), new process", size, std::chrono::duration<double>(t1 - t0).count());
+
+    std::remove(cache_path.c_str());
+}
+
+// A log that grows by a little between scans, hashed in full each time and then from the saved state
+auto run_incremental(std::uint64_t size, const std::string& dir) -> void
+{
+    const auto path {dir + "/md5_bench_incremental.log"};
+    const auto state_path {path + ".md5state"};
+    std::remove(state_path.c_str());
+
+    std::string chunk(1024U * 1024U, '\0');
+    for (std::size_t i {}; i < chunk.size(); ++i)
+    {
+        chunk[i] = static_cast<char>('a' + i % 26U);
+    }
+
+    {
+        std::ofstream fd(path, std::ios::binary | std::ios::trunc);
+        for (std::uint64_t written {}; written < size; written += chunk.size())
+        {
+            fd.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        }
+    }
+
+    constexpr std::size_t appends {8U};
+    const std::string line {"2024-01-01T00:00:00Z a line appended to the log between scans\n"};
+
+    std::error_code ec;
+    static_cast<void>(boost::crypt::md5_file_incremental(path, ec));
+
+    double full_seconds {};
+    double incremental_seconds {};
+    std::uint64_t total {};
+    for (std::size_t i {}; i < appends; ++i)
+    {
+        {
+            std::ofstream fd(path, std::ios::binary | std::ios::app);
+            for (std::size_t j {}; j < 100U; ++j)
+            {
+                fd.write(line.data(), static_cast<std::streamsize>(line.size()));
+            }
+        }
+
+        struct stat st {};
+        static_cast<void>(::stat(path.c_str(), &st));
+        total += static_cast<std::uint64_t>(st.st_size);
+
+        auto t0 {std::chrono::steady_clock::now()};
+        static_cast<void>(boost::crypt::md5_file(path));
+        auto t1 {std::chrono::steady_clock::now()};
+        full_seconds += std::chrono::duration<double>(t1 - t0).count();
+
+        t0 = std::chrono::steady_clock::now();
+        static_cast<void>(boost::crypt::md5_file_incremental(path, ec));
+        t1 = std::chrono::steady_clock::now();
+        incremental_seconds += std::chrono::duration<double>(t1 - t0).count();
+    }
+
+    std::cout << "\nRe-hashing a " << format_size(size) << " log after each of " << appends << " small appends (warm cache)\n\n";
+    print_pipe_rate("md5_file", total, full_seconds);
+    print_pipe_rate("md5_file_incremental", total, incremental_seconds);
+
+    std::remove(path.c_str());
+    std::remove(state_path.c_str());
+}
+
+// Finding the duplicates among files that mostly share a size, against hashing every file in full
+auto run_dedup(const std::string& dir) -> void
+{
+    constexpr std::size_t count {512U};
+    constexpr std::size_t file_size {256U * 1024U};
+    const auto root {dir + "/md5_bench_dedup"};
+    ::mkdir(root.c_str(), 0755);
+
+    std::vector<std::string> paths;
+    std::string contents(file_size, '\0');
+    for (std::size_t j {}; j < contents.size(); ++j)
+    {
+        contents[j] = static_cast<char>((j * 31U) % 251U);
+    }
+
+    for (std::size_t i {}; i < count; ++i)
+    {
+        // Every 32nd file is a copy of the one before it, and the rest differ in their first bytes
+        const std::uint64_t seed {i % 32U == 31U ? i - 1U : i};
+        std::memcpy(&contents[0], &seed, sizeof(seed));
+
+        paths.push_back(root + "/" + std::to_string(i) + ".bin");
+        std::ofstream fd(paths.back(), std::ios::binary | std::ios::trunc);
+        fd.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    }
+
+    const std::uint64_t size {count * file_size};
+    std::cout << "\nFinding duplicates (" << format_size(size) << " in " << count << " files of the same size, warm cache)\n\n";
+
+    std::error_code ec;
+    auto t0 {std::chrono::steady_clock::now()};
+    static_cast<void>(boost::crypt::md5_tree(root, ec));
+    auto t1 {std::chrono::steady_clock::now()};
+    print_pipe_rate("md5_tree, then group by digest", size, std::chrono::duration<double>(t1 - t0).count());
+
+    t0 = std::chrono::steady_clock::now();
+    const auto result {boost::crypt::md5_find_duplicates({root})};
+    t1 = std::chrono::steady_clock::now();
+    print_pipe_rate("md5_find_duplicates", size, std::chrono::duration<double>(t1 - t0).count());
+
+    std::cout << "  " << result.groups.size() << " groups, read " << format_size(result.stats.partial_bytes_read)
+              << " for partial hashes and " << format_size(result.stats.full_bytes_read) << " for full hashes of "
+              << format_size(result.stats.total_bytes) << '\n';
+
+    for (const auto& path : paths)
+    {
+        std::remove(path.c_str());
+    }
+    ::rmdir(root.c_str());
+}
+
+// Telling two huge files apart from samples of them, against hashing them in full
+auto run_sampled(const bench_file& file) -> void
+{
+    std::cout << "\nFingerprinting " << format_size(file.size) << " (warm cache)\n\n";
+
+    auto t0 {std::chrono::steady_clock::now()};
+    static_cast<void>(boost::crypt::md5_file(file.path));
+    auto t1 {std::chrono::steady_clock::now()};
+    print_pipe_rate("md5_file", file.size, std::chrono::duration<double>(t1 - t0).count());
+
+    std::error_code ec;
+    boost::crypt::utility::sample_options options;
+    for (const std::size_t threads : {1U, 0U})
+    {
+        options.thread_count = threads;
+        t0 = std::chrono::steady_clock::now();
+        const auto fingerprint {boost::crypt::md5_file_sampled(file.path, ec, options)};
+        t1 = std::chrono::steady_clock::now();
+        print_pipe_rate(threads == 1U ? "md5_file_sampled, 1 thread" : "md5_file_sampled", file.size,
+                        std::chrono::duration<double>(t1 - t0).count());
+
+        if (threads == 0U)
+        {
+            std::cout << "  " << boost::crypt::utility::format_fingerprint(fingerprint) << '\n';
+        }
+    }
+}
+
+// The MD5 of every line of a file, against reading each line into a string and hashing it
+auto run_records(std::uint64_t size, const std::string& dir) -> void
+{
+    const auto path {dir + "/md5_bench_records.txt"};
+    {
+        std::ofstream fd(path, std::ios::binary | std::ios::trunc);
+        std::string line;
+        for (std::uint64_t written {}, i {}; written < size; written += line.size(), ++i)
+        {
+            // Lines of 20 to 180 bytes, like the rows of a text export
+            line.assign(20U + static_cast<std::size_t>(i * 37U % 160U), static_cast<char>('a' + i % 26U));
+            line.back() = '\n';
+            fd.write(line.data(), static_cast<std::streamsize>(line.size()));
+        }
+    }
+
+    std::cout << "\nHashing each line of a " << format_size(size) << " file (warm cache)\n\n";
+
+    auto t0 {std::chrono::steady_clock::now()};
+    std::size_t lines {};
+    {
+        std::ifstream fd(path, std::ios::binary);
+        std::string line;
+        while (std::getline(fd, line))
+        {
+            static_cast<void>(boost::crypt::md5(line));
+            ++lines;
+        }
+    }
+    auto t1 {std::chrono::steady_clock::now()};
+    print_pipe_rate("std::getline, then md5", size, std::chrono::duration<double>(t1 - t0).count());
+
+    std::error_code ec;
+    boost::crypt::utility::record_options options;
+    for (const std::size_t threads : {1U, 0U})
+    {
+        options.thread_count = threads;
+        t0 = std::chrono::steady_clock::now();
+        const auto digests {boost::crypt::md5_file_records(path, ec, options)};
+        t1 = std::chrono::steady_clock::now();
+        print_pipe_rate(threads == 1U ? "md5_file_records, 1 thread" : "md5_file_records", size,
+                        std::chrono::duration<double>(t1 - t0).count());
+
+        if (digests.size() != lines)
+        {
+            std::cout << "  expected " << lines << " digests, got " << digests.size() << '\n';
+        }
+    }
+
+    std::remove(path.c_str());
+}
+
+} // namespace
+
+int main()
+{
+    const auto dir {env_or("BOOST_CRYPT_BENCH_DIR", ".")};
+    const auto max_size {static_cast<std::uint64_t>(std::strtoull(env_or("BOOST_CRYPT_BENCH_MAX_SIZE", "268435456").c_str(), nullptr, 10))};
+    const bool keep {std::getenv("BOOST_CRYPT_BENCH_KEEP") != nullptr};
+
+    std::vector<bench_file> single_files;
+    for (const auto size : {4U * kib, 64U * kib, mib, 16U * mib, 256U * mib, gib, 4U * gib})
+    {
+        if (size <= max_size)
+        {
+            single_files.push_back({dir + "/md5_bench_" + std::to_string(size) + ".bin", size, false});
+        }
+    }
+    for (const auto size : {256U * mib, 4U * gib})
+    {
+        if (size <= max_size)
+        {
+            single_files.push_back({dir + "/md5_bench_sparse_" + std::to_string(size) + ".bin", size, true});
+        }
+    }
+
+    // Many small files to measure per-file overhead (open, buffer setup, close)
+    std::vector<bench_file> small_files;
+    for (std::size_t i {}; i < 1024U; ++i)
+    {
+        small_files.push_back({dir + "/md5_bench_small_" + std::to_string(i) + ".bin", 16U * kib, false});
+    }
+
+    for (const auto& file : single_files)
+    {
+        if (!generate_file(file))
+        {
+            return 1;
+        }
+    }
+    for (const auto& file : small_files)
+    {
+        if (!generate_file(file))
+        {
+            return 1;
+        }
+    }
+
+    std::cout << "Sizes marked with * are sparse files\n\n";
+    print_header();
+
+    for (const auto& file : single_files)
+    {
+        run_all({&file});
+    }
+
+    for (const std::size_t count : {16U, 128U, 1024U})
+    {
+        std::vector<const bench_file*> files;
+        for (std::size_t i {}; i < count; ++i)
+        {
+            files.push_back(&small_files[i]);
+        }
+        run_all(files);
+    }
+
+    run_residency(single_files);
+    run_missing_files(dir);
+    run_pipe(std::min<std::uint64_t>(max_size, gib));
+
+    for (auto it {single_files.rbegin()}; it != single_files.rend(); ++it)
+    {
+        if (!it->sparse)
+        {
+            run_copy(*it);
+            break;
+        }
+    }
+
+    run_tar(single_files, dir);
+    run_tree(dir);
+    run_verify(small_files, dir);
+    run_cache(small_files, dir);
+    run_incremental(std::min<std::uint64_t>(max_size, gib), dir);
+    run_dedup(dir);
+    run_records(std::min<std::uint64_t>(max_size, gib), dir);
+
+    for (auto it {single_files.rbegin()}; it != single_files.rend(); ++it)
+    {
+        if (!it->sparse)
+        {
+            run_sampled(*it);
+            break;
+        }
+    }
+
+    if (!keep)
+    {
+        for (const auto& file : single_files)
+        {
+            std::remove(file.path.c_str());
+        }
+        for (const auto& file : small_files)
+        {
+            std::remove(file.path.c_str());
+        }
+    }
+
+    return 0;
+}
+
+#else
+
+#include <iostream>
+
+int main()
+{
+    std::cerr << "Benchmarks not run" << std::endl;
+    return 0;
+}
+
+#endif
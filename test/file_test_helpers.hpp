@@ -0,0 +1,73 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#ifndef BOOST_CRYPT_TEST_FILE_TEST_HELPERS
+#define BOOST_CRYPT_TEST_FILE_TEST_HELPERS
+
+#include <boost/core/lightweight_test.hpp>
+#include <cstdint>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace crypt_test {
+
+// Bytes from a linear congruential generator, so every test file can be made again from its size and seed
+inline auto make_contents(std::size_t size, std::uint32_t seed = 0x12345678U) -> std::string
+{
+    std::string contents(size, '\0');
+    for (auto& c : contents)
+    {
+        seed = seed * 1664525U + 1013904223U;
+        c = static_cast<char>(seed >> 24U);
+    }
+
+    return contents;
+}
+
+inline auto write_file(const std::string& path, const std::string& contents, bool append = false) -> void
+{
+    std::ofstream fd(path, std::ios::binary | std::ios::out | (append ? std::ios::app : std::ios::trunc));
+    fd.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+}
+
+template <typename Digest1, typename Digest2>
+auto digest_equal(const Digest1& lhs, const Digest2& rhs) -> bool
+{
+    if (lhs.size() != rhs.size())
+    {
+        return false;
+    }
+
+    for (std::size_t i {}; i < lhs.size(); ++i)
+    {
+        if (lhs[i] != rhs[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Tests each byte, and names the size of the input that failed
+template <typename Digest1, typename Digest2>
+void check_digest(const Digest1& res, const Digest2& expected, std::size_t size)
+{
+    for (std::size_t i {}; i < expected.size(); ++i)
+    {
+        if (!BOOST_TEST_EQ(res[i], expected[i]))
+        {
+            // LCOV_EXCL_START
+            std::cerr << "Failure with size: " << size << std::endl;
+            break;
+            // LCOV_EXCL_STOP
+        }
+    }
+}
+
+} // namespace crypt_test
+
+#endif // BOOST_CRYPT_TEST_FILE_TEST_HELPERS
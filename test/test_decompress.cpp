@@ -0,0 +1,265 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// The gzip and zstd tests run when BOOST_CRYPT_ENABLE_ZLIB and BOOST_CRYPT_ENABLE_ZSTD are defined,
+// and the test is linked with -lz and -lzstd
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/hash/md5/decompress.hpp>
+#include <boost/crypt/utility/decompress.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include "file_test_helpers.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+using crypt_test::check_digest;
+using crypt_test::make_contents;
+using crypt_test::write_file;
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+#include <unistd.h>
+#endif
+
+// Random data barely compresses while runs of zeros expand to many ring buffers from a few input bytes
+auto test_inputs() -> std::vector<std::string>
+{
+    return {std::string{}, std::string{"a"}, make_contents(100000U), make_contents(3U * BOOST_CRYPT_FILE_BUFFER_SIZE + 7U),
+            std::string(8U * BOOST_CRYPT_FILE_BUFFER_SIZE + 3U, '\0')};
+}
+
+void test_detect_compression()
+{
+    using boost::crypt::utility::compression;
+    using boost::crypt::utility::detail::detect_compression;
+
+    const std::uint8_t gzip[] {0x1FU, 0x8BU, 0x08U};
+    const std::uint8_t zstd[] {0x28U, 0xB5U, 0x2FU, 0xFDU};
+    BOOST_TEST(detect_compression(gzip, sizeof(gzip)) == compression::gzip);
+    BOOST_TEST(detect_compression(zstd, sizeof(zstd)) == compression::zstd);
+    BOOST_TEST(detect_compression(zstd, 3U) == compression::none);
+    BOOST_TEST(detect_compression(gzip, 1U) == compression::none);
+    BOOST_TEST(detect_compression(gzip, 0U) == compression::none);
+}
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+const char* const filename {"test_decompress.bin"};
+
+void test_uncompressed()
+{
+    for (const auto& contents : test_inputs())
+    {
+        write_file(filename, contents);
+        std::error_code ec;
+        check_digest(boost::crypt::md5_decompressed_file(filename, ec), boost::crypt::md5(contents), contents.size());
+        BOOST_TEST(!ec);
+    }
+
+    const boost::crypt::array<boost::crypt::uint8_t, 16> zeros {};
+    std::error_code ec;
+    check_digest(boost::crypt::md5_decompressed_file("test_decompress_missing.gz", ec), zeros, 0U);
+    BOOST_TEST(ec == std::errc::no_such_file_or_directory);
+
+    // A format that was not enabled is reported rather than hashed as is
+    #ifndef BOOST_CRYPT_HAS_ZLIB
+    write_file(filename, std::string{"\x1f\x8b\x08"});
+    check_digest(boost::crypt::md5_decompressed_file(filename, ec), zeros, 0U);
+    BOOST_TEST(ec == std::errc::not_supported);
+    #endif
+
+    std::remove(filename);
+}
+
+// Checks the digest of the compressed data against the original, including through a pipe and with small buffers
+void check_compressed(const std::string& compressed, const std::string& contents, boost::crypt::utility::compression format)
+{
+    const auto expected {boost::crypt::md5(contents)};
+    write_file(filename, compressed);
+
+    for (const auto mode : {boost::crypt::utility::compression::automatic, format})
+    {
+        std::error_code ec;
+        check_digest(boost::crypt::md5_decompressed_file(filename, ec, mode), expected, contents.size());
+        BOOST_TEST(!ec);
+    }
+
+    {
+        boost::crypt::md5_hasher hasher;
+        BOOST_TEST(!boost::crypt::utility::decompress_and_hash_file(filename, hasher, format, 1U, 4096U));
+        check_digest(hasher.get_digest(), expected, contents.size());
+    }
+
+    // Hashing the compressed bytes themselves
+    check_digest(boost::crypt::md5_decompressed_file(filename, boost::crypt::utility::compression::none),
+                 boost::crypt::md5(compressed), compressed.size());
+
+    {
+        int fds[2] {};
+        BOOST_TEST_EQ(pipe(fds), 0);
+        std::thread writer([fd = fds[1], &compressed]() {
+            std::size_t written {};
+            while (written < compressed.size())
+            {
+                const auto res {write(fd, compressed.data() + written, compressed.size() - written)};
+                if (res <= 0)
+                {
+                    break;
+                }
+                written += static_cast<std::size_t>(res);
+            }
+            close(fd);
+        });
+
+        boost::crypt::md5_hasher hasher;
+        BOOST_TEST(!boost::crypt::utility::decompress_and_hash_file(fds[0], hasher));
+        writer.join();
+        close(fds[0]);
+        check_digest(hasher.get_digest(), expected, contents.size());
+    }
+}
+
+// A stream cut short, and one damaged from offset on
+void check_damaged(const std::string& compressed, boost::crypt::utility::compression format, std::size_t offset)
+{
+    const boost::crypt::array<boost::crypt::uint8_t, 16> zeros {};
+    std::error_code ec;
+
+    write_file(filename, compressed.substr(0U, compressed.size() - 3U));
+    check_digest(boost::crypt::md5_decompressed_file(filename, ec), zeros, 0U);
+    BOOST_TEST(ec == std::errc::io_error);
+
+    auto corrupt {compressed};
+    for (auto i {offset}; i < offset + 64U && i < corrupt.size(); ++i)
+    {
+        corrupt[i] = static_cast<char>(corrupt[i] ^ 0x55);
+    }
+    write_file(filename, corrupt);
+    check_digest(boost::crypt::md5_decompressed_file(filename, ec, format), zeros, 0U);
+    BOOST_TEST(ec == std::errc::illegal_byte_sequence);
+}
+
+#ifdef BOOST_CRYPT_HAS_ZLIB
+
+auto gzip(const std::string& contents) -> std::string
+{
+    z_stream stream {};
+    BOOST_TEST_EQ(deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY), Z_OK);
+
+    std::string compressed(deflateBound(&stream, static_cast<uLong>(contents.size())), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(contents.data()));
+    stream.avail_in = static_cast<uInt>(contents.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&compressed[0]);
+    stream.avail_out = static_cast<uInt>(compressed.size());
+    BOOST_TEST_EQ(deflate(&stream, Z_FINISH), Z_STREAM_END);
+    compressed.resize(stream.total_out);
+    deflateEnd(&stream);
+    return compressed;
+}
+
+void test_gzip()
+{
+    for (const auto& contents : test_inputs())
+    {
+        check_compressed(gzip(contents), contents, boost::crypt::utility::compression::gzip);
+    }
+
+    // Members one after another, as written by pigz or by appending to a .gz file
+    const auto first {make_contents(70000U)};
+    const std::string second(2U * BOOST_CRYPT_FILE_BUFFER_SIZE, 'x');
+    check_compressed(gzip(first) + gzip(second), first + second, boost::crypt::utility::compression::gzip);
+
+    // Zeros after the last member are padding, as gzip treats them
+    check_compressed(gzip(first) + std::string(512U, '\0'), first, boost::crypt::utility::compression::gzip);
+
+    // The magic of the next member split across two reads
+    {
+        const auto members {gzip(first) + gzip(second)};
+        write_file(filename, members);
+        boost::crypt::md5_hasher hasher;
+        BOOST_TEST(!boost::crypt::utility::decompress_and_hash_file(filename, hasher, boost::crypt::utility::compression::gzip,
+                                                                    1U, gzip(first).size() + 1U));
+        check_digest(hasher.get_digest(), boost::crypt::md5(first + second), first.size() + second.size());
+    }
+
+    // Anything else after a member is reported apart from corrupt data, and half a magic as a stream cut short
+    const boost::crypt::array<boost::crypt::uint8_t, 16> zeros {};
+    for (const auto& trailer : {std::string{"garbage"}, std::string(100U, '\0') + "x", std::string{"\x1f\x8a"}})
+    {
+        std::error_code ec;
+        write_file(filename, gzip(first) + trailer);
+        check_digest(boost::crypt::md5_decompressed_file(filename, ec), zeros, trailer.size());
+        BOOST_TEST(ec == std::errc::bad_message);
+    }
+
+    {
+        std::error_code ec;
+        write_file(filename, gzip(first) + "\x1f");
+        check_digest(boost::crypt::md5_decompressed_file(filename, ec), zeros, 1U);
+        BOOST_TEST(ec == std::errc::io_error);
+    }
+
+    // The CRC-32 at the end of the member catches damage to stored blocks
+    const auto damaged {gzip(make_contents(100000U))};
+    check_damaged(damaged, boost::crypt::utility::compression::gzip, damaged.size() / 2U);
+    std::remove(filename);
+}
+
+#endif // BOOST_CRYPT_HAS_ZLIB
+
+#ifdef BOOST_CRYPT_HAS_ZSTD
+
+auto zstd(const std::string& contents) -> std::string
+{
+    std::string compressed(ZSTD_compressBound(contents.size()), '\0');
+    const auto size {ZSTD_compress(&compressed[0], compressed.size(), contents.data(), contents.size(), 3)};
+    BOOST_TEST(!ZSTD_isError(size));
+    compressed.resize(size);
+    return compressed;
+}
+
+void test_zstd()
+{
+    for (const auto& contents : test_inputs())
+    {
+        check_compressed(zstd(contents), contents, boost::crypt::utility::compression::zstd);
+    }
+
+    const auto first {make_contents(70000U)};
+    const std::string second(2U * BOOST_CRYPT_FILE_BUFFER_SIZE, 'x');
+    check_compressed(zstd(first) + zstd(second), first + second, boost::crypt::utility::compression::zstd);
+
+    // Frames are written without a checksum by default, so damage the frame header
+    check_damaged(zstd(make_contents(100000U)), boost::crypt::utility::compression::zstd, 0U);
+    std::remove(filename);
+}
+
+#endif // BOOST_CRYPT_HAS_ZSTD
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+int main()
+{
+    test_detect_compression();
+
+    #ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+    test_uncompressed();
+
+    #ifdef BOOST_CRYPT_HAS_ZLIB
+    test_gzip();
+    #endif
+
+    #ifdef BOOST_CRYPT_HAS_ZSTD
+    test_zstd();
+    #endif
+    #endif
+
+    return boost::report_errors();
+}
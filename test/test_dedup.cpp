@@ -0,0 +1,153 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/hash/md5/dedup.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include "file_test_helpers.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+using crypt_test::digest_equal;
+using crypt_test::write_file;
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+using digest_type = boost::crypt::array<boost::crypt::uint8_t, 16>;
+
+auto pattern(std::size_t size, std::size_t seed) -> std::string
+{
+    std::string contents;
+    for (std::size_t i {}; i < size; ++i)
+    {
+        contents.push_back(static_cast<char>((i * 31U + seed) % 251U));
+    }
+
+    return contents;
+}
+
+void test_md5_find_duplicates()
+{
+    const std::string root {"test_dedup_dir"};
+    static_cast<void>(::mkdir(root.c_str(), 0755));
+    static_cast<void>(::mkdir((root + "/sub").c_str(), 0755));
+
+    // Three copies and a hard link, and a file of the same size that differs at the start
+    const auto a {pattern(10000U, 1U)};
+    write_file(root + "/a1", a);
+    write_file(root + "/a2", a);
+    write_file(root + "/sub/a4", a);
+    static_cast<void>(::link((root + "/a1").c_str(), (root + "/a3").c_str()));
+    auto b {a};
+    b[0] = 'b';
+    write_file(root + "/b", b);
+
+    // The same size, start and end, but different in the middle
+    auto c {pattern(20000U, 2U)};
+    write_file(root + "/c1", c);
+    c[10000] = 'c';
+    write_file(root + "/c2", c);
+
+    // Small enough that the partial hash reads all of them
+    write_file(root + "/d1", pattern(100U, 3U));
+    write_file(root + "/d2", pattern(100U, 3U));
+
+    write_file(root + "/e", pattern(5000U, 4U));
+    write_file(root + "/empty1", "");
+    write_file(root + "/empty2", "");
+    static_cast<void>(::symlink("a1", (root + "/link").c_str()));
+
+    boost::crypt::utility::dedup_options options;
+    for (const std::size_t threads : {1U, 4U})
+    {
+        options.thread_count = threads;
+        const auto result {boost::crypt::md5_find_duplicates({root, root + "/", "test_dedup_missing"}, options)};
+
+        BOOST_TEST_EQ(result.groups.size(), 2U);
+        if (result.groups.size() == 2U)
+        {
+            const auto& first {result.groups[0]};
+            BOOST_TEST_EQ(first.size, 10000U);
+            BOOST_TEST(digest_equal(first.digest, boost::crypt::md5(a)));
+            BOOST_TEST_EQ(first.paths.size(), 4U);
+            if (first.paths.size() == 4U)
+            {
+                BOOST_TEST_EQ(first.paths[0], root + "/a1");
+                BOOST_TEST_EQ(first.paths[1], root + "/a2");
+                BOOST_TEST_EQ(first.paths[2], root + "/a3");
+                BOOST_TEST_EQ(first.paths[3], root + "/sub/a4");
+            }
+
+            const auto& second {result.groups[1]};
+            BOOST_TEST_EQ(second.size, 100U);
+            BOOST_TEST(digest_equal(second.digest, boost::crypt::md5(pattern(100U, 3U))));
+            BOOST_TEST_EQ(second.paths.size(), 2U);
+        }
+
+        BOOST_TEST_EQ(result.failures.size(), 1U);
+        if (result.failures.size() == 1U)
+        {
+            BOOST_TEST_EQ(result.failures[0].path, "test_dedup_missing");
+            BOOST_TEST(result.failures[0].ec == std::errc::no_such_file_or_directory);
+        }
+
+        const auto& stats {result.stats};
+        BOOST_TEST_EQ(stats.files, 10U);
+        BOOST_TEST_EQ(stats.total_bytes, 4U * 10000U + 2U * 20000U + 2U * 100U + 5000U);
+        BOOST_TEST_EQ(stats.partial_files, 8U);
+        BOOST_TEST_EQ(stats.partial_bytes_read, 6U * 8192U + 2U * 100U);
+        BOOST_TEST_EQ(stats.full_files, 5U);
+        BOOST_TEST_EQ(stats.full_bytes_read, 3U * 10000U + 2U * 20000U);
+        BOOST_TEST_EQ(stats.saved_by_size, 5000U);
+        BOOST_TEST_EQ(stats.saved_by_partial, 10000U - 8192U);
+        BOOST_TEST_EQ(stats.duplicate_bytes, 2U * 10000U + 100U);
+    }
+
+    // Files can be given directly, and hard links alone are not duplicates
+    {
+        const auto result {boost::crypt::md5_find_duplicates({root + "/a1", root + "/a3", root + "/b"})};
+        BOOST_TEST(result.groups.empty());
+        BOOST_TEST_EQ(result.stats.files, 3U);
+        BOOST_TEST_EQ(result.stats.total_bytes, 20000U);
+        BOOST_TEST_EQ(result.stats.full_files, 0U);
+    }
+
+    // Empty files are duplicates of each other once they are not ignored
+    {
+        options.min_size = 0U;
+        const auto result {boost::crypt::md5_find_duplicates({root}, options)};
+        BOOST_TEST_EQ(result.groups.size(), 3U);
+        if (result.groups.size() == 3U)
+        {
+            BOOST_TEST_EQ(result.groups[2].size, 0U);
+            BOOST_TEST(digest_equal(result.groups[2].digest, boost::crypt::md5("")));
+        }
+    }
+
+    for (const auto name : {"a1", "a2", "a3", "sub/a4", "b", "c1", "c2", "d1", "d2", "e", "empty1", "empty2", "link"})
+    {
+        std::remove((root + "/" + name).c_str());
+    }
+    ::rmdir((root + "/sub").c_str());
+    ::rmdir(root.c_str());
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+int main()
+{
+    #ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+    test_md5_find_duplicates();
+    #endif
+
+    return boost::report_errors();
+}
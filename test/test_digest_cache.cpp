@@ -0,0 +1,184 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/hash/md5/digest_cache.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include "file_test_helpers.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+using crypt_test::digest_equal;
+using crypt_test::write_file;
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using digest_type = boost::crypt::array<boost::crypt::uint8_t, 16>;
+
+auto file_size(const std::string& path) -> std::uint64_t
+{
+    struct stat st {};
+    return ::stat(path.c_str(), &st) == 0 ? static_cast<std::uint64_t>(st.st_size) : 0U;
+}
+
+// Ages a file's ctime past the racy window by waiting, since ctime can not be set directly
+auto wait_past_racy_window() -> void
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+}
+
+void test_md5_file_cached()
+{
+    const std::string cache_path {"test_digest_cache.bin"};
+    const std::string path {"test_digest_cache_a.bin"};
+    std::remove(cache_path.c_str());
+
+    const std::string contents(100000U, 'a');
+    write_file(path, contents);
+
+    boost::crypt::utility::file_key key {};
+    BOOST_TEST(!boost::crypt::utility::file_key_of(path, key));
+    BOOST_TEST_EQ(key.size, contents.size());
+    BOOST_TEST(boost::crypt::utility::file_key_of(".", key) == std::errc::invalid_argument);
+    BOOST_TEST(boost::crypt::utility::file_key_of("test_digest_cache_missing.bin", key) == std::errc::no_such_file_or_directory);
+
+    std::error_code ec;
+    boost::crypt::md5_digest_cache cache(cache_path, ec);
+    BOOST_TEST(!ec);
+    BOOST_TEST(cache.is_open());
+    BOOST_TEST(cache.writable());
+    BOOST_TEST_EQ(cache.size(), 0U);
+
+    // A file that has only just been written is hashed but not cached
+    BOOST_TEST(digest_equal(boost::crypt::md5_file(path, cache, ec), boost::crypt::md5(contents)));
+    BOOST_TEST(!ec);
+    BOOST_TEST_EQ(cache.size(), 0U);
+
+    wait_past_racy_window();
+    BOOST_TEST(digest_equal(boost::crypt::md5_file(path, cache, ec), boost::crypt::md5(contents)));
+    BOOST_TEST(!ec);
+    BOOST_TEST_EQ(cache.size(), 1U);
+    BOOST_TEST_EQ(file_size(cache_path), 32U + boost::crypt::md5_digest_cache::record_size);
+
+    // A hit is served from the cache without reading the file, which the entry for a made up digest shows
+    digest_type fake {};
+    fake[0] = 0xAB;
+    BOOST_TEST(!boost::crypt::utility::file_key_of(path, key));
+    BOOST_TEST(!cache.insert(key, fake));
+    BOOST_TEST(digest_equal(boost::crypt::md5_file(path, cache, ec), fake));
+    BOOST_TEST(!ec);
+    BOOST_TEST(!cache.insert(key, boost::crypt::md5(contents)));
+
+    // Another process sees the entries, including those written after it opened the cache
+    boost::crypt::md5_digest_cache other(cache_path, ec);
+    BOOST_TEST(!ec);
+    BOOST_TEST_EQ(other.size(), 1U);
+
+    const std::string second_path {"test_digest_cache_b.bin"};
+    write_file(second_path, "second");
+    boost::crypt::utility::file_key second_key {};
+    BOOST_TEST(!boost::crypt::utility::file_key_of(second_path, second_key));
+    BOOST_TEST(!cache.insert(second_key, fake));
+
+    digest_type found {};
+    BOOST_TEST(other.find(second_key, found));
+    BOOST_TEST(digest_equal(found, fake));
+
+    // Changing the file changes its key
+    write_file(path, "more", true);
+    wait_past_racy_window();
+    BOOST_TEST(digest_equal(boost::crypt::md5_file(path, other, ec), boost::crypt::md5(contents + "more")));
+    BOOST_TEST(!ec);
+    BOOST_TEST(digest_equal(boost::crypt::md5_file(path, cache, ec), boost::crypt::md5(contents + "more")));
+    BOOST_TEST_EQ(cache.size(), 3U);
+
+    // A record torn by a crash is skipped, and the next writer pads it out to keep the records in step
+    write_file(cache_path, std::string(10U, '\x5A'), true);
+    {
+        boost::crypt::md5_digest_cache torn(cache_path, ec);
+        BOOST_TEST(!ec);
+        BOOST_TEST_EQ(torn.size(), 3U);
+
+        const auto before {file_size(cache_path)};
+        BOOST_TEST(!torn.insert(boost::crypt::utility::file_key{1U, 2U, 3U, 4, 5}, fake));
+        BOOST_TEST_EQ(file_size(cache_path), before - 10U + 2U * boost::crypt::md5_digest_cache::record_size);
+    }
+    {
+        boost::crypt::md5_digest_cache reopened(cache_path, ec);
+        BOOST_TEST(!ec);
+        BOOST_TEST_EQ(reopened.size(), 4U);
+        BOOST_TEST(reopened.find(boost::crypt::utility::file_key{1U, 2U, 3U, 4, 5}, found));
+        BOOST_TEST(!reopened.find(boost::crypt::utility::file_key{1U, 2U, 3U, 4, 6}, found));
+    }
+
+    // Several threads with caches of their own append to the same file at once
+    {
+        std::vector<std::thread> threads;
+        for (std::uint64_t t {}; t < 4U; ++t)
+        {
+            threads.emplace_back([&cache_path, &fake, t]() {
+                std::error_code thread_ec;
+                boost::crypt::md5_digest_cache writer(cache_path, thread_ec);
+                for (std::uint64_t i {}; i < 500U; ++i)
+                {
+                    static_cast<void>(writer.insert(boost::crypt::utility::file_key{t, i, 0U, 0, 0}, fake));
+                }
+            });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        boost::crypt::md5_digest_cache reopened(cache_path, ec);
+        BOOST_TEST(!ec);
+        BOOST_TEST_EQ(reopened.size(), 2004U);
+    }
+
+    // Files that can not be hashed
+    BOOST_TEST(digest_equal(boost::crypt::md5_file("test_digest_cache_missing.bin", cache, ec), digest_type{}));
+    BOOST_TEST(ec == std::errc::no_such_file_or_directory);
+
+    // A cache of digests of a different size is refused
+    boost::crypt::utility::digest_cache<32U> wrong_size(cache_path, ec);
+    BOOST_TEST(ec == std::errc::invalid_argument);
+    BOOST_TEST(!wrong_size.is_open());
+
+    write_file(second_path, "not a cache, but long enough to have a header");
+    boost::crypt::md5_digest_cache not_cache(second_path, ec);
+    BOOST_TEST(ec == std::errc::invalid_argument);
+
+    // A closed cache finds nothing, and hashing through it still works
+    boost::crypt::md5_digest_cache closed;
+    BOOST_TEST(!closed.is_open());
+    BOOST_TEST(!closed.find(key, found));
+    BOOST_TEST(closed.insert(key, fake) == std::errc::read_only_file_system);
+    BOOST_TEST(digest_equal(boost::crypt::md5_file(path, closed), boost::crypt::md5(contents + "more")));
+
+    std::remove(cache_path.c_str());
+    std::remove(path.c_str());
+    std::remove(second_path.c_str());
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+int main()
+{
+    #ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+    test_md5_file_cached();
+    #endif
+
+    return boost::report_errors();
+}
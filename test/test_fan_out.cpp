@@ -0,0 +1,137 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/utility/fan_out.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include "file_test_helpers.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+using crypt_test::make_contents;
+using crypt_test::write_file;
+
+// A user supplied hasher that only needs to meet the byte hasher requirements
+struct byte_sum_hasher
+{
+    std::uint64_t sum {};
+    std::size_t count {};
+
+    void process_bytes(const std::uint8_t* data, std::size_t size)
+    {
+        for (std::size_t i {}; i < size; ++i)
+        {
+            sum += data[i];
+        }
+        count += size;
+    }
+};
+
+struct throwing_hasher
+{
+    void process_bytes(const std::uint8_t*, std::size_t)
+    {
+        throw std::runtime_error("Hasher failure");
+    }
+};
+
+static_assert(boost::crypt::utility::is_byte_hasher<boost::crypt::md5_hasher>::value, "md5_hasher is a byte hasher");
+static_assert(boost::crypt::utility::is_byte_hasher<byte_sum_hasher>::value, "byte_sum_hasher is a byte hasher");
+static_assert(!boost::crypt::utility::is_byte_hasher<int>::value, "int is not a byte hasher");
+
+auto expected_sum(const std::string& contents) -> std::uint64_t
+{
+    std::uint64_t sum {};
+    for (const auto c : contents)
+    {
+        sum += static_cast<std::uint8_t>(c);
+    }
+
+    return sum;
+}
+
+template <typename FanOut>
+void test_fan_out(FanOut fan_out, std::size_t size)
+{
+    const char* filename {"test_fan_out.bin"};
+    const auto contents {make_contents(size)};
+    write_file(filename, contents);
+
+    boost::crypt::md5_hasher md5_1;
+    boost::crypt::md5_hasher md5_2;
+    byte_sum_hasher sum_hasher;
+
+    BOOST_TEST(fan_out(filename, md5_1, md5_2, sum_hasher));
+
+    const auto expected {boost::crypt::md5(contents)};
+    const auto res_1 {md5_1.get_digest()};
+    const auto res_2 {md5_2.get_digest()};
+
+    for (std::size_t i {}; i < expected.size(); ++i)
+    {
+        BOOST_TEST_EQ(res_1[i], expected[i]);
+        BOOST_TEST_EQ(res_2[i], expected[i]);
+    }
+
+    BOOST_TEST_EQ(sum_hasher.count, size);
+    BOOST_TEST_EQ(sum_hasher.sum, expected_sum(contents));
+
+    std::remove(filename);
+}
+
+struct sequential
+{
+    template <typename... Hashers>
+    auto operator()(const std::string& filename, Hashers&... hashers) const -> bool
+    {
+        return boost::crypt::utility::fan_out_file(filename, hashers...);
+    }
+};
+
+struct parallel
+{
+    template <typename... Hashers>
+    auto operator()(const std::string& filename, Hashers&... hashers) const -> bool
+    {
+        return boost::crypt::utility::parallel_fan_out_file(filename, hashers...);
+    }
+};
+
+void test_invalid_file()
+{
+    boost::crypt::md5_hasher hasher;
+    BOOST_TEST(!boost::crypt::utility::fan_out_file("broken.bin", hasher));
+    BOOST_TEST(!boost::crypt::utility::parallel_fan_out_file("broken.bin", hasher));
+}
+
+void test_throwing_hasher()
+{
+    const char* filename {"test_fan_out_throw.bin"};
+    write_file(filename, make_contents(3U * BOOST_CRYPT_FILE_BUFFER_SIZE));
+
+    boost::crypt::md5_hasher md5;
+    throwing_hasher thrower;
+    BOOST_TEST_THROWS(boost::crypt::utility::parallel_fan_out_file(filename, md5, thrower), std::runtime_error);
+
+    std::remove(filename);
+}
+
+int main()
+{
+    for (const auto size : {std::size_t{0U}, std::size_t{1U}, std::size_t{63U}, std::size_t{64U}, std::size_t{1000U},
+                            std::size_t{BOOST_CRYPT_FILE_BUFFER_SIZE}, std::size_t{5U * BOOST_CRYPT_FILE_BUFFER_SIZE + 17U}})
+    {
+        test_fan_out(sequential{}, size);
+        test_fan_out(parallel{}, size);
+    }
+
+    test_invalid_file();
+    test_throwing_hasher();
+
+    return boost::report_errors();
+}
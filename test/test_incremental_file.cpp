@@ -0,0 +1,229 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/hash/md5/incremental_file.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include "file_test_helpers.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+using crypt_test::digest_equal;
+using crypt_test::write_file;
+
+using digest_type = boost::crypt::array<boost::crypt::uint8_t, 16>;
+
+void test_state_round_trip()
+{
+    std::string message;
+    for (std::size_t i {}; i < 1000U; ++i)
+    {
+        message.push_back(static_cast<char>('a' + i % 26U));
+    }
+
+    for (const std::size_t split : {0U, 64U, 128U, 640U, 960U})
+    {
+        boost::crypt::md5_hasher first;
+        first.process_bytes(message.data(), split);
+
+        boost::crypt::md5_state state {};
+        BOOST_TEST(first.get_state(state));
+        BOOST_TEST_EQ(state.byte_count, split);
+
+        boost::crypt::md5_hasher second;
+        second.process_bytes("something else", 14U);
+        BOOST_TEST(second.set_state(state));
+        second.process_bytes(message.data() + split, message.size() - split);
+        BOOST_TEST(digest_equal(second.get_digest(), boost::crypt::md5(message)));
+    }
+
+    // The state is only defined on a block boundary
+    boost::crypt::md5_hasher partial;
+    partial.process_bytes(message.data(), 100U);
+    boost::crypt::md5_state state {};
+    BOOST_TEST(!partial.get_state(state));
+
+    state.byte_count = 100U;
+    BOOST_TEST(!partial.set_state(state));
+    partial.process_bytes(message.data() + 100U, message.size() - 100U);
+    BOOST_TEST(digest_equal(partial.get_digest(), boost::crypt::md5(message)));
+}
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+// Counts the bytes it is given, to show how much of the file was read
+class counting_hasher : public boost::crypt::md5_hasher
+{
+public:
+    std::size_t bytes {};
+
+    template <typename ForwardIter>
+    auto process_bytes(ForwardIter buffer, std::size_t byte_count) noexcept -> void
+    {
+        bytes += byte_count;
+        static_cast<void>(boost::crypt::md5_hasher::process_bytes(buffer, byte_count));
+    }
+};
+
+void test_incremental_hash_file()
+{
+    const std::string path {"test_incremental_file.log"};
+    const std::string state_path {"test_incremental_file.log.state"};
+    std::remove(state_path.c_str());
+
+    std::string contents;
+    for (std::size_t i {}; i < 100000U; ++i)
+    {
+        contents.push_back(static_cast<char>(i * 7U % 251U));
+    }
+    write_file(path, contents);
+
+    // Without a state the whole file is hashed
+    counting_hasher hasher;
+    std::error_code ec;
+    auto result {boost::crypt::utility::incremental_hash_file(path, state_path, hasher, ec)};
+    BOOST_TEST(!ec);
+    BOOST_TEST_EQ(result.resumed_from, 0U);
+    BOOST_TEST_EQ(result.size, contents.size());
+    BOOST_TEST_EQ(hasher.bytes, contents.size());
+    BOOST_TEST(digest_equal(hasher.get_digest(), boost::crypt::md5(contents)));
+
+    // After an append only the new bytes, and those after the last whole block, are read
+    const std::string appended(5000U, 'x');
+    write_file(path, appended, true);
+    contents += appended;
+
+    hasher = counting_hasher{};
+    result = boost::crypt::utility::incremental_hash_file(path, state_path, hasher, ec);
+    BOOST_TEST(!ec);
+    BOOST_TEST_EQ(result.resumed_from, 100000U - 100000U % 64U);
+    BOOST_TEST_EQ(result.size, contents.size());
+    BOOST_TEST_EQ(hasher.bytes, contents.size() - result.resumed_from);
+    BOOST_TEST(digest_equal(hasher.get_digest(), boost::crypt::md5(contents)));
+
+    // Nothing appended still gives the same digest
+    BOOST_TEST(digest_equal(boost::crypt::md5_file_incremental(path, state_path, ec), boost::crypt::md5(contents)));
+    BOOST_TEST(!ec);
+
+    // A file rewritten in place with different bytes near the end of what was hashed is hashed again from the start
+    contents[contents.size() - 2000U] = '\x01';
+    contents += "tail";
+    write_file(path, contents);
+
+    hasher = counting_hasher{};
+    result = boost::crypt::utility::incremental_hash_file(path, state_path, hasher, ec);
+    BOOST_TEST(!ec);
+    BOOST_TEST_EQ(result.resumed_from, 0U);
+    BOOST_TEST(digest_equal(hasher.get_digest(), boost::crypt::md5(contents)));
+
+    // So is one that was truncated
+    contents.resize(50000U);
+    write_file(path, contents);
+    hasher = counting_hasher{};
+    result = boost::crypt::utility::incremental_hash_file(path, state_path, hasher, ec);
+    BOOST_TEST(!ec);
+    BOOST_TEST_EQ(result.resumed_from, 0U);
+    BOOST_TEST(digest_equal(hasher.get_digest(), boost::crypt::md5(contents)));
+
+    // And one replaced by a new file with the same contents, as log rotation does
+    const std::string replacement {"test_incremental_file.new"};
+    write_file(replacement, contents);
+    BOOST_TEST_EQ(std::rename(replacement.c_str(), path.c_str()), 0);
+    hasher = counting_hasher{};
+    result = boost::crypt::utility::incremental_hash_file(path, state_path, hasher, ec);
+    BOOST_TEST(!ec);
+    BOOST_TEST_EQ(result.resumed_from, 0U);
+    BOOST_TEST(digest_equal(hasher.get_digest(), boost::crypt::md5(contents)));
+
+    // A state file that is damaged or missing only costs a full hash
+    write_file(state_path, "not a state file");
+    write_file(path, "more", true);
+    contents += "more";
+    BOOST_TEST(digest_equal(boost::crypt::md5_file_incremental(path, state_path, ec), boost::crypt::md5(contents)));
+    BOOST_TEST(!ec);
+
+    hasher = counting_hasher{};
+    result = boost::crypt::utility::incremental_hash_file(path, "test_incremental_missing/state", hasher, ec);
+    BOOST_TEST(!ec);
+    BOOST_TEST_EQ(result.resumed_from, 0U);
+    BOOST_TEST(digest_equal(hasher.get_digest(), boost::crypt::md5(contents)));
+
+    // Files shorter than a block have no state to save
+    const std::string short_path {"test_incremental_file.short"};
+    write_file(short_path, "short");
+    BOOST_TEST(digest_equal(boost::crypt::md5_file_incremental(short_path, ec), boost::crypt::md5("short")));
+    BOOST_TEST(!ec);
+    std::ifstream short_state(short_path + ".md5state");
+    BOOST_TEST(!short_state.is_open());
+
+    BOOST_TEST(digest_equal(boost::crypt::md5_file_incremental("test_incremental_missing.log", ec), digest_type{}));
+    BOOST_TEST(ec == std::errc::no_such_file_or_directory);
+
+    std::remove(path.c_str());
+    std::remove(state_path.c_str());
+    std::remove(short_path.c_str());
+}
+
+void test_concurrent_saves()
+{
+    const std::string path {"test_incremental_file_shared.log"};
+    const std::string state_path {"test_incremental_file_shared.log.state"};
+    std::remove(state_path.c_str());
+
+    const std::string contents(70000U, 'q');
+    write_file(path, contents);
+
+    // Threads sharing a state file each write their own temporary file, so the one left behind is always whole
+    std::vector<std::thread> threads;
+    std::vector<int> matches(8U);
+    for (std::size_t i {}; i < matches.size(); ++i)
+    {
+        threads.emplace_back([&, i]() {
+            for (std::size_t j {}; j < 20U; ++j)
+            {
+                std::error_code thread_ec;
+                const auto digest {boost::crypt::md5_file_incremental(path, state_path, thread_ec)};
+                matches[i] += !thread_ec && digest_equal(digest, boost::crypt::md5(contents)) ? 1 : 0;
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    for (const auto match : matches)
+    {
+        BOOST_TEST_EQ(match, 20);
+    }
+
+    counting_hasher hasher;
+    std::error_code ec;
+    const auto result {boost::crypt::utility::incremental_hash_file(path, state_path, hasher, ec)};
+    BOOST_TEST(!ec);
+    BOOST_TEST_EQ(result.resumed_from, contents.size() - contents.size() % 64U);
+
+    std::remove(path.c_str());
+    std::remove(state_path.c_str());
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+int main()
+{
+    test_state_round_trip();
+
+    #ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+    test_incremental_hash_file();
+    test_concurrent_saves();
+    #endif
+
+    return boost::report_errors();
+}
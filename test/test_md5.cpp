@@ -33,6 +33,7 @@
 #include <cstdlib>
 #include <ctime>
 #include <cstring>
+#include <vector>
 
 auto get_boost_uuid_result(const char* str, size_t length)
 {
@@ -209,6 +210,146 @@ void test_class()
     }
 }
 
+void test_process_zero_bytes()
+{
+    // Prefixes that leave buffer_ empty, partially full, and one byte short of a block
+    for (const std::size_t prefix : {0U, 1U, 55U, 63U, 64U, 100U})
+    {
+        for (const std::size_t zeros : {0U, 1U, 8U, 63U, 64U, 65U, 128U, 1000U, 4099U})
+        {
+            const std::string message(prefix, 'a');
+            const std::string padding(zeros, '\0');
+
+            boost::crypt::md5_hasher expected_hasher;
+            expected_hasher.process_bytes(message.c_str(), message.size());
+            expected_hasher.process_bytes(padding.c_str(), padding.size());
+            expected_hasher.process_bytes("tail", 4U);
+
+            boost::crypt::md5_hasher hasher;
+            hasher.process_bytes(message.c_str(), message.size());
+            hasher.process_zero_bytes(zeros);
+            hasher.process_bytes("tail", 4U);
+
+            const auto expected {expected_hasher.get_digest()};
+            const auto result {hasher.get_digest()};
+            for (std::size_t i {}; i < result.size(); ++i)
+            {
+                if (!BOOST_TEST_EQ(result[i], expected[i]))
+                {
+                    // LCOV_EXCL_START
+                    std::cerr << "Failure with prefix: " << prefix << " zeros: " << zeros << std::endl;
+                    break;
+                    // LCOV_EXCL_STOP
+                }
+            }
+        }
+    }
+}
+
+void test_process_buffers()
+{
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<std::size_t> segment_len(0, 200);
+
+    for (std::size_t i {}; i < 256; ++i)
+    {
+        // Segments of every length around the block size, including empty ones
+        std::vector<std::string> segments;
+        std::string message;
+        for (std::size_t j {}; j < i % 17U; ++j)
+        {
+            segments.emplace_back(segment_len(rng), static_cast<char>('a' + j));
+            message += segments.back();
+        }
+
+        boost::crypt::md5_hasher hasher;
+        hasher.process_bytes("prefix", 6U);
+        hasher.process_buffers(segments);
+        const auto buffers_result {hasher.get_digest()};
+
+        const auto expected {boost::crypt::md5("prefix" + message)};
+        for (std::size_t j {}; j < expected.size(); ++j)
+        {
+            if (!BOOST_TEST_EQ(buffers_result[j], expected[j]))
+            {
+                std::cerr << "Failure with segments: " << segments.size() << std::endl; // LCOV_EXCL_LINE
+                break; // LCOV_EXCL_LINE
+            }
+        }
+
+        #ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+        std::vector<struct iovec> iov;
+        for (auto& segment : segments)
+        {
+            iov.push_back({&segment[0], segment.size()});
+        }
+
+        hasher.init();
+        hasher.process_bytes("prefix", 6U);
+        hasher.process_iovec(iov.data(), iov.size());
+        const auto iovec_result {hasher.get_digest()};
+        for (std::size_t j {}; j < expected.size(); ++j)
+        {
+            if (!BOOST_TEST_EQ(iovec_result[j], expected[j]))
+            {
+                std::cerr << "Failure with iovec segments: " << segments.size() << std::endl; // LCOV_EXCL_LINE
+                break; // LCOV_EXCL_LINE
+            }
+        }
+        #endif
+    }
+}
+
+// Refers to part of a longer buffer, so a long chain can repeat one allocation
+struct byte_segment
+{
+    const char* ptr;
+    std::size_t len;
+
+    auto data() const -> const char* { return ptr; }
+    auto size() const -> std::size_t { return len; }
+};
+
+void test_process_buffers_large()
+{
+    // Each chain is 768 MiB, so the bit count of a single call spills past 32 bits and must carry across calls
+    std::string block(64U * 1024U * 1024U, 'z');
+    const std::vector<byte_segment> chain(12U, byte_segment{block.data(), block.size()});
+
+    boost::crypt::md5_hasher pieces;
+    boost::crypt::md5_hasher buffers;
+    for (std::size_t i {}; i < 3U; ++i)
+    {
+        for (std::size_t j {}; j < chain.size(); ++j)
+        {
+            pieces.process_bytes(block.data(), block.size());
+        }
+        buffers.process_buffers(chain);
+    }
+
+    const auto expected {pieces.get_digest()};
+    const auto result {buffers.get_digest()};
+    for (std::size_t j {}; j < expected.size(); ++j)
+    {
+        BOOST_TEST_EQ(result[j], expected[j]);
+    }
+
+    #ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+    const std::vector<struct iovec> iov(12U, iovec{&block[0], block.size()});
+    buffers.init();
+    for (std::size_t i {}; i < 3U; ++i)
+    {
+        buffers.process_iovec(iov.data(), iov.size());
+    }
+
+    const auto iovec_result {buffers.get_digest()};
+    for (std::size_t j {}; j < expected.size(); ++j)
+    {
+        BOOST_TEST_EQ(iovec_result[j], expected[j]);
+    }
+    #endif
+}
+
 template <typename T>
 void test_random_values()
 {
@@ -428,6 +569,10 @@ int main()
 
     test_class();
 
+    test_process_zero_bytes();
+    test_process_buffers();
+    test_process_buffers_large();
+
     test_random_values<char>();
     test_random_piecewise_values<char>();
 
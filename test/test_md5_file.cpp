@@ -0,0 +1,834 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/hash/md5/file.hpp>
+#include <boost/crypt/hash/md5/pipe.hpp>
+#include <boost/crypt/hash/md5/copy_file.hpp>
+#include <boost/crypt/hash/md5/pipeline.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include "file_test_helpers.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using crypt_test::check_digest;
+using crypt_test::make_contents;
+using crypt_test::write_file;
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+
+// Sizes around the 64-byte block and the file buffer boundaries
+constexpr std::size_t test_sizes[] {0U, 1U, 55U, 56U, 63U, 64U, 65U, 4095U, 4096U, 4097U,
+                                    BOOST_CRYPT_FILE_BUFFER_SIZE - 1U, BOOST_CRYPT_FILE_BUFFER_SIZE,
+                                    BOOST_CRYPT_FILE_BUFFER_SIZE + 1U, 3U * BOOST_CRYPT_FILE_BUFFER_SIZE + 100U};
+
+void test_md5_file()
+{
+    const char* filename {"test_md5_file.bin"};
+
+    for (const auto size : test_sizes)
+    {
+        const auto contents {make_contents(size)};
+        write_file(filename, contents);
+
+        const auto expected {boost::crypt::md5(contents)};
+        check_digest(boost::crypt::md5_file(filename), expected, size);
+        check_digest(boost::crypt::md5_file(filename, boost::crypt::utility::read_mode::automatic), expected, size);
+        check_digest(boost::crypt::md5_file(filename, boost::crypt::utility::read_mode::read), expected, size);
+        check_digest(boost::crypt::md5_file(filename, boost::crypt::utility::read_mode::mmap), expected, size);
+        check_digest(boost::crypt::md5_file(filename, boost::crypt::utility::read_mode::direct), expected, size);
+        check_digest(boost::crypt::md5_file(filename, boost::crypt::utility::read_mode::scan), expected, size);
+
+        const std::string str_filename {filename};
+        check_digest(boost::crypt::md5_file(str_filename, boost::crypt::utility::read_mode::mmap), expected, size);
+
+        #ifdef BOOST_CRYPT_HAS_STRING_VIEW
+        const std::string_view str_view_filename {str_filename};
+        check_digest(boost::crypt::md5_file(str_view_filename, boost::crypt::utility::read_mode::mmap), expected, size);
+        #endif
+    }
+
+    std::remove(filename);
+
+    const boost::crypt::array<boost::crypt::uint8_t, 16> zeros {};
+    check_digest(boost::crypt::md5_file("broken.bin", boost::crypt::utility::read_mode::mmap), zeros, 0U);
+    check_digest(boost::crypt::md5_file("broken.bin", boost::crypt::utility::read_mode::automatic), zeros, 0U);
+    check_digest(boost::crypt::md5_file("broken.bin", boost::crypt::utility::read_mode::direct), zeros, 0U);
+    check_digest(boost::crypt::md5_file("broken.bin", boost::crypt::utility::read_mode::scan), zeros, 0U);
+}
+
+void test_md5_file_pipelined()
+{
+    const char* filename {"test_md5_file_pipelined.bin"};
+
+    for (const auto size : test_sizes)
+    {
+        const auto contents {make_contents(size)};
+        write_file(filename, contents);
+
+        const auto expected {boost::crypt::md5(contents)};
+        check_digest(boost::crypt::md5_file_pipelined(filename), expected, size);
+
+        // Double buffering with small buffers gives many hand-offs between the threads
+        check_digest(boost::crypt::md5_file_pipelined(filename, 2U, 4096U), expected, size);
+        check_digest(boost::crypt::md5_file_pipelined(filename, 1U, 100U), expected, size);
+    }
+
+    std::remove(filename);
+
+    const boost::crypt::array<boost::crypt::uint8_t, 16> zeros {};
+    check_digest(boost::crypt::md5_file_pipelined("broken.bin"), zeros, 0U);
+}
+
+void test_md5_file_error_code()
+{
+    const char* filename {"test_md5_file_error_code.bin"};
+    const boost::crypt::array<boost::crypt::uint8_t, 16> zeros {};
+
+    for (const auto size : test_sizes)
+    {
+        const auto contents {make_contents(size)};
+        write_file(filename, contents);
+
+        // A successful hash clears any previous error
+        auto ec {std::make_error_code(std::errc::io_error)};
+        check_digest(boost::crypt::md5_file(filename, ec), boost::crypt::md5(contents), size);
+        BOOST_TEST(!ec);
+
+        ec = std::make_error_code(std::errc::io_error);
+        check_digest(boost::crypt::md5_file(std::string{filename}, ec), boost::crypt::md5(contents), size);
+        BOOST_TEST(!ec);
+
+        #ifdef BOOST_CRYPT_HAS_STRING_VIEW
+        ec = std::make_error_code(std::errc::io_error);
+        check_digest(boost::crypt::md5_file(std::string_view{filename}, ec), boost::crypt::md5(contents), size);
+        BOOST_TEST(!ec);
+        #endif
+    }
+
+    std::remove(filename);
+
+    std::error_code ec;
+    check_digest(boost::crypt::md5_file("broken.bin", ec), zeros, 0U);
+    BOOST_TEST(ec == std::errc::no_such_file_or_directory);
+
+    ec.clear();
+    check_digest(boost::crypt::md5_file(static_cast<const char*>(nullptr), ec), zeros, 0U);
+    BOOST_TEST(ec == std::errc::invalid_argument);
+
+    #ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+    // Directories open, but fail when read
+    ec.clear();
+    check_digest(boost::crypt::md5_file(".", ec), zeros, 0U);
+    BOOST_TEST(ec == std::errc::is_a_directory);
+    #endif
+}
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+void test_posix_file_reader()
+{
+    const char* filename {"test_posix_file_reader.bin"};
+
+    for (const auto size : test_sizes)
+    {
+        const auto contents {make_contents(size)};
+        write_file(filename, contents);
+
+        // Small buffers are rounded up to the filesystem block size
+        boost::crypt::utility::posix_file_reader reader(filename, 100U);
+        BOOST_TEST_GE(reader.buffer_size(), 100U);
+
+        std::size_t total {};
+        boost::crypt::md5_hasher hasher;
+        while (!reader.eof())
+        {
+            const auto data {reader.read_next_block()};
+            const auto len {reader.get_bytes_read()};
+
+            // Every block except the last is full
+            BOOST_TEST(len == reader.buffer_size() || reader.eof());
+
+            hasher.process_bytes(data, len);
+            total += len;
+        }
+
+        BOOST_TEST_EQ(total, size);
+        BOOST_TEST_EQ(reader.error(), 0);
+        check_digest(hasher.get_digest(), boost::crypt::md5(contents), size);
+
+        // More segments than fit in one batch, including empty ones
+        std::vector<std::vector<std::uint8_t>> segments;
+        std::vector<struct iovec> iov;
+        for (std::size_t i {}; i < 100U; ++i)
+        {
+            segments.emplace_back((i * 4099U) % 9000U);
+        }
+        for (auto& segment : segments)
+        {
+            iov.push_back({segment.data(), segment.size()});
+        }
+
+        boost::crypt::utility::posix_file_reader iov_reader(filename);
+        boost::crypt::md5_hasher iov_hasher;
+        total = 0U;
+        while (!iov_reader.eof())
+        {
+            auto len {iov_reader.read_into(iov.data(), iov.size())};
+            total += len;
+
+            std::vector<struct iovec> filled;
+            for (std::size_t i {}; i < iov.size() && len > 0U; ++i)
+            {
+                filled.push_back({iov[i].iov_base, (std::min)(len, iov[i].iov_len)});
+                len -= filled.back().iov_len;
+            }
+            iov_hasher.process_iovec(filled.data(), filled.size());
+        }
+
+        BOOST_TEST_EQ(total, size);
+        BOOST_TEST_EQ(iov_reader.error(), 0);
+        check_digest(iov_hasher.get_digest(), boost::crypt::md5(contents), size);
+
+        // A range stops partway through the buffers
+        boost::crypt::utility::posix_file_reader range_reader(filename, 10U, 100000U);
+        const auto range_len {range_reader.read_into(iov.data(), iov.size())};
+        BOOST_TEST_EQ(range_len, size > 10U ? (std::min)(size - 10U, std::size_t{100000U}) : 0U);
+        BOOST_TEST(range_reader.eof());
+    }
+
+    std::remove(filename);
+
+    BOOST_TEST_THROWS(boost::crypt::utility::posix_file_reader("broken.bin"), std::runtime_error);
+}
+
+void test_mapped_file_reader()
+{
+    const char* filename {"test_mapped_file_reader.bin"};
+
+    for (const auto size : test_sizes)
+    {
+        const auto contents {make_contents(size)};
+        write_file(filename, contents);
+
+        // Use a single page window so that larger files are mapped in several windows
+        boost::crypt::utility::mapped_file_reader reader(filename, 1U);
+        BOOST_TEST_EQ(reader.file_size(), size);
+
+        std::size_t total {};
+        boost::crypt::md5_hasher hasher;
+        while (!reader.eof())
+        {
+            const auto data {reader.read_next_block()};
+            const auto len {reader.get_bytes_read()};
+            hasher.process_bytes(data, len);
+            total += len;
+        }
+
+        BOOST_TEST_EQ(total, size);
+        BOOST_TEST_EQ(reader.error(), 0);
+        check_digest(hasher.get_digest(), boost::crypt::md5(contents), size);
+    }
+
+    std::remove(filename);
+
+    BOOST_TEST_THROWS(boost::crypt::utility::mapped_file_reader("broken.bin"), std::runtime_error);
+}
+
+auto resident_page_count(const char* filename) -> std::size_t
+{
+    const int fd {open(filename, O_RDONLY)};
+    struct stat st {};
+    fstat(fd, &st);
+
+    std::vector<unsigned char> resident;
+    boost::crypt::utility::detail::resident_pages(fd, 0U, static_cast<std::size_t>(st.st_size), resident);
+    close(fd);
+
+    std::size_t count {};
+    for (const auto page : resident)
+    {
+        count += page & 1U;
+    }
+
+    return count;
+}
+
+void test_scan_file_reader()
+{
+    const char* filename {"test_scan_file_reader.bin"};
+
+    for (const auto size : test_sizes)
+    {
+        const auto contents {make_contents(size)};
+        write_file(filename, contents);
+
+        for (const auto readahead : {std::size_t{0U}, std::size_t{4096U}, std::size_t{BOOST_CRYPT_SCAN_READAHEAD_SIZE}})
+        {
+            boost::crypt::utility::scan_file_reader reader(filename, 100U, readahead);
+            BOOST_TEST_EQ(reader.file_size(), size);
+
+            std::size_t total {};
+            boost::crypt::md5_hasher hasher;
+            while (!reader.eof())
+            {
+                const auto data {reader.read_next_block()};
+                const auto len {reader.get_bytes_read()};
+                BOOST_TEST(len == reader.buffer_size() || reader.eof());
+                hasher.process_bytes(data, len);
+                total += len;
+            }
+
+            BOOST_TEST_EQ(total, size);
+            BOOST_TEST_EQ(reader.error(), 0);
+            check_digest(hasher.get_digest(), boost::crypt::md5(contents), size);
+        }
+    }
+
+    #ifdef POSIX_FADV_DONTNEED
+    // Evict the file, and cache only its first half without the kernel reading ahead into the second half
+    const auto contents {make_contents(8U * BOOST_CRYPT_FILE_BUFFER_SIZE)};
+    write_file(filename, contents);
+    {
+        const int fd {open(filename, O_RDONLY)};
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_RANDOM);
+        std::string half(contents.size() / 2U, '\0');
+        BOOST_TEST_EQ(pread(fd, &half[0], half.size(), 0), static_cast<ssize_t>(half.size()));
+        close(fd);
+    }
+
+    // A scan must not leave any more of the file cached than there was before
+    const auto before {resident_page_count(filename)};
+    check_digest(boost::crypt::md5_file(filename, boost::crypt::utility::read_mode::scan), boost::crypt::md5(contents), contents.size());
+    BOOST_TEST_LE(resident_page_count(filename), before);
+    #endif
+
+    std::remove(filename);
+
+    BOOST_TEST_THROWS(boost::crypt::utility::scan_file_reader("broken.bin"), std::runtime_error);
+}
+
+#ifdef BOOST_CRYPT_HAS_DIRECT_IO
+
+void test_direct_file_reader()
+{
+    const char* filename {"test_direct_file_reader.bin"};
+
+    for (const auto size : test_sizes)
+    {
+        const auto contents {make_contents(size)};
+        write_file(filename, contents);
+
+        // Small buffers with a deep queue give many reads in flight, and depth 1 reads synchronously
+        for (const std::size_t depth : {1U, 3U, 8U})
+        {
+            boost::crypt::utility::direct_file_reader reader(filename, 100U, depth);
+            BOOST_TEST_EQ(reader.file_size(), size);
+            BOOST_TEST_EQ(reader.queue_depth(), depth);
+            BOOST_TEST_EQ(reader.buffer_size() % reader.alignment(), 0U);
+
+            std::size_t total {};
+            boost::crypt::md5_hasher hasher;
+            while (!reader.eof())
+            {
+                const auto data {reader.read_next_block()};
+                const auto len {reader.get_bytes_read()};
+
+                // Every block except the last is full, and the buffers are aligned for O_DIRECT
+                BOOST_TEST(len == reader.buffer_size() || reader.eof());
+                BOOST_TEST_EQ(reinterpret_cast<std::uintptr_t>(data) % reader.alignment(), 0U);
+
+                hasher.process_bytes(data, len);
+                total += len;
+            }
+
+            BOOST_TEST_EQ(total, size);
+            BOOST_TEST_EQ(reader.error(), 0);
+            check_digest(hasher.get_digest(), boost::crypt::md5(contents), size);
+        }
+    }
+
+    std::remove(filename);
+
+    BOOST_TEST_THROWS(boost::crypt::utility::direct_file_reader("broken.bin"), std::runtime_error);
+}
+
+#endif // BOOST_CRYPT_HAS_DIRECT_IO
+
+void test_md5_file_descriptor()
+{
+    const char* filename {"test_md5_file_descriptor.bin"};
+    constexpr std::size_t size {3U * BOOST_CRYPT_FILE_BUFFER_SIZE + 100U};
+    const auto contents {make_contents(size)};
+    write_file(filename, contents);
+
+    const int fd {open(filename, O_RDONLY)};
+    BOOST_TEST(fd >= 0);
+
+    // The whole file is hashed regardless of the file position, which is left where it was
+    BOOST_TEST_EQ(lseek(fd, 123, SEEK_SET), 123);
+    check_digest(boost::crypt::md5_file(fd), boost::crypt::md5(contents), size);
+    BOOST_TEST_EQ(lseek(fd, 0, SEEK_CUR), 123);
+
+    const std::vector<std::pair<std::size_t, std::size_t>> ranges {
+        {0U, 0U}, {0U, 1U}, {100U, 64U}, {BOOST_CRYPT_FILE_BUFFER_SIZE - 1U, BOOST_CRYPT_FILE_BUFFER_SIZE + 2U},
+        {size - 10U, 100U}, {size + 5U, 10U}, {7U, size}
+    };
+
+    for (const auto& range : ranges)
+    {
+        const auto expected {boost::crypt::md5(contents.substr((std::min)(range.first, size), range.second))};
+        check_digest(boost::crypt::md5_file(fd, range.first, range.second), expected, range.first);
+        check_digest(boost::crypt::md5_file(filename, range.first, range.second), expected, range.first);
+        check_digest(boost::crypt::md5_file(std::string{filename}, range.first, range.second), expected, range.first);
+    }
+    BOOST_TEST_EQ(lseek(fd, 0, SEEK_CUR), 123);
+
+    // Each thread hashes its own part of the shared descriptor
+    constexpr std::size_t parts {4U};
+    constexpr std::size_t part_size {size / parts + 1U};
+    std::vector<boost::crypt::array<boost::crypt::uint8_t, 16>> digests(parts);
+    std::vector<std::thread> threads;
+    for (std::size_t i {}; i < parts; ++i)
+    {
+        threads.emplace_back([&digests, fd, i]() { digests[i] = boost::crypt::md5_file(fd, i * part_size, part_size); });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    for (std::size_t i {}; i < parts; ++i)
+    {
+        check_digest(digests[i], boost::crypt::md5(contents.substr(i * part_size, part_size)), i);
+    }
+
+    close(fd);
+
+    std::FILE* file {std::fopen(filename, "rb")};
+    BOOST_TEST(file != nullptr);
+    BOOST_TEST_EQ(std::fseek(file, 10, SEEK_SET), 0);
+    check_digest(boost::crypt::md5_file(file), boost::crypt::md5(contents), size);
+    check_digest(boost::crypt::md5_file(file, 5U, 1000U), boost::crypt::md5(contents.substr(5U, 1000U)), size);
+    BOOST_TEST_EQ(std::ftell(file), 10);
+    std::fclose(file);
+
+    std::remove(filename);
+
+    const boost::crypt::array<boost::crypt::uint8_t, 16> zeros {};
+    check_digest(boost::crypt::md5_file(-1), zeros, 0U);
+    check_digest(boost::crypt::md5_file(static_cast<std::FILE*>(nullptr)), zeros, 0U);
+    check_digest(boost::crypt::md5_file("broken.bin", 0U, 10U), zeros, 0U);
+
+    // Pipes are read from where they are, so only a range starting at 0 can be hashed
+    int pipe_fds[2] {};
+    BOOST_TEST_EQ(pipe(pipe_fds), 0);
+    const std::string message {"The quick brown fox jumps over the lazy dog"};
+    BOOST_TEST_EQ(write(pipe_fds[1], message.data(), message.size()), static_cast<ssize_t>(message.size()));
+    close(pipe_fds[1]);
+    check_digest(boost::crypt::md5_file(pipe_fds[0], 0U, 10U), boost::crypt::md5(message.substr(0U, 10U)), 10U);
+    check_digest(boost::crypt::md5_file(pipe_fds[0], 5U, 10U), zeros, 10U);
+    check_digest(boost::crypt::md5_file(pipe_fds[0]), boost::crypt::md5(message.substr(10U)), message.size());
+    close(pipe_fds[0]);
+}
+
+#ifdef BOOST_CRYPT_HAS_SEEK_HOLE
+
+struct data_segment
+{
+    std::size_t offset;
+    std::size_t size;
+};
+
+// Creates a file of size bytes that is a hole apart from the segments, and returns its contents
+auto write_sparse_file(const char* filename, std::size_t size, const std::vector<data_segment>& segments) -> std::string
+{
+    std::string contents(size, '\0');
+
+    std::remove(filename);
+    const int fd {open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0600)};
+    BOOST_TEST(fd >= 0);
+    BOOST_TEST_EQ(ftruncate(fd, static_cast<off_t>(size)), 0);
+
+    for (const auto& segment : segments)
+    {
+        const auto data {make_contents(segment.size)};
+        contents.replace(segment.offset, segment.size, data);
+        BOOST_TEST_EQ(pwrite(fd, data.data(), data.size(), static_cast<off_t>(segment.offset)), static_cast<ssize_t>(data.size()));
+    }
+
+    close(fd);
+    return contents;
+}
+
+void test_sparse_file_reader()
+{
+    const char* filename {"test_sparse_file_reader.bin"};
+    constexpr std::size_t mib {1048576U};
+
+    const std::vector<std::pair<std::size_t, std::vector<data_segment>>> layouts {
+        {10U * mib + 123U, {}},
+        {9U * mib, {{0U, 5000U}, {6U * mib + 7U, 70000U}}},
+        {3U * mib + 100U, {{3U * mib, 100U}}},
+        {2U * mib, {{0U, 2U * mib}}},
+    };
+
+    for (const auto& layout : layouts)
+    {
+        const auto size {layout.first};
+        const auto contents {write_sparse_file(filename, size, layout.second)};
+        const auto expected {boost::crypt::md5(contents)};
+
+        check_digest(boost::crypt::md5_file(filename), expected, size);
+        check_digest(boost::crypt::md5_file(filename, boost::crypt::utility::read_mode::read), expected, size);
+        check_digest(boost::crypt::md5_file(filename, boost::crypt::utility::read_mode::mmap), expected, size);
+
+        for (const std::size_t buffer_size : {std::size_t{0U}, std::size_t{4096U}, std::size_t{100000U}})
+        {
+            boost::crypt::utility::sparse_file_reader reader(filename, buffer_size);
+            BOOST_TEST_EQ(reader.file_size(), size);
+
+            std::size_t total {};
+            boost::crypt::md5_hasher hasher;
+            while (!reader.eof())
+            {
+                const auto data {reader.read_next_block()};
+                const auto len {reader.get_bytes_read()};
+                BOOST_TEST(len <= (reader.hole() ? boost::crypt::utility::sparse_zero_block_size : reader.buffer_size()));
+
+                if (reader.hole())
+                {
+                    BOOST_TEST(std::all_of(contents.begin() + static_cast<std::ptrdiff_t>(total),
+                                           contents.begin() + static_cast<std::ptrdiff_t>(total + len),
+                                           [](char c) { return c == '\0'; }));
+                    hasher.process_zero_bytes(len);
+                }
+                else
+                {
+                    hasher.process_bytes(data, len);
+                }
+                total += len;
+            }
+
+            BOOST_TEST_EQ(total, size);
+            BOOST_TEST_EQ(reader.error(), 0);
+            check_digest(hasher.get_digest(), expected, size);
+
+            // Filesystems without holes report the whole file as data
+            struct stat st {};
+            if (stat(filename, &st) == 0 && boost::crypt::utility::detail::is_sparse(st))
+            {
+                BOOST_TEST_GT(reader.hole_bytes(), 0U);
+            }
+        }
+    }
+
+    std::remove(filename);
+
+    BOOST_TEST_THROWS(boost::crypt::utility::sparse_file_reader("broken.bin"), std::runtime_error);
+}
+
+#endif // BOOST_CRYPT_HAS_SEEK_HOLE
+
+// Writes contents into fd in uneven chunks from another thread, then closes it
+auto start_writer(int fd, const std::string& contents) -> std::thread
+{
+    return std::thread([fd, &contents]() {
+        std::size_t offset {};
+        std::size_t chunk {1U};
+        while (offset < contents.size())
+        {
+            const auto len {(std::min)(chunk, contents.size() - offset)};
+            const auto res {write(fd, contents.data() + offset, len)};
+            if (res <= 0)
+            {
+                break; // LCOV_EXCL_LINE
+            }
+            offset += static_cast<std::size_t>(res);
+            chunk = chunk * 7U % 300001U;
+        }
+        close(fd);
+    });
+}
+
+// Reads fd until it is closed from another thread
+auto start_drain(int fd, std::string& output) -> std::thread
+{
+    return std::thread([fd, &output]() {
+        char buffer[65536];
+        ssize_t res {};
+        while ((res = read(fd, buffer, sizeof(buffer))) > 0)
+        {
+            output.append(buffer, static_cast<std::size_t>(res));
+        }
+    });
+}
+
+void test_pipe()
+{
+    const auto contents {make_contents(3U * BOOST_CRYPT_FILE_BUFFER_SIZE + 100U)};
+    const auto expected {boost::crypt::md5(contents)};
+
+    for (const std::size_t size : {std::size_t{0U}, std::size_t{1U}, std::size_t{4096U}, contents.size()})
+    {
+        const auto message {contents.substr(0U, size)};
+
+        int fds[2] {};
+        BOOST_TEST_EQ(pipe(fds), 0);
+        const auto flags {fcntl(fds[0], F_GETFL)};
+
+        auto writer {start_writer(fds[1], message)};
+        std::error_code ec;
+        check_digest(boost::crypt::md5_pipe(fds[0], ec), boost::crypt::md5(message), size);
+        BOOST_TEST(!ec);
+        writer.join();
+
+        // The descriptor is left blocking as it was found
+        BOOST_TEST_EQ(fcntl(fds[0], F_GETFL), flags);
+        close(fds[0]);
+    }
+
+    // Nor is it made non-blocking while it is being read, as another process sharing it would see that
+    {
+        int fds[2] {};
+        BOOST_TEST_EQ(pipe(fds), 0);
+        const auto flags {fcntl(fds[0], F_GETFL)};
+
+        int flags_while_reading {};
+        std::thread writer([&]() {
+            BOOST_TEST_EQ(write(fds[1], contents.data(), 100U), 100);
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            flags_while_reading = fcntl(fds[0], F_GETFL);
+            BOOST_TEST_EQ(write(fds[1], contents.data() + 100U, 100U), 100);
+            close(fds[1]);
+        });
+
+        std::error_code ec;
+        check_digest(boost::crypt::md5_pipe(fds[0], ec), boost::crypt::md5(contents.substr(0U, 200U)), 200U);
+        BOOST_TEST(!ec);
+        writer.join();
+        BOOST_TEST_EQ(flags_while_reading, flags);
+        close(fds[0]);
+    }
+
+    // A descriptor the caller made non-blocking is read the same way
+    {
+        int fds[2] {};
+        BOOST_TEST_EQ(pipe(fds), 0);
+        BOOST_TEST_EQ(fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK), 0);
+
+        auto writer {start_writer(fds[1], contents)};
+        std::error_code ec;
+        check_digest(boost::crypt::md5_pipe(fds[0], ec), expected, contents.size());
+        BOOST_TEST(!ec);
+        writer.join();
+        BOOST_TEST((fcntl(fds[0], F_GETFL) & O_NONBLOCK) != 0);
+        close(fds[0]);
+    }
+
+    // Pipe to pipe passes through with tee(2)
+    {
+        int in[2] {};
+        int out[2] {};
+        BOOST_TEST_EQ(pipe(in), 0);
+        BOOST_TEST_EQ(pipe(out), 0);
+
+        std::string output;
+        auto writer {start_writer(in[1], contents)};
+        auto drain {start_drain(out[0], output)};
+
+        std::error_code ec;
+        check_digest(boost::crypt::md5_pipe_through(in[0], out[1], ec), expected, contents.size());
+        BOOST_TEST(!ec);
+
+        close(out[1]);
+        writer.join();
+        drain.join();
+        close(in[0]);
+        close(out[0]);
+        BOOST_TEST(output == contents);
+    }
+
+    // Pipe to a regular file is read and written
+    {
+        const char* filename {"test_md5_pipe.bin"};
+        int in[2] {};
+        BOOST_TEST_EQ(pipe(in), 0);
+        const int out {open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0600)};
+        BOOST_TEST(out >= 0);
+
+        auto writer {start_writer(in[1], contents)};
+        check_digest(boost::crypt::md5_pipe_through(in[0], out), expected, contents.size());
+        writer.join();
+        close(in[0]);
+        close(out);
+
+        check_digest(boost::crypt::md5_file(filename), expected, contents.size());
+        std::remove(filename);
+    }
+
+    const boost::crypt::array<boost::crypt::uint8_t, 16> zeros {};
+    std::error_code ec;
+    check_digest(boost::crypt::md5_pipe(-1, ec), zeros, 0U);
+    BOOST_TEST(ec == std::errc::bad_file_descriptor);
+    check_digest(boost::crypt::md5_pipe_through(-1, -1, ec), zeros, 0U);
+    BOOST_TEST(ec == std::errc::bad_file_descriptor);
+}
+
+void test_fifo()
+{
+    const char* filename {"test_md5_file.fifo"};
+    std::remove(filename);
+    if (mkfifo(filename, 0600) != 0)
+    {
+        return; // LCOV_EXCL_LINE
+    }
+
+    const auto contents {make_contents(3U * BOOST_CRYPT_FILE_BUFFER_SIZE + 7U)};
+
+    const auto pid {fork()};
+    if (pid == 0)
+    {
+        const int fd {open(filename, O_WRONLY)};
+        std::size_t written {};
+        while (fd >= 0 && written < contents.size())
+        {
+            const auto res {write(fd, contents.data() + written, contents.size() - written)};
+            if (res <= 0)
+            {
+                break;
+            }
+            written += static_cast<std::size_t>(res);
+        }
+        _exit(0);
+    }
+
+    // Pipes can not be mapped so this falls back to reading
+    check_digest(boost::crypt::md5_file(filename, boost::crypt::utility::read_mode::mmap), boost::crypt::md5(contents), contents.size());
+
+    int status {};
+    waitpid(pid, &status, 0);
+    std::remove(filename);
+}
+
+void test_copy_file()
+{
+    const char* from {"test_md5_copy_from.bin"};
+    const char* to {"test_md5_copy_to.bin"};
+
+    const auto contents {make_contents(3U * BOOST_CRYPT_FILE_BUFFER_SIZE + 100U)};
+    for (const std::size_t size : {std::size_t{0U}, std::size_t{1U}, std::size_t{4096U}, std::size_t{4097U},
+                                   std::size_t{BOOST_CRYPT_FILE_BUFFER_SIZE + 1U}, contents.size()})
+    {
+        const auto message {contents.substr(0U, size)};
+        write_file(from, message);
+        const auto expected {boost::crypt::md5(message)};
+
+        for (const auto mode : {boost::crypt::utility::copy_mode::buffered, boost::crypt::utility::copy_mode::direct})
+        {
+            for (const auto sync : {boost::crypt::utility::copy_sync::none, boost::crypt::utility::copy_sync::data,
+                                    boost::crypt::utility::copy_sync::all})
+            {
+                std::remove(to);
+                std::error_code ec;
+                check_digest(boost::crypt::md5_copy_file(from, to, ec, sync, mode), expected, size);
+                BOOST_TEST(!ec);
+                check_digest(boost::crypt::md5_file(to), expected, size);
+            }
+        }
+
+        // An existing destination is truncated
+        write_file(to, contents + contents);
+        check_digest(boost::crypt::md5_copy_file(std::string{from}, std::string{to}), expected, size);
+        check_digest(boost::crypt::md5_file(to), expected, size);
+    }
+
+    // Small buffers and a shallow queue keep the three threads waiting on each other
+    {
+        write_file(from, contents);
+        boost::crypt::md5_hasher hasher;
+        BOOST_TEST(!boost::crypt::utility::copy_and_hash_file(from, to, hasher, boost::crypt::utility::copy_sync::none,
+                                                              boost::crypt::utility::copy_mode::buffered, 1U, 4096U));
+        check_digest(hasher.get_digest(), boost::crypt::md5(contents), contents.size());
+        check_digest(boost::crypt::md5_file(to), boost::crypt::md5(contents), contents.size());
+    }
+
+    // The copy gets the permissions of the source
+    {
+        std::remove(to);
+        BOOST_TEST_EQ(chmod(from, 0640), 0);
+        std::error_code ec;
+        boost::crypt::md5_copy_file(from, to, ec);
+        BOOST_TEST(!ec);
+        struct stat st {};
+        BOOST_TEST_EQ(stat(to, &st), 0);
+        BOOST_TEST_EQ(st.st_mode & 0777, 0640U);
+    }
+
+    const boost::crypt::array<boost::crypt::uint8_t, 16> zeros {};
+    std::error_code ec;
+
+    // Copying a file onto itself must not truncate it
+    check_digest(boost::crypt::md5_copy_file(from, from, ec), zeros, 0U);
+    BOOST_TEST(ec == std::errc::invalid_argument);
+    check_digest(boost::crypt::md5_file(from), boost::crypt::md5(contents), contents.size());
+
+    check_digest(boost::crypt::md5_copy_file("test_md5_copy_missing.bin", to, ec), zeros, 0U);
+    BOOST_TEST(ec == std::errc::no_such_file_or_directory);
+
+    check_digest(boost::crypt::md5_copy_file(from, "test_md5_copy_missing_dir/to.bin", ec), zeros, 0U);
+    BOOST_TEST(ec == std::errc::no_such_file_or_directory);
+
+    check_digest(boost::crypt::md5_copy_file(nullptr, to, ec), zeros, 0U);
+    BOOST_TEST(ec == std::errc::invalid_argument);
+
+    std::remove(from);
+    std::remove(to);
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+int main()
+{
+    test_md5_file();
+    test_md5_file_pipelined();
+    test_md5_file_error_code();
+
+    #ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+    test_posix_file_reader();
+    test_mapped_file_reader();
+    test_scan_file_reader();
+    test_md5_file_descriptor();
+    test_pipe();
+    test_fifo();
+    test_copy_file();
+    #endif
+
+    #ifdef BOOST_CRYPT_HAS_DIRECT_IO
+    test_direct_file_reader();
+    #endif
+
+    #ifdef BOOST_CRYPT_HAS_SEEK_HOLE
+    test_sparse_file_reader();
+    #endif
+
+    return boost::report_errors();
+}
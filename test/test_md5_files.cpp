@@ -0,0 +1,197 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/hash/md5/multi_file.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include "file_test_helpers.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+using crypt_test::digest_equal;
+using crypt_test::make_contents;
+using crypt_test::write_file;
+
+using digest_type = boost::crypt::array<boost::crypt::uint8_t, 16>;
+
+struct test_files
+{
+    std::vector<std::string> paths;
+    std::vector<digest_type> expected;
+
+    // Every third path does not exist
+    explicit test_files(std::size_t count)
+    {
+        for (std::size_t i {}; i < count; ++i)
+        {
+            paths.emplace_back("test_md5_files_" + std::to_string(i) + ".bin");
+
+            if (i % 3U == 2U)
+            {
+                std::remove(paths.back().c_str());
+                expected.emplace_back();
+                continue;
+            }
+
+            // Mix of empty, small, and multi-buffer files
+            const auto contents {make_contents((i * 7919U) % 300000U)};
+            write_file(paths.back(), contents);
+            expected.emplace_back(boost::crypt::md5(contents));
+        }
+    }
+
+    test_files(const test_files&) = delete;
+    auto operator=(const test_files&) -> test_files& = delete;
+
+    ~test_files()
+    {
+        for (const auto& path : paths)
+        {
+            std::remove(path.c_str());
+        }
+    }
+};
+
+template <typename Run>
+void check_callback(const test_files& files, Run run)
+{
+    std::vector<int> seen(files.paths.size());
+
+    run([&](std::size_t index, boost::crypt::md5_hasher& hasher, const std::error_code& ec) {
+        ++seen[index];
+        if (index % 3U == 2U)
+        {
+            BOOST_TEST(ec == std::errc::no_such_file_or_directory);
+        }
+        else
+        {
+            BOOST_TEST(!ec);
+            BOOST_TEST(digest_equal(hasher.get_digest(), files.expected[index]));
+        }
+    });
+
+    for (const auto count : seen)
+    {
+        BOOST_TEST_EQ(count, 1);
+    }
+}
+
+void test_md5_files()
+{
+    const test_files files(100U);
+
+    const auto digests {boost::crypt::md5_files(files.paths)};
+    BOOST_TEST_EQ(digests.size(), files.paths.size());
+    for (std::size_t i {}; i < digests.size(); ++i)
+    {
+        if (!BOOST_TEST(digest_equal(digests[i], files.expected[i])))
+        {
+            std::cerr << "Failure with file: " << files.paths[i] << std::endl; // LCOV_EXCL_LINE
+        }
+    }
+
+    std::size_t failures {};
+    boost::crypt::md5_files(files.paths, [&](std::size_t index, const digest_type& digest, const std::error_code& ec) {
+        failures += ec ? 1U : 0U;
+        BOOST_TEST(digest_equal(digest, files.expected[index]));
+    }, 8U, 4096U);
+    BOOST_TEST_EQ(failures, 33U);
+
+    BOOST_TEST(boost::crypt::md5_files(std::vector<std::string>{}).empty());
+
+    // Every file gets a status, and stale statuses are replaced
+    std::vector<std::error_code> ec(3U, std::make_error_code(std::errc::io_error));
+    const auto checked {boost::crypt::md5_files(files.paths, ec)};
+    BOOST_TEST_EQ(ec.size(), files.paths.size());
+    for (std::size_t i {}; i < checked.size(); ++i)
+    {
+        BOOST_TEST(digest_equal(checked[i], files.expected[i]));
+        BOOST_TEST(i % 3U == 2U ? ec[i] == std::errc::no_such_file_or_directory : !ec[i]);
+    }
+}
+
+void test_thread_pool_hash_files()
+{
+    const test_files files(50U);
+
+    for (const std::size_t threads : {0U, 1U, 3U, 64U})
+    {
+        check_callback(files, [&](const auto& callback) {
+            boost::crypt::utility::thread_pool_hash_files<boost::crypt::md5_hasher>(files.paths, callback, threads, 1000U);
+        });
+    }
+
+    // An exception from the callback stops the remaining files and is propagated
+    BOOST_TEST_THROWS(boost::crypt::utility::thread_pool_hash_files<boost::crypt::md5_hasher>(files.paths,
+        [](std::size_t, boost::crypt::md5_hasher&, const std::error_code&) { throw std::runtime_error("callback"); }, 4U),
+        std::runtime_error);
+}
+
+#ifdef BOOST_CRYPT_HAS_IO_URING
+
+struct throwing_hasher : boost::crypt::md5_hasher
+{
+    auto process_bytes(const std::uint8_t*, std::size_t) -> void
+    {
+        throw std::runtime_error("hasher");
+    }
+};
+
+void test_io_uring_hash_files()
+{
+    const test_files files(50U);
+
+    // Hashed on the calling thread, and on a pool
+    for (const std::size_t hash_threads : {1U, 4U})
+    for (const std::size_t in_flight : {1U, 4U, 256U})
+    {
+        bool supported {};
+        check_callback(files, [&](const auto& callback) {
+            supported = boost::crypt::utility::io_uring_hash_files<boost::crypt::md5_hasher>(files.paths, callback, in_flight, 4096U,
+                                                                                             hash_threads);
+            if (!supported)
+            {
+                // LCOV_EXCL_START
+                std::cerr << "io_uring not supported, using threads" << std::endl;
+                boost::crypt::utility::thread_pool_hash_files<boost::crypt::md5_hasher>(files.paths, callback);
+                // LCOV_EXCL_STOP
+            }
+        });
+
+        if (!supported)
+        {
+            return; // LCOV_EXCL_LINE
+        }
+    }
+
+    BOOST_TEST_THROWS(boost::crypt::utility::io_uring_hash_files<boost::crypt::md5_hasher>(files.paths,
+        [](std::size_t, boost::crypt::md5_hasher&, const std::error_code&) { throw std::runtime_error("callback"); }, 16U),
+        std::runtime_error);
+
+    // A hasher that throws on a pool thread stops the hashing on the calling thread
+    BOOST_TEST_THROWS(boost::crypt::utility::io_uring_hash_files<throwing_hasher>(files.paths,
+        [](std::size_t, throwing_hasher&, const std::error_code&) {}, 16U, 4096U, 4U),
+        std::runtime_error);
+}
+
+#endif // BOOST_CRYPT_HAS_IO_URING
+
+int main()
+{
+    test_md5_files();
+    test_thread_pool_hash_files();
+
+    #ifdef BOOST_CRYPT_HAS_IO_URING
+    test_io_uring_hash_files();
+    #endif
+
+    return boost::report_errors();
+}
@@ -0,0 +1,229 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/hash/md5/records.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include "file_test_helpers.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+using crypt_test::digest_equal;
+using crypt_test::write_file;
+
+using digest_type = boost::crypt::array<boost::crypt::uint8_t, 16>;
+
+auto as_bytes(const std::string& str) -> const std::uint8_t*
+{
+    return reinterpret_cast<const std::uint8_t*>(str.data());
+}
+
+void test_md5_messages()
+{
+    // Every length around the block and padding boundaries, and some long enough to be hashed on their own
+    std::string data;
+    std::vector<std::size_t> offsets;
+    std::vector<std::size_t> sizes;
+    for (std::size_t i {}; i < 600U; ++i)
+    {
+        const auto size {i % 100U == 99U ? 1024U + i : i % 200U};
+        offsets.push_back(data.size());
+        sizes.push_back(size);
+        for (std::size_t j {}; j < size; ++j)
+        {
+            data.push_back(static_cast<char>((i * 7U + j * 13U) % 251U));
+        }
+    }
+
+    std::vector<const std::uint8_t*> messages;
+    for (const auto offset : offsets)
+    {
+        messages.push_back(as_bytes(data) + offset);
+    }
+
+    std::vector<digest_type> digests(messages.size());
+    boost::crypt::md5_messages(messages.data(), sizes.data(), messages.size(), digests.data());
+    for (std::size_t i {}; i < messages.size(); ++i)
+    {
+        BOOST_TEST(digest_equal(digests[i], boost::crypt::md5(messages[i], sizes[i])));
+    }
+
+    // Fewer messages than lanes
+    boost::crypt::md5_messages(messages.data() + 5, sizes.data() + 5, 1U, digests.data());
+    BOOST_TEST(digest_equal(digests[0], boost::crypt::md5(messages[5], sizes[5])));
+    boost::crypt::md5_messages(messages.data(), sizes.data(), 0U, digests.data());
+}
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#include <sys/stat.h>
+
+auto check_digests(const std::vector<digest_type>& digests, const std::vector<std::string>& records) -> void
+{
+    BOOST_TEST_EQ(digests.size(), records.size());
+    if (digests.size() == records.size())
+    {
+        for (std::size_t i {}; i < records.size(); ++i)
+        {
+            BOOST_TEST(digest_equal(digests[i], boost::crypt::md5(records[i])));
+        }
+    }
+}
+
+void test_md5_records()
+{
+    std::error_code ec;
+    boost::crypt::utility::record_options options;
+
+    // The last line does not need a newline, and one at the very end does not start another line
+    const std::string text {"a\nbb\r\n\nccc"};
+    check_digests(boost::crypt::md5_records(as_bytes(text), text.size(), ec), {"a", "bb\r", "", "ccc"});
+    BOOST_TEST(!ec);
+    check_digests(boost::crypt::md5_records(as_bytes(text), 2U, ec), {"a"});
+    check_digests(boost::crypt::md5_records(as_bytes(text), 0U, ec), {});
+
+    options.strip_carriage_return = true;
+    check_digests(boost::crypt::md5_records(as_bytes(text), text.size(), ec, options), {"a", "bb", "", "ccc"});
+
+    // Lengths in front of each record, in either byte order
+    options.format = boost::crypt::utility::record_format::length_prefixed;
+    const std::string big_endian {std::string {"\0\0\0\3abc\0\0\0\0\0\0\1\1x", 16U} + std::string(256U, 'y')};
+    const auto records {boost::crypt::md5_records(as_bytes(big_endian), big_endian.size(), ec, options)};
+    BOOST_TEST(!ec);
+    check_digests(records, {"abc", "", "x" + std::string(256U, 'y')});
+
+    options.prefix_size = 2U;
+    options.little_endian = true;
+    const std::string little_endian {"\2\0hi\1\0!", 7U};
+    check_digests(boost::crypt::md5_records(as_bytes(little_endian), little_endian.size(), ec, options), {"hi", "!"});
+
+    // Ending part way through a length or a record
+    BOOST_TEST(boost::crypt::md5_records(as_bytes(little_endian), 6U, ec, options).empty());
+    BOOST_TEST(ec == std::errc::io_error);
+    BOOST_TEST(boost::crypt::md5_records(as_bytes(little_endian), 5U, ec, options).empty());
+    BOOST_TEST(ec == std::errc::io_error);
+
+    options.prefix_size = 9U;
+    BOOST_TEST(boost::crypt::md5_records(as_bytes(little_endian), little_endian.size(), ec, options).empty());
+    BOOST_TEST(ec == std::errc::invalid_argument);
+}
+
+void test_md5_file_records()
+{
+    const std::string path {"test_records.txt"};
+
+    // More than one window and more than one chunk of lines, including one longer than a window
+    std::string contents;
+    std::vector<std::string> lines;
+    for (std::size_t i {}; i < 40000U; ++i)
+    {
+        const auto size {i == 20000U ? 100000U : (i * 31U) % 90U};
+        std::string line;
+        for (std::size_t j {}; j < size; ++j)
+        {
+            line.push_back(static_cast<char>('a' + (i + j) % 26U));
+        }
+        contents += line + '\n';
+        lines.push_back(line);
+    }
+    write_file(path, contents);
+
+    boost::crypt::utility::record_options options;
+    std::error_code ec;
+    check_digests(boost::crypt::md5_file_records(path, ec), lines);
+    BOOST_TEST(!ec);
+
+    options.window_size = 65536U;
+    for (const std::size_t threads : {1U, 4U})
+    {
+        options.thread_count = threads;
+        check_digests(boost::crypt::md5_file_records(path, ec, options), lines);
+        BOOST_TEST(!ec);
+    }
+
+    // Length prefixed records, read from a pipe that can not be mapped
+    std::string prefixed;
+    for (const auto& line : lines)
+    {
+        const auto size {line.size()};
+        prefixed.push_back(static_cast<char>(size >> 24U));
+        prefixed.push_back(static_cast<char>(size >> 16U));
+        prefixed.push_back(static_cast<char>(size >> 8U));
+        prefixed.push_back(static_cast<char>(size));
+        prefixed += line;
+    }
+
+    const std::string fifo_path {"test_records.fifo"};
+    std::remove(fifo_path.c_str());
+    BOOST_TEST_EQ(::mkfifo(fifo_path.c_str(), 0600), 0);
+    std::thread writer([&]() { write_file(fifo_path, prefixed); });
+
+    options.format = boost::crypt::utility::record_format::length_prefixed;
+    check_digests(boost::crypt::md5_file_records(fifo_path, ec, options), lines);
+    BOOST_TEST(!ec);
+    writer.join();
+
+    // The same records from a file, and the file cut short
+    write_file(path, prefixed);
+    check_digests(boost::crypt::md5_file_records(path, ec, options), lines);
+    BOOST_TEST(!ec);
+
+    write_file(path, prefixed.substr(0U, prefixed.size() - 1U));
+    BOOST_TEST(boost::crypt::md5_file_records(path, ec, options).empty());
+    BOOST_TEST(ec == std::errc::io_error);
+
+    // A last line without a '\n' that is longer than a chunk, from a buffer, a file and a pipe
+    std::string unterminated;
+    std::vector<std::string> unterminated_lines;
+    for (std::size_t i {}; i < 10U; ++i)
+    {
+        unterminated += "hello\n";
+        unterminated_lines.emplace_back("hello");
+    }
+    unterminated_lines.emplace_back(2U * 1024U * 1024U, 'z');
+    unterminated += unterminated_lines.back();
+
+    options = boost::crypt::utility::record_options{};
+    check_digests(boost::crypt::md5_records(as_bytes(unterminated), unterminated.size(), ec, options), unterminated_lines);
+    BOOST_TEST(!ec);
+
+    const std::string no_newline(3U * 1024U * 1024U, 'z');
+    check_digests(boost::crypt::md5_records(as_bytes(no_newline), no_newline.size(), ec, options), {no_newline});
+    BOOST_TEST(!ec);
+
+    write_file(path, unterminated);
+    check_digests(boost::crypt::md5_file_records(path, ec, options), unterminated_lines);
+    BOOST_TEST(!ec);
+
+    std::thread unterminated_writer([&]() { write_file(fifo_path, unterminated); });
+    check_digests(boost::crypt::md5_file_records(fifo_path, ec, options), unterminated_lines);
+    BOOST_TEST(!ec);
+    unterminated_writer.join();
+
+    BOOST_TEST(boost::crypt::md5_file_records("test_records_missing.txt", ec).empty());
+    BOOST_TEST(ec == std::errc::no_such_file_or_directory);
+
+    std::remove(path.c_str());
+    std::remove(fifo_path.c_str());
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+int main()
+{
+    test_md5_messages();
+
+    #ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+    test_md5_records();
+    test_md5_file_records();
+    #endif
+
+    return boost::report_errors();
+}
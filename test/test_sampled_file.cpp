@@ -0,0 +1,177 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/hash/md5/sampled_file.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include "file_test_helpers.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+using crypt_test::write_file;
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#include <sys/stat.h>
+
+void test_sample_offsets()
+{
+    using boost::crypt::utility::detail::sample_offsets;
+
+    // Evenly spaced, from the first byte to the last sample_length bytes
+    const auto even {sample_offsets(10000U, 8U, 16U, 0U)};
+    BOOST_TEST_EQ(even.size(), 8U);
+    if (even.size() == 8U)
+    {
+        BOOST_TEST_EQ(even[0], 0U);
+        BOOST_TEST_EQ(even[1], 1426U);
+        BOOST_TEST_EQ(even[7], 10000U - 16U);
+    }
+
+    // Spacing a huge file does not overflow
+    const auto huge {sample_offsets(UINT64_C(0xFFFFFFFFFFFFFFF0), 1000U, 16U, 0U)};
+    BOOST_TEST_EQ(huge.back(), UINT64_C(0xFFFFFFFFFFFFFFE0));
+    for (std::size_t i {1U}; i < huge.size(); ++i)
+    {
+        BOOST_TEST(huge[i] > huge[i - 1U]);
+    }
+
+    // Keyed offsets stay within the file, keep the first and last sample, and depend on the key
+    const auto keyed {sample_offsets(10000U, 8U, 16U, 42U)};
+    const auto other {sample_offsets(10000U, 8U, 16U, 43U)};
+    BOOST_TEST_EQ(keyed.front(), 0U);
+    BOOST_TEST_EQ(keyed.back(), 10000U - 16U);
+    BOOST_TEST(keyed != other);
+    BOOST_TEST(keyed == sample_offsets(10000U, 8U, 16U, 42U));
+    for (std::size_t i {1U}; i < keyed.size(); ++i)
+    {
+        BOOST_TEST(keyed[i] >= keyed[i - 1U]);
+    }
+}
+
+void test_md5_file_sampled()
+{
+    const std::string path {"test_sampled_file.bin"};
+    const std::string copy_path {"test_sampled_file_copy.bin"};
+
+    std::string contents;
+    for (std::size_t i {}; i < 10000U; ++i)
+    {
+        contents.push_back(static_cast<char>(i * 13U % 251U));
+    }
+    write_file(path, contents);
+    write_file(copy_path, contents);
+
+    boost::crypt::utility::sample_options options;
+    options.sample_count = 8U;
+    options.sample_length = 16U;
+
+    std::error_code ec;
+    const auto fingerprint {boost::crypt::md5_file_sampled(path, ec, options)};
+    BOOST_TEST(!ec);
+    BOOST_TEST_EQ(fingerprint.size, contents.size());
+    BOOST_TEST(!fingerprint.complete);
+    BOOST_TEST(fingerprint == boost::crypt::md5_file_sampled(copy_path, ec, options));
+
+    // The digest covers the size, the parameters, and each sample after its offset, all little endian
+    {
+        boost::crypt::md5_hasher hasher;
+        const std::uint8_t header[24] {0x10, 0x27, 0, 0, 0, 0, 0, 0, 8, 0, 0, 0, 16, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+        hasher.process_bytes(header, sizeof(header));
+        for (const auto offset : boost::crypt::utility::detail::sample_offsets(10000U, 8U, 16U, 0U))
+        {
+            std::uint8_t encoded[8] {};
+            boost::crypt::utility::detail::sample_store(encoded, offset, 8U);
+            hasher.process_bytes(encoded, sizeof(encoded));
+            hasher.process_bytes(contents.data() + offset, 16U);
+        }
+        const auto digest {hasher.get_digest()};
+        for (std::size_t i {}; i < digest.size(); ++i)
+        {
+            BOOST_TEST_EQ(fingerprint.digest[i], digest[i]);
+        }
+    }
+
+    // Reading the samples one at a time gives the same fingerprint
+    options.thread_count = 1U;
+    BOOST_TEST(fingerprint == boost::crypt::md5_file_sampled(path, ec, options));
+    options.thread_count = 0U;
+
+    // A change to a sampled byte is noticed, and one between the samples is not
+    auto changed {contents};
+    changed[9999] = 'x';
+    write_file(copy_path, changed);
+    BOOST_TEST(fingerprint != boost::crypt::md5_file_sampled(copy_path, ec, options));
+
+    changed = contents;
+    changed[20] = 'x';
+    write_file(copy_path, changed);
+    BOOST_TEST(fingerprint == boost::crypt::md5_file_sampled(copy_path, ec, options));
+
+    // Fingerprints taken in different ways never compare equal, and neither does their text
+    options.key = 0x1234U;
+    const auto keyed {boost::crypt::md5_file_sampled(path, ec, options)};
+    BOOST_TEST(!ec);
+    BOOST_TEST(keyed != fingerprint);
+    BOOST_TEST(keyed == boost::crypt::md5_file_sampled(path, ec, options));
+
+    const auto text {boost::crypt::utility::format_fingerprint(fingerprint)};
+    BOOST_TEST_EQ(text.substr(0U, 11U), std::string{"8x16:10000:"});
+    BOOST_TEST_EQ(text.size(), 11U + 32U);
+    BOOST_TEST_EQ(boost::crypt::utility::format_fingerprint(keyed).substr(0U, 28U), std::string{"8x16k0000000000001234:10000:"});
+
+    // A file no larger than the samples together is read whole
+    options.key = 0U;
+    options.sample_count = 1000U;
+    const auto complete {boost::crypt::md5_file_sampled(path, ec, options)};
+    BOOST_TEST(!ec);
+    BOOST_TEST(complete.complete);
+    BOOST_TEST(complete != fingerprint);
+
+    write_file(copy_path, "");
+    const auto empty {boost::crypt::md5_file_sampled(copy_path, ec, options)};
+    BOOST_TEST(!ec);
+    BOOST_TEST(empty.complete);
+    BOOST_TEST_EQ(empty.size, 0U);
+
+    // Errors
+    boost::crypt::md5_file_sampled("test_sampled_file_missing.bin", ec, options);
+    BOOST_TEST(ec == std::errc::no_such_file_or_directory);
+
+    options.sample_count = 0U;
+    boost::crypt::md5_file_sampled(path, ec, options);
+    BOOST_TEST(ec == std::errc::invalid_argument);
+
+    // Files without a size to sample from
+    options.sample_count = 8U;
+    const auto device {boost::crypt::md5_file_sampled("/dev/null", ec, options)};
+    BOOST_TEST(ec == std::errc::invalid_argument);
+    BOOST_TEST(!device.complete);
+
+    const std::string fifo_path {"test_sampled_file.fifo"};
+    std::remove(fifo_path.c_str());
+    BOOST_TEST_EQ(::mkfifo(fifo_path.c_str(), 0600), 0);
+    boost::crypt::md5_file_sampled(fifo_path, ec, options);
+    BOOST_TEST(ec == std::errc::invalid_argument);
+    std::remove(fifo_path.c_str());
+
+    std::remove(path.c_str());
+    std::remove(copy_path.c_str());
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+int main()
+{
+    #ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+    test_sample_offsets();
+    test_md5_file_sampled();
+    #endif
+
+    return boost::report_errors();
+}
@@ -0,0 +1,386 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/hash/md5/tar.hpp>
+#include <boost/crypt/utility/tar.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include "file_test_helpers.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using crypt_test::make_contents;
+using crypt_test::write_file;
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using digest_type = boost::crypt::array<boost::crypt::uint8_t, 16>;
+
+struct record
+{
+    std::string path;
+    std::uint64_t size;
+    digest_type digest;
+};
+
+auto write_octal(char* field, std::size_t size, std::uint64_t value) -> void
+{
+    field[size - 1U] = '\0';
+    for (std::size_t i {size - 1U}; i > 0U; --i)
+    {
+        field[i - 1U] = static_cast<char>('0' + (value & 7U));
+        value >>= 3U;
+    }
+}
+
+auto make_header(const std::string& name, std::uint64_t size, char type, const std::string& prefix = "") -> std::string
+{
+    std::string header(512U, '\0');
+    std::memcpy(&header[0], name.data(), name.size());
+    write_octal(&header[100], 8U, 0644U);
+    write_octal(&header[108], 8U, 0U);
+    write_octal(&header[116], 8U, 0U);
+    write_octal(&header[124], 12U, size);
+    write_octal(&header[136], 12U, 0U);
+    header[156] = type;
+    std::memcpy(&header[257], "ustar\0" "00", 8U);
+    std::memcpy(&header[345], prefix.data(), prefix.size());
+
+    std::memset(&header[148], ' ', 8U);
+    std::uint32_t sum {};
+    for (const auto c : header)
+    {
+        sum += static_cast<std::uint8_t>(c);
+    }
+    write_octal(&header[148], 7U, sum);
+    return header;
+}
+
+auto padding(std::size_t size) -> std::string
+{
+    return std::string((512U - size % 512U) % 512U, '\0');
+}
+
+auto add_entry(std::string& archive, const std::string& name, const std::string& contents, char type = '0') -> void
+{
+    archive += make_header(name, contents.size(), type) + contents + padding(contents.size());
+}
+
+// A pax record counts its own length, including the digits of the length itself
+auto pax_record(const std::string& key, const std::string& value) -> std::string
+{
+    const auto body {" " + key + "=" + value + "\n"};
+    auto length {body.size() + 1U};
+    while (std::to_string(length).size() + body.size() != length)
+    {
+        ++length;
+    }
+    return std::to_string(length) + body;
+}
+
+auto hash_in_pieces(const std::string& archive, std::size_t piece_size, std::vector<record>& records) -> int
+{
+    boost::crypt::utility::tar_stream<boost::crypt::md5_hasher> stream;
+    auto callback = [&records](const boost::crypt::utility::tar_entry& entry, boost::crypt::md5_hasher& hasher) {
+        records.push_back({entry.path, entry.size, hasher.get_digest()});
+    };
+
+    const auto* data {reinterpret_cast<const std::uint8_t*>(archive.data())};
+    std::size_t offset {};
+    while (offset < archive.size())
+    {
+        const auto len {(std::min)(piece_size, archive.size() - offset)};
+        const auto err {stream.process(data + offset, len, callback)};
+        if (err != 0)
+        {
+            return err;
+        }
+        offset += len;
+    }
+
+    return stream.finish();
+}
+
+auto same_digest(const digest_type& a, const digest_type& b) -> bool
+{
+    for (std::size_t i {}; i < a.size(); ++i)
+    {
+        if (a[i] != b[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void check_records(const std::vector<record>& records, const std::vector<std::pair<std::string, std::string>>& expected)
+{
+    BOOST_TEST_EQ(records.size(), expected.size());
+    for (std::size_t i {}; i < records.size() && i < expected.size(); ++i)
+    {
+        BOOST_TEST_EQ(records[i].path, expected[i].first);
+        BOOST_TEST_EQ(records[i].size, expected[i].second.size());
+        BOOST_TEST(same_digest(records[i].digest, boost::crypt::md5(expected[i].second)));
+    }
+}
+
+auto build_archive(std::vector<std::pair<std::string, std::string>>& expected) -> std::string
+{
+    std::string archive;
+
+    expected.emplace_back("a.txt", "hello tar");
+    add_entry(archive, expected.back().first, expected.back().second);
+
+    // Directories, symlinks and hard links have no payload
+    archive += make_header("dir/", 0U, '5');
+    archive += make_header("link", 0U, '2');
+    archive += make_header("hard", 0U, '1');
+
+    expected.emplace_back("dir/empty", "");
+    add_entry(archive, expected.back().first, expected.back().second);
+
+    // Sizes around the block and file buffer boundaries
+    for (const std::size_t size : {std::size_t{511U}, std::size_t{512U}, std::size_t{513U}, std::size_t{BOOST_CRYPT_FILE_BUFFER_SIZE + 3U}})
+    {
+        expected.emplace_back("dir/file_" + std::to_string(size), make_contents(size, static_cast<std::uint32_t>(size)));
+        add_entry(archive, expected.back().first, expected.back().second);
+    }
+
+    // ustar splits long paths between the prefix and name fields
+    {
+        const std::string prefix {"a/very/long/directory/name/that/needs/the/prefix"};
+        expected.emplace_back(prefix + "/split.bin", make_contents(1000U, 1U));
+        archive += make_header("split.bin", 1000U, '0', prefix) + expected.back().second + padding(1000U);
+    }
+
+    // pax extended headers override the path and size of the next entry
+    {
+        const std::string long_path(300U, 'p');
+        const auto contents {make_contents(2000U, 2U)};
+        const auto records {pax_record("path", long_path) + pax_record("size", std::to_string(contents.size())) + pax_record("mtime", "1.5")};
+        archive += make_header("PaxHeaders/x", records.size(), 'x') + records + padding(records.size());
+        archive += make_header("truncated", 0U, '0') + contents + padding(contents.size());
+        expected.emplace_back(long_path, contents);
+    }
+
+    // A global pax header does not disturb the records for the next entry
+    {
+        const auto records {pax_record("comment", "global")};
+        const auto contents {make_contents(10U, 3U)};
+        const auto path {pax_record("path", "after/global.txt")};
+        archive += make_header("PaxHeaders/x", path.size(), 'x') + path + padding(path.size());
+        archive += make_header("PaxHeaders/g", records.size(), 'g') + records + padding(records.size());
+        add_entry(archive, "ignored", contents);
+        expected.emplace_back("after/global.txt", contents);
+    }
+
+    // GNU long names
+    {
+        const std::string long_name(200U, 'g');
+        archive += make_header("././@LongLink", long_name.size() + 1U, 'L') + long_name + '\0' + padding(long_name.size() + 1U);
+        expected.emplace_back(long_name, make_contents(700U, 4U));
+        add_entry(archive, "short", expected.back().second);
+    }
+
+    // Contiguous files are regular files, and base-256 sizes are used for entries of 8 GiB and more
+    {
+        const auto contents {make_contents(300U, 5U)};
+        auto header {make_header("contiguous", contents.size(), '7')};
+        std::memset(&header[124], 0, 12U);
+        header[124] = static_cast<char>(0x80);
+        header[134] = static_cast<char>(contents.size() >> 8U);
+        header[135] = static_cast<char>(contents.size() & 0xFFU);
+        std::memset(&header[148], ' ', 8U);
+        std::uint32_t sum {};
+        for (const auto c : header)
+        {
+            sum += static_cast<std::uint8_t>(c);
+        }
+        write_octal(&header[148], 7U, sum);
+        archive += header + contents + padding(contents.size());
+        expected.emplace_back("contiguous", contents);
+    }
+
+    // End-of-archive marker, and anything after it is ignored
+    archive += std::string(1024U, '\0');
+    archive += "trailing garbage";
+    return archive;
+}
+
+void test_tar_stream()
+{
+    std::vector<std::pair<std::string, std::string>> expected;
+    const auto archive {build_archive(expected)};
+
+    for (const std::size_t piece : {std::size_t{1U}, std::size_t{7U}, std::size_t{512U}, std::size_t{4096U}, archive.size()})
+    {
+        std::vector<record> records;
+        BOOST_TEST_EQ(hash_in_pieces(archive, piece, records), 0);
+        check_records(records, expected);
+    }
+
+    // A corrupt header
+    {
+        auto corrupt {archive};
+        corrupt[0] = 'b';
+        std::vector<record> records;
+        BOOST_TEST_EQ(hash_in_pieces(corrupt, 4096U, records), EILSEQ);
+        BOOST_TEST(records.empty());
+    }
+
+    // An archive that stops part way through an entry
+    {
+        std::vector<record> records;
+        BOOST_TEST_EQ(hash_in_pieces(archive.substr(0U, 600U), 4096U, records), EIO);
+        BOOST_TEST_EQ(records.size(), 1U);
+    }
+
+    // An archive without the end-of-archive marker is complete at an entry boundary
+    {
+        std::string unterminated;
+        add_entry(unterminated, "only", "data");
+        std::vector<record> records;
+        BOOST_TEST_EQ(hash_in_pieces(unterminated, 4096U, records), 0);
+        check_records(records, {{"only", "data"}});
+    }
+}
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+void test_md5_tar()
+{
+    std::vector<std::pair<std::string, std::string>> expected;
+    const auto archive {build_archive(expected)};
+    const char* filename {"test_tar_archive.tar"};
+    write_file(filename, archive);
+
+    auto collect = [](std::vector<record>& records) {
+        return [&records](const boost::crypt::utility::tar_entry& entry, const digest_type& digest) {
+            records.push_back({entry.path, entry.size, digest});
+        };
+    };
+
+    {
+        std::vector<record> records;
+        BOOST_TEST(!boost::crypt::md5_tar(filename, collect(records)));
+        check_records(records, expected);
+    }
+
+    // A shallow queue of small buffers makes the headers straddle buffers
+    {
+        std::vector<record> records;
+        BOOST_TEST(!boost::crypt::utility::hash_tar<boost::crypt::md5_hasher>(filename,
+            [&records](const boost::crypt::utility::tar_entry& entry, boost::crypt::md5_hasher& hasher) {
+                records.push_back({entry.path, entry.size, hasher.get_digest()});
+            }, 1U, 1000U));
+        check_records(records, expected);
+    }
+
+    // Streamed through a pipe, as from tar c
+    {
+        int fds[2] {};
+        BOOST_TEST_EQ(pipe(fds), 0);
+        std::thread writer([fd = fds[1], &archive]() {
+            std::size_t written {};
+            while (written < archive.size())
+            {
+                const auto res {write(fd, archive.data() + written, archive.size() - written)};
+                if (res <= 0)
+                {
+                    break;
+                }
+                written += static_cast<std::size_t>(res);
+            }
+            close(fd);
+        });
+
+        std::vector<record> records;
+        BOOST_TEST(!boost::crypt::md5_tar(fds[0], collect(records)));
+        writer.join();
+        close(fds[0]);
+        check_records(records, expected);
+    }
+
+    {
+        std::vector<record> records;
+        write_file(filename, archive.substr(0U, 600U));
+        BOOST_TEST(boost::crypt::md5_tar(filename, collect(records)) == std::errc::io_error);
+
+        auto corrupt {archive};
+        corrupt[0] = 'b';
+        write_file(filename, corrupt);
+        BOOST_TEST(boost::crypt::md5_tar(filename, collect(records)) == std::errc::illegal_byte_sequence);
+
+        BOOST_TEST(boost::crypt::md5_tar("test_tar_missing.tar", collect(records)) == std::errc::no_such_file_or_directory);
+        BOOST_TEST(boost::crypt::md5_tar(-1, collect(records)) == std::errc::bad_file_descriptor);
+    }
+
+    std::remove(filename);
+}
+
+// Archives written by the system tar, where one is available
+void test_system_tar()
+{
+    const char* dir {"test_tar_tree"};
+    const std::string long_dir {std::string{dir} + "/" + std::string(120U, 'd')};
+    if (std::system(("mkdir -p " + long_dir).c_str()) != 0)
+    {
+        return; // LCOV_EXCL_LINE
+    }
+
+    std::vector<std::pair<std::string, std::string>> files {
+        {std::string{dir} + "/small.txt", "small"},
+        {long_dir + "/" + std::string(110U, 'f'), make_contents(100000U, 7U)},
+    };
+    for (const auto& file : files)
+    {
+        write_file(file.first.c_str(), file.second);
+    }
+
+    for (const char* format : {"gnu", "pax"})
+    {
+        const char* archive {"test_tar_system.tar"};
+        const auto command {std::string{"tar --format="} + format + " -cf " + archive + " " + files[0].first + " " + files[1].first + " 2>/dev/null"};
+        if (std::system(command.c_str()) != 0)
+        {
+            continue; // LCOV_EXCL_LINE
+        }
+
+        std::vector<record> records;
+        BOOST_TEST(!boost::crypt::md5_tar(archive, [&records](const boost::crypt::utility::tar_entry& entry, const digest_type& digest) {
+            records.push_back({entry.path, entry.size, digest});
+        }));
+        check_records(records, files);
+        std::remove(archive);
+    }
+
+    static_cast<void>(std::system((std::string{"rm -rf "} + dir).c_str()));
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+int main()
+{
+    test_tar_stream();
+
+    #ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+    test_md5_tar();
+    test_system_tar();
+    #endif
+
+    return boost::report_errors();
+}
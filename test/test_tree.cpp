@@ -0,0 +1,242 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/hash/md5/tree.hpp>
+#include <boost/crypt/utility/thread_pool.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include "file_test_helpers.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+using crypt_test::digest_equal;
+using crypt_test::make_contents;
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+using digest_type = boost::crypt::array<boost::crypt::uint8_t, 16>;
+
+void test_work_stealing_pool()
+{
+    using boost::crypt::utility::work_stealing_pool;
+
+    for (const std::size_t threads : {0U, 1U, 4U})
+    {
+        work_stealing_pool pool(threads);
+        BOOST_TEST(pool.thread_count() > 0U);
+        BOOST_TEST(pool.current_worker() == work_stealing_pool::no_worker);
+
+        // Every task fans out into more tasks, like a directory tree
+        std::atomic<std::size_t> count {0U};
+        std::function<void(std::size_t)> spawn = [&](std::size_t depth) {
+            BOOST_TEST(pool.current_worker() < pool.thread_count());
+            ++count;
+            if (depth < 6U)
+            {
+                for (std::size_t i {}; i < 3U; ++i)
+                {
+                    pool.submit([&spawn, depth]() { spawn(depth + 1U); });
+                }
+            }
+        };
+
+        pool.submit([&spawn]() { spawn(0U); });
+        pool.wait();
+        BOOST_TEST_EQ(count.load(), 1093U);
+
+        // The pool can be reused after an exception
+        pool.submit([]() { throw std::runtime_error("task"); });
+        BOOST_TEST_THROWS(pool.wait(), std::runtime_error);
+
+        count = 0U;
+        pool.submit([&count]() { ++count; });
+        pool.wait();
+        BOOST_TEST_EQ(count.load(), 1U);
+    }
+}
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+// A directory tree of files of many sizes that removes itself
+struct test_tree
+{
+    std::string root {"test_tree_dir"};
+    std::vector<std::string> directories;
+    std::vector<std::string> others;
+    std::map<std::string, std::string> files;
+
+    test_tree()
+    {
+        directories.push_back(root);
+        for (std::size_t i {}; i < 6U; ++i)
+        {
+            directories.push_back(root + "/d" + std::to_string(i));
+            for (std::size_t j {}; j < i; ++j)
+            {
+                directories.push_back(directories.back() + "/e" + std::to_string(j));
+            }
+        }
+        directories.push_back(root + "/empty");
+
+        for (const auto& directory : directories)
+        {
+            ::mkdir(directory.c_str(), 0755);
+        }
+
+        // Enough files in one directory to be split into several batches
+        std::size_t n {};
+        for (const auto& directory : directories)
+        {
+            const auto count {directory == root + "/d3" ? 200U : 5U};
+            for (std::size_t i {}; i < count; ++i, ++n)
+            {
+                const auto path {directory + "/f" + std::to_string(i) + ".bin"};
+                files[path.substr(root.size() + 1U)] = make_contents((n * 7919U) % 20000U);
+            }
+        }
+        files["d1/big.bin"] = make_contents(3U * BOOST_CRYPT_FILE_BUFFER_SIZE + 5U);
+        files["d4/e0/big.bin"] = make_contents(BOOST_CRYPT_FILE_BUFFER_SIZE);
+
+        for (const auto& file : files)
+        {
+            std::ofstream fd(root + "/" + file.first, std::ios::binary | std::ios::out | std::ios::trunc);
+            fd.write(file.second.data(), static_cast<std::streamsize>(file.second.size()));
+        }
+
+        // Neither links nor special files are part of the manifest
+        others.push_back(root + "/link");
+        BOOST_TEST_EQ(::symlink("d1/big.bin", others.back().c_str()), 0);
+        others.push_back(root + "/d2/dir_link");
+        BOOST_TEST_EQ(::symlink("..", others.back().c_str()), 0);
+        others.push_back(root + "/fifo");
+        BOOST_TEST_EQ(::mkfifo(others.back().c_str(), 0644), 0);
+    }
+
+    test_tree(const test_tree&) = delete;
+    auto operator=(const test_tree&) -> test_tree& = delete;
+
+    ~test_tree()
+    {
+        for (const auto& file : files)
+        {
+            std::remove((root + "/" + file.first).c_str());
+        }
+        for (const auto& other : others)
+        {
+            std::remove(other.c_str());
+        }
+        for (auto it {directories.rbegin()}; it != directories.rend(); ++it)
+        {
+            ::rmdir(it->c_str());
+        }
+    }
+};
+
+void check_manifest(const test_tree& tree, const std::vector<boost::crypt::md5_tree_entry>& manifest)
+{
+    BOOST_TEST_EQ(manifest.size(), tree.files.size());
+
+    // std::map iterates in the same order that the manifest is sorted in
+    auto file {tree.files.begin()};
+    for (const auto& entry : manifest)
+    {
+        if (file == tree.files.end())
+        {
+            break; // LCOV_EXCL_LINE
+        }
+
+        BOOST_TEST_EQ(entry.path, file->first);
+        BOOST_TEST_EQ(entry.size, file->second.size());
+        BOOST_TEST(!entry.ec);
+        if (!BOOST_TEST(digest_equal(entry.digest, boost::crypt::md5(file->second))))
+        {
+            std::cerr << "Failure with file: " << entry.path << std::endl; // LCOV_EXCL_LINE
+        }
+        ++file;
+    }
+}
+
+void test_md5_tree()
+{
+    const test_tree tree;
+
+    std::error_code ec;
+    check_manifest(tree, boost::crypt::md5_tree(tree.root, ec));
+    BOOST_TEST(!ec);
+
+    // Every way of dividing the work gives the same manifest
+    boost::crypt::utility::tree_options options;
+    options.large_file_size = 100000U;
+    for (const std::size_t threads : {1U, 3U, 32U})
+    {
+        for (const std::size_t large_threads : {0U, 1U, 2U})
+        {
+            options.thread_count = threads;
+            options.large_file_threads = large_threads;
+            options.buffer_size = threads == 1U ? 0U : 1000U;
+            check_manifest(tree, boost::crypt::md5_tree(tree.root, ec, options));
+            BOOST_TEST(!ec);
+        }
+    }
+
+    // Paths are relative to the root however it is spelled
+    check_manifest(tree, boost::crypt::md5_tree(tree.root + "/", ec));
+    BOOST_TEST(!ec);
+
+    const auto missing {boost::crypt::md5_tree("test_tree_missing", ec)};
+    BOOST_TEST(missing.empty());
+    BOOST_TEST(ec == std::errc::no_such_file_or_directory);
+
+    const auto not_directory {boost::crypt::md5_tree(tree.root + "/d1/big.bin", ec)};
+    BOOST_TEST(not_directory.empty());
+    BOOST_TEST(ec == std::errc::not_a_directory);
+
+    // The callback sees each file exactly once
+    std::map<std::string, int> seen;
+    ec = boost::crypt::md5_tree(tree.root, [&seen](const std::string& path, std::uint64_t, const digest_type&, const std::error_code&) {
+        ++seen[path];
+    }, options);
+    BOOST_TEST(!ec);
+    BOOST_TEST_EQ(seen.size(), tree.files.size());
+    for (const auto& entry : seen)
+    {
+        BOOST_TEST_EQ(entry.second, 1);
+    }
+
+    // An exception from the callback stops the remaining files and is propagated
+    for (const std::size_t large_threads : {0U, 2U})
+    {
+        options.large_file_threads = large_threads;
+        BOOST_TEST_THROWS(boost::crypt::utility::hash_tree<boost::crypt::md5_hasher>(tree.root,
+            [](const std::string&, std::uint64_t, boost::crypt::md5_hasher&, const std::error_code&) { throw std::runtime_error("callback"); },
+            options), std::runtime_error);
+    }
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+int main()
+{
+    test_work_stealing_pool();
+
+    #ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+    test_md5_tree();
+    #endif
+
+    return boost::report_errors();
+}
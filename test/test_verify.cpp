@@ -0,0 +1,213 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/hash/md5/verify.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include "file_test_helpers.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+using crypt_test::write_file;
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+using digest_type = boost::crypt::array<boost::crypt::uint8_t, 16>;
+
+auto to_hex(const digest_type& digest, bool upper = false) -> std::string
+{
+    const char* digits {upper ? "0123456789ABCDEF" : "0123456789abcdef"};
+    std::string hex;
+    for (std::size_t i {}; i < digest.size(); ++i)
+    {
+        hex.push_back(digits[digest[i] >> 4U]);
+        hex.push_back(digits[digest[i] & 0x0FU]);
+    }
+
+    return hex;
+}
+
+void test_decode_hex()
+{
+    using boost::crypt::utility::detail::decode_hex_word;
+
+    std::uint8_t out[4] {};
+    BOOST_TEST(decode_hex_word("0123abCD", out));
+    BOOST_TEST_EQ(out[0], 0x01U);
+    BOOST_TEST_EQ(out[1], 0x23U);
+    BOOST_TEST_EQ(out[2], 0xABU);
+    BOOST_TEST_EQ(out[3], 0xCDU);
+
+    BOOST_TEST(decode_hex_word("fFfF9a0E", out));
+    BOOST_TEST_EQ(out[0], 0xFFU);
+    BOOST_TEST_EQ(out[1], 0xFFU);
+    BOOST_TEST_EQ(out[2], 0x9AU);
+    BOOST_TEST_EQ(out[3], 0x0EU);
+
+    // Every character that is not a hex digit is rejected in every position
+    for (int c {}; c < 256; ++c)
+    {
+        const auto ch {static_cast<char>(c)};
+        const bool hex {(ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'f') || (ch >= 'A' && ch <= 'F')};
+        for (std::size_t i {}; i < 8U; ++i)
+        {
+            std::string word(8U, '7');
+            word[i] = ch;
+            if (!BOOST_TEST_EQ(decode_hex_word(word.data(), out), hex))
+            {
+                std::cerr << "Failure with character: " << c << " at " << i << std::endl; // LCOV_EXCL_LINE
+            }
+        }
+    }
+}
+
+void test_md5_verify()
+{
+    std::map<std::string, std::string> files {
+        {"test_verify_a.bin", "The quick brown fox jumps over the lazy dog"},
+        {"test_verify_b.bin", ""},
+        {"test_verify_(c).bin", std::string(200000U, 'c')},
+        {"test_verify_d\nnewline.bin", "d"},
+        {"test_verify_e\\backslash.bin", "e"},
+        {" test_verify_f.bin", "f"}
+    };
+    for (const auto& file : files)
+    {
+        write_file(file.first, file.second);
+    }
+
+    const auto hex = [&files](const std::string& name) { return to_hex(boost::crypt::md5(files[name])); };
+
+    const std::string list {"test_verify_list.md5"};
+    std::string contents;
+    contents += hex("test_verify_a.bin") + "  test_verify_a.bin\n";                             // 1
+    contents += to_hex(boost::crypt::md5(files["test_verify_b.bin"]), true) + " *test_verify_b.bin\n"; // 2
+    contents += "# comment\n";                                                                  // 3
+    contents += "\n";                                                                           // 4
+    contents += "MD5 (test_verify_(c).bin) = " + hex("test_verify_(c).bin") + "\r\n";           // 5
+    contents += "\\" + hex("test_verify_d\nnewline.bin") + "  test_verify_d\\nnewline.bin\n";    // 6
+    contents += "\\MD5 (test_verify_e\\\\backslash.bin) = " + hex("test_verify_e\\backslash.bin") + "\n"; // 7
+    contents += hex(" test_verify_f.bin") + "   test_verify_f.bin\n";                          // 8
+    contents += hex("test_verify_b.bin") + "  test_verify_a.bin\n";                             // 9 mismatch
+    contents += hex("test_verify_a.bin") + "  test_verify_missing.bin\n";                       // 10 unreadable
+    contents += "not a checksum line\n";                                                        // 11 malformed
+    contents += hex("test_verify_a.bin").substr(1U) + "g  test_verify_a.bin\n";                 // 12 malformed
+    contents += hex("test_verify_a.bin") + " \n";                                               // 13 malformed
+    contents += "MD5 (test_verify_a.bin) = " + hex("test_verify_a.bin") + "0\n";                // 14 malformed
+    contents += "\\" + hex("test_verify_a.bin") + "  test_verify_\\x.bin\n";                     // 15 malformed
+    contents += hex("test_verify_a.bin") + " test_verify_a.bin";                                // 16 without a newline
+    write_file(list, contents);
+
+    const std::map<std::size_t, boost::crypt::utility::verify_status> expected {
+        {9U, boost::crypt::utility::verify_status::mismatch},
+        {10U, boost::crypt::utility::verify_status::unreadable},
+        {11U, boost::crypt::utility::verify_status::malformed},
+        {12U, boost::crypt::utility::verify_status::malformed},
+        {13U, boost::crypt::utility::verify_status::malformed},
+        {14U, boost::crypt::utility::verify_status::malformed},
+        {15U, boost::crypt::utility::verify_status::malformed}
+    };
+
+    boost::crypt::utility::verify_options options;
+    for (const std::size_t threads : {0U, 1U, 3U, 64U})
+    {
+        options.thread_count = threads;
+        options.buffer_size = threads == 3U ? 1000U : boost::crypt::utility::default_multi_file_buffer_size;
+
+        std::vector<boost::crypt::utility::verify_failure> failures;
+        const auto result {boost::crypt::md5_verify(list, failures, options)};
+        BOOST_TEST(!result.ec);
+        BOOST_TEST_EQ(result.verified, 7U);
+        BOOST_TEST_EQ(result.mismatched, 1U);
+        BOOST_TEST_EQ(result.unreadable, 1U);
+        BOOST_TEST_EQ(result.malformed, 5U);
+
+        BOOST_TEST_EQ(failures.size(), expected.size());
+        auto it {expected.begin()};
+        for (const auto& failure : failures)
+        {
+            if (it == expected.end())
+            {
+                break; // LCOV_EXCL_LINE
+            }
+
+            BOOST_TEST_EQ(failure.line, it->first);
+            BOOST_TEST(failure.status == it->second);
+            ++it;
+        }
+
+        if (failures.size() == expected.size())
+        {
+            BOOST_TEST_EQ(failures[0].path, "test_verify_a.bin");
+            BOOST_TEST(!failures[0].ec);
+            BOOST_TEST_EQ(failures[1].path, "test_verify_missing.bin");
+            BOOST_TEST(failures[1].ec == std::errc::no_such_file_or_directory);
+            BOOST_TEST(failures[2].path.empty());
+        }
+    }
+
+    // A list long enough to be split between the threads many times
+    std::string long_contents;
+    for (std::size_t i {}; i < 5000U; ++i)
+    {
+        const std::string name {i % 7U == 3U ? "test_verify_b.bin" : "test_verify_a.bin"};
+        const std::string other {i % 7U == 3U ? "test_verify_a.bin" : "test_verify_b.bin"};
+        long_contents += hex(i % 1000U == 999U ? other : name) + "  " + name + "\n";
+    }
+    write_file(list, long_contents);
+
+    std::size_t calls {};
+    const auto result {boost::crypt::md5_verify(list, [&calls](const boost::crypt::utility::verify_failure& failure) {
+        ++calls;
+        BOOST_TEST(failure.status == boost::crypt::utility::verify_status::mismatch);
+        BOOST_TEST_EQ(failure.line % 1000U, 0U);
+    })};
+    BOOST_TEST(!result.ec);
+    BOOST_TEST_EQ(result.verified, 4995U);
+    BOOST_TEST_EQ(result.mismatched, 5U);
+    BOOST_TEST_EQ(calls, 5U);
+
+    // An exception from the callback stops the remaining lines and is propagated
+    BOOST_TEST_THROWS(boost::crypt::md5_verify(list, [](const boost::crypt::utility::verify_failure&) {
+        throw std::runtime_error("callback");
+    }), std::runtime_error);
+
+    // An empty list verifies nothing
+    write_file(list, "");
+    std::vector<boost::crypt::utility::verify_failure> failures;
+    const auto empty {boost::crypt::md5_verify(list, failures)};
+    BOOST_TEST(!empty.ec);
+    BOOST_TEST_EQ(empty.verified, 0U);
+    BOOST_TEST(failures.empty());
+
+    const auto missing {boost::crypt::md5_verify("test_verify_missing.md5", failures)};
+    BOOST_TEST(missing.ec == std::errc::no_such_file_or_directory);
+    BOOST_TEST_EQ(missing.verified, 0U);
+
+    std::remove(list.c_str());
+    for (const auto& file : files)
+    {
+        std::remove(file.first.c_str());
+    }
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+int main()
+{
+    #ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+    test_decode_hex();
+    test_md5_verify();
+    #endif
+
+    return boost::report_errors();
+}
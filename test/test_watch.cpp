@@ -0,0 +1,246 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/hash/md5/watch.hpp>
+#include <boost/core/lightweight_test.hpp>
+#include "file_test_helpers.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+#include <thread>
+
+using crypt_test::digest_equal;
+using crypt_test::write_file;
+
+#ifdef BOOST_CRYPT_HAS_INOTIFY
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+using digest_type = boost::crypt::array<boost::crypt::uint8_t, 16>;
+
+auto read_file(const std::string& path) -> std::string
+{
+    std::ifstream fd(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(fd), std::istreambuf_iterator<char>());
+}
+
+// Counts the bytes hashed by every instance, to show which files were read again
+std::atomic<std::size_t> bytes_hashed {0U};
+
+class counting_hasher : public boost::crypt::md5_hasher
+{
+public:
+    template <typename ForwardIter>
+    auto process_bytes(ForwardIter buffer, std::size_t byte_count) noexcept -> void
+    {
+        bytes_hashed += byte_count;
+        static_cast<void>(boost::crypt::md5_hasher::process_bytes(buffer, byte_count));
+    }
+};
+
+void test_md5_tree_watcher()
+{
+    const std::string root {"test_watch_dir"};
+    const std::string manifest_path {"test_watch_manifest.md5"};
+    static_cast<void>(::mkdir(root.c_str(), 0755));
+    static_cast<void>(::mkdir((root + "/sub").c_str(), 0755));
+
+    const std::string a_contents(300000U, 'a');
+    write_file(root + "/a.txt", a_contents);
+    write_file(root + "/sub/b.txt", "b");
+    static_cast<void>(::symlink("a.txt", (root + "/link").c_str()));
+
+    boost::crypt::utility::watch_options options;
+    options.debounce_ms = 20U;
+    options.thread_count = 2U;
+    options.manifest_path = manifest_path;
+
+    std::error_code ec;
+    boost::crypt::md5_tree_watcher watcher(root, ec, options);
+    BOOST_TEST(!ec);
+    BOOST_TEST(watcher.wait_idle(10000U));
+    BOOST_TEST_EQ(watcher.size(), 2U);
+
+    boost::crypt::md5_tree_watcher::entry found {};
+    BOOST_TEST(watcher.find("a.txt", found));
+    BOOST_TEST_EQ(found.size, a_contents.size());
+    BOOST_TEST(digest_equal(found.digest, boost::crypt::md5(a_contents)));
+    BOOST_TEST(!found.ec);
+    BOOST_TEST(watcher.find("sub/b.txt", found));
+    BOOST_TEST(digest_equal(found.digest, boost::crypt::md5("b")));
+    BOOST_TEST(!watcher.find("link", found));
+
+    // A file that is written is hashed again
+    const auto generation {watcher.generation()};
+    write_file(root + "/sub/b.txt", "bb");
+    BOOST_TEST(watcher.wait_idle(10000U));
+    BOOST_TEST(watcher.generation() > generation);
+    BOOST_TEST(watcher.find("sub/b.txt", found));
+    BOOST_TEST(digest_equal(found.digest, boost::crypt::md5("bb")));
+
+    // Files in a new directory, one moved in, and the contents of a renamed directory
+    static_cast<void>(::mkdir((root + "/new").c_str(), 0755));
+    write_file(root + "/new/c.txt", "c");
+    write_file("test_watch_outside.txt", "d");
+    BOOST_TEST_EQ(std::rename("test_watch_outside.txt", (root + "/new/d.txt").c_str()), 0);
+    BOOST_TEST(watcher.wait_idle(10000U));
+    BOOST_TEST(watcher.find("new/c.txt", found));
+    BOOST_TEST(digest_equal(found.digest, boost::crypt::md5("c")));
+    BOOST_TEST(watcher.find("new/d.txt", found));
+    BOOST_TEST(digest_equal(found.digest, boost::crypt::md5("d")));
+
+    BOOST_TEST_EQ(std::rename((root + "/new").c_str(), (root + "/renamed").c_str()), 0);
+    BOOST_TEST(watcher.wait_idle(10000U));
+    BOOST_TEST(!watcher.find("new/c.txt", found));
+    BOOST_TEST(watcher.find("renamed/c.txt", found));
+    BOOST_TEST(digest_equal(found.digest, boost::crypt::md5("c")));
+
+    // The old name of the directory is not watched any more, and the new one is
+    write_file(root + "/renamed/e.txt", "e");
+    BOOST_TEST(watcher.wait_idle(10000U));
+    BOOST_TEST(watcher.find("renamed/e.txt", found));
+    BOOST_TEST(!watcher.find("new/e.txt", found));
+
+    // Removed files and directories leave the manifest
+    BOOST_TEST_EQ(std::remove((root + "/renamed/c.txt").c_str()), 0);
+    BOOST_TEST_EQ(std::remove((root + "/renamed/d.txt").c_str()), 0);
+    BOOST_TEST_EQ(std::remove((root + "/renamed/e.txt").c_str()), 0);
+    BOOST_TEST_EQ(::rmdir((root + "/renamed").c_str()), 0);
+    BOOST_TEST(watcher.wait_idle(10000U));
+    BOOST_TEST_EQ(watcher.size(), 2U);
+
+    const auto manifest {watcher.manifest()};
+    BOOST_TEST_EQ(manifest.size(), 2U);
+    if (manifest.size() == 2U)
+    {
+        BOOST_TEST_EQ(manifest[0].path, "a.txt");
+        BOOST_TEST_EQ(manifest[1].path, "sub/b.txt");
+    }
+
+    // The manifest written is what md5sum prints for the same files
+    watcher.stop();
+    BOOST_TEST(!watcher.error());
+    BOOST_TEST(!watcher.wait_idle(10U));
+    BOOST_TEST_EQ(watcher.size(), 2U);
+    BOOST_TEST_EQ(read_file(manifest_path), "92712d77c46f3ee77d7ac6caba4fe2ba  a.txt\n"
+                                            "21ad0bd836b90d08f4cf640b4c298e7c  sub/b.txt\n");
+
+    std::remove((root + "/a.txt").c_str());
+    std::remove((root + "/link").c_str());
+    std::remove((root + "/sub/b.txt").c_str());
+    ::rmdir((root + "/sub").c_str());
+    ::rmdir(root.c_str());
+    std::remove(manifest_path.c_str());
+
+    BOOST_TEST(boost::crypt::md5_tree_watcher("test_watch_missing", ec).size() == 0U);
+    BOOST_TEST(ec == std::errc::no_such_file_or_directory);
+}
+
+void test_only_changes_are_hashed()
+{
+    const std::string root {"test_watch_count"};
+    static_cast<void>(::mkdir(root.c_str(), 0755));
+    for (int i {}; i < 20; ++i)
+    {
+        write_file(root + "/" + std::to_string(i), std::string(10000U, 'x'));
+    }
+
+    boost::crypt::utility::watch_options options;
+    options.debounce_ms = 20U;
+
+    std::error_code ec;
+    boost::crypt::utility::tree_watcher<counting_hasher> watcher(root, ec, options);
+    BOOST_TEST(!ec);
+    BOOST_TEST(watcher.wait_idle(10000U));
+    BOOST_TEST_EQ(bytes_hashed.load(), 200000U);
+
+    bytes_hashed = 0U;
+    write_file(root + "/7", "changed");
+    BOOST_TEST(watcher.wait_idle(10000U));
+    BOOST_TEST_EQ(bytes_hashed.load(), 7U);
+
+    // Many writes in a row are hashed once they stop
+    bytes_hashed = 0U;
+    {
+        std::ofstream fd(root + "/3", std::ios::binary | std::ios::trunc);
+        for (int i {}; i < 100; ++i)
+        {
+            fd << "line\n";
+            fd.flush();
+        }
+    }
+    BOOST_TEST(watcher.wait_idle(10000U));
+    BOOST_TEST(bytes_hashed.load() <= 1000U);
+
+    boost::crypt::utility::tree_watcher<counting_hasher>::entry found {};
+    BOOST_TEST(watcher.find("3", found));
+    BOOST_TEST_EQ(found.size, 500U);
+    BOOST_TEST_EQ(watcher.size(), 20U);
+
+    watcher.stop();
+    for (int i {}; i < 20; ++i)
+    {
+        std::remove((root + "/" + std::to_string(i)).c_str());
+    }
+    ::rmdir(root.c_str());
+}
+
+// The manifest and the cache can be kept in the tree they describe
+void test_own_files_are_ignored()
+{
+    const std::string root {"test_watch_own"};
+    static_cast<void>(::mkdir(root.c_str(), 0755));
+    write_file(root + "/a.txt", "a");
+
+    boost::crypt::utility::watch_options options;
+    options.debounce_ms = 20U;
+    options.manifest_path = root + "/MD5SUMS";
+    options.cache_path = root + "/cache";
+
+    std::error_code ec;
+    boost::crypt::md5_tree_watcher watcher(root, ec, options);
+    BOOST_TEST(!ec);
+    BOOST_TEST(watcher.wait_idle(10000U));
+
+    const auto generation {watcher.generation()};
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    BOOST_TEST(watcher.wait_idle(10000U));
+    BOOST_TEST_EQ(watcher.generation(), generation);
+    BOOST_TEST_EQ(watcher.size(), 1U);
+
+    // Writing the same contents again does not change the manifest
+    write_file(root + "/a.txt", "a");
+    BOOST_TEST(watcher.wait_idle(10000U));
+    BOOST_TEST_EQ(watcher.generation(), generation);
+
+    watcher.stop();
+    BOOST_TEST(!watcher.error());
+    BOOST_TEST_EQ(read_file(options.manifest_path), "0cc175b9c0f1b6a831c399e269772661  a.txt\n");
+
+    std::remove((root + "/a.txt").c_str());
+    std::remove(options.manifest_path.c_str());
+    std::remove(options.cache_path.c_str());
+    ::rmdir(root.c_str());
+}
+
+#endif // BOOST_CRYPT_HAS_INOTIFY
+
+int main()
+{
+    #ifdef BOOST_CRYPT_HAS_INOTIFY
+    test_md5_tree_watcher();
+    test_only_changes_are_hashed();
+    test_own_files_are_ignored();
+    #endif
+
+    return boost::report_errors();
+}
@@ -0,0 +1,93 @@
+#!/bin/sh
+# Copyright 2024 Matt Borland
+# Distributed under the Boost Software License, Version 1.0.
+# https://www.boost.org/LICENSE_1_0.txt
+#
+# Compares the md5sum tool against GNU coreutils md5sum on many small files and on a few huge ones,
+# after checking that both write exactly the same output.
+#
+# Usage:
+#   tools/benchmark_md5sum.sh path/to/built/md5sum [directory]
+#
+# The following environment variables can be used to adjust the run:
+#   SMALL_COUNT - Number of small files (default: 20000)
+#   SMALL_SIZE  - Size of each small file in bytes (default: 4096)
+#   HUGE_COUNT  - Number of huge files (default: 4)
+#   HUGE_SIZE   - Size of each huge file in MiB (default: 1024)
+#   REFERENCE   - The md5sum to compare against (default: md5sum from PATH)
+
+set -eu
+
+tool=${1:?usage: benchmark_md5sum.sh path/to/md5sum [directory]}
+tool=$(cd "$(dirname "$tool")" && pwd)/$(basename "$tool")
+dir=${2:-.}/md5sum_bench
+small_count=${SMALL_COUNT:-20000}
+small_size=${SMALL_SIZE:-4096}
+huge_count=${HUGE_COUNT:-4}
+huge_size=${HUGE_SIZE:-1024}
+reference=${REFERENCE:-md5sum}
+
+mkdir -p "$dir/small" "$dir/huge"
+dir=$(cd "$dir" && pwd)
+trap 'rm -rf "$dir"' EXIT
+
+i=0
+while [ "$i" -lt "$small_count" ]; do
+    head -c "$small_size" /dev/urandom > "$dir/small/$i.bin"
+    i=$((i + 1))
+done
+
+i=0
+while [ "$i" -lt "$huge_count" ]; do
+    head -c "$((huge_size * 1048576))" /dev/urandom > "$dir/huge/$i.bin"
+    i=$((i + 1))
+done
+
+# Both tools must agree byte for byte before their speed is worth comparing
+for options in "" "--tag" "-z" "-b"; do
+    # shellcheck disable=SC2086
+    (cd "$dir" && "$reference" $options small/*.bin huge/*.bin) > "$dir/expected"
+    # shellcheck disable=SC2086
+    (cd "$dir" && "$tool" $options small/*.bin huge/*.bin) > "$dir/actual"
+    if ! cmp -s "$dir/expected" "$dir/actual"; then
+        echo "Output differs from $reference with options '$options'" >&2
+        exit 1
+    fi
+done
+
+(cd "$dir" && "$reference" small/*.bin huge/*.bin) > "$dir/sums"
+(cd "$dir" && "$reference" -c sums) > "$dir/expected"
+(cd "$dir" && "$tool" -c sums) > "$dir/actual"
+if ! cmp -s "$dir/expected" "$dir/actual"; then
+    echo "Output of -c differs from $reference" >&2
+    exit 1
+fi
+
+# Wall time in seconds of the fastest of three warm cache runs
+best_of_three() {
+    best=
+    for run in 1 2 3; do
+        start=$(date +%s.%N)
+        "$@" > /dev/null
+        end=$(date +%s.%N)
+        best=$(echo "$start $end $best" | awk '{ t = $2 - $1; if ($3 == "" || t < $3) print t; else print $3 }')
+    done
+    echo "$best"
+}
+
+report() {
+    name=$1
+    shift
+    ref=$(best_of_three "$reference" "$@")
+    ours=$(best_of_three "$tool" "$@")
+    printf '%-36s %10.3f s %10.3f s %8.2fx\n' "$name" "$ref" "$ours" "$(echo "$ref $ours" | awk '{ print $1 / $2 }')"
+}
+
+# Warm the page cache so both tools read from memory
+cd "$dir"
+cat small/*.bin huge/*.bin > /dev/null
+
+printf '%-36s %12s %12s %9s\n' "" "coreutils" "this" "speedup"
+report "$small_count x $small_size byte files" small/*.bin
+report "$huge_count x $huge_size MiB files" huge/*.bin
+report "check $((small_count + huge_count)) files" -c sums
@@ -0,0 +1,981 @@
+// Copyright 2024 Matt Borland
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+//
+// A replacement for GNU coreutils md5sum built on the library.
+// It accepts the same options and writes the same output, including the escaping of unusual file names,
+// the check mode report, and the diagnostics on standard error, but hashes the files on a pool of threads
+// with large reads while still printing the results in the order the files were named
+
+#include <boost/crypt/hash/md5.hpp>
+#include <boost/crypt/hash/md5/pipe.hpp>
+#include <boost/crypt/utility/multi_file.hpp>
+
+#ifdef BOOST_CRYPT_HAS_POSIX_FILE_IO
+
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+const char* program_name {"md5sum"};
+
+// Number of lines of a checksum file that are hashed in parallel before printing their results
+constexpr std::size_t check_batch_size {4096U};
+
+struct options
+{
+    bool check {};
+    bool tag {};
+    bool zero {};
+    bool ignore_missing {};
+    bool quiet {};
+    bool status {};
+    bool strict {};
+    bool warn {};
+
+    // -1 when neither --binary nor --text was given
+    int binary {-1};
+};
+
+// Quotes a file name in a diagnostic the way coreutils does in the C locale:
+// names made only of characters that are safe in a shell are left alone, others are put in quotes,
+// and unprintable bytes are written as $'\n' or $'\ooo'
+auto quote(const std::string& name) -> std::string
+{
+    const auto unprintable = [](char c) {
+        const auto u {static_cast<unsigned char>(c)};
+        return u < 0x20U || u >= 0x7FU;
+    };
+
+    bool needs_quotes {name.empty()};
+    bool has_single_quote {};
+    bool double_quotes_ok {true};
+    for (std::size_t i {}; i < name.size(); ++i)
+    {
+        const auto c {name[i]};
+        if (unprintable(c))
+        {
+            needs_quotes = true;
+            double_quotes_ok = false;
+        }
+        else if (std::strchr(" !\"$&'()*:;<=>?[\\^`|", c) != nullptr || ((c == '#' || c == '~') && i == 0U))
+        {
+            needs_quotes = true;
+            has_single_quote = has_single_quote || c == '\'';
+            double_quotes_ok = double_quotes_ok && std::strchr("!\"$\\`", c) == nullptr;
+        }
+    }
+
+    if (!needs_quotes)
+    {
+        return name;
+    }
+
+    if (has_single_quote && double_quotes_ok)
+    {
+        return '"' + name + '"';
+    }
+
+    std::string quoted {"'"};
+    bool in_dollar {};
+    for (const auto c : name)
+    {
+        if (unprintable(c))
+        {
+            if (!in_dollar)
+            {
+                quoted += "'$'";
+                in_dollar = true;
+            }
+
+            const char* escape {nullptr};
+            switch (c)
+            {
+                case '\a': escape = "\\a"; break;
+                case '\b': escape = "\\b"; break;
+                case '\t': escape = "\\t"; break;
+                case '\n': escape = "\\n"; break;
+                case '\v': escape = "\\v"; break;
+                case '\f': escape = "\\f"; break;
+                case '\r': escape = "\\r"; break;
+                default: break;
+            }
+
+            if (escape != nullptr)
+            {
+                quoted += escape;
+            }
+            else
+            {
+                const auto u {static_cast<unsigned char>(c)};
+                quoted += '\\';
+                quoted += static_cast<char>('0' + ((u >> 6U) & 7U));
+                quoted += static_cast<char>('0' + ((u >> 3U) & 7U));
+                quoted += static_cast<char>('0' + (u & 7U));
+            }
+            continue;
+        }
+
+        if (in_dollar)
+        {
+            quoted += "''";
+            in_dollar = false;
+        }
+
+        if (c == '\'')
+        {
+            quoted += "'\\''";
+        }
+        else
+        {
+            quoted += c;
+        }
+    }
+
+    quoted += '\'';
+    return quoted;
+}
+
+// Writes "program: message" to standard error, after anything already written to standard output
+auto report(const std::string& message) -> void
+{
+    std::fflush(stdout);
+    std::fprintf(stderr, "%s: %s\n", program_name, message.c_str());
+}
+
+auto usage_error(const std::string& message) -> int
+{
+    if (!message.empty())
+    {
+        report(message);
+    }
+    std::fprintf(stderr, "Try '%s --help' for more information.\n", program_name);
+    return EXIT_FAILURE;
+}
+
+auto print_help() -> int
+{
+    std::printf("Usage: %s [OPTION]... [FILE]...\n", program_name);
+    std::fputs("Print or check MD5 (128-bit) checksums, hashing the files in parallel.\n"
+               "\n"
+               "With no FILE, or when FILE is -, read standard input.\n"
+               "  -b, --binary          read in binary mode\n"
+               "  -c, --check           read checksums from the FILEs and check them\n"
+               "      --tag             create a BSD-style checksum\n"
+               "  -t, --text            read in text mode (default)\n"
+               "  -z, --zero            end each output line with NUL, not newline,\n"
+               "                          and disable file name escaping\n"
+               "\n"
+               "The following five options are useful only when verifying checksums:\n"
+               "      --ignore-missing  don't fail or report status for missing files\n"
+               "      --quiet           don't print OK for each successfully verified file\n"
+               "      --status          don't output anything, status code shows success\n"
+               "      --strict          exit non-zero for improperly formatted checksum lines\n"
+               "  -w, --warn            warn about improperly formatted checksum lines\n"
+               "\n"
+               "      --help        display this help and exit\n"
+               "      --version     output version information and exit\n"
+               "\n"
+               "The output is the same as that of GNU coreutils md5sum, and either can check the other's checksums.\n"
+               "There is no difference between binary mode and text mode on POSIX systems.\n", stdout);
+    return EXIT_SUCCESS;
+}
+
+auto print_version() -> int
+{
+    std::printf("%s (Boost.Crypt)\n", program_name);
+    return EXIT_SUCCESS;
+}
+
+auto to_hex(const boost::crypt::array<boost::crypt::uint8_t, 16>& digest) -> std::string
+{
+    constexpr const char* digits {"0123456789abcdef"};
+    std::string hex;
+    for (std::size_t i {}; i < digest.size(); ++i)
+    {
+        hex += digits[digest[i] >> 4U];
+        hex += digits[digest[i] & 0xFU];
+    }
+
+    return hex;
+}
+
+auto has_problematic_chars(const std::string& name) -> bool
+{
+    return name.find_first_of("\\\n\r") != std::string::npos;
+}
+
+// With escape set, writes backslashes, newlines and carriage returns as \\, \n and \r
+auto append_name(std::string& line, const std::string& name, bool escape) -> void
+{
+    if (!escape)
+    {
+        line += name;
+        return;
+    }
+
+    for (const auto c : name)
+    {
+        switch (c)
+        {
+            case '\\': line += "\\\\"; break;
+            case '\n': line += "\\n"; break;
+            case '\r': line += "\\r"; break;
+            default: line += c; break;
+        }
+    }
+}
+
+auto write_line(const std::string& line) -> void
+{
+    std::fwrite(line.data(), 1U, line.size(), stdout);
+}
+
+struct file_result
+{
+    boost::crypt::array<boost::crypt::uint8_t, 16> digest;
+    std::error_code ec;
+};
+
+// Hashes the named files on a pool of threads, where - is standard input, and calls done(index, result)
+// for each one in the order they were named as soon as it and every file before it are complete
+template <typename Done>
+auto hash_in_order(const std::vector<std::string>& names, Done&& done) -> void
+{
+    std::vector<file_result> results(names.size());
+    std::vector<char> ready(names.size());
+    std::size_t next {};
+
+    const auto flush = [&]() {
+        while (next < names.size() && ready[next] != 0)
+        {
+            done(next, results[next]);
+            ++next;
+        }
+    };
+
+    // Standard input can only be read once, so the second - sees an empty stream just as it would with md5sum
+    std::vector<std::string> paths;
+    std::vector<std::size_t> indices;
+    for (std::size_t i {}; i < names.size(); ++i)
+    {
+        if (names[i] == "-")
+        {
+            results[i].digest = boost::crypt::md5_pipe(STDIN_FILENO, results[i].ec);
+            ready[i] = 1;
+        }
+        else
+        {
+            paths.push_back(names[i]);
+            indices.push_back(i);
+        }
+    }
+
+    flush();
+    boost::crypt::utility::thread_pool_hash_files<boost::crypt::md5_hasher>(paths,
+        [&](std::size_t index, boost::crypt::md5_hasher& hasher, const std::error_code& ec) {
+            const auto i {indices[index]};
+            results[i].ec = ec;
+            if (!ec)
+            {
+                results[i].digest = hasher.get_digest();
+            }
+            ready[i] = 1;
+            flush();
+        }, 0U, BOOST_CRYPT_FILE_BUFFER_SIZE);
+    flush();
+}
+
+auto print_checksums(const std::vector<std::string>& names, const options& opts) -> bool
+{
+    bool ok {true};
+    const char delimiter {opts.zero ? '\0' : '\n'};
+
+    hash_in_order(names, [&](std::size_t index, const file_result& result) {
+        const auto& name {names[index]};
+        if (result.ec)
+        {
+            report(quote(name) + ": " + result.ec.message());
+            ok = false;
+            return;
+        }
+
+        const bool escape {!opts.zero && has_problematic_chars(name)};
+        std::string line;
+        if (escape)
+        {
+            line += '\\';
+        }
+
+        if (opts.tag)
+        {
+            line += "MD5 (";
+            append_name(line, name, escape);
+            line += ") = ";
+            line += to_hex(result.digest);
+        }
+        else
+        {
+            line += to_hex(result.digest);
+            line += ' ';
+            line += opts.binary == 1 ? '*' : ' ';
+            append_name(line, name, escape);
+        }
+
+        line += delimiter;
+        write_line(line);
+    });
+
+    return ok;
+}
+
+// Undoes append_name, returning false for a trailing backslash or one not followed by \, n, or r
+auto unescape(std::string& name) -> bool
+{
+    std::string result;
+    for (std::size_t i {}; i < name.size(); ++i)
+    {
+        if (name[i] == '\0')
+        {
+            return false;
+        }
+        if (name[i] != '\\')
+        {
+            result += name[i];
+            continue;
+        }
+
+        if (++i == name.size())
+        {
+            return false;
+        }
+
+        switch (name[i])
+        {
+            case 'n': result += '\n'; break;
+            case 'r': result += '\r'; break;
+            case '\\': result += '\\'; break;
+            default: return false;
+        }
+    }
+
+    name = std::move(result);
+    return true;
+}
+
+auto is_white(char c) -> bool
+{
+    return c == ' ' || c == '\t';
+}
+
+auto hex_digits(const std::string& s, std::size_t pos) -> bool
+{
+    if (s.size() - pos != 32U)
+    {
+        return false;
+    }
+
+    for (auto i {pos}; i < s.size(); ++i)
+    {
+        if (std::isxdigit(static_cast<unsigned char>(s[i])) == 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+struct check_entry
+{
+    std::size_t line_number;
+
+    // Empty for an improperly formatted line
+    std::string hex;
+    std::string name;
+};
+
+// Parses the checksum lines of one or more files, accepting exactly the lines that md5sum does
+class checksum_parser
+{
+private:
+    // Whether lines are "digest name" rather than "digest  name" is decided by the first line, and then sticks,
+    // so that names starting with a space or * are not misread
+    int bsd_reversed_ {-1};
+
+    auto parse_bsd(const std::string& line, std::size_t i, bool escaped, check_entry& entry) -> bool
+    {
+        const auto close {line.rfind(')')};
+        if (close == std::string::npos || close < i)
+        {
+            return false;
+        }
+
+        entry.name = line.substr(i, close - i);
+        if (escaped && !unescape(entry.name))
+        {
+            return false;
+        }
+
+        auto pos {close + 1U};
+        while (pos < line.size() && is_white(line[pos]))
+        {
+            ++pos;
+        }
+        if (pos == line.size() || line[pos] != '=')
+        {
+            return false;
+        }
+        ++pos;
+        while (pos < line.size() && is_white(line[pos]))
+        {
+            ++pos;
+        }
+
+        if (!hex_digits(line, pos))
+        {
+            return false;
+        }
+        entry.hex = line.substr(pos);
+        return true;
+    }
+
+public:
+    auto parse(const std::string& line, check_entry& entry) -> bool
+    {
+        std::size_t i {};
+        while (i < line.size() && is_white(line[i]))
+        {
+            ++i;
+        }
+
+        bool escaped {};
+        if (i < line.size() && line[i] == '\\')
+        {
+            ++i;
+            escaped = true;
+        }
+
+        if (line.compare(i, 3U, "MD5") == 0)
+        {
+            i += 3U;
+            if (i < line.size() && line[i] == ' ')
+            {
+                ++i;
+            }
+            if (i < line.size() && line[i] == '(')
+            {
+                return parse_bsd(line, i + 1U, escaped, entry);
+            }
+            return false;
+        }
+
+        // The digest, a blank, and at least one character of the name
+        if (line.size() - i < 34U + (i < line.size() && line[i] == '\\' ? 1U : 0U))
+        {
+            return false;
+        }
+
+        const auto digest {i};
+        i += 32U;
+        if (!is_white(line[i]))
+        {
+            return false;
+        }
+        ++i;
+
+        for (auto j {digest}; j < digest + 32U; ++j)
+        {
+            if (std::isxdigit(static_cast<unsigned char>(line[j])) == 0)
+            {
+                return false;
+            }
+        }
+
+        if (line.size() - i == 1U || (line[i] != ' ' && line[i] != '*'))
+        {
+            if (bsd_reversed_ == 0)
+            {
+                return false;
+            }
+            bsd_reversed_ = 1;
+        }
+        else if (bsd_reversed_ != 1)
+        {
+            bsd_reversed_ = 0;
+            ++i;
+        }
+
+        entry.hex = line.substr(digest, 32U);
+        entry.name = line.substr(i);
+        return !escaped || unescape(entry.name);
+    }
+};
+
+struct check_totals
+{
+    bool properly_formatted {};
+    bool matched {};
+    std::size_t improperly_formatted {};
+    std::size_t unreadable {};
+    std::size_t mismatched {};
+};
+
+// Hashes the files named by a batch of lines in parallel, and reports on each line in order
+auto check_batch(const std::vector<check_entry>& entries, const std::string& checkfile, const options& opts, check_totals& totals) -> void
+{
+    std::vector<std::string> names;
+    std::vector<std::size_t> entry_of_name;
+    for (std::size_t i {}; i < entries.size(); ++i)
+    {
+        if (!entries[i].hex.empty())
+        {
+            names.push_back(entries[i].name);
+            entry_of_name.push_back(i);
+        }
+    }
+
+    std::size_t next_entry {};
+    const auto report_misformatted = [&](std::size_t end) {
+        for (; next_entry < end; ++next_entry)
+        {
+            if (opts.warn)
+            {
+                report(quote(checkfile) + ": " + std::to_string(entries[next_entry].line_number) +
+                       ": improperly formatted MD5 checksum line");
+            }
+        }
+    };
+
+    hash_in_order(names, [&](std::size_t index, const file_result& result) {
+        report_misformatted(entry_of_name[index]);
+        ++next_entry;
+
+        const auto& entry {entries[entry_of_name[index]]};
+        const bool escape {!opts.status && entry.name.find('\n') != std::string::npos};
+        std::string line;
+        if (escape)
+        {
+            line += '\\';
+        }
+        append_name(line, entry.name, escape);
+
+        if (result.ec)
+        {
+            if (opts.ignore_missing && result.ec == std::errc::no_such_file_or_directory)
+            {
+                return;
+            }
+
+            report(quote(entry.name) + ": " + result.ec.message());
+            ++totals.unreadable;
+            if (!opts.status)
+            {
+                write_line(line + ": FAILED open or read\n");
+            }
+            return;
+        }
+
+        const auto hex {to_hex(result.digest)};
+        bool match {true};
+        for (std::size_t i {}; i < hex.size(); ++i)
+        {
+            match = match && std::tolower(static_cast<unsigned char>(entry.hex[i])) == hex[i];
+        }
+
+        if (match)
+        {
+            totals.matched = true;
+        }
+        else
+        {
+            ++totals.mismatched;
+        }
+
+        if (!opts.status && (!match || !opts.quiet))
+        {
+            write_line(line + (match ? ": OK\n" : ": FAILED\n"));
+        }
+    });
+
+    report_misformatted(entries.size());
+}
+
+auto plural(std::size_t count, const char* one, const char* many) -> std::string
+{
+    return "WARNING: " + std::to_string(count) + (count == 1U ? one : many);
+}
+
+auto check_file(const std::string& filename, checksum_parser& parser, const options& opts) -> bool
+{
+    const bool is_stdin {filename == "-"};
+    const std::string checkfile {is_stdin ? "standard input" : filename};
+
+    std::FILE* stream {is_stdin ? stdin : std::fopen(filename.c_str(), "r")};
+    if (stream == nullptr)
+    {
+        report(quote(checkfile) + ": " + std::error_code(errno, std::system_category()).message());
+        return false;
+    }
+
+    check_totals totals;
+    std::vector<check_entry> entries;
+    char* buffer {nullptr};
+    std::size_t capacity {};
+    std::size_t line_number {};
+    bool read_error {};
+
+    while (true)
+    {
+        const auto res {::getline(&buffer, &capacity, stream)};
+        if (res < 0)
+        {
+            read_error = std::ferror(stream) != 0;
+            break;
+        }
+
+        ++line_number;
+        std::string line(buffer, static_cast<std::size_t>(res));
+        if (line[0] == '#')
+        {
+            continue;
+        }
+
+        if (line.back() == '\n')
+        {
+            line.pop_back();
+        }
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        if (line.empty())
+        {
+            continue;
+        }
+
+        check_entry entry {line_number, {}, {}};
+        if (!parser.parse(line, entry) || (is_stdin && entry.name == "-"))
+        {
+            entry.hex.clear();
+            ++totals.improperly_formatted;
+        }
+        else
+        {
+            totals.properly_formatted = true;
+        }
+        entries.push_back(std::move(entry));
+
+        if (entries.size() == check_batch_size)
+        {
+            check_batch(entries, checkfile, opts, totals);
+            entries.clear();
+        }
+    }
+
+    check_batch(entries, checkfile, opts, totals);
+    std::free(buffer);
+
+    if (!is_stdin)
+    {
+        std::fclose(stream);
+    }
+
+    if (read_error)
+    {
+        report(quote(checkfile) + ": read error");
+        return false;
+    }
+
+    if (!totals.properly_formatted)
+    {
+        report(quote(checkfile) + ": no properly formatted checksum lines found");
+    }
+    else if (!opts.status)
+    {
+        if (totals.improperly_formatted != 0U)
+        {
+            report(plural(totals.improperly_formatted, " line is improperly formatted", " lines are improperly formatted"));
+        }
+        if (totals.unreadable != 0U)
+        {
+            report(plural(totals.unreadable, " listed file could not be read", " listed files could not be read"));
+        }
+        if (totals.mismatched != 0U)
+        {
+            report(plural(totals.mismatched, " computed checksum did NOT match", " computed checksums did NOT match"));
+        }
+        if (opts.ignore_missing && !totals.matched)
+        {
+            report(quote(checkfile) + ": no file was verified");
+        }
+    }
+
+    return totals.properly_formatted && totals.matched && totals.mismatched == 0U && totals.unreadable == 0U &&
+           (!opts.strict || totals.improperly_formatted == 0U);
+}
+
+enum class long_option
+{
+    binary,
+    check,
+    ignore_missing,
+    quiet,
+    status,
+    strict,
+    tag,
+    text,
+    warn,
+    zero,
+    help,
+    version
+};
+
+struct long_option_name
+{
+    const char* name;
+    long_option option;
+};
+
+constexpr long_option_name long_options[] {
+    {"binary", long_option::binary},
+    {"check", long_option::check},
+    {"ignore-missing", long_option::ignore_missing},
+    {"quiet", long_option::quiet},
+    {"status", long_option::status},
+    {"strict", long_option::strict},
+    {"tag", long_option::tag},
+    {"text", long_option::text},
+    {"warn", long_option::warn},
+    {"zero", long_option::zero},
+    {"help", long_option::help},
+    {"version", long_option::version}
+};
+
+// Applies an option, returning -1 to carry on or the exit status for --help and --version
+auto apply(long_option option, options& opts) -> int
+{
+    switch (option)
+    {
+        case long_option::binary: opts.binary = 1; break;
+        case long_option::check: opts.check = true; break;
+        case long_option::ignore_missing: opts.ignore_missing = true; break;
+        case long_option::tag: opts.tag = true; opts.binary = 1; break;
+        case long_option::text: opts.binary = 0; break;
+        case long_option::zero: opts.zero = true; break;
+        case long_option::strict: opts.strict = true; break;
+
+        // The last of these wins
+        case long_option::quiet: opts.quiet = true; opts.status = false; opts.warn = false; break;
+        case long_option::status: opts.status = true; opts.quiet = false; opts.warn = false; break;
+        case long_option::warn: opts.warn = true; opts.status = false; opts.quiet = false; break;
+
+        case long_option::help: return print_help();
+        case long_option::version: return print_version();
+    }
+
+    return -1;
+}
+
+// Parses the arguments the way getopt_long does, allowing options after file names and unambiguous abbreviations
+// of long options. Returns -1 to carry on, or the exit status
+auto parse_arguments(int argc, char** argv, options& opts, std::vector<std::string>& files) -> int
+{
+    for (int i {1}; i < argc; ++i)
+    {
+        const std::string arg {argv[i]};
+        if (arg == "--")
+        {
+            for (++i; i < argc; ++i)
+            {
+                files.emplace_back(argv[i]);
+            }
+            break;
+        }
+
+        if (arg.size() < 2U || arg[0] != '-')
+        {
+            files.push_back(arg);
+            continue;
+        }
+
+        if (arg[1] == '-')
+        {
+            const auto equals {arg.find('=')};
+            const auto name {arg.substr(2U, equals == std::string::npos ? std::string::npos : equals - 2U)};
+
+            std::vector<const long_option_name*> matches;
+            for (const auto& candidate : long_options)
+            {
+                if (name == candidate.name)
+                {
+                    matches.assign(1U, &candidate);
+                    break;
+                }
+                if (std::strncmp(candidate.name, name.c_str(), name.size()) == 0)
+                {
+                    matches.push_back(&candidate);
+                }
+            }
+
+            if (matches.empty())
+            {
+                return usage_error("unrecognized option '" + arg + "'");
+            }
+            if (matches.size() > 1U)
+            {
+                std::string message {"option '--" + name + "' is ambiguous; possibilities:"};
+                for (const auto* match : matches)
+                {
+                    message += std::string{" '--"} + match->name + "'";
+                }
+                return usage_error(message);
+            }
+            if (equals != std::string::npos)
+            {
+                return usage_error(std::string{"option '--"} + matches[0]->name + "' doesn't allow an argument");
+            }
+
+            const auto status {apply(matches[0]->option, opts)};
+            if (status >= 0)
+            {
+                return status;
+            }
+            continue;
+        }
+
+        for (std::size_t j {1U}; j < arg.size(); ++j)
+        {
+            long_option option {};
+            switch (arg[j])
+            {
+                case 'b': option = long_option::binary; break;
+                case 'c': option = long_option::check; break;
+                case 't': option = long_option::text; break;
+                case 'w': option = long_option::warn; break;
+                case 'z': option = long_option::zero; break;
+                default: return usage_error(std::string{"invalid option -- '"} + arg[j] + "'");
+            }
+
+            static_cast<void>(apply(option, opts));
+        }
+    }
+
+    // Same checks in the same order as md5sum, so the same mistake gives the same message
+    if (opts.zero && opts.check)
+    {
+        return usage_error("the --zero option is not supported when verifying checksums");
+    }
+    if (opts.tag && opts.check)
+    {
+        return usage_error("the --tag option is meaningless when verifying checksums");
+    }
+    if (opts.tag && opts.binary == 0)
+    {
+        return usage_error("--tag does not support --text mode");
+    }
+    if (opts.binary >= 0 && opts.check)
+    {
+        return usage_error("the --binary and --text options are meaningless when verifying checksums");
+    }
+
+    if (opts.ignore_missing && !opts.check)
+    {
+        return usage_error("the --ignore-missing option is meaningful only when verifying checksums");
+    }
+    if (opts.status && !opts.check)
+    {
+        return usage_error("the --status option is meaningful only when verifying checksums");
+    }
+    if (opts.warn && !opts.check)
+    {
+        return usage_error("the --warn option is meaningful only when verifying checksums");
+    }
+    if (opts.quiet && !opts.check)
+    {
+        return usage_error("the --quiet option is meaningful only when verifying checksums");
+    }
+    if (opts.strict && !opts.check)
+    {
+        return usage_error("the --strict option is meaningful only when verifying checksums");
+    }
+
+    return -1;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc > 0)
+    {
+        program_name = argv[0];
+    }
+
+    try
+    {
+        options opts;
+        std::vector<std::string> files;
+        const auto status {parse_arguments(argc, argv, opts, files)};
+        if (status >= 0)
+        {
+            return status;
+        }
+
+        if (files.empty())
+        {
+            files.emplace_back("-");
+        }
+
+        bool ok {true};
+        if (opts.check)
+        {
+            checksum_parser parser;
+            for (const auto& file : files)
+            {
+                ok = check_file(file, parser, opts) && ok;
+            }
+        }
+        else
+        {
+            ok = print_checksums(files, opts);
+        }
+
+        if (std::fflush(stdout) != 0 || std::ferror(stdout) != 0)
+        {
+            report("write error: " + std::error_code(errno, std::system_category()).message());
+            return EXIT_FAILURE;
+        }
+
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    catch (const std::exception& e)
+    {
+        report(e.what());
+        return EXIT_FAILURE;
+    }
+}
+
+#else
+
+#include <cstdio>
+#include <cstdlib>
+
+int main()
+{
+    std::fputs("md5sum: not supported on this platform\n", stderr);
+    return EXIT_FAILURE;
+}
+
+#endif // BOOST_CRYPT_HAS_POSIX_FILE_IO